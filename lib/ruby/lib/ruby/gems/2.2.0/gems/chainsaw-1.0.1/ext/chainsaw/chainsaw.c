@@ -1,13 +1,60 @@
 #include "chainsaw.h"
 #include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>
+#include <math.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #define EOL '\n'
 #define STRING 0
 #define LONG 1
 #define DOUBLE 2
 #define LINE_BUF_SIZE 500
+#define BLOCK_BUF_SIZE (128 * 1024)
+#define LATENCY_BUF_SIZE 4096
 #define RB_ARY_INIT_SIZE 8
 
+/*
+ * Returns the first occurrence of c in [p, end), or NULL. Lines are short
+ * and fields shorter, so this is inlined rather than calling memchr. With
+ * SSE2 (always there on x86_64) or AVX2 (when built with -mavx2 or
+ * -march=native) it compares 16 or 32 bytes at a time.
+ */
+static inline char *
+chainsaw_find(char *p, char *end, char c)
+{
+#if defined(__AVX2__)
+    __m256i needle = _mm256_set1_epi8(c);
+    while (end - p >= 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *) p);
+        unsigned int mask = (unsigned int) _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle));
+        if (mask)
+            return p + __builtin_ctz(mask);
+        p += 32;
+    }
+#elif defined(__SSE2__)
+    __m128i needle = _mm_set1_epi8(c);
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *) p);
+        unsigned int mask = (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+        if (mask)
+            return p + __builtin_ctz(mask);
+        p += 16;
+    }
+#endif
+    while (p < end) {
+        if (*p == c)
+            return p;
+        ++p;
+    }
+    return NULL;
+}
+
 static long
 chainsaw_naive_str_to_long(const char *p)
 {
@@ -77,6 +124,33 @@ chainsaw_transform_value(const char* ptr, long len, int idx, Chainsaw *chainsaw)
     return rb_str_new(ptr, len);
 }
 
+static Columns *
+chainsaw_columns_new(VALUE rb_columns)
+{
+    Columns *columns;
+    long count = RARRAY_LEN(rb_columns);
+    long max = -1;
+
+    for (long i = 0; i < count; i++) {
+        long column = NUM2LONG(rb_ary_entry(rb_columns, i));
+        if (column < 0)
+            rb_raise(rb_eArgError, "column index can't be negative");
+        if (column > max)
+            max = column;
+    }
+
+    columns = ALLOC(Columns);
+    columns->count = count;
+    columns->max = max;
+    columns->slots = ALLOC_N(int, max + 1);
+    for (long i = 0; i <= max; i++)
+        columns->slots[i] = -1;
+    for (long i = 0; i < count; i++)
+        columns->slots[NUM2LONG(rb_ary_entry(rb_columns, i))] = (int) i;
+
+    return columns;
+}
+
 static VALUE
 chainsaw_initialize(int argc, VALUE* argv, VALUE self)
 {
@@ -85,12 +159,12 @@ chainsaw_initialize(int argc, VALUE* argv, VALUE self)
     size_t line_size;
     char *line;
     Chainsaw *chainsaw;
-    VALUE rb_delimeter, rb_transformation_indexes;
+    VALUE rb_delimeter, rb_transformation_indexes, rb_columns;
     Transformations *transformations;
 
     Data_Get_Struct(self, Chainsaw, chainsaw);
     
-    rb_scan_args(argc, argv, "02", &rb_delimeter, &rb_transformation_indexes);
+    rb_scan_args(argc, argv, "03", &rb_delimeter, &rb_transformation_indexes, &rb_columns);
     
     if (NIL_P(rb_transformation_indexes))
         rb_transformation_indexes = rb_ary_new();
@@ -112,9 +186,12 @@ chainsaw_initialize(int argc, VALUE* argv, VALUE self)
     line = malloc(line_size * sizeof(char));
 
     chainsaw->transformations = transformations;
+    chainsaw->columns = NIL_P(rb_columns) ? NULL : chainsaw_columns_new(rb_columns);
     chainsaw->delimeter = DELIM;
     chainsaw->line_size = line_size;
     chainsaw->line = line;
+    chainsaw->block_size = 0;
+    chainsaw->block = NULL;
 
     return self;
 }
@@ -130,7 +207,12 @@ chainsaw_free(void *ptr)
     c = (Chainsaw*)ptr;
     xfree(c->transformations->indexes);
     xfree(c->transformations);
+    if (c->columns) {
+        xfree(c->columns->slots);
+        xfree(c->columns);
+    }
     xfree(c->line);
+    xfree(c->block);
     xfree(ptr);
 }
 
@@ -142,64 +224,83 @@ chainsaw_allocate(VALUE klass)
     return res;
 }
 
-VALUE
-chainsaw_split(Chainsaw *chainsaw, char *line)
+/*
+ * Finds the next delimiter in [p, eol) that isn't escaped by an odd number
+ * of backslashes, counting back as far as the start of the line.
+ */
+static inline char *
+chainsaw_next_delimeter(Chainsaw *chainsaw, char *line, char *p, char *eol)
 {
-    char *token, *start, *nobackslash, *t2;
-    int idx = 0;
-    int count = 0;
-    
-    VALUE ary;
-    
-    if ((token = strchr(line, EOL))) {
-        *token = '\0';
-    }
-    
-    ary = rb_ary_new2(RB_ARY_INIT_SIZE); // magic number
-    start = line;
-    nobackslash = line;
-    
-    while (token = strchr(nobackslash, chainsaw->delimeter)) {
+    char *token, *t2;
+    int count;
+
+    while ((token = chainsaw_find(p, eol, chainsaw->delimeter))) {
         count = 0;
         t2 = token - 1;
-
         while ((t2 >= line) && (*t2 == '\\')) {
             ++count;
             --t2;
         }
-        if(count % 2 == 1) {
-            nobackslash = token + 1;
-            continue;
-        }
-        break;
+        if (count % 2 == 0)
+            break;
+        p = token + 1;
     }
-    idx = 0;
-    
-    while (token != NULL) {
-        rb_ary_store(ary, idx, chainsaw_transform_value(start, token - start, idx, chainsaw));
-        idx++;
+    return token;
+}
 
-        nobackslash = start = token + 1;
+/*
+ * Cuts the line in [line, eol), *eol being a NUL. With columns selected,
+ * only those are converted to Ruby objects, in the order they were given,
+ * and the rest of the line after the last of them isn't scanned at all.
+ */
+static VALUE
+chainsaw_split_line(Chainsaw *chainsaw, char *line, char *eol)
+{
+    Columns *columns = chainsaw->columns;
+    char *token, *start;
+    long idx = 0;
+    VALUE ary;
 
-        while ((token = strchr(nobackslash, chainsaw->delimeter))) {
-            count = 0;
-            t2 = token - 1;
-            while ((t2 >= line) && (*t2 == '\\')) {
-                ++count;
-                --t2;
-            }
-            if (count % 2 == 1) {
-                nobackslash = token + 1;
-                continue;
-            }
+    ary = rb_ary_new2(columns ? columns->count : RB_ARY_INIT_SIZE);
+    start = line;
+
+    for (;;) {
+        if (columns && idx > columns->max)
             break;
-        }
+
+        token = chainsaw_next_delimeter(chainsaw, line, start, eol);
+        if (token == NULL)
+            token = eol;
+
+        if (!columns)
+            rb_ary_store(ary, idx, chainsaw_transform_value(start, token - start, idx, chainsaw));
+        else if (columns->slots[idx] >= 0)
+            rb_ary_store(ary, columns->slots[idx], chainsaw_transform_value(start, token - start, idx, chainsaw));
+
+        if (token == eol)
+            break;
+
+        idx++;
+        start = token + 1;
     }
-    
-    rb_ary_store(ary, idx, chainsaw_transform_value(start, strlen(start), idx, chainsaw));
+
     return ary;
 }
 
+VALUE
+chainsaw_split(Chainsaw *chainsaw, char *line)
+{
+    char *eol;
+
+    if ((eol = strchr(line, EOL))) {
+        *eol = '\0';
+    } else {
+        eol = line + strlen(line);
+    }
+
+    return chainsaw_split_line(chainsaw, line, eol);
+}
+
 /* https://github.com/evan/ccsv/blob/master/ext/ccsv.c */
 VALUE
 chainsaw_cut(VALUE self, VALUE input)
@@ -262,6 +363,371 @@ chainsaw_cut(VALUE self, VALUE input)
     return Qfalse;
 }
 
+typedef struct scan_state {
+    Chainsaw *chainsaw;
+    VALUE input;
+    int fd;
+    off_t pos;
+    bool lines_processed;
+    void (*cut_line)(struct scan_state *state, char *line, char *eol);
+    void *data;
+} ScanState;
+
+static VALUE
+chainsaw_scan_blocks(VALUE arg)
+{
+    ScanState *state = (ScanState *) arg;
+    Chainsaw *chainsaw = state->chainsaw;
+    size_t filled = 0;
+    ssize_t chars_read;
+    char *p, *end, *eol;
+
+    for (;;) {
+        // a line longer than the buffer, make room for the rest of it
+        if (filled == chainsaw->block_size) {
+            chainsaw->block_size = chainsaw->block_size ? chainsaw->block_size * 2 : BLOCK_BUF_SIZE;
+            REALLOC_N(chainsaw->block, char, chainsaw->block_size);
+        }
+
+        chars_read = pread(state->fd, chainsaw->block + filled, chainsaw->block_size - filled, state->pos + filled);
+        if (chars_read < 0) {
+            if (errno == EINTR)
+                continue;
+            rb_sys_fail("pread");
+        }
+        if (chars_read == 0)
+            break;
+        filled += chars_read;
+
+        p = chainsaw->block;
+        end = chainsaw->block + filled;
+        while ((eol = chainsaw_find(p, end, EOL))) {
+            *eol = '\0';
+
+            // counted before yielding, like the line getline() has returned
+            state->pos += eol + 1 - p;
+            state->lines_processed = true;
+
+            state->cut_line(state, p, eol);
+            p = eol + 1;
+        }
+
+        filled = end - p;
+        memmove(chainsaw->block, p, filled);
+    }
+
+    return Qnil;
+}
+
+static VALUE
+chainsaw_scan_done(VALUE arg)
+{
+    ScanState *state = (ScanState *) arg;
+
+    rb_funcall(state->input, rb_intern("pos="), 1, OFFT2NUM(state->pos));
+    return Qnil;
+}
+
+/*
+ * Runs state->cut_line over every complete line from the IO's current
+ * position on, then leaves pos after the last of them, also when the
+ * block raises or breaks.
+ */
+static bool
+chainsaw_scan_io(VALUE input, ScanState *state)
+{
+    rb_io_t *fptr;
+
+    switch (TYPE(input)) {
+        case T_FILE:
+            break;
+        default:
+            rb_raise(rb_eTypeError, "not valid value");
+            break;
+    }
+
+    if(!rb_block_given_p()) {
+        rb_raise(rb_eArgError, "block is required");
+    }
+
+    GetOpenFile(input, fptr);
+    rb_io_check_readable(fptr);
+
+    // pos accounts for anything Ruby has buffered, so start from there
+    state->input = input;
+    state->fd = fptr->fd;
+    state->pos = NUM2OFFT(rb_funcall(input, rb_intern("pos"), 0));
+    state->lines_processed = false;
+
+    rb_ensure(chainsaw_scan_blocks, (VALUE) state, chainsaw_scan_done, (VALUE) state);
+
+    return state->lines_processed;
+}
+
+static void
+chainsaw_scan_line(ScanState *state, char *line, char *eol)
+{
+    rb_yield(chainsaw_split_line(state->chainsaw, line, eol));
+}
+
+/*
+ * Like cut, but reads the file a block at a time from the IO's current
+ * position and only ever yields complete lines: an unterminated last line
+ * is left for the next call, and pos is set to its start. That suits
+ * following a log that's being written to.
+ */
+VALUE
+chainsaw_scan(VALUE self, VALUE input)
+{
+    ScanState state;
+
+    Data_Get_Struct(self, Chainsaw, state.chainsaw);
+    state.cut_line = chainsaw_scan_line;
+    state.data = NULL;
+
+    if (chainsaw_scan_io(input, &state) == true)
+        return Qtrue;
+
+    return Qfalse;
+}
+
+static void
+timeslots_mark(void *ptr)
+{
+    Timeslots *t;
+
+    if (0 == ptr) {
+        return;
+    }
+    t = (Timeslots*)ptr;
+    rb_gc_mark(t->rb_chainsaw);
+}
+
+static void
+timeslots_free(void *ptr)
+{
+    Timeslots *t;
+
+    if (0 == ptr) {
+        return;
+    }
+    t = (Timeslots*)ptr;
+    xfree(t->latencies);
+    xfree(ptr);
+}
+
+VALUE
+timeslots_allocate(VALUE klass)
+{
+    Timeslots *timeslots;
+    VALUE res = Data_Make_Struct(klass, Timeslots, timeslots_mark, timeslots_free, timeslots);
+    timeslots->rb_chainsaw = Qnil;
+    return res;
+}
+
+static VALUE
+timeslots_initialize(VALUE self, VALUE rb_delimeter, VALUE rb_interval, VALUE rb_columns, VALUE rb_usec, VALUE rb_arrival)
+{
+    Timeslots *timeslots;
+    long interval;
+
+    Data_Get_Struct(self, Timeslots, timeslots);
+
+    interval = NUM2LONG(rb_interval);
+    if (interval <= 0)
+        rb_raise(rb_eArgError, "interval has to be positive");
+
+    Check_Type(rb_columns, T_ARRAY);
+    if (RARRAY_LEN(rb_columns) != 3)
+        rb_raise(rb_eArgError, "columns have to be epoch, status and latency");
+
+    // an untransformed Chainsaw, only used for its delimiter and block buffer
+    timeslots->rb_chainsaw = rb_class_new_instance(1, &rb_delimeter, rb_cChainsaw);
+    timeslots->interval = interval;
+    timeslots->epoch_column = NUM2LONG(rb_ary_entry(rb_columns, 0));
+    timeslots->status_column = NUM2LONG(rb_ary_entry(rb_columns, 1));
+    timeslots->latency_column = NUM2LONG(rb_ary_entry(rb_columns, 2));
+    timeslots->usec = RTEST(rb_usec);
+    timeslots->arrival = RTEST(rb_arrival);
+
+    timeslots->last_column = timeslots->epoch_column;
+    if (timeslots->status_column > timeslots->last_column)
+        timeslots->last_column = timeslots->status_column;
+    if (timeslots->latency_column > timeslots->last_column)
+        timeslots->last_column = timeslots->latency_column;
+    if (timeslots->epoch_column < 0 || timeslots->status_column < 0 || timeslots->latency_column < 0)
+        rb_raise(rb_eArgError, "column index can't be negative");
+
+    timeslots->current = 0;
+    timeslots->count = 0;
+    timeslots->latencies_size = 0;
+    timeslots->latencies = NULL;
+    memset(timeslots->statuses, 0, sizeof(timeslots->statuses));
+    timeslots->skipped = 0;
+
+    return self;
+}
+
+static void
+timeslots_record(Timeslots *timeslots, long status, double latency)
+{
+    if (timeslots->count == timeslots->latencies_size) {
+        timeslots->latencies_size = timeslots->latencies_size ? timeslots->latencies_size * 2 : LATENCY_BUF_SIZE;
+        REALLOC_N(timeslots->latencies, double, timeslots->latencies_size);
+    }
+    timeslots->latencies[timeslots->count++] = latency;
+    timeslots->statuses[status]++;
+}
+
+/*
+ * A status is one to three digits filling its whole field, anything else
+ * ("-", "5xx", a stray space) gives -1 so the line can be skipped.
+ */
+static long
+timeslots_status(Chainsaw *chainsaw, const char *p)
+{
+    long status = 0;
+    int digits = 0;
+
+    while (*p >= '0' && *p <= '9') {
+        if (++digits > 3)
+            return -1;
+        status = (status*10) + (*p - '0');
+        ++p;
+    }
+    if (digits == 0 || (*p != chainsaw->delimeter && *p != '\0'))
+        return -1;
+    return status;
+}
+
+/*
+ * Closes the current timeslot and opens the next one with the line that
+ * closed it, before yielding, so breaking out of the block loses nothing.
+ */
+static void
+timeslots_yield(Timeslots *timeslots, long timeslot, long status, double latency)
+{
+    VALUE rb_timeslot = LONG2NUM(timeslots->current);
+    VALUE latencies = rb_ary_new2(timeslots->count);
+    VALUE statuses = rb_hash_new();
+
+    for (long i = 0; i < timeslots->count; i++)
+        rb_ary_push(latencies, DBL2NUM(timeslots->latencies[i]));
+    for (long i = 0; i < STATUS_CODES; i++) {
+        if (timeslots->statuses[i])
+            rb_hash_aset(statuses, LONG2NUM(i), LONG2NUM(timeslots->statuses[i]));
+    }
+
+    timeslots->count = 0;
+    memset(timeslots->statuses, 0, sizeof(timeslots->statuses));
+    timeslots->current = timeslot;
+    timeslots_record(timeslots, status, latency);
+
+    rb_yield_values(3, rb_timeslot, latencies, statuses);
+}
+
+/*
+ * Same arithmetic as the appstat plugin did per line in Ruby: latency in
+ * seconds rounded to milliseconds, the epoch truncated and optionally moved
+ * to completion time, and the slot named after the end of its interval.
+ */
+static void
+timeslots_cut_line(ScanState *state, char *line, char *eol)
+{
+    Timeslots *timeslots = (Timeslots*) state->data;
+    Chainsaw *chainsaw = state->chainsaw;
+    char *start = line, *token;
+    char *fields[3] = {NULL, NULL, NULL};
+    long idx = 0;
+    long epoch, status, timeslot;
+    double latency, at;
+
+    for (;;) {
+        if (idx == timeslots->epoch_column)
+            fields[0] = start;
+        if (idx == timeslots->status_column)
+            fields[1] = start;
+        if (idx == timeslots->latency_column)
+            fields[2] = start;
+        if (idx == timeslots->last_column)
+            break;
+
+        token = chainsaw_next_delimeter(chainsaw, line, start, eol);
+        if (token == NULL)
+            break;
+
+        idx++;
+        start = token + 1;
+    }
+
+    if (idx < timeslots->last_column) {
+        timeslots->skipped++;
+        return;
+    }
+
+    // lines without a status are skipped whole, latency included
+    status = timeslots_status(chainsaw, fields[1]);
+    if (status < 0) {
+        timeslots->skipped++;
+        return;
+    }
+
+    epoch = chainsaw_naive_str_to_long(fields[0]);
+    latency = chainsaw_naive_str_to_float(fields[2]);
+
+    if (timeslots->usec)
+        latency = round(latency / 1000.0) / 1000.0;
+
+    at = timeslots->arrival ? epoch + latency : epoch;
+    timeslot = (long) floor(at / timeslots->interval) * timeslots->interval + timeslots->interval;
+
+    // timestamps aren't monotonic, late lines count towards the open slot
+    if (timeslot > timeslots->current) {
+        if (timeslots->count > 0) {
+            timeslots_yield(timeslots, timeslot, status, latency);
+            return;
+        }
+        timeslots->current = timeslot;
+    }
+
+    timeslots_record(timeslots, status, latency);
+}
+
+/*
+ * Cuts complete lines like Chainsaw#scan, but instead of yielding them
+ * collects them into timeslots and only yields each finished one, with
+ * its latencies and a status => count Hash. The slot still being filled
+ * is kept for the next call.
+ */
+VALUE
+timeslots_feed(VALUE self, VALUE input)
+{
+    ScanState state;
+    Timeslots *timeslots;
+
+    Data_Get_Struct(self, Timeslots, timeslots);
+    if (NIL_P(timeslots->rb_chainsaw))
+        rb_raise(rb_eRuntimeError, "timeslots not initialized");
+
+    Data_Get_Struct(timeslots->rb_chainsaw, Chainsaw, state.chainsaw);
+    state.cut_line = timeslots_cut_line;
+    state.data = timeslots;
+
+    if (chainsaw_scan_io(input, &state) == true)
+        return Qtrue;
+
+    return Qfalse;
+}
+
+VALUE
+timeslots_skipped(VALUE self)
+{
+    Timeslots *timeslots;
+
+    Data_Get_Struct(self, Timeslots, timeslots);
+    return LONG2NUM(timeslots->skipped);
+}
+
 void
 Init_chainsaw(void)
 {
@@ -271,4 +737,12 @@ Init_chainsaw(void)
     rb_define_alloc_func(rb_cChainsaw, chainsaw_allocate);
     rb_define_method(rb_cChainsaw, "initialize", chainsaw_initialize, -1);
     rb_define_method(rb_cChainsaw, "cut", chainsaw_cut, 1);
+    rb_define_method(rb_cChainsaw, "scan", chainsaw_scan, 1);
+
+    rb_cTimeslots = rb_define_class_under(rb_mChainsaw, "Timeslots", rb_cObject);
+
+    rb_define_alloc_func(rb_cTimeslots, timeslots_allocate);
+    rb_define_method(rb_cTimeslots, "initialize", timeslots_initialize, 5);
+    rb_define_method(rb_cTimeslots, "feed", timeslots_feed, 1);
+    rb_define_method(rb_cTimeslots, "skipped", timeslots_skipped, 0);
 }
@@ -6,6 +6,7 @@
 
 VALUE rb_mChainsaw;
 VALUE rb_cChainsaw;
+VALUE rb_cTimeslots;
 VALUE cut(VALUE self, VALUE str);
 
 typedef struct transformations {
@@ -13,11 +14,39 @@ typedef struct transformations {
 	int *indexes;
 } Transformations;
 
+typedef struct columns {
+	long count;
+	long max;
+	int *slots;
+} Columns;
+
 typedef struct chainsaw {
 	Transformations *transformations;
+    Columns *columns;
     char delimeter;
     char *line;
     size_t line_size;
+    char *block;
+    size_t block_size;
 } Chainsaw;
 
+#define STATUS_CODES 1000
+
+typedef struct timeslots {
+    VALUE rb_chainsaw;
+    long interval;
+    long epoch_column;
+    long status_column;
+    long latency_column;
+    long last_column;
+    bool usec;
+    bool arrival;
+    long current;
+    long count;
+    long latencies_size;
+    double *latencies;
+    long statuses[STATUS_CODES];
+    long skipped;
+} Timeslots;
+
 #endif /* CHAINSAW_H */
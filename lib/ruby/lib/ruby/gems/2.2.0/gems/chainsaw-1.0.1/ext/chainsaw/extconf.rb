@@ -12,4 +12,10 @@ else
     $CFLAGS << ' -std=c99'
 end
 
+# the delimiter scan uses SSE2 on x86_64 as is, AVX2 when built for a CPU that has it
+if ENV['NATIVE'] || ENV['native']
+    puts "enabling native CPU flags"
+    $CFLAGS << ' -march=native'
+end
+
 create_makefile("chainsaw")
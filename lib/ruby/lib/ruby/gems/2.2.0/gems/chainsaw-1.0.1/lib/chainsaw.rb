@@ -24,9 +24,32 @@ module Chainsaw
     #
     # Returns true if any lines were cut
     #
-    def self.create(separator: ',', transforms: [], ext: true)
+    # == Columns
+    #
+    # Pass :columns to get only some of the fields, in the order given. The
+    # others are skipped without creating Ruby objects for them, as is the
+    # rest of a line after the last column asked for. Transforms are still
+    # indexed by the column's position in the line.
+    #
+    #   chainsaw = Chainsaw.create :separator => '"', :transforms => [:fixnum, nil, :fixnum, :float], :columns => [0, 2, 3]
+    #   chainsaw.scan(file) do |epoch, status, latency|
+    #       ...
+    #   end
+    #
+    # scan reads the file in large blocks instead of a line at a time, and
+    # yields complete lines only. An unfinished line at the end of the file
+    # is left to the next call, which makes it the one to use on logs that
+    # are still being written.
+    #
+    def self.create(separator: ',', transforms: [], columns: nil, ext: true)
         raise %[separator has to be a single character] unless separator.length == 1
 
+        if columns
+            unless columns.all? { |i| i.is_a?(Integer) && i >= 0 }
+                raise ArgumentError, %[columns have to be non-negative integers]
+            end
+        end
+
         if ext
             transforms = transforms.collect do |i|
                 case i
@@ -42,39 +65,152 @@ module Chainsaw
                 end
             end
 
-            Chainsaw.new separator, transforms
+            Chainsaw.new separator, transforms, columns
+        else
+            Handsaw.new separator, transforms, columns
+        end
+    end
+
+    # == Timeslots
+    #
+    # Aggregates an access log by time instead of yielding its lines. The
+    # epoch, status and latency columns are parsed in C, lines are put into
+    # interval long timeslots named after their end, and only finished
+    # timeslots are yielded, with their latencies and a status => count Hash.
+    # The timeslot being filled is kept until a later line closes it.
+    #
+    #   timeslots = Chainsaw.timeslots :separator => '"', :interval => 10
+    #   timeslots.feed(file) do |timeslot, latencies, statuses|
+    #       digest.add_many latencies
+    #       ...
+    #   end
+    #
+    # Latencies in microseconds are converted to seconds with millisecond
+    # resolution if usec is set, and arrival moves each epoch to the request's
+    # completion time. Like scan, feed returns true if any lines were cut, and
+    # skipped counts the malformed lines so far. A line whose status isn't one
+    # to three digits is malformed too and none of it is counted.
+    #
+    def self.timeslots(separator: '"', interval:, epoch: 0, status: 2, latency: 3, usec: false, arrival: false, ext: true)
+        raise %[separator has to be a single character] unless separator.length == 1
+
+        columns = [epoch, status, latency]
+        unless columns.all? { |i| i.is_a?(Integer) && i >= 0 }
+            raise ArgumentError, %[columns have to be non-negative integers]
+        end
+
+        if ext
+            Timeslots.new separator, interval, columns, usec, arrival
         else
-            Handsaw.new separator, transforms
+            HandTimeslots.new separator, interval, columns, usec, arrival
+        end
+    end
+
+    # Ruby version of Chainsaw::Timeslots. Intented for regression testing
+    class HandTimeslots
+        attr_reader :skipped
+
+        def initialize(separator, interval, columns, usec, arrival)
+            raise ArgumentError, %[interval has to be positive] unless interval > 0
+
+            transforms = []
+            transforms[columns[0]] = :fixnum
+            transforms[columns[1]] = :string
+            transforms[columns[2]] = :float
+
+            @handsaw = Handsaw.new separator, transforms, columns
+            @interval = interval
+            @usec = usec
+            @arrival = arrival
+            @current = 0
+            @latencies = []
+            @statuses = Hash.new 0
+            @skipped = 0
+        end
+
+        def feed(io)
+            @handsaw.scan(io) do |epoch, status, latency|
+                unless latency && status =~ /\A\d{1,3}\z/
+                    @skipped += 1
+                    next
+                end
+                status = status.to_i
+
+                latency = (latency / 1000.0).round / 1000.0 if @usec
+                epoch += latency if @arrival
+
+                timeslot = epoch.div(@interval) * @interval + @interval
+                if timeslot > @current && !@latencies.empty?
+                    previous, latencies, statuses = @current, @latencies, @statuses
+                    @current = timeslot
+                    @latencies = []
+                    @statuses = Hash.new 0
+                    record status, latency
+
+                    yield previous, latencies, statuses
+                    next
+                end
+
+                @current = timeslot if timeslot > @current
+                record status, latency
+            end
+        end
+
+        private
+        def record(status, latency)
+            @latencies << latency
+            @statuses[status] += 1
         end
     end
 
     # Ruby version of Chainsaw. Intented for regression testing
     class Handsaw
-        def initialize(separator, transforms)
+        def initialize(separator, transforms, columns = nil)
             @separator = separator
             @transforms = transforms
+            @columns = columns
         end
 
         def cut(io)
             lines_cut = false
 
             while line = io.gets
-                o = line.split @separator
-                o.each_index do |index|
-                    case @transforms[index]
-                    when :fixnum
-                        o[index] = o[index].to_i
-                    when :float
-                        o[index] = o[index].to_f
-                    else
-                        o[index] = o[index].strip
-                    end
+                yield split(line)
+                lines_cut = true
+            end
+            return lines_cut
+        end
+
+        def scan(io)
+            lines_cut = false
+
+            while line = io.gets
+                unless line.end_with? "\n"
+                    io.pos -= line.bytesize
+                    break
                 end
 
-                yield o
+                yield split(line)
                 lines_cut = true
             end
             return lines_cut
         end
+
+        private
+        def split(line)
+            o = line.split @separator
+            o.each_index do |index|
+                case @transforms[index]
+                when :fixnum
+                    o[index] = o[index].to_i
+                when :float
+                    o[index] = o[index].to_f
+                else
+                    o[index] = o[index].strip
+                end
+            end
+
+            @columns ? o.values_at(*@columns) : o
+        end
     end
 end
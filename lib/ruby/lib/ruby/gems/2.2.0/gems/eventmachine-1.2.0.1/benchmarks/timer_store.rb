@@ -0,0 +1,54 @@
+# Compares the default multimap timer store with the hierarchical timing
+# wheel (EM.timer_wheel = true) at 1k, 100k and 1M outstanding timers.
+#
+# For each size it measures how long it takes to install the timers, with
+# deadlines spread uniformly over the next second, and how much CPU time the
+# reactor then spends until all of them have fired.
+#
+#   ruby -Ilib benchmarks/timer_store.rb [count ...]
+
+$:.unshift File.expand_path('../../lib', __FILE__)
+require 'eventmachine'
+require 'benchmark'
+
+counts = ARGV.empty? ? [1_000, 100_000, 1_000_000] : ARGV.map { |a| Integer(a) }
+
+def cpu_time
+  Process.clock_gettime(Process::CLOCK_PROCESS_CPUTIME_ID)
+end
+
+def run_store(wheel, count)
+  EM.timer_wheel = wheel
+  EM.set_max_timers(count + 100)
+
+  srand(42)
+  delays = Array.new(count) { rand }
+  remaining = count
+  install = fire = nil
+
+  GC.start
+  EM.run {
+    install = Benchmark.realtime {
+      delays.each { |d| EM.add_timer(d) { remaining -= 1 } }
+    }
+    started = cpu_time
+    EM.add_periodic_timer(0.05) {
+      if remaining == 0
+        fire = cpu_time - started
+        EM.stop
+      end
+    }
+  }
+
+  [install, fire]
+ensure
+  EM.timer_wheel = false
+end
+
+puts "%10s  %-8s  %12s  %14s" % ['timers', 'store', 'install (s)', 'fire cpu (s)']
+counts.each do |count|
+  [false, true].each do |wheel|
+    install, fire = run_store(wheel, count)
+    puts "%10d  %-8s  %12.3f  %14.3f" % [count, wheel ? 'wheel' : 'multimap', install, fire]
+  end
+end
@@ -22,7 +22,8 @@ See the file COPYING for complete licensing information.
 #define DEV_URANDOM "/dev/urandom"
 
 
-map<uintptr_t, Bindable_t*> Bindable_t::BindingBag;
+vector<Bindable_t::Slot_t> Bindable_t::Slots;
+size_t Bindable_t::FreeSlots = 0;
 
 
 /********************************
@@ -31,9 +32,61 @@ STATIC Bindable_t::CreateBinding
 
 uintptr_t Bindable_t::CreateBinding()
 {
-	static uintptr_t num = 0;
-	while(BindingBag[++num]) {}
-	return num;
+	// Free slots are chained through NextFree, which like FreeSlots holds
+	// the slot number plus one.
+	size_t index;
+	if (FreeSlots) {
+		index = FreeSlots - 1;
+		FreeSlots = Slots[index].NextFree;
+	}
+	else {
+		if (Slots.size() >= ((size_t)1 << IndexBits) - 1)
+			throw std::runtime_error ("no more bindings available");
+		Slot_t slot = {NULL, 0, 0, 0, false};
+		Slots.push_back (slot);
+		index = Slots.size() - 1;
+	}
+
+	Slots[index].NextFree = 0;
+	Slots[index].bInUse = true;
+	return (Slots[index].Generation << IndexBits) | (uintptr_t)(index + 1);
+}
+
+
+/*********************************
+STATIC Bindable_t::ReleaseBinding
+*********************************/
+
+void Bindable_t::ReleaseBinding (const uintptr_t binding)
+{
+	Slot_t *slot = _GetSlot (binding);
+	if (!slot)
+		return;
+
+	slot->Object = NULL;
+	slot->Data = 0;
+	slot->Generation = (slot->Generation + 1) & (((uintptr_t)1 << GenerationBits) - 1);
+	slot->NextFree = FreeSlots;
+	slot->bInUse = false;
+	FreeSlots = (binding & (((uintptr_t)1 << IndexBits) - 1));
+}
+
+
+/***************************
+STATIC Bindable_t::_GetSlot
+***************************/
+
+Bindable_t::Slot_t *Bindable_t::_GetSlot (const uintptr_t binding)
+{
+	// Null for bindings that are malformed, released, or from an older generation.
+	size_t index = (size_t)(binding & (((uintptr_t)1 << IndexBits) - 1));
+	if (index == 0 || index > Slots.size())
+		return NULL;
+
+	Slot_t *slot = &Slots [index - 1];
+	if (!slot->bInUse || slot->Generation != (binding >> IndexBits))
+		return NULL;
+	return slot;
 }
 
 #if 0
@@ -92,11 +145,33 @@ STATIC: Bindable_t::GetObject
 
 Bindable_t *Bindable_t::GetObject (const uintptr_t binding)
 {
-	map<uintptr_t, Bindable_t*>::const_iterator i = BindingBag.find (binding);
-	if (i != BindingBag.end())
-		return i->second;
-	else
-		return NULL;
+	Slot_t *slot = _GetSlot (binding);
+	return slot ? slot->Object : NULL;
+}
+
+
+/***************************
+STATIC: Bindable_t::GetData
+***************************/
+
+uintptr_t Bindable_t::GetData (const uintptr_t binding)
+{
+	Slot_t *slot = _GetSlot (binding);
+	return slot ? slot->Data : 0;
+}
+
+
+/***************************
+STATIC: Bindable_t::SetData
+***************************/
+
+bool Bindable_t::SetData (const uintptr_t binding, uintptr_t data)
+{
+	Slot_t *slot = _GetSlot (binding);
+	if (!slot || !slot->Object)
+		return false;
+	slot->Data = data;
+	return true;
 }
 
 
@@ -107,7 +182,7 @@ Bindable_t::Bindable_t
 Bindable_t::Bindable_t()
 {
 	Binding = Bindable_t::CreateBinding();
-	BindingBag [Binding] = this;
+	_GetSlot (Binding)->Object = this;
 }
 
 
@@ -118,7 +193,7 @@ Bindable_t::~Bindable_t
 
 Bindable_t::~Bindable_t()
 {
-	BindingBag.erase (Binding);
+	ReleaseBinding (Binding);
 }
 
 
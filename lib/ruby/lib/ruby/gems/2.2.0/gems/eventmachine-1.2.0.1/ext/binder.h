@@ -21,12 +21,32 @@ See the file COPYING for complete licensing information.
 #define __ObjectBindings__H_
 
 
+/****************
+class Bindable_t
+****************/
+
+/* Bindings index a table of slots. The low IndexBits of a binding are
+ * the slot number plus one, so zero is never a binding, and the bits
+ * above them are the slot's generation, which is bumped whenever the slot
+ * is released. Lookups are O(1), freed slots are reused, and a binding
+ * that outlived its object can't reach whatever took its slot over.
+ *
+ * Generations are kept short enough that a binding is always a Fixnum
+ * on the Ruby side.
+ *
+ * Each slot also holds an opaque word for the embedding language, which
+ * the Ruby extension uses to keep the connection object that goes with
+ * the binding. It's cleared when the slot is released.
+ */
+
 class Bindable_t
 {
 	public:
 		static uintptr_t CreateBinding();
+		static void ReleaseBinding (const uintptr_t);
 		static Bindable_t *GetObject (const uintptr_t);
-		static map<uintptr_t, Bindable_t*> BindingBag;
+		static uintptr_t GetData (const uintptr_t);
+		static bool SetData (const uintptr_t, uintptr_t);
 
 	public:
 		Bindable_t();
@@ -36,6 +56,25 @@ class Bindable_t
 
 	private:
 		uintptr_t Binding;
+
+	private:
+		enum {
+			IndexBits = (sizeof(uintptr_t) > 4) ? 32 : 24,
+			GenerationBits = (sizeof(uintptr_t) * 8) - 2 - IndexBits
+		};
+
+		struct Slot_t {
+			Bindable_t *Object;
+			uintptr_t Data;
+			uintptr_t Generation;
+			size_t NextFree;
+			bool bInUse;
+		};
+
+		static Slot_t *_GetSlot (const uintptr_t);
+
+		static vector<Slot_t> Slots;
+		static size_t FreeSlots;
 };
 
 
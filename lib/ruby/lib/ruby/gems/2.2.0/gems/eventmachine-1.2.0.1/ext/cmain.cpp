@@ -127,6 +127,25 @@ extern "C" const uintptr_t evma_connect_to_unix_server (const char *server)
 	return EventMachine->ConnectToUnixServer (server);
 }
 
+/*********************
+evma_get_binding_data
+*********************/
+
+extern "C" uintptr_t evma_get_binding_data (const uintptr_t binding)
+{
+	// Doesn't need the reactor, and is called for every event dispatched.
+	return Bindable_t::GetData (binding);
+}
+
+/*********************
+evma_set_binding_data
+*********************/
+
+extern "C" int evma_set_binding_data (const uintptr_t binding, uintptr_t data)
+{
+	return Bindable_t::SetData (binding, data) ? 1 : 0;
+}
+
 /**************
 evma_attach_fd
 **************/
@@ -280,6 +299,16 @@ extern "C" const uintptr_t evma_create_tcp_server (const char *address, int port
 	return EventMachine->CreateTcpServer (address, port);
 }
 
+/********************************
+evma_create_reuseport_tcp_server
+********************************/
+
+extern "C" const uintptr_t evma_create_reuseport_tcp_server (const char *address, int port)
+{
+	ensure_eventmachine("evma_create_reuseport_tcp_server");
+	return EventMachine->CreateTcpServer (address, port, true);
+}
+
 /******************************
 evma_create_unix_domain_server
 ******************************/
@@ -340,6 +369,16 @@ extern "C" void evma_unwatch_filename (const uintptr_t sig)
 	EventMachine->UnwatchFile(sig);
 }
 
+/**************
+evma_tail_file
+**************/
+
+extern "C" const uintptr_t evma_tail_file (const char *fname, int flags, unsigned long max_line_size)
+{
+	ensure_eventmachine("evma_tail_file");
+	return EventMachine->TailFile(fname, flags, max_line_size);
+}
+
 /**************
 evma_watch_pid
 **************/
@@ -542,6 +581,21 @@ extern "C" const char *evma_get_sni_hostname (const uintptr_t binding)
 }
 #endif
 
+/**************************
+evma_is_ssl_session_reused
+**************************/
+
+#ifdef WITH_SSL
+extern "C" int evma_is_ssl_session_reused (const uintptr_t binding)
+{
+	ensure_eventmachine("evma_is_ssl_session_reused");
+	EventableDescriptor *ed = dynamic_cast <EventableDescriptor*> (Bindable_t::GetObject (binding));
+	if (ed)
+		return ed->IsSslSessionReused() ? 1 : 0;
+	return 0;
+}
+#endif
+
 /********************
 evma_accept_ssl_peer
 ********************/
@@ -648,6 +702,40 @@ extern "C" void evma_signal_loopbreak()
 }
 
 
+#ifdef HAVE_SYNC_BUILTINS
+
+/*********************
+evma_queue_completion
+*********************/
+
+extern "C" void evma_queue_completion (uintptr_t data)
+{
+	ensure_eventmachine("evma_queue_completion");
+	EventMachine->QueueCompletion (data);
+}
+
+/********************
+evma_has_completions
+********************/
+
+extern "C" int evma_has_completions()
+{
+	return (EventMachine && EventMachine->HasCompletions()) ? 1 : 0;
+}
+
+/*********************
+evma_mark_completions
+*********************/
+
+extern "C" void evma_mark_completions (void (*mark)(uintptr_t))
+{
+	if (EventMachine)
+		EventMachine->MarkCompletions (mark);
+}
+
+#endif // HAVE_SYNC_BUILTINS
+
+
 
 /********************************
 evma_get_comm_inactivity_timeout
@@ -711,6 +799,104 @@ extern "C" int evma_set_pending_connect_timeout (const uintptr_t binding, float
 		return 0;
 }
 
+/************************
+evma_get_read_batch_size
+************************/
+
+extern "C" int evma_get_read_batch_size (const uintptr_t binding)
+{
+	ensure_eventmachine("evma_get_read_batch_size");
+	ConnectionDescriptor *cd = dynamic_cast <ConnectionDescriptor*> (Bindable_t::GetObject (binding));
+	if (cd)
+		return cd->GetReadBatchSize();
+	else
+		return -1;
+}
+
+/************************
+evma_set_read_batch_size
+************************/
+
+extern "C" int evma_set_read_batch_size (const uintptr_t binding, int value)
+{
+	ensure_eventmachine("evma_set_read_batch_size");
+	ConnectionDescriptor *cd = dynamic_cast <ConnectionDescriptor*> (Bindable_t::GetObject (binding));
+	if (cd)
+		return cd->SetReadBatchSize (value);
+	else
+		return 0;
+}
+
+/************************
+evma_set_inbound_framing
+************************/
+
+extern "C" int evma_set_inbound_framing (const uintptr_t binding, int mode, const char *delimiter, int delimiter_length, int prefix_size, unsigned long max_frame_size)
+{
+	ensure_eventmachine("evma_set_inbound_framing");
+	ConnectionDescriptor *cd = dynamic_cast <ConnectionDescriptor*> (Bindable_t::GetObject (binding));
+	if (cd)
+		return cd->SetInboundFraming (mode, delimiter, delimiter_length, prefix_size, max_frame_size);
+	else
+		return 0;
+}
+
+/****************************
+evma_get_datagram_batch_size
+****************************/
+
+extern "C" int evma_get_datagram_batch_size (const uintptr_t binding)
+{
+	ensure_eventmachine("evma_get_datagram_batch_size");
+	DatagramDescriptor *dd = dynamic_cast <DatagramDescriptor*> (Bindable_t::GetObject (binding));
+	if (dd)
+		return dd->GetBatchSize();
+	else
+		return -1;
+}
+
+/**************************
+evma_set_datagram_batching
+**************************/
+
+extern "C" int evma_set_datagram_batching (const uintptr_t binding, int batch_size, int deliver_batches)
+{
+	ensure_eventmachine("evma_set_datagram_batching");
+	DatagramDescriptor *dd = dynamic_cast <DatagramDescriptor*> (Bindable_t::GetObject (binding));
+	if (dd)
+		return dd->SetBatching (batch_size, deliver_batches ? true : false);
+	else
+		return 0;
+}
+
+/************************
+evma_get_read_iterations
+************************/
+
+extern "C" int evma_get_read_iterations (const uintptr_t binding)
+{
+	ensure_eventmachine("evma_get_read_iterations");
+	ConnectionDescriptor *cd = dynamic_cast <ConnectionDescriptor*> (Bindable_t::GetObject (binding));
+	if (cd)
+		return cd->GetReadIterations();
+	else
+		return -1;
+}
+
+/************************
+evma_set_read_iterations
+************************/
+
+extern "C" int evma_set_read_iterations (const uintptr_t binding, int value)
+{
+	ensure_eventmachine("evma_set_read_iterations");
+	ConnectionDescriptor *cd = dynamic_cast <ConnectionDescriptor*> (Bindable_t::GetObject (binding));
+	if (cd)
+		return cd->SetReadIterations (value);
+	else
+		return 0;
+}
+
 
 /**********************
 evma_set_timer_quantum
@@ -749,6 +935,90 @@ extern "C" void evma_set_max_timer_count (int ct)
 	EventMachine_t::SetMaxTimerCount (ct);
 }
 
+/********************
+evma_get_timer_wheel
+********************/
+
+extern "C" int evma_get_timer_wheel()
+{
+	return EventMachine_t::GetUseTimerWheel() ? 1 : 0;
+}
+
+/********************
+evma_set_timer_wheel
+********************/
+
+extern "C" void evma_set_timer_wheel (int use)
+{
+	// Like the timer count, the timer store is fixed once the reactor exists.
+
+	if (EventMachine)
+		#ifdef BUILD_FOR_RUBY
+			rb_raise(rb_eRuntimeError, "eventmachine already initialized: evma_set_timer_wheel");
+		#else
+			throw std::runtime_error ("eventmachine already initialized: evma_set_timer_wheel");
+		#endif
+	EventMachine_t::SetUseTimerWheel (use ? true : false);
+}
+
+/************************
+evma_get_edge_triggered
+************************/
+
+extern "C" int evma_get_edge_triggered()
+{
+	return EventMachine_t::GetUseEdgeTriggered() ? 1 : 0;
+}
+
+/************************
+evma_set_edge_triggered
+************************/
+
+extern "C" void evma_set_edge_triggered (int use)
+{
+	if (EventMachine)
+		#ifdef BUILD_FOR_RUBY
+			rb_raise(rb_eRuntimeError, "eventmachine already initialized: evma_set_edge_triggered");
+		#else
+			throw std::runtime_error ("eventmachine already initialized: evma_set_edge_triggered");
+		#endif
+	EventMachine_t::SetUseEdgeTriggered (use ? true : false);
+}
+
+/***********************
+evma_get_event_batching
+***********************/
+
+extern "C" int evma_get_event_batching()
+{
+	return EventMachine_t::GetUseEventBatching() ? 1 : 0;
+}
+
+/***********************
+evma_set_event_batching
+***********************/
+
+extern "C" void evma_set_event_batching (int use)
+{
+	if (EventMachine)
+		#ifdef BUILD_FOR_RUBY
+			rb_raise(rb_eRuntimeError, "eventmachine already initialized: evma_set_event_batching");
+		#else
+			throw std::runtime_error ("eventmachine already initialized: evma_set_event_batching");
+		#endif
+	EventMachine_t::SetUseEventBatching (use ? true : false);
+}
+
+/**************
+evma_get_stats
+**************/
+
+extern "C" const ReactorStats_t *evma_get_stats()
+{
+	ensure_eventmachine("evma_get_stats");
+	return &(EventMachine->Stats);
+}
+
 /******************
 evma_get/set_simultaneous_accept_count
 ******************/
@@ -833,6 +1103,24 @@ extern "C" int evma_set_rlimit_nofile (int nofiles)
 }
 
 
+/***********************
+_sendfile_to_connection
+***********************/
+
+static int _sendfile_to_connection (const uintptr_t binding, int Fd, off_t filesize)
+{
+	/* Queues the file on the connection, which then owns Fd. Returns -1 and
+	 * leaves Fd to the caller if the connection can't send it with sendfile.
+	 */
+	#ifdef HAVE_SENDFILE
+	ConnectionDescriptor *cd = dynamic_cast <ConnectionDescriptor*> (Bindable_t::GetObject (binding));
+	if (cd && cd->SendOutboundFile (Fd, filesize) >= 0)
+		return 0;
+	#endif
+	return -1;
+}
+
+
 /*********************************
 evma_send_file_data_to_connection
 *********************************/
@@ -854,6 +1142,9 @@ extern "C" int evma_send_file_data_to_connection (const uintptr_t binding, const
 	 * errno in case of other errors.
 	 *
 	 * Contributed by Kirk Haines.
+	 *
+	 * Files too large for the buffer are handed to the connection as they are, if
+	 * it can send them with sendfile. See evma_sendfile_data_to_connection.
 	 */
 
 	char data[32*1024];
@@ -863,6 +1154,9 @@ extern "C" int evma_send_file_data_to_connection (const uintptr_t binding, const
 
 #if defined(OS_WIN32)
 	int Fd = open (filename, O_RDONLY|O_BINARY);
+#elif defined(O_CLOEXEC)
+	// Fd may outlive this call on a connection, keep it out of child processes.
+	int Fd = open (filename, O_RDONLY|O_CLOEXEC);
 #else
 	int Fd = open (filename, O_RDONLY);
 #endif
@@ -883,6 +1177,8 @@ extern "C" int evma_send_file_data_to_connection (const uintptr_t binding, const
 		return 0;
 	}
 	else if (filesize > (off_t) sizeof(data)) {
+		if (_sendfile_to_connection (binding, Fd, filesize) == 0)
+			return 0;
 		close (Fd);
 		return -1;
 	}
@@ -900,6 +1196,47 @@ extern "C" int evma_send_file_data_to_connection (const uintptr_t binding, const
 }
 
 
+/********************************
+evma_sendfile_data_to_connection
+********************************/
+
+extern "C" int evma_sendfile_data_to_connection (const uintptr_t binding, const char *filename)
+{
+	/* Like evma_send_file_data_to_connection, but for files of any size, which
+	 * are never read into memory: the kernel copies them straight to the socket
+	 * as the connection's outbound data drains. Returns 0 on success, -1 if the
+	 * connection can't do that (no sendfile, TLS), and a positive errno for
+	 * other errors.
+	 */
+	ensure_eventmachine("evma_sendfile_data_to_connection");
+
+	#ifdef HAVE_SENDFILE
+	int Fd = open (filename, O_RDONLY|O_CLOEXEC);
+	if (Fd < 0)
+		return errno;
+
+	struct stat st;
+	if (fstat (Fd, &st)) {
+		int e = errno;
+		close (Fd);
+		return e;
+	}
+
+	if (st.st_size <= 0) {
+		close (Fd);
+		return 0;
+	}
+
+	int r = _sendfile_to_connection (binding, Fd, st.st_size);
+	if (r != 0)
+		close (Fd);
+	return r;
+	#else
+	return -1;
+	#endif
+}
+
+
 /****************
 evma_start_proxy
 *****************/
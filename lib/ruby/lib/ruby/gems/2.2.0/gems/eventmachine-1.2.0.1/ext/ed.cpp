@@ -116,6 +116,7 @@ EventableDescriptor::EventableDescriptor (SOCKET sd, EventMachine_t *em):
 	#ifdef HAVE_EPOLL
 	EpollEvent.events = 0;
 	EpollEvent.data.ptr = this;
+	EpollRegistered = 0;
 	#endif
 	LastActivity = MyEventMachine->GetCurrentLoopTime();
 }
@@ -403,6 +404,17 @@ ConnectionDescriptor::ConnectionDescriptor (SOCKET sd, EventMachine_t *em):
 	bReadAttemptedAfterClose (false),
 	bWriteAttemptedAfterClose (false),
 	OutboundDataSize (0),
+	ReadBatchSize (0),
+	ReadIterations (10),
+	InboundFramer (NULL),
+	DeliveringFramer (NULL),
+	bEdgeTriggered (em->IsEdgeTriggered()),
+	bReadPending (false),
+	bWritePending (false),
+	bWriteBlocked (false),
+	#ifdef HAVE_SPLICE
+	bSpliceFailed (false),
+	#endif
 	#ifdef WITH_SSL
 	SslBox (NULL),
 	bHandshakeSignaled (false),
@@ -416,6 +428,9 @@ ConnectionDescriptor::ConnectionDescriptor (SOCKET sd, EventMachine_t *em):
 {
 	// 22Jan09: Moved ArmKqueueWriter into SetConnectPending() to fix assertion failure in _WriteOutboundData()
 	//  5May09: Moved EPOLLOUT into SetConnectPending() so it doesn't happen for attached read pipes
+	#ifdef HAVE_SPLICE
+	SplicePipe[0] = SplicePipe[1] = -1;
+	#endif
 }
 
 
@@ -425,14 +440,22 @@ ConnectionDescriptor::~ConnectionDescriptor
 
 ConnectionDescriptor::~ConnectionDescriptor()
 {
-	// Run down any stranded outbound data.
-	for (size_t i=0; i < OutboundPages.size(); i++)
-		OutboundPages[i].Free();
+	// Stranded outbound data is run down by the OutboundChain_t destructor.
+
+	if (InboundFramer)
+		delete InboundFramer;
 
 	#ifdef WITH_SSL
 	if (SslBox)
 		delete SslBox;
 	#endif
+
+	#ifdef HAVE_SPLICE
+	if (SplicePipe[0] != -1) {
+		close (SplicePipe[0]);
+		close (SplicePipe[1]);
+	}
+	#endif
 }
 
 
@@ -454,6 +477,21 @@ void ConnectionDescriptor::_UpdateEvents(bool read, bool write)
 		return;
 
 	#ifdef HAVE_EPOLL
+	if (bEdgeTriggered) {
+		// Interest stays put; just flag whatever can be done now.
+		EpollEvent.events = EPOLLIN | EPOLLOUT | EPOLLET;
+		bool deferred = false;
+		if (read && bReadPending && SelectForRead())
+			deferred = true;
+		if (write && !bConnectPending && !bWriteBlocked && SelectForWrite()) {
+			bWritePending = true;
+			deferred = true;
+		}
+		if (deferred)
+			MyEventMachine->Modify (this);
+		return;
+	}
+
 	unsigned int old = EpollEvent.events;
 
 	if (read) {
@@ -495,6 +533,20 @@ void ConnectionDescriptor::SetConnectPending(bool f)
 }
 
 
+/***************************************
+ConnectionDescriptor::SetConnectAddress
+***************************************/
+
+void ConnectionDescriptor::SetConnectAddress (const char *server UNUSED, int port UNUSED)
+{
+	#ifdef WITH_SSL
+	char buf [16];
+	snprintf (buf, sizeof(buf), ":%d", port);
+	ConnectAddress = std::string (server) + buf;
+	#endif
+}
+
+
 /**********************************
 ConnectionDescriptor::SetAttached
 ***********************************/
@@ -502,6 +554,8 @@ ConnectionDescriptor::SetAttached
 void ConnectionDescriptor::SetAttached(bool state)
 {
 	bAttached = state;
+	if (state)
+		_DisableEdgeTrigger();
 }
 
 
@@ -512,10 +566,29 @@ ConnectionDescriptor::SetWatchOnly
 void ConnectionDescriptor::SetWatchOnly(bool watching)
 {
 	bWatchOnly = watching;
+	if (watching)
+		_DisableEdgeTrigger();
 	_UpdateEvents();
 }
 
 
+/*****************************************
+ConnectionDescriptor::_DisableEdgeTrigger
+*****************************************/
+
+void ConnectionDescriptor::_DisableEdgeTrigger()
+{
+	/* Attached descriptors can be anything, and watch-only ones promise
+	 * level-triggered notify_readable/writable semantics, so both stay
+	 * level-triggered. This happens before the descriptor is registered.
+	 */
+	bEdgeTriggered = false;
+	#ifdef HAVE_EPOLL
+	EpollEvent.events &= ~EPOLLET;
+	#endif
+}
+
+
 /*********************************
 ConnectionDescriptor::HandleError
 *********************************/
@@ -624,6 +697,50 @@ int ConnectionDescriptor::SendOutboundData (const char *data, unsigned long leng
 
 
 
+#ifdef HAVE_SENDFILE
+/**************************************
+ConnectionDescriptor::SendOutboundFile
+**************************************/
+
+int ConnectionDescriptor::SendOutboundFile (int fd, off_t length)
+{
+	/* Queues the first length bytes of an open file, to be sent with
+	 * sendfile as the outbound data ahead of it drains, so the file is
+	 * never read into user space. On success the connection owns fd and
+	 * closes it when done. Returns -1, leaving fd alone, when the data has
+	 * to pass through here instead: TLS has to encrypt it, and a watch-only
+	 * connection sends nothing. Also when the length doesn't fit the
+	 * outbound byte count.
+	 */
+	if (bWatchOnly)
+		return -1;
+	#ifdef WITH_SSL
+	if (SslBox)
+		return -1;
+	#endif
+	if (length > (off_t)(INT_MAX - OutboundDataSize))
+		return -1;
+
+	if (ProxiedFrom && MaxOutboundBufSize && (unsigned int)(GetOutboundDataSize() + length) > MaxOutboundBufSize)
+		ProxiedFrom->Pause();
+
+	if (IsCloseScheduled() || length <= 0) {
+		close (fd);
+		return 0;
+	}
+
+	OutboundPages.AppendFile (fd, 0, length);
+	OutboundDataSize += length;
+	MyEventMachine->Stats.RecordOutbound (ReactorStats_t::Connection, OutboundDataSize);
+
+	_UpdateEvents(false, true);
+
+	return (int)length;
+}
+#endif
+
+
+
 /******************************************
 ConnectionDescriptor::_SendRawOutboundData
 ******************************************/
@@ -639,8 +756,8 @@ int ConnectionDescriptor::_SendRawOutboundData (const char *data, unsigned long
 
 	// Highly naive and incomplete implementation.
 	// There's no throttle for runaways (which should abort only this connection
-	// and not the whole process), and no coalescing of small pages.
-	// (Well, not so bad, small pages are coalesced in ::Write)
+	// and not the whole process). Small pages are coalesced into shared slabs
+	// by the outbound chain.
 
 	if (IsCloseScheduled())
 		return 0;
@@ -651,14 +768,10 @@ int ConnectionDescriptor::_SendRawOutboundData (const char *data, unsigned long
 
 	if (!data && (length > 0))
 		throw std::runtime_error ("bad outbound data");
-	char *buffer = (char *) malloc (length + 1);
-	if (!buffer)
-		throw std::runtime_error ("no allocation for outbound data");
 
-	memcpy (buffer, data, length);
-	buffer [length] = 0;
-	OutboundPages.push_back (OutboundPage (buffer, length));
+	OutboundPages.Append (data, length, true);
 	OutboundDataSize += length;
+	MyEventMachine->Stats.RecordOutbound (ReactorStats_t::Connection, OutboundDataSize);
 
 	_UpdateEvents(false, true);
 
@@ -793,12 +906,42 @@ void ConnectionDescriptor::Read()
 		return;
 	}
 
+	if (bEdgeTriggered) {
+		// The edge won't come again, so remember it for when we're
+		// connected or resumed.
+		if (!SelectForRead()) {
+			bReadPending = true;
+			return;
+		}
+		bReadPending = false;
+	}
+
 	LastActivity = MyEventMachine->GetCurrentLoopTime();
 
+	#ifdef HAVE_SPLICE
+	if (_SpliceProxy())
+		return;
+	#endif
+
 	int total_bytes_read = 0;
+	bool drained = false;
+	bool eof = false;
 	char readbuffer [16 * 1024 + 1];
 
-	for (int i=0; i < 10; i++) {
+	/* With a read batch size set, successive reads fill the reactor's
+	 * read arena and everything gathered is dispatched as one chunk at the
+	 * end, so a bulk receiver sees one callback per wakeup instead of one
+	 * per 16K.
+	 */
+	char *buffer = readbuffer;
+	int buffer_size = sizeof(readbuffer) - 1;
+	int filled = 0;
+	if (ReadBatchSize > 0) {
+		buffer = MyEventMachine->GetReadArena (ReadBatchSize);
+		buffer_size = ReadBatchSize;
+	}
+
+	for (int i=0; i < ReadIterations; i++) {
 		// Don't read just one buffer and then move on. This is faster
 		// if there is a lot of incoming.
 		// But don't read indefinitely. Give other sockets a chance to run.
@@ -807,7 +950,8 @@ void ConnectionDescriptor::Read()
 		// to user code.
 		
 
-		int r = read (sd, readbuffer, sizeof(readbuffer) - 1);
+		int want = buffer_size - filled;
+		int r = read (sd, buffer + filled, want);
 #ifdef OS_WIN32
 		int e = WSAGetLastError();
 #else
@@ -818,6 +962,15 @@ void ConnectionDescriptor::Read()
 		if (r > 0) {
 			total_bytes_read += r;
 
+			if (ReadBatchSize > 0) {
+				// A short read means the socket is drained for now, though
+				// edge-triggered we have to hear that from the kernel.
+				filled += r;
+				if ((r < want && !bEdgeTriggered) || filled == buffer_size)
+					break;
+				continue;
+			}
+
 			// Add a null-terminator at the the end of the buffer
 			// that we will send to the callback.
 			// DO NOT EVER CHANGE THIS. We want to explicitly allow users
@@ -830,9 +983,11 @@ void ConnectionDescriptor::Read()
 				break;
 		}
 		else if (r == 0) {
+			drained = eof = true;
 			break;
 		}
 		else {
+			drained = true;
 			#ifdef OS_UNIX
 			if ((e != EINPROGRESS) && (e != EWOULDBLOCK) && (e != EAGAIN) && (e != EINTR)) {
 			#endif
@@ -852,6 +1007,20 @@ void ConnectionDescriptor::Read()
 
 	}
 
+	MyEventMachine->Stats.BytesRead [ReactorStats_t::Connection] += total_bytes_read;
+
+	if (filled > 0) {
+		// Same guard byte as above.
+		buffer [filled] = 0;
+		_DispatchInboundData (buffer, filled);
+	}
+
+	_DeliverFrames();
+
+	if (bEdgeTriggered) {
+		_FinishEdgeTriggeredRead (drained, eof, total_bytes_read);
+		return;
+	}
 
 	if (total_bytes_read == 0) {
 		// If we read no data on a socket that selected readable,
@@ -863,6 +1032,178 @@ void ConnectionDescriptor::Read()
 }
 
 
+/**********************************************
+ConnectionDescriptor::_FinishEdgeTriggeredRead
+**********************************************/
+
+void ConnectionDescriptor::_FinishEdgeTriggeredRead (bool drained, bool eof, unsigned long total_bytes_read)
+{
+	/* Edge-triggered, being called with nothing to read is normal (the
+	 * data that raised the edge may have been read on an earlier pass), so
+	 * only an actual end-of-file closes the connection. And if we stopped
+	 * before the socket ran dry, nobody is going to tell us to come back,
+	 * so we queue ourselves. The same goes for an end-of-file that came
+	 * right behind the data: as level-triggered, it closes us on the next
+	 * pass, but its edge has been spent.
+	 */
+	if (eof && total_bytes_read == 0)
+		ScheduleClose (false);
+	else if ((!drained || eof) && GetSocket() != INVALID_SOCKET) {
+		bReadPending = true;
+		if (SelectForRead())
+			MyEventMachine->Modify (this);
+	}
+}
+
+
+
+/**********************************
+ConnectionDescriptor::_SpliceProxy
+**********************************/
+
+#ifdef HAVE_SPLICE
+bool ConnectionDescriptor::_SpliceProxy()
+{
+	/* When we're proxying to another plain TCP connection, move the data
+	 * from our socket to the target's with splice(2) through a pipe, so it
+	 * never gets copied into user space. Returns false if the proxy isn't
+	 * eligible, in which case the caller reads and dispatches as usual.
+	 *
+	 * Splicing only happens while the target's outbound queue is empty, so
+	 * the byte order on the wire can't be disturbed. If the target can't
+	 * take everything we pulled into the pipe, the remainder is copied onto
+	 * its outbound queue and later reads go through the copy path until
+	 * that queue drains again.
+	 */
+	if (!ProxyTarget || bSpliceFailed || bPaused)
+		return false;
+
+	/* The tail end of a length-limited proxy is left to the copy path, so
+	 * whatever follows it is handed to receive_data out of the same read,
+	 * exactly as before.
+	 */
+	if (BytesToProxy > 0 && BytesToProxy <= SpliceChunk)
+		return false;
+
+	ConnectionDescriptor *target = dynamic_cast <ConnectionDescriptor*> (ProxyTarget);
+	if (!target || target->IsWatchOnly() || target->IsConnectPending() || target->IsCloseScheduled())
+		return false;
+	if (target->GetSocket() == INVALID_SOCKET || target->GetOutboundDataSize() > 0)
+		return false;
+	#ifdef WITH_SSL
+	if (SslBox || target->SslBox)
+		return false;
+	#endif
+
+	if (SplicePipe[0] == -1) {
+		if (pipe (SplicePipe)) {
+			SplicePipe[0] = SplicePipe[1] = -1;
+			bSpliceFailed = true;
+			return false;
+		}
+		if (!SetSocketNonblocking (SplicePipe[0]) || !SetSocketNonblocking (SplicePipe[1]) || !SetFdCloexec (SplicePipe[0]) || !SetFdCloexec (SplicePipe[1])) {
+			close (SplicePipe[0]);
+			close (SplicePipe[1]);
+			SplicePipe[0] = SplicePipe[1] = -1;
+			bSpliceFailed = true;
+			return false;
+		}
+	}
+
+	SOCKET sd = GetSocket();
+	SOCKET td = target->GetSocket();
+	unsigned long total_bytes_read = 0;
+	bool drained = false;
+	bool eof = false;
+
+	for (int i=0; i < ReadIterations; i++) {
+		size_t want = SpliceChunk;
+		if (BytesToProxy > 0)
+			want = min ((unsigned long) SpliceChunk, BytesToProxy - SpliceChunk);
+
+		ssize_t r = splice (sd, NULL, SplicePipe[1], NULL, want, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+		int e = errno;
+
+		if (r == 0) {
+			drained = eof = true;
+			break;
+		}
+		if (r < 0) {
+			drained = true;
+			if (e == EINVAL && total_bytes_read == 0) {
+				// Not a descriptor the kernel can splice from.
+				bSpliceFailed = true;
+				return false;
+			}
+			if ((e != EINPROGRESS) && (e != EWOULDBLOCK) && (e != EAGAIN) && (e != EINTR)) {
+				UnbindReasonCode = e;
+				Close();
+			}
+			break;
+		}
+
+		total_bytes_read += r;
+		ProxiedBytes += r;
+
+		unsigned long left = r;
+		while (left > 0) {
+			ssize_t w = splice (SplicePipe[0], NULL, td, NULL, left, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+			if (w <= 0)
+				break;
+			left -= w;
+		}
+		if (left < (unsigned long) r) {
+			target->LastActivity = MyEventMachine->GetCurrentLoopTime();
+			MyEventMachine->Stats.BytesWritten [ReactorStats_t::Connection] += r - left;
+		}
+		if (left > 0)
+			_DrainSplicePipe (target, left);
+
+		if (BytesToProxy > 0) {
+			BytesToProxy -= r;
+			if (BytesToProxy <= SpliceChunk)
+				break;
+		}
+
+		if (left > 0 || bPaused)
+			break;
+	}
+
+	MyEventMachine->Stats.BytesRead [ReactorStats_t::Connection] += total_bytes_read;
+
+	if (bEdgeTriggered)
+		_FinishEdgeTriggeredRead (drained, eof, total_bytes_read);
+	else if (total_bytes_read == 0) {
+		// Same as in Read: readable with nothing to read means the peer closed.
+		ScheduleClose (false);
+	}
+
+	return true;
+}
+
+
+/**************************************
+ConnectionDescriptor::_DrainSplicePipe
+**************************************/
+
+void ConnectionDescriptor::_DrainSplicePipe (ConnectionDescriptor *target, unsigned long size)
+{
+	/* The target socket is full (or gone). Whatever is still in the pipe
+	 * has already been taken off our socket, so queue it on the target the
+	 * ordinary way. SendOutboundData also takes care of pausing us if that
+	 * pushes the target past its proxy buffer size.
+	 */
+	char buf [16 * 1024];
+	while (size > 0) {
+		ssize_t r = read (SplicePipe[0], buf, min ((unsigned long) sizeof(buf), size));
+		if (r <= 0)
+			break;
+		target->SendOutboundData (buf, r);
+		size -= r;
+	}
+}
+#endif
+
 
 /******************************************
 ConnectionDescriptor::_DispatchInboundData
@@ -879,7 +1220,7 @@ void ConnectionDescriptor::_DispatchInboundData (const char *buffer, unsigned lo
 		while ((s = SslBox->GetPlaintext (B, sizeof(B) - 1)) > 0) {
 			_CheckHandshakeStatus();
 			B [s] = 0;
-			_GenericInboundDispatch(B, s);
+			_FramedInboundDispatch(B, s);
 		}
 
 		// If our SSL handshake had a problem, shut down the connection.
@@ -901,17 +1242,70 @@ void ConnectionDescriptor::_DispatchInboundData (const char *buffer, unsigned lo
 		_DispatchCiphertext();
 	}
 	else {
-		_GenericInboundDispatch(buffer, size);
+		_FramedInboundDispatch(buffer, size);
 	}
 }
 #else
 void ConnectionDescriptor::_DispatchInboundData (const char *buffer, unsigned long size)
 {
-	_GenericInboundDispatch(buffer, size);
+	_FramedInboundDispatch(buffer, size);
 }
 #endif
 
 
+/********************************************
+ConnectionDescriptor::_FramedInboundDispatch
+********************************************/
+
+void ConnectionDescriptor::_FramedInboundDispatch (const char *buffer, unsigned long size)
+{
+	// Plaintext goes through the framing stage if there is one; a proxy takes it as it is.
+	if (!InboundFramer || ProxyTarget) {
+		_GenericInboundDispatch (buffer, size);
+		return;
+	}
+
+	if (!InboundFramer->Feed (buffer, size) && !IsCloseScheduled()) {
+		#ifdef OS_UNIX
+		UnbindReasonCode = EMSGSIZE;
+		#endif
+		#ifdef OS_WIN32
+		UnbindReasonCode = WSAEMSGSIZE;
+		#endif
+		ScheduleClose (false);
+	}
+}
+
+
+/************************************
+ConnectionDescriptor::_DeliverFrames
+************************************/
+
+void ConnectionDescriptor::_DeliverFrames()
+{
+	/* Hands every frame completed since the last delivery to the callback
+	 * at once. If the callback changes the framing, the new stage takes over
+	 * whatever the old one hadn't framed yet, once the batch is done with.
+	 */
+	Framer_t *framer = InboundFramer;
+	if (!framer || !framer->HasFrames() || DeliveringFramer)
+		return;
+
+	assert (EventCallback);
+	DeliveringFramer = framer;
+	(*EventCallback)(GetBinding(), EM_CONNECTION_FRAMES, (const char*) framer->GetFrames(), framer->GetFrameCount());
+	DeliveringFramer = NULL;
+	framer->ConsumeFrames();
+
+	if (framer != InboundFramer) {
+		if (framer->GetBuffered() > 0)
+			_FramedInboundDispatch (framer->GetBufferedData(), framer->GetBuffered());
+		delete framer;
+		_DeliverFrames();
+	}
+}
+
+
 
 /*******************************************
 ConnectionDescriptor::_CheckHandshakeStatus
@@ -985,6 +1379,14 @@ void ConnectionDescriptor::Write()
 
 		assert(!bWatchOnly);
 
+		// Edge-triggered, writability is reported alongside every read edge,
+		// and while we're paused too.
+		if (bEdgeTriggered) {
+			bWriteBlocked = false;
+			if (!SelectForWrite())
+				return;
+		}
+
 		/* 5May09: Kqueue bugs on OSX cause one extra writable event to fire even though we're using
 		   EV_ONESHOT. We ignore this extra event once, but only the first time. If it happens again,
 		   we should fall through to the assert(nbytes>0) failure to catch any EM bugs which might cause
@@ -1035,15 +1437,27 @@ void ConnectionDescriptor::_WriteOutboundData()
 	LastActivity = MyEventMachine->GetCurrentLoopTime();
 	size_t nbytes = 0;
 
+	#ifdef HAVE_SENDFILE
+	// A queued file goes out on its own once everything before it is written.
+	if (!OutboundPages.Empty() && OutboundPages[0].IsFile()) {
+		_SendOutboundFile();
+		return;
+	}
+	#endif
+
 	#ifdef HAVE_WRITEV
-	int iovcnt = OutboundPages.size();
+	int iovcnt = OutboundPages.Size();
 	// Max of 16 outbound pages at a time
 	if (iovcnt > 16) iovcnt = 16;
 
 	iovec iov[16];
 
 	for(int i = 0; i < iovcnt; i++){
-		OutboundPage *op = &(OutboundPages[i]);
+		OutboundChain_t::Segment_t *op = &(OutboundPages[i]);
+		if (op->IsFile()) {
+			iovcnt = i;
+			break;
+		}
 		#ifdef CC_SUNWspro
 		// TODO: The void * cast works fine on Solaris 11, but
 		// I don't know at what point that changed from older Solaris.
@@ -1058,20 +1472,16 @@ void ConnectionDescriptor::_WriteOutboundData()
 	#else
 	char output_buffer [16 * 1024];
 
-	while ((OutboundPages.size() > 0) && (nbytes < sizeof(output_buffer))) {
-		OutboundPage *op = &(OutboundPages[0]);
-		if ((nbytes + op->Length - op->Offset) < sizeof (output_buffer)) {
-			memcpy (output_buffer + nbytes, op->Buffer + op->Offset, op->Length - op->Offset);
-			nbytes += (op->Length - op->Offset);
-			op->Free();
-			OutboundPages.pop_front();
-		}
-		else {
-			int len = sizeof(output_buffer) - nbytes;
-			memcpy (output_buffer + nbytes, op->Buffer + op->Offset, len);
-			op->Offset += len;
-			nbytes += len;
-		}
+	// Gather without dequeuing; whatever gets written is consumed afterwards.
+	for (size_t i = 0; (i < OutboundPages.Size()) && (nbytes < sizeof(output_buffer)); i++) {
+		OutboundChain_t::Segment_t *op = &(OutboundPages[i]);
+		if (op->IsFile())
+			break;
+		size_t len = op->Length - op->Offset;
+		if (len > sizeof(output_buffer) - nbytes)
+			len = sizeof(output_buffer) - nbytes;
+		memcpy (output_buffer + nbytes, op->Buffer + op->Offset, len);
+		nbytes += len;
 	}
 	#endif
 
@@ -1088,6 +1498,44 @@ void ConnectionDescriptor::_WriteOutboundData()
 	int bytes_written = write (GetSocket(), output_buffer, nbytes);
 	#endif
 
+	_FinishWrite (bytes_written, nbytes);
+}
+
+
+#ifdef HAVE_SENDFILE
+/***************************************
+ConnectionDescriptor::_SendOutboundFile
+***************************************/
+
+void ConnectionDescriptor::_SendOutboundFile()
+{
+	// Sends as much of the file segment at the front as the socket takes.
+	OutboundChain_t::Segment_t *op = &(OutboundPages[0]);
+	size_t nbytes = op->Length - op->Offset;
+	off_t offset = op->FileOffset + op->Offset;
+
+	assert (GetSocket() != INVALID_SOCKET);
+	int bytes_written = sendfile (GetSocket(), op->File, &offset, nbytes);
+
+	// Sending nothing without an error means the file was truncated after
+	// it was queued, and what's missing can never be sent.
+	if (bytes_written == 0) {
+		errno = EIO;
+		bytes_written = -1;
+	}
+
+	_FinishWrite (bytes_written, nbytes);
+}
+#endif
+
+
+/**********************************
+ConnectionDescriptor::_FinishWrite
+**********************************/
+
+void ConnectionDescriptor::_FinishWrite (int bytes_written, size_t nbytes)
+{
+	// Accounts for a write of up to nbytes from the front of the outbound chain.
 	bool err = false;
 #ifdef OS_WIN32
 	int e = WSAGetLastError();
@@ -1101,44 +1549,17 @@ void ConnectionDescriptor::_WriteOutboundData()
 
 	assert (bytes_written >= 0);
 	OutboundDataSize -= bytes_written;
+	MyEventMachine->Stats.BytesWritten [ReactorStats_t::Connection] += bytes_written;
 
 	if (ProxiedFrom && MaxOutboundBufSize && (unsigned int)GetOutboundDataSize() < MaxOutboundBufSize && ProxiedFrom->IsPaused())
 		ProxiedFrom->Resume();
 
-	#ifdef HAVE_WRITEV
-	if (!err) {
-		unsigned int sent = bytes_written;
-		deque<OutboundPage>::iterator op = OutboundPages.begin();
-
-		for (int i = 0; i < iovcnt; i++) {
-			if (iov[i].iov_len <= sent) {
-				// Sent this page in full, free it.
-				op->Free();
-				OutboundPages.pop_front();
+	// Release fully sent pages, and advance the offset into a partially sent one.
+	OutboundPages.Consume (bytes_written);
 
-				sent -= iov[i].iov_len;
-			} else {
-				// Sent part (or none) of this page, increment offset to send the remainder
-				op->Offset += sent;
-				break;
-			}
-
-			// Shouldn't be possible run out of pages before the loop ends
-			assert(op != OutboundPages.end());
-			*op++;
-		}
-	}
-	#else
-	if ((size_t)bytes_written < nbytes) {
-		int len = nbytes - bytes_written;
-		char *buffer = (char*) malloc (len + 1);
-		if (!buffer)
-			throw std::runtime_error ("bad alloc throwing back data");
-		memcpy (buffer, output_buffer + bytes_written, len);
-		buffer [len] = 0;
-		OutboundPages.push_front (OutboundPage (buffer, len));
-	}
-	#endif
+	// A short write means the kernel's buffer is full, and it will raise an
+	// edge when there's room again.
+	bWriteBlocked = ((size_t)bytes_written < nbytes);
 
 	_UpdateEvents(false, true);
 
@@ -1194,7 +1615,7 @@ void ConnectionDescriptor::StartTls()
 	if (SslBox)
 		throw std::runtime_error ("SSL/TLS already running on connection");
 
-	SslBox = new SslBox_t (bIsServer, PrivateKeyFilename, CertChainFilename, bSslVerifyPeer, bSslFailIfNoPeerCert, SniHostName, CipherList, EcdhCurve, DhParam, Protocols, GetBinding());
+	SslBox = new SslBox_t (bIsServer, PrivateKeyFilename, CertChainFilename, bSslVerifyPeer, bSslFailIfNoPeerCert, SniHostName, CipherList, EcdhCurve, DhParam, Protocols, ConnectAddress, GetBinding());
 	_DispatchCiphertext();
 
 }
@@ -1311,6 +1732,20 @@ const char *ConnectionDescriptor::GetSNIHostname()
 #endif
 
 
+/****************************************
+ConnectionDescriptor::IsSslSessionReused
+****************************************/
+
+#ifdef WITH_SSL
+bool ConnectionDescriptor::IsSslSessionReused()
+{
+	if (!SslBox)
+		throw std::runtime_error ("SSL/TLS not running on this connection");
+	return SslBox->IsSessionReused();
+}
+#endif
+
+
 /***********************************
 ConnectionDescriptor::VerifySslPeer
 ***********************************/
@@ -1588,6 +2023,8 @@ void AcceptorDescriptor::Read()
 		}
 		#ifdef HAVE_EPOLL
 		cd->GetEpollEvent()->events = 0;
+		if (cd->IsEdgeTriggered())
+			cd->GetEpollEvent()->events = EPOLLIN | EPOLLOUT | EPOLLET;
 		if (cd->SelectForRead())
 			cd->GetEpollEvent()->events |= EPOLLIN;
 		if (cd->SelectForWrite())
@@ -1651,7 +2088,12 @@ DatagramDescriptor::DatagramDescriptor
 
 DatagramDescriptor::DatagramDescriptor (SOCKET sd, EventMachine_t *parent_em):
 	EventableDescriptor (sd, parent_em),
-	OutboundDataSize (0)
+	OutboundDataSize (0),
+	BatchSize (0),
+	bDeliverBatches (false),
+	bDispatchingBatch (false),
+	PendingBatchSize (-1),
+	bPendingDeliverBatches (false)
 {
 	memset (&ReturnAddress, 0, sizeof(ReturnAddress));
 
@@ -1691,9 +2133,7 @@ DatagramDescriptor::~DatagramDescriptor
 
 DatagramDescriptor::~DatagramDescriptor()
 {
-	// Run down any stranded outbound data.
-	for (size_t i=0; i < OutboundPages.size(); i++)
-		OutboundPages[i].Free();
+	// Stranded outbound data is run down by the OutboundChain_t destructor.
 }
 
 
@@ -1721,6 +2161,11 @@ void DatagramDescriptor::Read()
 	assert (sd != INVALID_SOCKET);
 	LastActivity = MyEventMachine->GetCurrentLoopTime();
 
+	if (BatchSize > 0) {
+		_ReadBatch();
+		return;
+	}
+
 	// This is an extremely large read buffer.
 	// In many cases you wouldn't expect to get any more than 4K.
 	char readbuffer [16 * 1024];
@@ -1742,6 +2187,7 @@ void DatagramDescriptor::Read()
 
 		// In UDP, a zero-length packet is perfectly legal.
 		if (r >= 0) {
+			MyEventMachine->Stats.BytesRead [ReactorStats_t::Datagram] += r;
 
 			// Add a null-terminator at the the end of the buffer
 			// that we will send to the callback.
@@ -1777,38 +2223,129 @@ void DatagramDescriptor::Read()
 }
 
 
-/*************************
-DatagramDescriptor::Write
-*************************/
+/******************************
+DatagramDescriptor::_ReadBatch
+******************************/
 
-void DatagramDescriptor::Write()
+void DatagramDescriptor::_ReadBatch()
 {
-	/* It's possible for a socket to select writable and then no longer
-	 * be writable by the time we get around to writing. The kernel might
-	 * have used up its available output buffers between the select call
-	 * and when we get here. So this condition is not an error.
-	 * This code is very reminiscent of ConnectionDescriptor::_WriteOutboundData,
-	 * but differs in the that the outbound data pages (received from the
-	 * user) are _message-structured._ That is, we send each of them out
-	 * one message at a time.
-	 * TODO, we are currently suppressing the EMSGSIZE error!!!
+	/* Receives up to BatchSize datagrams into slots of the reactor's read
+	 * arena, with a single recvmmsg where we have it. Then they're either
+	 * dispatched one by one like Read does, each with its own return
+	 * address, or all together as an EM_CONNECTION_DATAGRAMS event.
 	 */
-
+	// In case an exception got out of the last dispatch before it finished.
+	bDispatchingBatch = false;
+	_ApplyPendingBatching();
+	if (BatchSize == 0) {
+		Read();
+		return;
+	}
+
+	SOCKET sd = GetSocket();
+	char *arena = MyEventMachine->GetReadArena (BatchSize * SlotSize);
+	int count = 0;
+
+	#ifdef HAVE_RECVMMSG
+	for (int i = 0; i < BatchSize; i++) {
+		BatchIovecs[i].iov_base = arena + (i * SlotSize);
+		BatchIovecs[i].iov_len = SlotSize - 1;
+		memset (&BatchHeaders[i], 0, sizeof(BatchHeaders[i]));
+		BatchHeaders[i].msg_hdr.msg_name = &BatchSenders[i];
+		BatchHeaders[i].msg_hdr.msg_namelen = sizeof(BatchSenders[i]);
+		BatchHeaders[i].msg_hdr.msg_iov = &BatchIovecs[i];
+		BatchHeaders[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	count = recvmmsg (sd, &BatchHeaders[0], BatchSize, 0, NULL);
+	if (count <= 0)
+		return;
+
+	for (int i = 0; i < count; i++) {
+		BatchDatagrams[i].data = arena + (i * SlotSize);
+		BatchDatagrams[i].length = BatchHeaders[i].msg_len;
+		BatchDatagrams[i].sender = (struct sockaddr*) &BatchSenders[i];
+		BatchDatagrams[i].sender_length = BatchHeaders[i].msg_hdr.msg_namelen;
+	}
+	#else
+	for (; count < BatchSize; count++) {
+		char *slot = arena + (count * SlotSize);
+		socklen_t slen = sizeof(BatchSenders[count]);
+		int r = recvfrom (sd, slot, SlotSize - 1, 0, (struct sockaddr*) &BatchSenders[count], &slen);
+		if (r < 0)
+			break;
+		BatchDatagrams[count].data = slot;
+		BatchDatagrams[count].length = r;
+		BatchDatagrams[count].sender = (struct sockaddr*) &BatchSenders[count];
+		BatchDatagrams[count].sender_length = slen;
+	}
+	if (count == 0)
+		return;
+	#endif
+
+	for (int i = 0; i < count; i++) {
+		MyEventMachine->Stats.BytesRead [ReactorStats_t::Datagram] += BatchDatagrams[i].length;
+		// The same guard byte Read puts after every datagram.
+		((char*) BatchDatagrams[i].data) [BatchDatagrams[i].length] = 0;
+	}
+
+	if (bDeliverBatches && !ProxyTarget) {
+		// Plain send_data replies to the last sender of the batch.
+		memset (&ReturnAddress, 0, sizeof(ReturnAddress));
+		memcpy (&ReturnAddress, BatchDatagrams[count - 1].sender, BatchDatagrams[count - 1].sender_length);
+		(*EventCallback)(GetBinding(), EM_CONNECTION_DATAGRAMS, (const char*) &BatchDatagrams[0], count);
+		return;
+	}
+
+	bDispatchingBatch = true;
+	for (int i = 0; i < count; i++) {
+		memset (&ReturnAddress, 0, sizeof(ReturnAddress));
+		memcpy (&ReturnAddress, BatchDatagrams[i].sender, BatchDatagrams[i].sender_length);
+		_GenericInboundDispatch (BatchDatagrams[i].data, BatchDatagrams[i].length);
+	}
+	bDispatchingBatch = false;
+	_ApplyPendingBatching();
+}
+
+
+/*************************
+DatagramDescriptor::Write
+*************************/
+
+void DatagramDescriptor::Write()
+{
+	/* It's possible for a socket to select writable and then no longer
+	 * be writable by the time we get around to writing. The kernel might
+	 * have used up its available output buffers between the select call
+	 * and when we get here. So this condition is not an error.
+	 * This code is very reminiscent of ConnectionDescriptor::_WriteOutboundData,
+	 * but differs in the that the outbound data pages (received from the
+	 * user) are _message-structured._ That is, we send each of them out
+	 * one message at a time.
+	 * TODO, we are currently suppressing the EMSGSIZE error!!!
+	 */
+
 	SOCKET sd = GetSocket();
 	assert (sd != INVALID_SOCKET);
 	LastActivity = MyEventMachine->GetCurrentLoopTime();
 
-	assert (OutboundPages.size() > 0);
+	assert (OutboundPages.Size() > 0);
 
-	// Send out up to 10 packets, then cycle the machine.
+	// Send out up to 10 packets, or one batch, then cycle the machine.
+	#ifdef HAVE_SENDMMSG
+	if (BatchSize > 0)
+		_WriteBatch();
+	else
+	#endif
 	for (int i = 0; i < 10; i++) {
-		if (OutboundPages.size() <= 0)
+		if (OutboundPages.Size() <= 0)
 			break;
-		OutboundPage *op = &(OutboundPages[0]);
+		OutboundChain_t::Segment_t *op = &(OutboundPages[0]);
+		struct sockaddr_in6 *from = &(OutboundAddresses.front());
 
 		// The nasty cast to (char*) is needed because Windows is brain-dead.
-		int s = sendto (sd, (char*)op->Buffer, op->Length, 0, (struct sockaddr*)&(op->From),
-		               (op->From.sin6_family == AF_INET6 ? sizeof (struct sockaddr_in6) : sizeof (struct sockaddr_in)));
+		int s = sendto (sd, (char*)op->Buffer, op->Length, 0, (struct sockaddr*)from,
+		               (from->sin6_family == AF_INET6 ? sizeof (struct sockaddr_in6) : sizeof (struct sockaddr_in)));
 #ifdef OS_WIN32
 		int e = WSAGetLastError();
 #else
@@ -1816,8 +2353,10 @@ void DatagramDescriptor::Write()
 #endif
 
 		OutboundDataSize -= op->Length;
-		op->Free();
-		OutboundPages.pop_front();
+		if (s != SOCKET_ERROR)
+			MyEventMachine->Stats.BytesWritten [ReactorStats_t::Datagram] += s;
+		OutboundPages.PopFront();
+		OutboundAddresses.pop_front();
 
 		if (s == SOCKET_ERROR) {
 			#ifdef OS_UNIX
@@ -1848,6 +2387,54 @@ void DatagramDescriptor::Write()
 }
 
 
+/*******************************
+DatagramDescriptor::_WriteBatch
+*******************************/
+
+#ifdef HAVE_SENDMMSG
+void DatagramDescriptor::_WriteBatch()
+{
+	SOCKET sd = GetSocket();
+	int count = min ((size_t) BatchSize, OutboundPages.Size());
+
+	for (int i = 0; i < count; i++) {
+		OutboundChain_t::Segment_t *op = &(OutboundPages[i]);
+		struct sockaddr_in6 *to = &(OutboundAddresses[i]);
+		BatchIovecs[i].iov_base = (void*) op->Buffer;
+		BatchIovecs[i].iov_len = op->Length;
+		memset (&BatchHeaders[i], 0, sizeof(BatchHeaders[i]));
+		BatchHeaders[i].msg_hdr.msg_name = to;
+		BatchHeaders[i].msg_hdr.msg_namelen = (to->sin6_family == AF_INET6 ? sizeof (struct sockaddr_in6) : sizeof (struct sockaddr_in));
+		BatchHeaders[i].msg_hdr.msg_iov = &BatchIovecs[i];
+		BatchHeaders[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	int s = sendmmsg (sd, &BatchHeaders[0], count, 0);
+	int e = errno;
+
+	if (s > 0) {
+		for (int i = 0; i < s; i++) {
+			OutboundDataSize -= OutboundPages[0].Length;
+			MyEventMachine->Stats.BytesWritten [ReactorStats_t::Datagram] += BatchHeaders[i].msg_len;
+			OutboundPages.PopFront();
+			OutboundAddresses.pop_front();
+		}
+		return;
+	}
+
+	// sendmmsg only fails outright when the first datagram can't go. Like
+	// the sendto loop in Write, drop it and close on anything but a would-block.
+	OutboundDataSize -= OutboundPages[0].Length;
+	OutboundPages.PopFront();
+	OutboundAddresses.pop_front();
+	if ((e != EINPROGRESS) && (e != EWOULDBLOCK) && (e != EINTR)) {
+		UnbindReasonCode = e;
+		Close();
+	}
+}
+#endif
+
+
 /**********************************
 DatagramDescriptor::SelectForWrite
 **********************************/
@@ -1861,7 +2448,7 @@ bool DatagramDescriptor::SelectForWrite()
 	 * which may be wrong.
 	 */
 	//return (GetOutboundDataSize() > 0); (Original)
-	return (OutboundPages.size() > 0);
+	return (OutboundPages.Size() > 0);
 }
 
 
@@ -1880,13 +2467,10 @@ int DatagramDescriptor::SendOutboundData (const char *data, unsigned long length
 
 	if (!data && (length > 0))
 		throw std::runtime_error ("bad outbound data");
-	char *buffer = (char *) malloc (length + 1);
-	if (!buffer)
-		throw std::runtime_error ("no allocation for outbound data");
-	memcpy (buffer, data, length);
-	buffer [length] = 0;
-	OutboundPages.push_back (OutboundPage (buffer, length, ReturnAddress));
+	OutboundPages.Append (data, length, false);
+	OutboundAddresses.push_back (ReturnAddress);
 	OutboundDataSize += length;
+	MyEventMachine->Stats.RecordOutbound (ReactorStats_t::Datagram, OutboundDataSize);
 
 	#ifdef HAVE_EPOLL
 	EpollEvent.events = (EPOLLIN | EPOLLOUT);
@@ -1927,13 +2511,10 @@ int DatagramDescriptor::SendOutboundDatagram (const char *data, unsigned long le
 
 	if (!data && (length > 0))
 		throw std::runtime_error ("bad outbound data");
-	char *buffer = (char *) malloc (length + 1);
-	if (!buffer)
-		throw std::runtime_error ("no allocation for outbound data");
-	memcpy (buffer, data, length);
-	buffer [length] = 0;
-	OutboundPages.push_back (OutboundPage (buffer, length, addr_here));
+	OutboundPages.Append (data, length, false);
+	OutboundAddresses.push_back (addr_here);
 	OutboundDataSize += length;
+	MyEventMachine->Stats.RecordOutbound (ReactorStats_t::Datagram, OutboundDataSize);
 
 	#ifdef HAVE_EPOLL
 	EpollEvent.events = (EPOLLIN | EPOLLOUT);
@@ -1950,6 +2531,59 @@ int DatagramDescriptor::SendOutboundDatagram (const char *data, unsigned long le
 }
 
 
+/*******************************
+DatagramDescriptor::SetBatching
+*******************************/
+
+int DatagramDescriptor::SetBatching (int batch_size, bool deliver_batches)
+{
+	// Zero goes back to reading and sending a datagram per call.
+	if (batch_size < 0 || batch_size > MaxBatchSize)
+		return 0;
+
+	if (bDispatchingBatch) {
+		// The batch being dispatched still points into the vectors.
+		PendingBatchSize = batch_size;
+		bPendingDeliverBatches = deliver_batches;
+		return 1;
+	}
+
+	_ApplyBatching (batch_size, deliver_batches);
+	return 1;
+}
+
+
+/*****************************************
+DatagramDescriptor::_ApplyPendingBatching
+*****************************************/
+
+void DatagramDescriptor::_ApplyPendingBatching()
+{
+	if (PendingBatchSize < 0)
+		return;
+	_ApplyBatching (PendingBatchSize, bPendingDeliverBatches);
+	PendingBatchSize = -1;
+}
+
+
+/**********************************
+DatagramDescriptor::_ApplyBatching
+**********************************/
+
+void DatagramDescriptor::_ApplyBatching (int batch_size, bool deliver_batches)
+{
+	BatchSize = batch_size;
+	bDeliverBatches = deliver_batches && (batch_size > 0);
+
+	BatchSenders.resize (BatchSize);
+	BatchDatagrams.resize (BatchSize);
+	#if defined(HAVE_RECVMMSG) || defined(HAVE_SENDMMSG)
+	BatchHeaders.resize (BatchSize);
+	BatchIovecs.resize (BatchSize);
+	#endif
+}
+
+
 /*********************************
 ConnectionDescriptor::GetPeername
 *********************************/
@@ -2002,6 +2636,97 @@ int ConnectionDescriptor::SetCommInactivityTimeout (uint64_t value)
 	return 1;
 }
 
+/***********************************
+ConnectionDescriptor::RunDeferredIO
+***********************************/
+
+void ConnectionDescriptor::RunDeferredIO()
+{
+	if (!bEdgeTriggered)
+		return;
+
+	if (bWritePending) {
+		bWritePending = false;
+		if (!bConnectPending && SelectForWrite())
+			Write();
+	}
+
+	if (bReadPending && SelectForRead() && GetSocket() != INVALID_SOCKET)
+		Read();
+}
+
+/**************************************
+ConnectionDescriptor::SetReadBatchSize
+**************************************/
+
+int ConnectionDescriptor::SetReadBatchSize (int value)
+{
+	// Zero goes back to dispatching every read as it comes in.
+	if (value < 0)
+		return 0;
+	ReadBatchSize = value;
+	return 1;
+}
+
+/***************************************
+ConnectionDescriptor::SetInboundFraming
+***************************************/
+
+int ConnectionDescriptor::SetInboundFraming (int mode, const char *delimiter, int delimiter_length, int prefix_size, unsigned long max_frame_size)
+{
+	/* Starts, changes or (with EM_FRAMING_NONE) stops splitting inbound
+	 * data into frames. Bytes the previous stage was holding on to are run
+	 * through the new one, or delivered as plain data without one.
+	 */
+	Framer_t *framer = NULL;
+
+	switch (mode) {
+		case EM_FRAMING_NONE:
+			break;
+		case EM_FRAMING_LINE:
+			framer = new Framer_t (Framer_t::Line, NULL, 0, 0, max_frame_size);
+			break;
+		case EM_FRAMING_DELIMITER:
+			if (!delimiter || delimiter_length <= 0)
+				return 0;
+			framer = new Framer_t (Framer_t::Delimiter, delimiter, delimiter_length, 0, max_frame_size);
+			break;
+		case EM_FRAMING_LENGTH_PREFIX:
+			if (prefix_size < 1 || prefix_size > 4)
+				return 0;
+			framer = new Framer_t (Framer_t::LengthPrefix, NULL, 0, prefix_size, max_frame_size);
+			break;
+		default:
+			return 0;
+	}
+
+	Framer_t *previous = InboundFramer;
+	InboundFramer = framer;
+
+	// While a batch is out, its stage is handed over when it comes back.
+	// Any stage set up and replaced in the meantime hasn't seen any data.
+	if (previous && previous != DeliveringFramer) {
+		if (previous->GetBuffered() > 0)
+			_FramedInboundDispatch (previous->GetBufferedData(), previous->GetBuffered());
+		delete previous;
+		_DeliverFrames();
+	}
+
+	return 1;
+}
+
+/***************************************
+ConnectionDescriptor::SetReadIterations
+***************************************/
+
+int ConnectionDescriptor::SetReadIterations (int value)
+{
+	if (value < 1)
+		return 0;
+	ReadIterations = value;
+	return 1;
+}
+
 /*******************************
 DatagramDescriptor::GetPeername
 *******************************/
@@ -2118,3 +2843,368 @@ void InotifyDescriptor::Write()
 {
 	throw std::runtime_error("bad code path in inotify");
 }
+
+
+#ifdef HAVE_INOTIFY
+
+/******************************
+TailDescriptor::TailDescriptor
+******************************/
+
+TailDescriptor::TailDescriptor (EventMachine_t *em, const char *path, int flags, unsigned long max_line_size):
+	EventableDescriptor(0, em),
+	Pattern (path),
+	Flags (flags),
+	File (-1),
+	Offset (0),
+	Device (0),
+	Inode (0),
+	bBacklog (true),
+	FileWatch (-1),
+	DirectoryWatch (-1),
+	LineFramer (NULL)
+{
+	int fd = inotify_init();
+	if (fd == -1) {
+		char buf[200];
+		snprintf (buf, sizeof(buf)-1, "unable to create inotify descriptor: %s", strerror(errno));
+		throw std::runtime_error (buf);
+	}
+
+	MySocket = fd;
+	SetSocketNonblocking(MySocket);
+	SetFdCloexec(MySocket);
+	#ifdef HAVE_EPOLL
+	EpollEvent.events = EPOLLIN;
+	#endif
+
+	if (Flags & EM_TAIL_LINES)
+		LineFramer = new Framer_t (Framer_t::Line, NULL, 0, 0, max_line_size);
+
+	/* Where tailing starts from is settled here rather than on the first
+	 * heartbeat, which does the reading, so nothing appended in between is
+	 * missed. A file that only turns up later is read from its start.
+	 */
+	string current = CurrentPath (Pattern, Flags);
+	_Watch (current);
+	if (_Open (current) && !(Flags & EM_TAIL_FROM_START)) {
+		off_t end = lseek (File, 0, SEEK_END);
+		if (end > 0)
+			Offset = end;
+	}
+}
+
+
+/*******************************
+TailDescriptor::~TailDescriptor
+*******************************/
+
+TailDescriptor::~TailDescriptor()
+{
+	// The watches go with the inotify descriptor, which Close takes care of.
+	_CloseFile();
+	delete LineFramer;
+}
+
+
+/***************************
+TailDescriptor::CurrentPath
+***************************/
+
+string TailDescriptor::CurrentPath (const string &pattern, int flags)
+{
+	// Patterns are expanded in UTC, so names don't jump when DST changes.
+	if (!(flags & EM_TAIL_STRFTIME))
+		return pattern;
+
+	time_t now = time (NULL);
+	struct tm tm;
+	gmtime_r (&now, &tm);
+
+	char buf[1024];
+	size_t n = strftime (buf, sizeof(buf), pattern.c_str(), &tm);
+	return (n > 0) ? string (buf, n) : pattern;
+}
+
+
+/***************************
+TailDescriptor::DirectoryOf
+***************************/
+
+string TailDescriptor::DirectoryOf (const string &path)
+{
+	size_t slash = path.rfind ('/');
+	if (slash == string::npos)
+		return ".";
+	if (slash == 0)
+		return "/";
+	return path.substr (0, slash);
+}
+
+
+/********************
+TailDescriptor::Read
+********************/
+
+void TailDescriptor::Read()
+{
+	/* Events only say that something happened to the file or its
+	 * directory. They're drained, and _Check works out what it was from
+	 * the file system, which also covers any the queue overflowed on.
+	 */
+	char buffer[4096];
+	for (;;) {
+		int r = read (MySocket, buffer, sizeof(buffer));
+		if (r <= 0)
+			break;
+	}
+
+	_Check();
+	if (bBacklog)
+		MyEventMachine->QueueHeartbeat (this);
+}
+
+
+/*********************
+TailDescriptor::Write
+*********************/
+
+void TailDescriptor::Write()
+{
+	throw std::runtime_error ("bad code path in tail");
+}
+
+
+/*************************
+TailDescriptor::Heartbeat
+*************************/
+
+void TailDescriptor::Heartbeat()
+{
+	_Check();
+}
+
+
+/********************************
+TailDescriptor::GetNextHeartbeat
+********************************/
+
+uint64_t TailDescriptor::GetNextHeartbeat()
+{
+	/* Heartbeats do the first read, carry on with one that was cut short,
+	 * and look for the next name of a pattern every so often.
+	 */
+	if (NextHeartbeat)
+		MyEventMachine->ClearHeartbeat (NextHeartbeat, this);
+
+	NextHeartbeat = 0;
+
+	if (!ShouldDelete()) {
+		if (bBacklog)
+			NextHeartbeat = MyEventMachine->GetRealTime();
+		else if (Flags & EM_TAIL_STRFTIME)
+			NextHeartbeat = MyEventMachine->GetRealTime() + PatternCheckInterval;
+	}
+
+	return NextHeartbeat;
+}
+
+
+/**********************
+TailDescriptor::_Check
+**********************/
+
+void TailDescriptor::_Check()
+{
+	if (IsCloseScheduled())
+		return;
+
+	// Whatever went into the old file before it was replaced comes first.
+	if (File != -1) {
+		_ReadAppended();
+		if (bBacklog || IsCloseScheduled())
+			return;
+	}
+
+	string current = CurrentPath (Pattern, Flags);
+	_Watch (current);
+
+	/* Nothing there means it was removed, or the next file of a pattern
+	 * hasn't been created yet. Either way the open one is kept until
+	 * there's a replacement.
+	 */
+	struct stat st;
+	if (stat (current.c_str(), &st) == -1)
+		return;
+	if (File != -1 && current == Path && st.st_dev == Device && st.st_ino == Inode)
+		return;
+
+	bool rotated = !Path.empty();
+	if (LineFramer) {
+		LineFramer->Flush();
+		_DeliverFrames();
+		if (IsCloseScheduled())
+			return;
+	}
+	_CloseFile();
+
+	if (!_Open (current))
+		return;
+	if (rotated) {
+		assert (EventCallback);
+		(*EventCallback)(GetBinding(), EM_FILE_ROTATED, Path.data(), Path.size());
+	}
+	_ReadAppended();
+}
+
+
+/**********************
+TailDescriptor::_Watch
+**********************/
+
+void TailDescriptor::_Watch (const string &path)
+{
+	/* The directory is watched for the file being created, or renamed
+	 * over. A pattern can move on to another directory, in which case the
+	 * watch follows it.
+	 */
+	string dir = DirectoryOf (path);
+	if (DirectoryWatch != -1 && dir == Directory)
+		return;
+
+	if (DirectoryWatch != -1)
+		inotify_rm_watch (MySocket, DirectoryWatch);
+	DirectoryWatch = inotify_add_watch (MySocket, dir.c_str(), IN_CREATE | IN_MOVED_TO);
+	Directory = dir;
+}
+
+
+/*********************
+TailDescriptor::_Open
+*********************/
+
+bool TailDescriptor::_Open (const string &path)
+{
+	int fd = open (path.c_str(), O_RDONLY);
+	if (fd == -1)
+		return false;
+	SetFdCloexec (fd);
+
+	struct stat st;
+	if (fstat (fd, &st) == -1) {
+		close (fd);
+		return false;
+	}
+
+	File = fd;
+	Path = path;
+	Offset = 0;
+	Device = st.st_dev;
+	Inode = st.st_ino;
+
+	// IN_ATTRIB catches the last link going, IN_MOVE_SELF a rename.
+	FileWatch = inotify_add_watch (MySocket, path.c_str(), IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF);
+	return true;
+}
+
+
+/**************************
+TailDescriptor::_CloseFile
+**************************/
+
+void TailDescriptor::_CloseFile()
+{
+	if (FileWatch != -1) {
+		// Don't let go of the directory's watch, if it shares a descriptor.
+		if (FileWatch != DirectoryWatch)
+			inotify_rm_watch (MySocket, FileWatch);
+		FileWatch = -1;
+	}
+	if (File != -1) {
+		close (File);
+		File = -1;
+	}
+}
+
+
+/*****************************
+TailDescriptor::_ReadAppended
+*****************************/
+
+void TailDescriptor::_ReadAppended()
+{
+	struct stat st;
+	if (fstat (File, &st) == -1)
+		return;
+
+	// Truncated, as copytruncate rotation does. The line in progress is
+	// ended where it stopped, and reading starts over.
+	if (st.st_size < Offset) {
+		Offset = 0;
+		if (LineFramer) {
+			LineFramer->Flush();
+			_DeliverFrames();
+		}
+		if (IsCloseScheduled())
+			return;
+		assert (EventCallback);
+		(*EventCallback)(GetBinding(), EM_FILE_TRUNCATED, NULL, 0);
+	}
+
+	bBacklog = false;
+	unsigned long total = 0;
+
+	while (!IsCloseScheduled()) {
+		if (total >= MaxReadPerPass) {
+			bBacklog = true;
+			break;
+		}
+
+		char *buffer = MyEventMachine->GetReadArena (ChunkSize);
+		ssize_t r = pread (File, buffer, ChunkSize, Offset);
+		if (r <= 0)
+			break;
+
+		Offset += r;
+		total += r;
+		buffer[r] = 0; // guard byte
+		_DispatchInboundData (buffer, r);
+	}
+}
+
+
+/************************************
+TailDescriptor::_DispatchInboundData
+************************************/
+
+void TailDescriptor::_DispatchInboundData (const char *buffer, unsigned long size)
+{
+	if (!LineFramer) {
+		_GenericInboundDispatch (buffer, size);
+		return;
+	}
+
+	if (!LineFramer->Feed (buffer, size)) {
+		UnbindReasonCode = EMSGSIZE;
+		ScheduleClose (false);
+		return;
+	}
+	_DeliverFrames();
+}
+
+
+/******************************
+TailDescriptor::_DeliverFrames
+******************************/
+
+void TailDescriptor::_DeliverFrames()
+{
+	if (!LineFramer->HasFrames())
+		return;
+
+	assert (EventCallback);
+	(*EventCallback)(GetBinding(), EM_CONNECTION_FRAMES, (const char*) LineFramer->GetFrames(), LineFramer->GetFrameCount());
+	LineFramer->ConsumeFrames();
+}
+
+#endif // HAVE_INOTIFY
@@ -22,6 +22,7 @@ See the file COPYING for complete licensing information.
 
 
 class EventMachine_t; // forward reference
+class Framer_t; // forward reference
 #ifdef WITH_SSL
 class SslBox_t; // forward reference
 #endif
@@ -33,7 +34,7 @@ bool SetFdCloexec (int);
 class EventableDescriptor
 *************************/
 
-class EventableDescriptor: public Bindable_t
+class EventableDescriptor: public Bindable_t, public TimerWheel_t::Entry_t
 {
 	public:
 		EventableDescriptor (SOCKET, EventMachine_t*);
@@ -77,6 +78,7 @@ class EventableDescriptor: public Bindable_t
 		virtual const char *GetCipherName() {return NULL;}
 		virtual const char *GetCipherProtocol() {return NULL;}
 		virtual const char *GetSNIHostname() {return NULL;}
+		virtual bool IsSslSessionReused() {return false;}
 		#endif
 
 		virtual uint64_t GetCommInactivityTimeout() {return 0;}
@@ -87,8 +89,13 @@ class EventableDescriptor: public Bindable_t
 
 		#ifdef HAVE_EPOLL
 		struct epoll_event *GetEpollEvent() { return &EpollEvent; }
+		uint32_t GetEpollRegistered() { return EpollRegistered; }
+		void SetEpollRegistered (uint32_t events) { EpollRegistered = events; }
 		#endif
 
+		// Edge-triggered descriptors do I/O they put off here, between polls.
+		virtual void RunDeferredIO() {}
+
 		#ifdef HAVE_KQUEUE
 		bool GetKqueueArmWrite() { return bKqueueArmWrite; }
 		#endif
@@ -132,6 +139,7 @@ class EventableDescriptor: public Bindable_t
 
 		#ifdef HAVE_EPOLL
 		struct epoll_event EpollEvent;
+		uint32_t EpollRegistered;
 		#endif
 
 		#ifdef HAVE_KQUEUE
@@ -178,8 +186,12 @@ class ConnectionDescriptor: public EventableDescriptor
 		virtual ~ConnectionDescriptor();
 
 		int SendOutboundData (const char*, unsigned long);
+		#ifdef HAVE_SENDFILE
+		int SendOutboundFile (int, off_t);
+		#endif
 
 		void SetConnectPending (bool f);
+		void SetConnectAddress (const char*, int);
 		virtual void ScheduleClose (bool after_writing);
 		virtual void HandleError();
 
@@ -192,6 +204,7 @@ class ConnectionDescriptor: public EventableDescriptor
 		bool Resume();
 
 		bool IsNotifyReadable(){ return bNotifyReadable; }
+		bool IsEdgeTriggered(){ return bEdgeTriggered; }
 		bool IsNotifyWritable(){ return bNotifyWritable; }
 
 		virtual void Read();
@@ -213,6 +226,7 @@ class ConnectionDescriptor: public EventableDescriptor
 		virtual const char *GetCipherName();
 		virtual const char *GetCipherProtocol();
 		virtual const char *GetSNIHostname();
+		virtual bool IsSslSessionReused();
 		virtual bool VerifySslPeer(const char*);
 		virtual void AcceptSslPeer();
 		#endif
@@ -228,14 +242,14 @@ class ConnectionDescriptor: public EventableDescriptor
 		virtual int ReportErrorStatus();
 		virtual bool IsConnectPending(){ return bConnectPending; }
 
-	protected:
-		struct OutboundPage {
-			OutboundPage (const char *b, int l, int o=0): Buffer(b), Length(l), Offset(o) {}
-			void Free() {if (Buffer) free (const_cast<char*>(Buffer)); }
-			const char *Buffer;
-			int Length;
-			int Offset;
-		};
+		virtual void RunDeferredIO();
+
+		int GetReadBatchSize() {return ReadBatchSize;}
+		int SetReadBatchSize (int);
+		int GetReadIterations() {return ReadIterations;}
+		int SetReadIterations (int);
+
+		int SetInboundFraming (int, const char*, int, int, unsigned long);
 
 	protected:
 		bool bConnectPending;
@@ -246,9 +260,33 @@ class ConnectionDescriptor: public EventableDescriptor
 		bool bReadAttemptedAfterClose;
 		bool bWriteAttemptedAfterClose;
 
-		deque<OutboundPage> OutboundPages;
+		OutboundChain_t OutboundPages;
 		int OutboundDataSize;
 
+		// Zero reads and dispatches one stack buffer at a time.
+		int ReadBatchSize;
+		int ReadIterations;
+
+		// Frames found during a read are delivered in one callback at its end.
+		Framer_t *InboundFramer;
+		Framer_t *DeliveringFramer;
+
+		/* With edge-triggered epoll, a connection is registered for both
+		 * directions once and never rearmed. Reads and writes that can't be
+		 * finished when the edge arrives are flagged and picked up through
+		 * RunDeferredIO instead.
+		 */
+		bool bEdgeTriggered;
+		bool bReadPending;
+		bool bWritePending;
+		bool bWriteBlocked;
+
+		#ifdef HAVE_SPLICE
+		// Pipe that proxied data passes through on its way to ProxyTarget.
+		int SplicePipe[2];
+		bool bSpliceFailed;
+		#endif
+
 		#ifdef WITH_SSL
 		SslBox_t *SslBox;
 		std::string CertChainFilename;
@@ -262,6 +300,8 @@ class ConnectionDescriptor: public EventableDescriptor
 		bool bSslFailIfNoPeerCert;
 		std::string SniHostName;
 		bool bSslPeerAccepted;
+		// host:port given to connect, which client TLS sessions are cached under.
+		std::string ConnectAddress;
 		#endif
 
 		#ifdef HAVE_KQUEUE
@@ -274,8 +314,21 @@ class ConnectionDescriptor: public EventableDescriptor
 		void _UpdateEvents();
 		void _UpdateEvents(bool, bool);
 		void _WriteOutboundData();
+		void _FinishWrite (int, size_t);
+		#ifdef HAVE_SENDFILE
+		void _SendOutboundFile();
+		#endif
 		void _DispatchInboundData (const char *buffer, unsigned long size);
+		void _FramedInboundDispatch (const char *buffer, unsigned long size);
+		void _DeliverFrames();
 		void _DispatchCiphertext();
+		void _DisableEdgeTrigger();
+		void _FinishEdgeTriggeredRead (bool, bool, unsigned long);
+		#ifdef HAVE_SPLICE
+		enum { SpliceChunk = 64 * 1024 };
+		bool _SpliceProxy();
+		void _DrainSplicePipe (ConnectionDescriptor*, unsigned long);
+		#endif
 		int _SendRawOutboundData (const char *buffer, unsigned long size);
 		void _CheckHandshakeStatus();
 
@@ -311,20 +364,51 @@ class DatagramDescriptor: public EventableDescriptor
 		virtual uint64_t GetCommInactivityTimeout();
 		virtual int SetCommInactivityTimeout (uint64_t value);
 
-	protected:
-		struct OutboundPage {
-			OutboundPage (const char *b, int l, struct sockaddr_in6 f, int o=0): Buffer(b), Length(l), Offset(o), From(f) {}
-			void Free() {if (Buffer) free (const_cast<char*>(Buffer)); }
-			const char *Buffer;
-			int Length;
-			int Offset;
-			struct sockaddr_in6 From;
+		int GetBatchSize() {return (PendingBatchSize >= 0) ? PendingBatchSize : BatchSize;}
+		int SetBatching (int, bool);
+
+		enum {
+			// Each datagram gets this much of the read arena, as Read's own
+			// buffer does. The batch size is capped to keep the arena in check.
+			SlotSize = 16 * 1024,
+			MaxBatchSize = 256
 		};
 
-		deque<OutboundPage> OutboundPages;
+	protected:
+		void _ReadBatch();
+		void _ApplyBatching (int, bool);
+		void _ApplyPendingBatching();
+		#ifdef HAVE_SENDMMSG
+		void _WriteBatch();
+		#endif
+
+		// One destination address per queued datagram, in step with OutboundPages.
+		OutboundChain_t OutboundPages;
+		deque<struct sockaddr_in6> OutboundAddresses;
 		int OutboundDataSize;
 
 		struct sockaddr_in6 ReturnAddress;
+
+		/* With a batch size set, datagrams are received with recvmmsg and sent
+		 * with sendmmsg up to that many at a time, falling back to a loop of
+		 * recvfrom where those are missing. bDeliverBatches hands each batch
+		 * received to the callback in one EM_CONNECTION_DATAGRAMS event.
+		 */
+		int BatchSize;
+		bool bDeliverBatches;
+
+		/* receive_data can change the batching while _ReadBatch is still
+		 * walking the batch, so the change waits until the batch is done.
+		 */
+		bool bDispatchingBatch;
+		int PendingBatchSize;
+		bool bPendingDeliverBatches;
+		vector<struct sockaddr_in6> BatchSenders;
+		vector<struct evma_datagram> BatchDatagrams;
+		#if defined(HAVE_RECVMMSG) || defined(HAVE_SENDMMSG)
+		vector<struct mmsghdr> BatchHeaders;
+		vector<struct iovec> BatchIovecs;
+		#endif
 };
 
 
@@ -373,19 +457,10 @@ class PipeDescriptor: public EventableDescriptor
 
 		virtual bool GetSubprocessPid (pid_t*);
 
-	protected:
-		struct OutboundPage {
-			OutboundPage (const char *b, int l, int o=0): Buffer(b), Length(l), Offset(o) {}
-			void Free() {if (Buffer) free (const_cast<char*>(Buffer)); }
-			const char *Buffer;
-			int Length;
-			int Offset;
-		};
-
 	protected:
 		bool bReadAttemptedAfterClose;
 
-		deque<OutboundPage> OutboundPages;
+		OutboundChain_t OutboundPages;
 		int OutboundDataSize;
 
 		pid_t SubprocessPid;
@@ -439,4 +514,78 @@ class InotifyDescriptor: public EventableDescriptor
 		virtual bool SelectForWrite() {return false;}
 };
 
+
+/********************
+class TailDescriptor
+********************/
+
+/* Follows a file that's being appended to, such as a log. It has an
+ * inotify instance of its own watching the file and its directory, and
+ * reads only what was appended since the offset it last got to. When
+ * another file takes the name over, or the next one of a strftime pattern
+ * like an hourly log's turns up, the old file is read to its end before
+ * switching to the new one. A file that shrinks is read again from its
+ * start. With EM_TAIL_LINES, lines are framed here and delivered in
+ * batches, as EM_CONNECTION_FRAMES.
+ */
+
+#ifdef HAVE_INOTIFY
+class TailDescriptor: public EventableDescriptor
+{
+	public:
+		TailDescriptor (EventMachine_t*, const char*, int, unsigned long);
+		virtual ~TailDescriptor();
+
+		virtual void Read();
+		virtual void Write();
+		virtual void Heartbeat();
+
+		virtual bool SelectForRead() {return true;}
+		virtual bool SelectForWrite() {return false;}
+
+		virtual uint64_t GetNextHeartbeat();
+
+		static string CurrentPath (const string&, int);
+		static string DirectoryOf (const string&);
+
+		enum {
+			ChunkSize = 64 * 1024,
+			// Other descriptors get a turn after this much, and the rest is
+			// read on the next pass.
+			MaxReadPerPass = 1024 * 1024,
+			// How often a strftime pattern is checked for its next name, in
+			// case that's in a directory that isn't being watched (usec).
+			PatternCheckInterval = 1000000
+		};
+
+	protected:
+		void _Check();
+		void _Watch (const string&);
+		bool _Open (const string&);
+		void _CloseFile();
+		void _ReadAppended();
+		void _DispatchInboundData (const char*, unsigned long);
+		void _DeliverFrames();
+
+		string Pattern;
+		int Flags;
+
+		// The file being read, and how far into it.
+		string Path;
+		int File;
+		off_t Offset;
+		dev_t Device;
+		ino_t Inode;
+
+		// Set while there's more to read than one pass takes.
+		bool bBacklog;
+
+		string Directory;
+		int FileWatch;
+		int DirectoryWatch;
+
+		Framer_t *LineFramer;
+};
+#endif // HAVE_INOTIFY
+
 #endif // __EventableDescriptor__H_
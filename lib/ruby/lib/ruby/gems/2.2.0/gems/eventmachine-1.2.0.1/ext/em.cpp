@@ -32,6 +32,23 @@ static unsigned int MaxOutstandingTimers = 100000;
  */
 static unsigned int SimultaneousAcceptCount = 10;
 
+/* Selects the timer store for reactors created from now on: the original
+ * multimaps, or hierarchical timing wheels with O(1) insert and cancel.
+ */
+static bool UseTimerWheel = false;
+
+/* Registers stream connections with epoll as edge-triggered, for reactors
+ * created from now on. Only takes effect with the epoll poller.
+ */
+static bool UseEdgeTriggered = false;
+
+/* For reactors created from now on, fires timers at the end of each pass
+ * instead of the start. A caller that collects the events of a pass and
+ * delivers them once it returns then gets the timers' along with the rest,
+ * rather than after the next poll has waited for the timer after them.
+ */
+static bool UseEventBatching = false;
+
 /* Internal helper to create a socket with SOCK_CLOEXEC set, and fall
  * back to fcntl'ing it if the headers/runtime don't support it.
  */
@@ -98,6 +115,36 @@ void EventMachine_t::SetSimultaneousAcceptCount (int count)
 	SimultaneousAcceptCount = count;
 }
 
+bool EventMachine_t::GetUseTimerWheel()
+{
+	return UseTimerWheel;
+}
+
+void EventMachine_t::SetUseTimerWheel (bool use)
+{
+	UseTimerWheel = use;
+}
+
+bool EventMachine_t::GetUseEdgeTriggered()
+{
+	return UseEdgeTriggered;
+}
+
+void EventMachine_t::SetUseEdgeTriggered (bool use)
+{
+	UseEdgeTriggered = use;
+}
+
+bool EventMachine_t::GetUseEventBatching()
+{
+	return UseEventBatching;
+}
+
+void EventMachine_t::SetUseEventBatching (bool use)
+{
+	UseEventBatching = use;
+}
+
 
 /******************************
 EventMachine_t::EventMachine_t
@@ -107,6 +154,11 @@ EventMachine_t::EventMachine_t (EMCallback event_callback, Poller_t poller):
 	NumCloseScheduled (0),
 	HeartbeatInterval(2000000),
 	EventCallback (event_callback),
+	bUseTimerWheel (UseTimerWheel),
+	bUseEdgeTriggered (UseEdgeTriggered),
+	bUseEventBatching (UseEventBatching),
+	ReadArena (NULL),
+	ReadArenaSize (0),
 	LoopBreakerReader (INVALID_SOCKET),
 	LoopBreakerWriter (INVALID_SOCKET),
 	bTerminateSignalReceived (false),
@@ -139,6 +191,8 @@ EventMachine_t::EventMachine_t (EMCallback event_callback, Poller_t poller):
 	// Make sure the current loop time is sane, in case we do any initializations of
 	// objects before we start running.
 	_UpdateTime();
+	TimerWheel.Reset (MyCurrentLoopTime);
+	HeartbeatWheel.Reset (MyCurrentLoopTime);
 
 	/* We initialize the network library here (only on Windows of course)
 	 * and initialize "loop breakers." Our destructor also does some network-level
@@ -153,6 +207,10 @@ EventMachine_t::EventMachine_t (EMCallback event_callback, Poller_t poller):
 
 	_InitializeLoopBreaker();
 	SelectData = new SelectData_t();
+
+	#ifdef HAVE_SYNC_BUILTINS
+	Completions = NULL;
+	#endif
 }
 
 
@@ -169,9 +227,23 @@ EventMachine_t::~EventMachine_t()
 	for (i = 0; i < Descriptors.size(); i++)
 		delete Descriptors[i];
 
+	// Wheel timers are heap-allocated, unlike the ones held by value in Timers.
+	TimerWheel.ExpireAll();
+	while (TimerWheel_t::Entry_t *e = TimerWheel.PopExpired())
+		delete static_cast<WheelTimer_t*>(e);
+
 	close (LoopBreakerReader);
 	close (LoopBreakerWriter);
 
+	#ifdef HAVE_SYNC_BUILTINS
+	// Completions nobody got to are dropped with the reactor.
+	while (Completions) {
+		Completion_t *c = Completions;
+		Completions = c->Next;
+		delete c;
+	}
+	#endif
+
 	// Remove any file watch descriptors
 	while(!Files.empty()) {
 		map<int, Bindable_t*>::iterator f = Files.begin();
@@ -183,6 +255,8 @@ EventMachine_t::~EventMachine_t()
 	if (kqfd != -1)
 		close (kqfd);
 
+	free (ReadArena);
+
 	delete SelectData;
 }
 
@@ -321,6 +395,61 @@ void EventMachine_t::SignalLoopBreaker()
 }
 
 
+#ifdef HAVE_SYNC_BUILTINS
+
+/*******************************
+EventMachine_t::QueueCompletion
+*******************************/
+
+void EventMachine_t::QueueCompletion (uintptr_t data)
+{
+	/* Safe to call from any thread. The loop only has to be broken when
+	 * the stack was empty; if it wasn't, the push that made it non-empty
+	 * already did so, and _RunCompletions hasn't taken the stack yet.
+	 */
+	Completion_t *c = new Completion_t;
+	c->Data = data;
+
+	Completion_t *head;
+	do {
+		head = Completions;
+		c->Next = head;
+	} while (!__sync_bool_compare_and_swap (&Completions, head, c));
+
+	if (!head)
+		SignalLoopBreaker();
+}
+
+
+/******************************
+EventMachine_t::HasCompletions
+******************************/
+
+bool EventMachine_t::HasCompletions()
+{
+	return Completions != NULL || !CompletionBatch.empty();
+}
+
+
+/*******************************
+EventMachine_t::MarkCompletions
+*******************************/
+
+void EventMachine_t::MarkCompletions (void (*mark)(uintptr_t))
+{
+	/* Completions can carry references to objects of whoever queued them,
+	 * so a garbage collector has to be shown them. It must not run while
+	 * another thread might be pushing, as Ruby's can't.
+	 */
+	for (Completion_t *c = Completions; c; c = c->Next)
+		(*mark)(c->Data);
+	for (size_t i = 0; i < CompletionBatch.size(); i++)
+		(*mark)(CompletionBatch[i]);
+}
+
+#endif // HAVE_SYNC_BUILTINS
+
+
 /**************************************
 EventMachine_t::_InitializeLoopBreaker
 **************************************/
@@ -492,6 +621,29 @@ uint64_t EventMachine_t::GetRealTime()
 	return current_time;
 }
 
+
+/****************************
+EventMachine_t::GetReadArena
+****************************/
+
+char *EventMachine_t::GetReadArena (size_t size)
+{
+	/* Returns a buffer of at least size+1 bytes (room for the guard byte)
+	 * that descriptors reading in batches fill and dispatch in one piece.
+	 * There's only ever one reader at a time, so the whole reactor shares a
+	 * single arena, grown to the largest batch anyone has asked for.
+	 */
+	if (size + 1 > ReadArenaSize) {
+		char *arena = (char*) realloc (ReadArena, size + 1);
+		if (!arena)
+			throw std::runtime_error ("no memory for read arena");
+		ReadArena = arena;
+		ReadArenaSize = size + 1;
+	}
+	return ReadArena;
+}
+
+
 /***********************************
 EventMachine_t::_DispatchHeartbeats
 ***********************************/
@@ -503,6 +655,18 @@ void EventMachine_t::_DispatchHeartbeats()
 	// is changed out from underneath MyCurrentLoopTime.
 	const EventableDescriptor *head = NULL;
 
+	if (bUseTimerWheel) {
+		// The whole batch that came due is detached up front, and anything
+		// requeued lands back in the wheel, so there's no risk of looping here.
+		HeartbeatWheel.Expire (MyCurrentLoopTime);
+		while (TimerWheel_t::Entry_t *e = HeartbeatWheel.PopExpired()) {
+			EventableDescriptor *ed = static_cast<EventableDescriptor*>(e);
+			ed->Heartbeat();
+			QueueHeartbeat(ed);
+		}
+		return;
+	}
+
 	while (true) {
 		multimap<uint64_t,EventableDescriptor*>::iterator i = Heartbeats.begin();
 		if (i == Heartbeats.end())
@@ -530,7 +694,11 @@ void EventMachine_t::QueueHeartbeat(EventableDescriptor *ed)
 {
 	uint64_t heartbeat = ed->GetNextHeartbeat();
 
-	if (heartbeat) {
+	if (heartbeat && bUseTimerWheel) {
+		ed->When = heartbeat;
+		HeartbeatWheel.Insert (ed);
+	}
+	else if (heartbeat) {
 		#ifndef HAVE_MAKE_PAIR
 		Heartbeats.insert (multimap<uint64_t,EventableDescriptor*>::value_type (heartbeat, ed));
 		#else
@@ -545,6 +713,11 @@ EventMachine_t::ClearHeartbeat
 
 void EventMachine_t::ClearHeartbeat(uint64_t key, EventableDescriptor* ed)
 {
+	if (bUseTimerWheel) {
+		HeartbeatWheel.Remove (ed);
+		return;
+	}
+
 	multimap<uint64_t,EventableDescriptor*>::iterator it;
 	pair<multimap<uint64_t,EventableDescriptor*>::iterator,multimap<uint64_t,EventableDescriptor*>::iterator> ret;
 	ret = Heartbeats.equal_range (key);
@@ -571,8 +744,11 @@ EventMachine_t::RunOnce
 
 bool EventMachine_t::RunOnce()
 {
+	Stats.LoopIterations++;
+
 	_UpdateTime();
-	_RunTimers();
+	if (!bUseEventBatching)
+		_RunTimers();
 
 	/* _Add must precede _Modify because the same descriptor might
 	 * be on both lists during the same pass through the machine,
@@ -593,9 +769,18 @@ bool EventMachine_t::RunOnce()
 		break;
 	}
 
+	uint64_t sweep = GetRealTime();
 	_DispatchHeartbeats();
+	Stats.HeartbeatSweeps++;
+	Stats.HeartbeatTime += GetRealTime() - sweep;
+
 	_CleanupSockets();
 
+	if (bUseEventBatching) {
+		_UpdateTime();
+		_RunTimers();
+	}
+
 	if (bTerminateSignalReceived)
 		return false;
 
@@ -614,6 +799,7 @@ void EventMachine_t::_RunEpollOnce()
 	int s;
 
 	timeval tv = _TimeTilNextEvent();
+	uint64_t poll_start = GetRealTime();
 
 	#ifdef BUILD_FOR_RUBY
 	int ret = 0;
@@ -632,6 +818,7 @@ void EventMachine_t::_RunEpollOnce()
 			assert(errno != EINVAL);
 			assert(errno != EBADF);
 		}
+		Stats.PollTime += GetRealTime() - poll_start;
 		return;
 	}
 
@@ -645,7 +832,13 @@ void EventMachine_t::_RunEpollOnce()
 	s = epoll_wait (epfd, epoll_events, MaxEvents, duration);
 	#endif
 
+	uint64_t dispatch_start = GetRealTime();
+	Stats.PollTime += dispatch_start - poll_start;
+
 	if (s > 0) {
+		Stats.RecordWakeup (s);
+		uint64_t last = dispatch_start;
+
 		for (int i=0; i < s; i++) {
 			EventableDescriptor *ed = (EventableDescriptor*) epoll_events[i].data.ptr;
 
@@ -660,7 +853,13 @@ void EventMachine_t::_RunEpollOnce()
 				ed->Write();
 			if (epoll_events[i].events & (EPOLLERR | EPOLLHUP))
 				ed->HandleError();
+
+			uint64_t now = GetRealTime();
+			Stats.RecordLatency (now - last);
+			last = now;
 		}
+
+		Stats.DispatchTime += last - dispatch_start;
 	}
 	else if (s < 0) {
 		// epoll_wait can fail on error in a handful of ways.
@@ -692,6 +891,8 @@ void EventMachine_t::_RunKqueueOnce()
 	ts.tv_sec = tv.tv_sec;
 	ts.tv_nsec = tv.tv_usec * 1000;
 
+	uint64_t poll_start = GetRealTime();
+
 	#ifdef BUILD_FOR_RUBY
 	int ret = 0;
 
@@ -709,6 +910,7 @@ void EventMachine_t::_RunKqueueOnce()
 			assert(errno != EINVAL);
 			assert(errno != EBADF);
 		}
+		Stats.PollTime += GetRealTime() - poll_start;
 		return;
 	}
 
@@ -720,6 +922,11 @@ void EventMachine_t::_RunKqueueOnce()
 	k = kevent (kqfd, NULL, 0, Karray, MaxEvents, &ts);
 	#endif
 
+	uint64_t dispatch_start = GetRealTime();
+	uint64_t last = dispatch_start;
+	Stats.PollTime += dispatch_start - poll_start;
+	Stats.RecordWakeup (k);
+
 	struct kevent *ke = Karray;
 	while (k > 0) {
 		switch (ke->filter)
@@ -750,10 +957,16 @@ void EventMachine_t::_RunKqueueOnce()
 				break;
 		}
 
+		uint64_t now = GetRealTime();
+		Stats.RecordLatency (now - last);
+		last = now;
+
 		--k;
 		++ke;
 	}
 
+	Stats.DispatchTime += last - dispatch_start;
+
 	// TODO, replace this with rb_thread_blocking_region for 1.9 builds.
 	#ifdef BUILD_FOR_RUBY
 	if (!rb_thread_alone()) {
@@ -783,6 +996,13 @@ timeval EventMachine_t::_TimeTilNextEvent()
 	uint64_t next_event = 0;
 	uint64_t current_time = GetRealTime();
 
+	if (bUseTimerWheel) {
+		next_event = HeartbeatWheel.NextDeadline();
+		uint64_t timers = TimerWheel.NextDeadline();
+		if (timers && (next_event == 0 || timers < next_event))
+			next_event = timers;
+	}
+
 	if (!Heartbeats.empty()) {
 		multimap<uint64_t,EventableDescriptor*>::iterator heartbeats = Heartbeats.begin();
 		next_event = heartbeats->first;
@@ -875,12 +1095,19 @@ void EventMachine_t::_ModifyEpollEvent (EventableDescriptor *ed)
 		assert (epfd != -1);
 		assert (ed);
 		assert (ed->GetSocket() != INVALID_SOCKET);
+
+		// Only the net change matters: interest that was flipped and flipped
+		// back during the last pass costs nothing.
+		if (ed->GetEpollEvent()->events == ed->GetEpollRegistered())
+			return;
+
 		int e = epoll_ctl (epfd, EPOLL_CTL_MOD, ed->GetSocket(), ed->GetEpollEvent());
 		if (e) {
 			char buf [200];
 			snprintf (buf, sizeof(buf)-1, "unable to modify epoll event: %s", strerror(errno));
 			throw std::runtime_error (buf);
 		}
+		ed->SetEpollRegistered (ed->GetEpollEvent()->events);
 	}
 }
 #else
@@ -1008,7 +1235,10 @@ void EventMachine_t::_RunSelectOnce()
 		//timeval tv = {1, 0}; // Solaris fails if the microseconds member is >= 1000000.
 		//timeval tv = Quantum;
 		SelectData->tv = _TimeTilNextEvent();
+		uint64_t poll_start = GetRealTime();
 		int s = SelectData->_Select();
+		uint64_t dispatch_start = GetRealTime();
+		Stats.PollTime += dispatch_start - poll_start;
 		//rb_thread_blocking_region(xxx,(void*)&SelectData,RUBY_UBF_IO,0);
 		//int s = EmSelect (SelectData.maxsocket+1, &(SelectData.fdreads), &(SelectData.fdwrites), NULL, &(SelectData.tv));
 		//int s = SelectData.nSockets;
@@ -1023,6 +1253,9 @@ void EventMachine_t::_RunSelectOnce()
 			 * IMMEDIATELY if _ReadLoopBreaker is done here instead of after
 			 * the other descriptors are processed. That defeats the whole purpose.
 			 */
+			Stats.RecordWakeup (s);
+			uint64_t last = dispatch_start;
+
 			for (i=0; i < Descriptors.size(); i++) {
 				EventableDescriptor *ed = Descriptors[i];
 				assert (ed);
@@ -1031,20 +1264,34 @@ void EventMachine_t::_RunSelectOnce()
 					continue;
 				assert (sd != INVALID_SOCKET);
 
+				bool handled = false;
 				if (rb_fd_isset (sd, &(SelectData->fdwrites))) {
 					// Double-check SelectForWrite() still returns true. If not, one of the callbacks must have
 					// modified some value since we checked SelectForWrite() earlier in this method.
 					if (ed->SelectForWrite())
 						ed->Write();
+					handled = true;
 				}
-				if (rb_fd_isset (sd, &(SelectData->fdreads)))
+				if (rb_fd_isset (sd, &(SelectData->fdreads))) {
 					ed->Read();
-				if (rb_fd_isset (sd, &(SelectData->fderrors)))
+					handled = true;
+				}
+				if (rb_fd_isset (sd, &(SelectData->fderrors))) {
 					ed->HandleError();
+					handled = true;
+				}
+
+				if (handled) {
+					uint64_t now = GetRealTime();
+					Stats.RecordLatency (now - last);
+					last = now;
+				}
 			}
 
 			if (rb_fd_isset (LoopBreakerReader, &(SelectData->fdreads)))
 				_ReadLoopBreaker();
+
+			Stats.DispatchTime += GetRealTime() - dispatch_start;
 		}
 		else if (s < 0) {
 			switch (errno) {
@@ -1107,11 +1354,54 @@ void EventMachine_t::_ReadLoopBreaker()
 	 */
 	char buffer [1024];
 	(void)read (LoopBreakerReader, buffer, sizeof(buffer));
+	Stats.LoopBreaks++;
+
+	#ifdef HAVE_SYNC_BUILTINS
+	_RunCompletions();
+	#endif
+
 	if (EventCallback)
 		(*EventCallback)(0, EM_LOOPBREAK_SIGNAL, "", 0);
 }
 
 
+#ifdef HAVE_SYNC_BUILTINS
+
+/*******************************
+EventMachine_t::_RunCompletions
+*******************************/
+
+void EventMachine_t::_RunCompletions()
+{
+	// Takes the whole stack, so the next push breaks the loop again.
+	Completion_t *c;
+	do {
+		c = Completions;
+	} while (c && !__sync_bool_compare_and_swap (&Completions, c, (Completion_t*)NULL));
+
+	// Anything left from a delivery the callback didn't return from is stale.
+	CompletionBatch.clear();
+	while (c) {
+		Completion_t *next = c->Next;
+		CompletionBatch.push_back (c->Data);
+		delete c;
+		c = next;
+	}
+	if (CompletionBatch.empty())
+		return;
+
+	// The stack has the newest on top.
+	reverse (CompletionBatch.begin(), CompletionBatch.end());
+	Stats.Completions += CompletionBatch.size();
+
+	if (EventCallback)
+		(*EventCallback)(0, EM_DEFERRED_COMPLETIONS, (const char*) &CompletionBatch[0], CompletionBatch.size());
+	CompletionBatch.clear();
+}
+
+#endif // HAVE_SYNC_BUILTINS
+
+
 /**************************
 EventMachine_t::_RunTimers
 **************************/
@@ -1123,6 +1413,20 @@ void EventMachine_t::_RunTimers()
 	// inspecting the whole list every time we come here.
 	// Just keep inspecting and processing the list head until we hit
 	// one that hasn't expired yet.
+	// With the timing wheel, everything that came due is expired in one batch.
+
+	if (bUseTimerWheel) {
+		TimerWheel.Expire (MyCurrentLoopTime);
+		while (TimerWheel_t::Entry_t *e = TimerWheel.PopExpired()) {
+			WheelTimer_t *t = static_cast<WheelTimer_t*>(e);
+			const uintptr_t binding = t->Binding;
+			delete t;
+			Stats.TimersFired++;
+			if (EventCallback)
+				(*EventCallback) (0, EM_TIMER_FIRED, NULL, binding);
+		}
+		return;
+	}
 
 	while (true) {
 		multimap<uint64_t,Timer_t>::iterator i = Timers.begin();
@@ -1130,8 +1434,9 @@ void EventMachine_t::_RunTimers()
 			break;
 		if (i->first > MyCurrentLoopTime)
 			break;
+		Stats.TimersFired++;
 		if (EventCallback)
-			(*EventCallback) (0, EM_TIMER_FIRED, NULL, i->second.GetBinding());
+			(*EventCallback) (0, EM_TIMER_FIRED, NULL, i->second.Binding);
 		Timers.erase (i);
 	}
 }
@@ -1144,19 +1449,32 @@ EventMachine_t::InstallOneshotTimer
 
 const uintptr_t EventMachine_t::InstallOneshotTimer (int milliseconds)
 {
-	if (Timers.size() > MaxOutstandingTimers)
+	if (Timers.size() + TimerWheel.Size() > MaxOutstandingTimers)
 		return false;
 
 	uint64_t fire_at = GetRealTime();
 	fire_at += ((uint64_t)milliseconds) * 1000LL;
 
+	// Timers are never looked up by binding, the number only has to be
+	// unique among timers. Slot bindings would come back around too soon.
+	static uintptr_t num = 0;
+
+	if (bUseTimerWheel) {
+		WheelTimer_t *t = new WheelTimer_t;
+		t->Binding = ++num;
+		t->When = fire_at;
+		TimerWheel.Insert (t);
+		return t->Binding;
+	}
+
 	Timer_t t;
+	t.Binding = ++num;
 	#ifndef HAVE_MAKE_PAIR
 	multimap<uint64_t,Timer_t>::iterator i = Timers.insert (multimap<uint64_t,Timer_t>::value_type (fire_at, t));
 	#else
 	multimap<uint64_t,Timer_t>::iterator i = Timers.insert (make_pair (fire_at, t));
 	#endif
-	return i->second.GetBinding();
+	return i->second.Binding;
 }
 
 
@@ -1260,6 +1578,7 @@ const uintptr_t EventMachine_t::ConnectToServer (const char *bind_addr, int bind
 		if (!cd)
 			throw std::runtime_error ("no connection allocated");
 		cd->SetConnectPending (true);
+		cd->SetConnectAddress (server, port);
 		Add (cd);
 		out = cd->GetBinding();
 	}
@@ -1278,6 +1597,7 @@ const uintptr_t EventMachine_t::ConnectToServer (const char *bind_addr, int bind
 			if (!cd)
 				throw std::runtime_error ("no connection allocated");
 			cd->SetConnectPending (true);
+			cd->SetConnectAddress (server, port);
 			Add (cd);
 			out = cd->GetBinding();
 		} else {
@@ -1332,6 +1652,7 @@ const uintptr_t EventMachine_t::ConnectToServer (const char *bind_addr, int bind
 		if (!cd)
 			throw std::runtime_error ("no connection allocated");
 		cd->SetConnectPending (true);
+		cd->SetConnectAddress (server, port);
 		Add (cd);
 		out = cd->GetBinding();
 	}
@@ -1570,12 +1891,17 @@ bool EventMachine_t::name2address (const char *server, int port, struct sockaddr
 EventMachine_t::CreateTcpServer
 *******************************/
 
-const uintptr_t EventMachine_t::CreateTcpServer (const char *server, int port)
+const uintptr_t EventMachine_t::CreateTcpServer (const char *server, int port, bool reuseport)
 {
 	/* Create a TCP-acceptor (server) socket and add it to the event machine.
 	 * Return the binding of the new acceptor to the caller.
 	 * This binding will be referenced when the new acceptor sends events
 	 * to indicate accepted connections.
+	 *
+	 * If reuseport is set, the listener is opened with SO_REUSEPORT so that
+	 * several reactors (typically one per forked worker process) can each bind
+	 * their own acceptor to the same address and let the kernel spread incoming
+	 * connections across them. Fails where the platform lacks SO_REUSEPORT.
 	 */
 
 
@@ -1597,6 +1923,16 @@ const uintptr_t EventMachine_t::CreateTcpServer (const char *server, int port)
 		}
 	}
 
+	if (reuseport) { // shard accepts across every listener bound to this address.
+		#ifdef HAVE_CONST_SO_REUSEPORT
+		int oval = 1;
+		if (setsockopt (sd_accept, SOL_SOCKET, SO_REUSEPORT, (char*)&oval, sizeof(oval)) < 0)
+			goto fail;
+		#else
+		goto fail;
+		#endif
+	}
+
 	{ // set CLOEXEC. Only makes sense on Unix
 		#ifdef OS_UNIX
 		int cloexec = fcntl (sd_accept, F_GETFD, 0);
@@ -1775,6 +2111,7 @@ void EventMachine_t::_AddNewDescriptors()
 				snprintf (buf, sizeof(buf)-1, "unable to add new descriptor: %s", strerror(errno));
 				throw std::runtime_error (buf);
 			}
+			ed->SetEpollRegistered (ed->GetEpollEvent()->events);
 		}
 		#endif
 
@@ -1827,12 +2164,24 @@ void EventMachine_t::_ModifyDescriptors()
 
 	#ifdef HAVE_EPOLL
 	if (Poller == Poller_Epoll) {
-		set<EventableDescriptor*>::iterator i = ModifiedDescriptors.begin();
-		while (i != ModifiedDescriptors.end()) {
-			assert (*i);
-			_ModifyEpollEvent (*i);
-			++i;
+		/* The set is swapped out first, because edge-triggered descriptors
+		 * then get to do the I/O they had deferred, and the callbacks that
+		 * runs can mark descriptors modified again. Those are picked up on
+		 * the next pass.
+		 */
+		vector<EventableDescriptor*> modified (ModifiedDescriptors.begin(), ModifiedDescriptors.end());
+		ModifiedDescriptors.clear();
+
+		for (size_t i = 0; i < modified.size(); i++) {
+			assert (modified[i]);
+			if (modified[i]->GetSocket() != INVALID_SOCKET)
+				_ModifyEpollEvent (modified[i]);
+		}
+		for (size_t i = 0; i < modified.size(); i++) {
+			if (modified[i]->GetSocket() != INVALID_SOCKET)
+				modified[i]->RunDeferredIO();
 		}
+		return;
 	}
 	#endif
 
@@ -2247,6 +2596,35 @@ void EventMachine_t::UnwatchFile (const uintptr_t sig)
 }
 
 
+/************************
+EventMachine_t::TailFile
+************************/
+
+const uintptr_t EventMachine_t::TailFile (const char *fpath, int flags, unsigned long max_line_size)
+{
+	#ifdef HAVE_INOTIFY
+	/* The file itself needn't exist yet, as it's picked up once it's
+	 * created, but there has to be a directory to watch for that.
+	 */
+	string dir = TailDescriptor::DirectoryOf (TailDescriptor::CurrentPath (fpath, flags));
+	struct stat sb;
+	if (stat (dir.c_str(), &sb) == -1 || !S_ISDIR (sb.st_mode)) {
+		char errbuf[300];
+		snprintf (errbuf, sizeof(errbuf)-1, "error registering file %s for tailing: no directory %s", fpath, dir.c_str());
+		throw std::runtime_error (errbuf);
+	}
+
+	TailDescriptor *td = new TailDescriptor (this, fpath, flags, max_line_size);
+	if (!td)
+		throw std::runtime_error ("no tail-object allocated");
+	Add (td);
+	return td->GetBinding();
+	#else
+	throw std::runtime_error ("no file tailing support on this system");
+	#endif
+}
+
+
 /***********************************
 EventMachine_t::_ReadInotify_Events
 ************************************/
@@ -133,6 +133,15 @@ class EventMachine_t
 		static int GetSimultaneousAcceptCount();
 		static void SetSimultaneousAcceptCount (int);
 
+		static bool GetUseTimerWheel();
+		static void SetUseTimerWheel (bool);
+
+		static bool GetUseEdgeTriggered();
+		static void SetUseEdgeTriggered (bool);
+
+		static bool GetUseEventBatching();
+		static void SetUseEventBatching (bool);
+
 	public:
 		EventMachine_t (EMCallback, Poller_t);
 		virtual ~EventMachine_t();
@@ -142,11 +151,16 @@ class EventMachine_t
 		void ScheduleHalt();
 		bool Stopping();
 		void SignalLoopBreaker();
+		#ifdef HAVE_SYNC_BUILTINS
+		void QueueCompletion (uintptr_t);
+		bool HasCompletions();
+		void MarkCompletions (void (*)(uintptr_t));
+		#endif
 		const uintptr_t InstallOneshotTimer (int);
 		const uintptr_t ConnectToServer (const char *, int, const char *, int);
 		const uintptr_t ConnectToUnixServer (const char *);
 
-		const uintptr_t CreateTcpServer (const char *, int);
+		const uintptr_t CreateTcpServer (const char *, int, bool reuseport = false);
 		const uintptr_t OpenDatagramSocket (const char *, int);
 		const uintptr_t CreateUnixDomainServer (const char*);
 		const uintptr_t AttachSD (SOCKET);
@@ -179,6 +193,8 @@ class EventMachine_t
 		void UnwatchFile (int);
 		void UnwatchFile (const uintptr_t);
 
+		const uintptr_t TailFile (const char*, int, unsigned long);
+
 		#ifdef HAVE_KQUEUE
 		void _HandleKqueueFileEvent (struct kevent*);
 		void _RegisterKqueueFileEvent(int);
@@ -199,7 +215,10 @@ class EventMachine_t
 
 		uint64_t GetRealTime();
 
+		char *GetReadArena (size_t);
+
 		Poller_t GetPoller() { return Poller; }
+		bool IsEdgeTriggered() { return bUseEdgeTriggered && Poller == Poller_Epoll; }
 
 		static bool name2address (const char *server, int port, struct sockaddr *addr, size_t *addr_len);
 
@@ -222,8 +241,12 @@ class EventMachine_t
 
 	public:
 		void _ReadLoopBreaker();
+		#ifdef HAVE_SYNC_BUILTINS
+		void _RunCompletions();
+		#endif
 		void _ReadInotifyEvents();
 		int NumCloseScheduled;
+		ReactorStats_t Stats;
 
 	private:
 		enum {
@@ -233,23 +256,52 @@ class EventMachine_t
 		int HeartbeatInterval;
 		EMCallback EventCallback;
 
-		class Timer_t: public Bindable_t {
+		struct Timer_t {
+			uintptr_t Binding;
 		};
 
+		struct WheelTimer_t: public TimerWheel_t::Entry_t {
+			uintptr_t Binding;
+		};
+
+		bool bUseTimerWheel;
+		bool bUseEdgeTriggered;
+		bool bUseEventBatching;
 		multimap<uint64_t, Timer_t> Timers;
 		multimap<uint64_t, EventableDescriptor*> Heartbeats;
+		TimerWheel_t TimerWheel;
+		TimerWheel_t HeartbeatWheel;
 		map<int, Bindable_t*> Files;
 		map<int, Bindable_t*> Pids;
 		vector<EventableDescriptor*> Descriptors;
 		vector<EventableDescriptor*> NewDescriptors;
 		set<EventableDescriptor*> ModifiedDescriptors;
 
+		char *ReadArena;
+		size_t ReadArenaSize;
+
 		SOCKET LoopBreakerReader;
 		SOCKET LoopBreakerWriter;
 		#ifdef OS_WIN32
 		struct sockaddr_in LoopBreakerTarget;
 		#endif
 
+		#ifdef HAVE_SYNC_BUILTINS
+		/* Work finished on other threads, as with EM.defer, is pushed onto
+		 * a lock-free stack. Only the push that finds it empty breaks the
+		 * loop, and the rest ride along on that wakeup. _ReadLoopBreaker
+		 * takes the whole stack at once and delivers it, oldest first, in
+		 * one EM_DEFERRED_COMPLETIONS event.
+		 */
+		struct Completion_t {
+			Completion_t *Next;
+			uintptr_t Data;
+		};
+		Completion_t *Completions;
+		// The batch being delivered, which still has to be seen by MarkCompletions.
+		vector<uintptr_t> CompletionBatch;
+		#endif
+
 		timeval Quantum;
 
 		uint64_t MyCurrentLoopTime;
@@ -36,7 +36,12 @@ extern "C" {
 		EM_SSL_HANDSHAKE_COMPLETED = 108,
 		EM_SSL_VERIFY = 109,
 		EM_PROXY_TARGET_UNBOUND = 110,
-		EM_PROXY_COMPLETED = 111
+		EM_PROXY_COMPLETED = 111,
+		EM_CONNECTION_FRAMES = 112,
+		EM_CONNECTION_DATAGRAMS = 113,
+		EM_FILE_ROTATED = 114,
+		EM_FILE_TRUNCATED = 115,
+		EM_DEFERRED_COMPLETIONS = 116
 	};
 
 	enum { // SSL/TLS Protocols
@@ -47,6 +52,38 @@ extern "C" {
 		EM_PROTO_TLSv1_2 = 32
 	};
 
+	enum { // Inbound framing
+		EM_FRAMING_NONE = 0,
+		EM_FRAMING_LINE = 1,
+		EM_FRAMING_DELIMITER = 2,
+		EM_FRAMING_LENGTH_PREFIX = 3
+	};
+
+	enum { // Tailing files
+		EM_TAIL_FROM_START = 1,
+		EM_TAIL_STRFTIME = 2,
+		EM_TAIL_LINES = 4
+	};
+
+	/* EM_CONNECTION_FRAMES passes an array of these as its data and their
+	 * count as its length. They point into the connection's buffer, and are
+	 * only valid during the callback.
+	 */
+	struct evma_frame {
+		const char *data;
+		unsigned long length;
+	};
+
+	/* Likewise for EM_CONNECTION_DATAGRAMS, with the address each datagram
+	 * came from.
+	 */
+	struct evma_datagram {
+		const char *data;
+		unsigned long length;
+		const struct sockaddr *sender;
+		int sender_length;
+	};
+
 	void evma_initialize_library (EMCallback);
 	bool evma_run_machine_once();
 	void evma_run_machine();
@@ -71,6 +108,7 @@ extern "C" {
 
 	void evma_stop_tcp_server (const uintptr_t binding);
 	const uintptr_t evma_create_tcp_server (const char *address, int port);
+	const uintptr_t evma_create_reuseport_tcp_server (const char *address, int port);
 	const uintptr_t evma_create_unix_domain_server (const char *filename);
 	const uintptr_t evma_attach_sd (int sd);
 	const uintptr_t evma_open_datagram_socket (const char *server, int port);
@@ -84,6 +122,7 @@ extern "C" {
 	const char *evma_get_cipher_name (const uintptr_t binding);
 	const char *evma_get_cipher_protocol (const uintptr_t binding);
 	const char *evma_get_sni_hostname (const uintptr_t binding);
+	int evma_is_ssl_session_reused (const uintptr_t binding);
 	void evma_accept_ssl_peer (const uintptr_t binding);
 	#endif
 
@@ -98,16 +137,38 @@ extern "C" {
 	int evma_set_comm_inactivity_timeout (const uintptr_t binding, float value);
 	float evma_get_pending_connect_timeout (const uintptr_t binding);
 	int evma_set_pending_connect_timeout (const uintptr_t binding, float value);
+	int evma_get_read_batch_size (const uintptr_t binding);
+	int evma_set_read_batch_size (const uintptr_t binding, int value);
+	int evma_set_inbound_framing (const uintptr_t binding, int mode, const char *delimiter, int delimiter_length, int prefix_size, unsigned long max_frame_size);
+	int evma_get_datagram_batch_size (const uintptr_t binding);
+	int evma_set_datagram_batching (const uintptr_t binding, int batch_size, int deliver_batches);
+	int evma_get_read_iterations (const uintptr_t binding);
+	int evma_set_read_iterations (const uintptr_t binding, int value);
 	int evma_get_outbound_data_size (const uintptr_t binding);
+	uintptr_t evma_get_binding_data (const uintptr_t binding);
+	int evma_set_binding_data (const uintptr_t binding, uintptr_t data);
 	uint64_t evma_get_last_activity_time (const uintptr_t binding);
 	int evma_send_file_data_to_connection (const uintptr_t binding, const char *filename);
+	int evma_sendfile_data_to_connection (const uintptr_t binding, const char *filename);
 
 	void evma_close_connection (const uintptr_t binding, int after_writing);
 	int evma_report_connection_error_status (const uintptr_t binding);
 	void evma_signal_loopbreak();
+	#ifdef HAVE_SYNC_BUILTINS
+	void evma_queue_completion (uintptr_t data);
+	int evma_has_completions();
+	void evma_mark_completions (void (*)(uintptr_t));
+	#endif
 	void evma_set_timer_quantum (int);
 	int evma_get_max_timer_count();
 	void evma_set_max_timer_count (int);
+	int evma_get_timer_wheel();
+	void evma_set_timer_wheel (int);
+	int evma_get_edge_triggered();
+	void evma_set_edge_triggered (int);
+	int evma_get_event_batching();
+	void evma_set_event_batching (int);
+	const ReactorStats_t *evma_get_stats();
 	int evma_get_simultaneous_accept_count();
 	void evma_set_simultaneous_accept_count (int);
 	void evma_setuid_string (const char *username);
@@ -121,6 +182,8 @@ extern "C" {
 	const uintptr_t evma_watch_filename (const char *fname);
 	void evma_unwatch_filename (const uintptr_t binding);
 
+	const uintptr_t evma_tail_file (const char *fname, int flags, unsigned long max_line_size);
+
 	const uintptr_t evma_watch_pid (int);
 	void evma_unwatch_pid (const uintptr_t binding);
 
@@ -120,9 +120,14 @@ have_func('rb_time_new')
 add_define('HAVE_INOTIFY') if inotify = have_func('inotify_init', 'sys/inotify.h')
 add_define('HAVE_OLD_INOTIFY') if !inotify && have_macro('__NR_inotify_init', 'sys/syscall.h')
 have_func('writev', 'sys/uio.h')
+have_func('splice', 'fcntl.h')
+have_func('sendfile', 'sys/sendfile.h')
 have_func('pipe2', 'unistd.h')
 have_func('accept4', 'sys/socket.h')
+have_func('recvmmsg', 'sys/socket.h')
+have_func('sendmmsg', 'sys/socket.h')
 have_const('SOCK_CLOEXEC', 'sys/socket.h')
+have_const('SO_REUSEPORT', 'sys/socket.h')
 
 # Minor platform details between *nix and Windows:
 
@@ -265,6 +270,11 @@ add_define 'HAVE_MAKE_PAIR' if try_link(<<SRC, '-lstdc++')
   using namespace std;
   int main(){ pair<const int,int> tuple = make_pair(1,2); }
 SRC
+
+# Compare-and-swap for the queue other threads hand completions back on
+add_define 'HAVE_SYNC_BUILTINS' if try_link(<<SRC)
+  int main(){ void *p = 0; return !__sync_bool_compare_and_swap(&p, (void*)0, (void*)&p); }
+SRC
 TRY_LINK.sub!('$(CXX)', '$(CC)')
 
 create_makefile "rubyeventmachine"
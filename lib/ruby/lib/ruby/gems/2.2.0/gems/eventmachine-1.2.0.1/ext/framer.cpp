@@ -0,0 +1,266 @@
+/*****************************************************************************
+
+$Id$
+
+File:     framer.cpp
+Date:     17Oct16
+
+Copyright (C) 2006-07 by Francis Cianfrocca. All Rights Reserved.
+Gmail: blackhedd
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of either: 1) the GNU General Public License
+as published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version; or 2) Ruby's License.
+
+See the file COPYING for complete licensing information.
+
+*****************************************************************************/
+
+
+#include "project.h"
+
+
+/******************
+Framer_t::Framer_t
+******************/
+
+Framer_t::Framer_t (Mode_t mode, const char *delimiter, int delimiter_length, int prefix_size, unsigned long max_frame_size):
+	Mode (mode),
+	PrefixSize (prefix_size),
+	MaxFrameSize (max_frame_size),
+	Buffer (NULL),
+	Capacity (0),
+	Start (0),
+	End (0),
+	Scan (0),
+	Searched (0),
+	bFailed (false)
+{
+	if (mode == Line)
+		Separator = "\n";
+	else if (mode == Delimiter)
+		Separator.assign (delimiter, delimiter_length);
+}
+
+
+/*******************
+Framer_t::~Framer_t
+*******************/
+
+Framer_t::~Framer_t()
+{
+	free (Buffer);
+}
+
+
+/**************
+Framer_t::Feed
+**************/
+
+bool Framer_t::Feed (const char *data, unsigned long length)
+{
+	/* Appends the data and collects every frame it completes. Returns false
+	 * once a frame turns out to be larger than the maximum, after which
+	 * nothing more is taken.
+	 */
+	if (bFailed)
+		return false;
+	if (length == 0)
+		return true;
+
+	_Reserve (length);
+	memcpy (Buffer + End, data, length);
+	End += length;
+
+	if (!_Scan())
+		bFailed = true;
+	return !bFailed;
+}
+
+
+/*******************
+Framer_t::GetFrames
+*******************/
+
+const struct evma_frame *Framer_t::GetFrames()
+{
+	// Only valid until the next Feed, which may move the buffer.
+	Batch.resize (Frames.size());
+	for (size_t i = 0; i < Frames.size(); i++) {
+		Batch[i].data = Buffer + Start + Frames[i].Offset;
+		Batch[i].length = Frames[i].Length;
+	}
+	return Batch.empty() ? NULL : &Batch[0];
+}
+
+
+/***********************
+Framer_t::ConsumeFrames
+***********************/
+
+void Framer_t::ConsumeFrames()
+{
+	// Drops the delivered frames, and the delimiters and prefixes around them.
+	Frames.clear();
+	Start += Scan;
+	Searched -= Scan;
+	Scan = 0;
+
+	if (Start == End)
+		Start = End = Searched = 0;
+}
+
+
+/***************
+Framer_t::Flush
+***************/
+
+void Framer_t::Flush()
+{
+	/* Ends the frame in progress where the data stops, for a stream that
+	 * has nothing more coming to finish it. Length-prefixed frames can't be
+	 * cut short, so they're left as they are.
+	 */
+	if (bFailed || Mode == LengthPrefix)
+		return;
+
+	unsigned long available = End - Start;
+	if (available > Scan) {
+		Frames.push_back (Frame_t (Scan, available - Scan));
+		Scan = Searched = available;
+	}
+}
+
+
+/***************
+Framer_t::_Scan
+***************/
+
+bool Framer_t::_Scan()
+{
+	if (Mode == LengthPrefix)
+		return _ScanLengthPrefixed();
+	return _ScanDelimited();
+}
+
+
+/************************
+Framer_t::_ScanDelimited
+************************/
+
+bool Framer_t::_ScanDelimited()
+{
+	/* Searches the bytes that haven't been searched yet for the first byte
+	 * of the delimiter, and checks the rest of it where there is one. A
+	 * multibyte delimiter that's cut off at the end of the buffer is looked
+	 * at again after the next Feed.
+	 */
+	const char *base = Buffer + Start;
+	unsigned long available = End - Start;
+	unsigned long delimiter_length = Separator.size();
+	unsigned long from = (Searched > Scan) ? Searched : Scan;
+
+	while (from < available) {
+		const char *p = (const char*) memchr (base + from, Separator[0], available - from);
+		if (!p) {
+			from = available;
+			break;
+		}
+
+		unsigned long at = p - base;
+		if (delimiter_length > 1) {
+			if (available - at < delimiter_length) {
+				from = at;
+				break;
+			}
+			if (memcmp (p, Separator.data(), delimiter_length)) {
+				from = at + 1;
+				continue;
+			}
+		}
+
+		unsigned long length = at - Scan;
+		// Lines may end in CRLF as well.
+		if (Mode == Line && length > 0 && base [at - 1] == '\r')
+			length--;
+		if (MaxFrameSize && length > MaxFrameSize)
+			return false;
+
+		Frames.push_back (Frame_t (Scan, length));
+		Scan = at + delimiter_length;
+		from = Scan;
+	}
+
+	Searched = from;
+
+	// Don't keep buffering a frame that's already too long to be delivered.
+	if (MaxFrameSize && (available - Scan) > MaxFrameSize + delimiter_length)
+		return false;
+	return true;
+}
+
+
+/*****************************
+Framer_t::_ScanLengthPrefixed
+*****************************/
+
+bool Framer_t::_ScanLengthPrefixed()
+{
+	// Each frame is preceded by its length as a big-endian unsigned integer.
+	const unsigned char *base = (const unsigned char*) (Buffer + Start);
+	unsigned long available = End - Start;
+
+	while (available - Scan >= (unsigned long) PrefixSize) {
+		unsigned long length = 0;
+		for (int i = 0; i < PrefixSize; i++)
+			length = (length << 8) | base [Scan + i];
+
+		if (MaxFrameSize && length > MaxFrameSize)
+			return false;
+		if (available - Scan - PrefixSize < length)
+			break;
+
+		Frames.push_back (Frame_t (Scan + PrefixSize, length));
+		Scan += PrefixSize + length;
+	}
+
+	Searched = Scan;
+	return true;
+}
+
+
+/******************
+Framer_t::_Reserve
+******************/
+
+void Framer_t::_Reserve (unsigned long length)
+{
+	// Makes room for length more bytes at the end.
+	if (End + length <= Capacity)
+		return;
+
+	unsigned long used = End - Start;
+	if (Start > 0 && used + length <= Capacity) {
+		memmove (Buffer, Buffer + Start, used);
+		Start = 0;
+		End = used;
+		return;
+	}
+
+	unsigned long size = Capacity ? Capacity : InitialSize;
+	while (size < used + length)
+		size *= 2;
+
+	char *buffer = (char*) malloc (size);
+	if (!buffer)
+		throw std::runtime_error ("no memory for inbound frames");
+	if (used > 0)
+		memcpy (buffer, Buffer + Start, used);
+	free (Buffer);
+
+	Buffer = buffer;
+	Capacity = size;
+	Start = 0;
+	End = used;
+}
@@ -0,0 +1,104 @@
+/*****************************************************************************
+
+$Id$
+
+File:     framer.h
+Date:     17Oct16
+
+Copyright (C) 2006-07 by Francis Cianfrocca. All Rights Reserved.
+Gmail: blackhedd
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of either: 1) the GNU General Public License
+as published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version; or 2) Ruby's License.
+
+See the file COPYING for complete licensing information.
+
+*****************************************************************************/
+
+
+#ifndef __InboundFramer__H_
+#define __InboundFramer__H_
+
+
+/**************
+class Framer_t
+**************/
+
+/* Optional inbound framing stage of a connection. Inbound data is
+ * appended to a buffer that grows as needed, and the frames completed by
+ * it are collected until the connection hands them all to the callback
+ * in one batch. Frames are found with memchr, which libc vectorizes, so
+ * line protocols don't need to split and rejoin strings in Ruby.
+ *
+ * The buffer is linear rather than a ring, so every frame is contiguous
+ * and can be passed on without copying. Consumed bytes are reclaimed by
+ * sliding the rest down, and only when the buffer would otherwise have
+ * to grow.
+ */
+
+class Framer_t
+{
+	public:
+		enum Mode_t {
+			Line = EM_FRAMING_LINE,
+			Delimiter = EM_FRAMING_DELIMITER,
+			LengthPrefix = EM_FRAMING_LENGTH_PREFIX
+		};
+
+		enum {
+			InitialSize = 16 * 1024
+		};
+
+	public:
+		Framer_t (Mode_t, const char *delimiter, int delimiter_length, int prefix_size, unsigned long max_frame_size);
+		virtual ~Framer_t();
+
+		bool Feed (const char*, unsigned long);
+		bool IsFailed() {return bFailed;}
+
+		bool HasFrames() {return !Frames.empty();}
+		const struct evma_frame *GetFrames();
+		int GetFrameCount() {return Frames.size();}
+		void ConsumeFrames();
+		void Flush();
+
+		unsigned long GetBuffered() {return End - Start - Scan;}
+		const char *GetBufferedData() {return Buffer + Start + Scan;}
+
+	private:
+		struct Frame_t {
+			Frame_t (unsigned long o, unsigned long l): Offset(o), Length(l) {}
+			unsigned long Offset;
+			unsigned long Length;
+		};
+
+		bool _Scan();
+		bool _ScanDelimited();
+		bool _ScanLengthPrefixed();
+		void _Reserve (unsigned long);
+
+		Mode_t Mode;
+		std::string Separator;
+		int PrefixSize;
+		unsigned long MaxFrameSize;
+
+		char *Buffer;
+		unsigned long Capacity;
+		unsigned long Start;
+		unsigned long End;
+
+		// Offsets are relative to Start. Scan is where the next frame begins,
+		// Searched how far it's known not to contain a delimiter.
+		unsigned long Scan;
+		unsigned long Searched;
+
+		bool bFailed;
+
+		vector<Frame_t> Frames;
+		vector<struct evma_frame> Batch;
+};
+
+
+#endif // __InboundFramer__H_
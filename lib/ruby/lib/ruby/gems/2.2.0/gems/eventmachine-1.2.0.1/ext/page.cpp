@@ -105,3 +105,209 @@ void PageList::Push (const char *buf, int size)
 
 
 
+
+
+
+OutboundSlab_t *OutboundSlab_t::FreeList = NULL;
+int OutboundSlab_t::FreeCount = 0;
+
+
+/*******************************
+STATIC OutboundSlab_t::Acquire
+*******************************/
+
+OutboundSlab_t *OutboundSlab_t::Acquire (size_t capacity)
+{
+	/* Returns a slab with at least the requested capacity and one reference,
+	 * owned by the caller.
+	 */
+	OutboundSlab_t *slab;
+
+	if (capacity <= SlabSize && FreeList) {
+		slab = FreeList;
+		FreeList = slab->NextFree;
+		FreeCount--;
+	}
+	else {
+		if (capacity < SlabSize)
+			capacity = SlabSize;
+		slab = (OutboundSlab_t*) malloc (sizeof(OutboundSlab_t) + capacity);
+		if (!slab)
+			throw std::runtime_error ("no allocation for outbound data");
+		slab->Capacity = capacity;
+	}
+
+	slab->Used = 0;
+	slab->RefCount = 1;
+	slab->NextFree = NULL;
+	return slab;
+}
+
+
+/**********************
+OutboundSlab_t::Unref
+**********************/
+
+void OutboundSlab_t::Unref()
+{
+	assert (RefCount > 0);
+	if (--RefCount > 0)
+		return;
+
+	if (Capacity == SlabSize && FreeCount < MaxPooledSlabs) {
+		NextFree = FreeList;
+		FreeList = this;
+		FreeCount++;
+	}
+	else
+		free (this);
+}
+
+
+/*********************************
+OutboundChain_t::OutboundChain_t
+*********************************/
+
+OutboundChain_t::OutboundChain_t():
+	Tail (NULL)
+{
+}
+
+
+/**********************************
+OutboundChain_t::~OutboundChain_t
+**********************************/
+
+OutboundChain_t::~OutboundChain_t()
+{
+	Clear();
+}
+
+
+/************************
+OutboundChain_t::Append
+************************/
+
+void OutboundChain_t::Append (const char *data, int length, bool coalesce)
+{
+	/* Copies the data onto the end of the chain. Streams pass coalesce so
+	 * that consecutive small sends landing next to each other in the tail
+	 * slab grow a single segment, which keeps the writev vector short.
+	 * Datagrams don't, since every send must remain its own message.
+	 */
+	assert (length >= 0);
+
+	// An empty page carries meaning for a datagram, but not for a stream.
+	if (length == 0 && coalesce)
+		return;
+
+	if (length > OutboundSlab_t::CoalesceLimit) {
+		OutboundSlab_t *slab = OutboundSlab_t::Acquire (length);
+		memcpy (slab->Data(), data, length);
+		slab->Used = length;
+		Segments.push_back (Segment_t (slab, slab->Data(), length));
+		return;
+	}
+
+	if (!Tail || Tail->Free() < (size_t)length) {
+		if (Tail)
+			Tail->Unref();
+		Tail = OutboundSlab_t::Acquire (OutboundSlab_t::SlabSize);
+	}
+
+	char *p = Tail->Data() + Tail->Used;
+	if (length > 0)
+		memcpy (p, data, length);
+	Tail->Used += length;
+
+	if (coalesce && !Segments.empty()) {
+		Segment_t &last = Segments.back();
+		if (last.Slab == Tail && last.Buffer + last.Length == p) {
+			last.Length += length;
+			return;
+		}
+	}
+
+	Tail->Ref();
+	Segments.push_back (Segment_t (Tail, p, length));
+}
+
+
+/****************************
+OutboundChain_t::AppendFile
+****************************/
+
+void OutboundChain_t::AppendFile (int fd, off_t offset, off_t length)
+{
+	/* Queues length bytes of fd starting at offset, and takes ownership of
+	 * the descriptor: it's closed when the last of its segments is popped.
+	 * Ranges too big for a segment's int length are split up.
+	 */
+	assert (fd != -1 && length > 0);
+
+	while (length > 0) {
+		int len = (length > FileSegmentSize) ? (int)FileSegmentSize : (int)length;
+		length -= len;
+		Segments.push_back (Segment_t (fd, offset, len, length == 0));
+		offset += len;
+	}
+}
+
+
+/*************************
+OutboundChain_t::Consume
+*************************/
+
+void OutboundChain_t::Consume (size_t nbytes)
+{
+	// Drops the given number of bytes, which have been written, off the front.
+	while (nbytes > 0 && !Segments.empty()) {
+		Segment_t &seg = Segments.front();
+		size_t remaining = seg.Length - seg.Offset;
+		if (nbytes < remaining) {
+			seg.Offset += nbytes;
+			return;
+		}
+		nbytes -= remaining;
+		PopFront();
+	}
+}
+
+
+/**************************
+OutboundChain_t::PopFront
+**************************/
+
+void OutboundChain_t::PopFront()
+{
+	if (Segments.empty())
+		return;
+
+	Segment_t &seg = Segments.front();
+	if (seg.Slab)
+		seg.Slab->Unref();
+	else if (seg.bCloseFile)
+		close (seg.File);
+	Segments.pop_front();
+
+	// Once drained, let an idle connection give its tail slab back to the pool.
+	if (Segments.empty() && Tail) {
+		Tail->Unref();
+		Tail = NULL;
+	}
+}
+
+
+/***********************
+OutboundChain_t::Clear
+***********************/
+
+void OutboundChain_t::Clear()
+{
+	while (!Segments.empty())
+		PopFront();
+	if (Tail) {
+		Tail->Unref();
+		Tail = NULL;
+	}
+}
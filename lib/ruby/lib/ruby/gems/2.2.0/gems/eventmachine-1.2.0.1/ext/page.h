@@ -48,4 +48,96 @@ class PageList
 };
 
 
+/********************
+class OutboundSlab_t
+********************/
+
+/* A refcounted block of outbound bytes. Small sends are copied into shared
+ * slabs of SlabSize bytes, so one malloc serves many send_data calls;
+ * large sends get a slab of their own. Released slabs of the standard
+ * size go back on a free list instead of to the allocator. Like the rest
+ * of the reactor, this is only touched from the reactor thread.
+ */
+
+class OutboundSlab_t
+{
+	public:
+		enum {
+			SlabSize = 16 * 1024,
+			CoalesceLimit = 4 * 1024,
+			MaxPooledSlabs = 256
+		};
+
+		static OutboundSlab_t *Acquire (size_t);
+
+		void Ref() {RefCount++;}
+		void Unref();
+
+		char *Data() {return (char*)(this + 1);}
+		size_t Free() {return Capacity - Used;}
+
+		size_t Capacity;
+		size_t Used;
+
+	private:
+		int RefCount;
+		OutboundSlab_t *NextFree;
+
+		static OutboundSlab_t *FreeList;
+		static int FreeCount;
+};
+
+
+/*********************
+class OutboundChain_t
+*********************/
+
+/* Queue of outbound segments shared by the connection, pipe and datagram
+ * descriptors. Each segment points into a slab and holds a reference on it.
+ * A partial write just advances the offset of the first segment.
+ *
+ * Connections can also queue a range of an open file, which is sent with
+ * sendfile when it reaches the front and never copied into a slab. Such a
+ * segment has no slab, and the last segment of a file closes it.
+ */
+
+class OutboundChain_t
+{
+	public:
+		struct Segment_t {
+			Segment_t (OutboundSlab_t *s, const char *b, int l): Slab(s), Buffer(b), Length(l), Offset(0), File(-1), FileOffset(0), bCloseFile(false) {}
+			Segment_t (int f, off_t o, int l, bool c): Slab(NULL), Buffer(NULL), Length(l), Offset(0), File(f), FileOffset(o), bCloseFile(c) {}
+			bool IsFile() {return File != -1;}
+			OutboundSlab_t *Slab;
+			const char *Buffer;
+			int Length;
+			int Offset;
+			int File;
+			off_t FileOffset;
+			bool bCloseFile;
+		};
+
+		// Largest file range queued as a single segment.
+		enum { FileSegmentSize = 1024 * 1024 * 1024 };
+
+	public:
+		OutboundChain_t();
+		virtual ~OutboundChain_t();
+
+		void Append (const char*, int, bool coalesce);
+		void AppendFile (int, off_t, off_t);
+		void Consume (size_t);
+		void PopFront();
+		void Clear();
+
+		size_t Size() {return Segments.size();}
+		bool Empty() {return Segments.empty();}
+		Segment_t &operator[] (size_t i) {return Segments[i];}
+
+	private:
+		deque<Segment_t> Segments;
+		OutboundSlab_t *Tail;
+};
+
+
 #endif // __PageManager__H_
@@ -48,9 +48,7 @@ PipeDescriptor::~PipeDescriptor
 
 PipeDescriptor::~PipeDescriptor()
 {
-	// Run down any stranded outbound data.
-	for (size_t i=0; i < OutboundPages.size(); i++)
-		OutboundPages[i].Free();
+	// Stranded outbound data is run down by the OutboundChain_t destructor.
 
 	/* As a virtual destructor, we come here before the base-class
 	 * destructor that closes our file-descriptor.
@@ -162,6 +160,7 @@ void PipeDescriptor::Read()
 
 		if (r > 0) {
 			total_bytes_read += r;
+			MyEventMachine->Stats.BytesRead [ReactorStats_t::Pipe] += r;
 
 			// Add a null-terminator at the the end of the buffer
 			// that we will send to the callback.
@@ -205,20 +204,14 @@ void PipeDescriptor::Write()
 	char output_buffer [16 * 1024];
 	size_t nbytes = 0;
 
-	while ((OutboundPages.size() > 0) && (nbytes < sizeof(output_buffer))) {
-		OutboundPage *op = &(OutboundPages[0]);
-		if ((nbytes + op->Length - op->Offset) < sizeof (output_buffer)) {
-			memcpy (output_buffer + nbytes, op->Buffer + op->Offset, op->Length - op->Offset);
-			nbytes += (op->Length - op->Offset);
-			op->Free();
-			OutboundPages.pop_front();
-		}
-		else {
-			int len = sizeof(output_buffer) - nbytes;
-			memcpy (output_buffer + nbytes, op->Buffer + op->Offset, len);
-			op->Offset += len;
-			nbytes += len;
-		}
+	// Gather without dequeuing; whatever gets written is consumed afterwards.
+	for (size_t i = 0; (i < OutboundPages.Size()) && (nbytes < sizeof(output_buffer)); i++) {
+		OutboundChain_t::Segment_t *op = &(OutboundPages[i]);
+		size_t len = op->Length - op->Offset;
+		if (len > sizeof(output_buffer) - nbytes)
+			len = sizeof(output_buffer) - nbytes;
+		memcpy (output_buffer + nbytes, op->Buffer + op->Offset, len);
+		nbytes += len;
 	}
 
 	// We should never have gotten here if there were no data to write,
@@ -237,15 +230,8 @@ void PipeDescriptor::Write()
 
 	if (bytes_written > 0) {
 		OutboundDataSize -= bytes_written;
-		if ((size_t)bytes_written < nbytes) {
-			int len = nbytes - bytes_written;
-			char *buffer = (char*) malloc (len + 1);
-			if (!buffer)
-				throw std::runtime_error ("bad alloc throwing back data");
-			memcpy (buffer, output_buffer + bytes_written, len);
-			buffer [len] = 0;
-			OutboundPages.push_front (OutboundPage (buffer, len));
-		}
+		MyEventMachine->Stats.BytesWritten [ReactorStats_t::Pipe] += bytes_written;
+		OutboundPages.Consume (bytes_written);
 		#ifdef HAVE_EPOLL
 		EpollEvent.events = EPOLLIN;
 		if (SelectForWrite())
@@ -320,13 +306,9 @@ int PipeDescriptor::SendOutboundData (const char *data, unsigned long length)
 
 	if (!data && (length > 0))
 		throw std::runtime_error ("bad outbound data");
-	char *buffer = (char *) malloc (length + 1);
-	if (!buffer)
-		throw std::runtime_error ("no allocation for outbound data");
-	memcpy (buffer, data, length);
-	buffer [length] = 0;
-	OutboundPages.push_back (OutboundPage (buffer, length));
+	OutboundPages.Append (data, length, true);
 	OutboundDataSize += length;
+	MyEventMachine->Stats.RecordOutbound (ReactorStats_t::Pipe, OutboundDataSize);
 	#ifdef HAVE_EPOLL
 	EpollEvent.events = (EPOLLIN | EPOLLOUT);
 	assert (MyEventMachine);
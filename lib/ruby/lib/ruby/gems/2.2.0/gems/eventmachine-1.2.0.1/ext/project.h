@@ -30,6 +30,7 @@ See the file COPYING for complete licensing information.
 #include <string>
 #include <sstream>
 #include <stdexcept>
+#include <algorithm>
 
 
 #ifdef OS_UNIX
@@ -152,6 +153,10 @@ static inline int inotify_rm_watch (int fd, __u32 wd) { return syscall (__NR_ino
 #include <sys/uio.h>
 #endif
 
+#ifdef HAVE_SENDFILE
+#include <sys/sendfile.h>
+#endif
+
 #if __cplusplus
 extern "C" {
 #endif
@@ -167,10 +172,13 @@ extern "C" {
 #endif
 
 #include "binder.h"
+#include "wheel.h"
+#include "stats.h"
+#include "page.h"
 #include "em.h"
 #include "ed.h"
-#include "page.h"
 #include "ssl.h"
 #include "eventmachine.h"
+#include "framer.h"
 
 #endif // __Project__H_
@@ -54,6 +54,21 @@ static VALUE EmConnection;
 static VALUE EmConnsHash;
 static VALUE EmTimersHash;
 
+/* With event batching on, the data, completion, unbind and timer events
+ * of each pass through the reactor are collected here as
+ * [opcode, target, data] triples and handed to Ruby in one call.
+ */
+static bool BatchEvents = false;
+static bool CollectingEvents = false;
+static VALUE EventBatch = Qnil;
+
+#ifdef HAVE_SYNC_BUILTINS
+/* Completions queued by other threads are held by the reactor, out of the
+ * GC's sight. This object marks them for as long as they're there.
+ */
+static VALUE CompletionMarker = Qnil;
+#endif
+
 static VALUE EM_eConnectionError;
 static VALUE EM_eUnknownTimerFired;
 static VALUE EM_eConnectionNotBound;
@@ -65,16 +80,22 @@ static VALUE Intern_at_conns;
 static VALUE Intern_at_error_handler;
 static VALUE Intern_event_callback;
 static VALUE Intern_run_deferred_callbacks;
+static VALUE Intern_run_completions;
 static VALUE Intern_delete;
 static VALUE Intern_call;
 static VALUE Intern_at;
 static VALUE Intern_receive_data;
+static VALUE Intern_receive_frames;
+static VALUE Intern_receive_datagrams;
+static VALUE Intern_run_event_batch;
 static VALUE Intern_ssl_handshake_completed;
 static VALUE Intern_ssl_verify_peer;
 static VALUE Intern_notify_readable;
 static VALUE Intern_notify_writable;
 static VALUE Intern_proxy_target_unbound;
 static VALUE Intern_proxy_completed;
+static VALUE Intern_file_rotated;
+static VALUE Intern_file_truncated;
 static VALUE Intern_connection_completed;
 
 static VALUE rb_cProcStatus;
@@ -86,15 +107,50 @@ struct em_event {
 	unsigned long data_num;
 };
 
+static inline VALUE lookup_conn(const uintptr_t signature)
+{
+	/* The connection object is kept in the binding's slot after the first
+	 * lookup, so events don't go through the hash. @conns still holds a
+	 * reference to it until unbind, which is also when the slot goes away.
+	 */
+	VALUE conn = (VALUE) evma_get_binding_data (signature);
+	if (!conn) {
+		conn = rb_hash_aref (EmConnsHash, BSIG2NUM (signature));
+		if (conn != Qnil)
+			evma_set_binding_data (signature, (uintptr_t) conn);
+	}
+	return conn;
+}
+
 static inline VALUE ensure_conn(const uintptr_t signature)
 {
-	VALUE conn = rb_hash_aref (EmConnsHash, BSIG2NUM (signature));
+	VALUE conn = lookup_conn (signature);
 	if (conn == Qnil)
 		rb_raise (EM_eConnectionNotBound, "unknown connection: %" PRIFBSIG, signature);
 	return conn;
 }
 
 
+static inline VALUE frames_to_ary(const char *data_str, const unsigned long data_num)
+{
+	const struct evma_frame *frames = (const struct evma_frame*) data_str;
+	VALUE ary = rb_ary_new2 (data_num);
+	for (unsigned long i = 0; i < data_num; i++)
+		rb_ary_push (ary, rb_str_new (frames[i].data, frames[i].length));
+	return ary;
+}
+
+static inline VALUE datagrams_to_ary(const char *data_str, const unsigned long data_num)
+{
+	const struct evma_datagram *datagrams = (const struct evma_datagram*) data_str;
+	VALUE ary = rb_ary_new2 (data_num);
+	for (unsigned long i = 0; i < data_num; i++)
+		rb_ary_push (ary, rb_assoc_new (rb_str_new (datagrams[i].data, datagrams[i].length),
+			rb_str_new ((const char*) datagrams[i].sender, datagrams[i].sender_length)));
+	return ary;
+}
+
+
 /****************
 t_event_callback
 ****************/
@@ -109,12 +165,24 @@ static inline void event_callback (struct em_event* e)
 	switch (event) {
 		case EM_CONNECTION_READ:
 		{
-			VALUE conn = rb_hash_aref (EmConnsHash, BSIG2NUM (signature));
+			VALUE conn = lookup_conn (signature);
 			if (conn == Qnil)
 				rb_raise (EM_eConnectionNotBound, "received %lu bytes of data for unknown signature: %" PRIFBSIG, data_num, signature);
 			rb_funcall (conn, Intern_receive_data, 1, rb_str_new (data_str, data_num));
 			return;
 		}
+		case EM_CONNECTION_FRAMES:
+		{
+			VALUE conn = ensure_conn(signature);
+			rb_funcall (conn, Intern_receive_frames, 1, frames_to_ary (data_str, data_num));
+			return;
+		}
+		case EM_CONNECTION_DATAGRAMS:
+		{
+			VALUE conn = ensure_conn(signature);
+			rb_funcall (conn, Intern_receive_datagrams, 1, datagrams_to_ary (data_str, data_num));
+			return;
+		}
 		case EM_CONNECTION_ACCEPTED:
 		{
 			rb_funcall (EmModule, Intern_event_callback, 3, BSIG2NUM(signature), INT2FIX(event), ULONG2NUM(data_num));
@@ -148,6 +216,15 @@ static inline void event_callback (struct em_event* e)
 			rb_funcall (EmModule, Intern_run_deferred_callbacks, 0);
 			return;
 		}
+		case EM_DEFERRED_COMPLETIONS:
+		{
+			const uintptr_t *completions = (const uintptr_t*) data_str;
+			VALUE ary = rb_ary_new2 (data_num);
+			for (unsigned long i = 0; i < data_num; i++)
+				rb_ary_push (ary, (VALUE) completions[i]);
+			rb_funcall (EmModule, Intern_run_completions, 1, ary);
+			return;
+		}
 		case EM_TIMER_FIRED:
 		{
 			VALUE timer = rb_funcall (EmTimersHash, Intern_delete, 1, ULONG2NUM (data_num));
@@ -188,6 +265,18 @@ static inline void event_callback (struct em_event* e)
 			rb_funcall (conn, Intern_proxy_completed, 0);
 			return;
 		}
+		case EM_FILE_ROTATED:
+		{
+			VALUE conn = ensure_conn(signature);
+			rb_funcall (conn, Intern_file_rotated, 1, rb_str_new (data_str, data_num));
+			return;
+		}
+		case EM_FILE_TRUNCATED:
+		{
+			VALUE conn = ensure_conn(signature);
+			rb_funcall (conn, Intern_file_truncated, 0);
+			return;
+		}
 	}
 }
 
@@ -201,12 +290,93 @@ static void event_error_handler(VALUE self UNUSED, VALUE err)
 	rb_funcall (error_handler, Intern_call, 1, err);
 }
 
+/*****************
+flush_event_batch
+*****************/
+
+static void flush_event_batch()
+{
+	if (RARRAY_LEN (EventBatch) == 0)
+		return;
+
+	// Anything the handlers cause is dispatched right away.
+	bool collecting = CollectingEvents;
+	CollectingEvents = false;
+	rb_funcall (EmModule, Intern_run_event_batch, 1, EventBatch);
+	rb_ary_clear (EventBatch);
+	CollectingEvents = collecting;
+}
+
+/***********
+batch_event
+***********/
+
+static bool batch_event (const uintptr_t signature, int event, const char *data_str, const unsigned long data_num)
+{
+	VALUE target, data;
+
+	switch (event) {
+		case EM_CONNECTION_READ:
+		case EM_CONNECTION_FRAMES:
+		case EM_CONNECTION_DATAGRAMS:
+		case EM_CONNECTION_COMPLETED:
+			// Connections are resolved now, while their slots still exist.
+			target = lookup_conn (signature);
+			if (target == Qnil)
+				target = BSIG2NUM (signature);
+			if (event == EM_CONNECTION_READ)
+				data = rb_str_new (data_str, data_num);
+			else if (event == EM_CONNECTION_FRAMES)
+				data = frames_to_ary (data_str, data_num);
+			else if (event == EM_CONNECTION_DATAGRAMS)
+				data = datagrams_to_ary (data_str, data_num);
+			else
+				data = Qnil;
+			break;
+		case EM_CONNECTION_UNBOUND:
+			target = BSIG2NUM (signature);
+			data = ULONG2NUM (data_num);
+			break;
+		case EM_TIMER_FIRED:
+			target = Qnil;
+			data = ULONG2NUM (data_num);
+			break;
+		default:
+			return false;
+	}
+
+	rb_ary_push (EventBatch, INT2FIX (event));
+	rb_ary_push (EventBatch, target);
+	rb_ary_push (EventBatch, data);
+	return true;
+}
+
+/************************
+run_machine_once_batched
+************************/
+
+static bool run_machine_once_batched()
+{
+	CollectingEvents = true;
+	bool running = evma_run_machine_once();
+	CollectingEvents = false;
+	flush_event_batch();
+	return running;
+}
+
 /**********************
 event_callback_wrapper
 **********************/
 
 static void event_callback_wrapper (const uintptr_t signature, int event, const char *data_str, const unsigned long data_num)
 {
+	if (CollectingEvents) {
+		if (batch_event (signature, event, data_str, data_num))
+			return;
+		// Events that can't wait go after the ones collected before them.
+		flush_event_batch();
+	}
+
 	struct em_event e;
 	e.signature = signature;
 	e.event = event;
@@ -229,6 +399,9 @@ static VALUE t_initialize_event_machine (VALUE self UNUSED)
 	EmTimersHash = rb_ivar_get (EmModule, Intern_at_timers);
 	assert(EmConnsHash != Qnil);
 	assert(EmTimersHash != Qnil);
+	BatchEvents = evma_get_event_batching() ? true : false;
+	CollectingEvents = false;
+	rb_ary_clear (EventBatch);
 	evma_initialize_library ((EMCallback)event_callback_wrapper);
 	return Qnil;
 }
@@ -240,6 +413,8 @@ t_run_machine_once
 
 static VALUE t_run_machine_once (VALUE self UNUSED)
 {
+	if (BatchEvents)
+		return run_machine_once_batched() ? Qtrue : Qfalse;
 	return evma_run_machine_once () ? Qtrue : Qfalse;
 }
 
@@ -250,7 +425,11 @@ t_run_machine
 
 static VALUE t_run_machine (VALUE self UNUSED)
 {
-	evma_run_machine();
+	if (BatchEvents) {
+		while (run_machine_once_batched()) ;
+	}
+	else
+		evma_run_machine();
 	return Qnil;
 }
 
@@ -280,6 +459,18 @@ static VALUE t_start_server (VALUE self UNUSED, VALUE server, VALUE port)
 	return BSIG2NUM (f);
 }
 
+/************************
+t_start_reuseport_server
+************************/
+
+static VALUE t_start_reuseport_server (VALUE self UNUSED, VALUE server, VALUE port)
+{
+	const uintptr_t f = evma_create_reuseport_tcp_server (StringValueCStr(server), FIX2INT(port));
+	if (!f)
+		rb_raise (rb_eRuntimeError, "%s", "no acceptor (port is in use by a non-reuseport listener or requires root privileges)");
+	return BSIG2NUM (f);
+}
+
 /*************
 t_stop_server
 *************/
@@ -464,6 +655,22 @@ static VALUE t_get_sni_hostname (VALUE self UNUSED, VALUE signature UNUSED)
 }
 #endif
 
+/***********************
+t_is_ssl_session_reused
+***********************/
+
+#ifdef WITH_SSL
+static VALUE t_is_ssl_session_reused (VALUE self UNUSED, VALUE signature)
+{
+	return evma_is_ssl_session_reused (NUM2BSIG (signature)) ? Qtrue : Qfalse;
+}
+#else
+static VALUE t_is_ssl_session_reused (VALUE self UNUSED, VALUE signature UNUSED)
+{
+	return Qfalse;
+}
+#endif
+
 /**************
 t_get_peername
 **************/
@@ -597,6 +804,94 @@ static VALUE t_set_pending_connect_timeout (VALUE self UNUSED, VALUE signature,
 	return Qfalse;
 }
 
+/*********************
+t_get_read_batch_size
+*********************/
+
+static VALUE t_get_read_batch_size (VALUE self UNUSED, VALUE signature)
+{
+	int value = evma_get_read_batch_size (NUM2BSIG (signature));
+	if (value < 0)
+		return Qnil;
+	return INT2NUM (value);
+}
+
+/*********************
+t_set_read_batch_size
+*********************/
+
+static VALUE t_set_read_batch_size (VALUE self UNUSED, VALUE signature, VALUE value)
+{
+	if (evma_set_read_batch_size (NUM2BSIG (signature), NUM2INT (value)))
+		return Qtrue;
+	return Qfalse;
+}
+
+/*********************
+t_set_inbound_framing
+*********************/
+
+static VALUE t_set_inbound_framing (VALUE self UNUSED, VALUE signature, VALUE mode, VALUE delimiter, VALUE prefix_size, VALUE max_frame_size)
+{
+	const char *delim = NULL;
+	int delim_len = 0;
+	if (!NIL_P (delimiter)) {
+		StringValue (delimiter);
+		delim = RSTRING_PTR (delimiter);
+		delim_len = (int) RSTRING_LEN (delimiter);
+	}
+
+	if (evma_set_inbound_framing (NUM2BSIG (signature), NUM2INT (mode), delim, delim_len, NUM2INT (prefix_size), NUM2ULONG (max_frame_size)))
+		return Qtrue;
+	return Qfalse;
+}
+
+/*************************
+t_get_datagram_batch_size
+*************************/
+
+static VALUE t_get_datagram_batch_size (VALUE self UNUSED, VALUE signature)
+{
+	int value = evma_get_datagram_batch_size (NUM2BSIG (signature));
+	if (value < 0)
+		return Qnil;
+	return INT2NUM (value);
+}
+
+/***********************
+t_set_datagram_batching
+***********************/
+
+static VALUE t_set_datagram_batching (VALUE self UNUSED, VALUE signature, VALUE batch_size, VALUE deliver_batches)
+{
+	if (evma_set_datagram_batching (NUM2BSIG (signature), NUM2INT (batch_size), RTEST (deliver_batches) ? 1 : 0))
+		return Qtrue;
+	return Qfalse;
+}
+
+/*********************
+t_get_read_iterations
+*********************/
+
+static VALUE t_get_read_iterations (VALUE self UNUSED, VALUE signature)
+{
+	int value = evma_get_read_iterations (NUM2BSIG (signature));
+	if (value < 0)
+		return Qnil;
+	return INT2NUM (value);
+}
+
+/*********************
+t_set_read_iterations
+*********************/
+
+static VALUE t_set_read_iterations (VALUE self UNUSED, VALUE signature, VALUE value)
+{
+	if (evma_set_read_iterations (NUM2BSIG (signature), NUM2INT (value)))
+		return Qtrue;
+	return Qfalse;
+}
+
 /***************
 t_send_datagram
 ***************/
@@ -889,6 +1184,49 @@ static VALUE t_signal_loopbreak (VALUE self UNUSED)
 	return Qnil;
 }
 
+#ifdef HAVE_SYNC_BUILTINS
+
+/******************
+t_queue_completion
+******************/
+
+static VALUE t_queue_completion (VALUE self UNUSED, VALUE completion)
+{
+	evma_queue_completion ((uintptr_t) completion);
+	return Qnil;
+}
+
+/*********************
+t_completions_pending
+*********************/
+
+static VALUE t_completions_pending (VALUE self UNUSED)
+{
+	return evma_has_completions() ? Qtrue : Qfalse;
+}
+
+/****************
+mark_completions
+****************/
+
+static void mark_completion (uintptr_t completion)
+{
+	rb_gc_mark ((VALUE) completion);
+}
+
+static void mark_completions (void *ptr UNUSED)
+{
+	evma_mark_completions (mark_completion);
+}
+
+static const rb_data_type_t CompletionMarkerType = {
+	"EventMachine completions",
+	{mark_completions, NULL, NULL,},
+	NULL, NULL, 0
+};
+
+#endif // HAVE_SYNC_BUILTINS
+
 /**************
 t_library_type
 **************/
@@ -929,6 +1267,115 @@ static VALUE t_set_max_timer_count (VALUE self UNUSED, VALUE ct)
 	return Qnil;
 }
 
+/*****************
+t_get_timer_wheel
+*****************/
+
+static VALUE t_get_timer_wheel (VALUE self UNUSED)
+{
+	return evma_get_timer_wheel() ? Qtrue : Qfalse;
+}
+
+/*****************
+t_set_timer_wheel
+*****************/
+
+static VALUE t_set_timer_wheel (VALUE self UNUSED, VALUE val)
+{
+	evma_set_timer_wheel (RTEST (val) ? 1 : 0);
+	return val;
+}
+
+/**********************
+t_get_edge_triggered
+**********************/
+
+static VALUE t_get_edge_triggered (VALUE self UNUSED)
+{
+	return evma_get_edge_triggered() ? Qtrue : Qfalse;
+}
+
+/**********************
+t_set_edge_triggered
+**********************/
+
+static VALUE t_set_edge_triggered (VALUE self UNUSED, VALUE val)
+{
+	evma_set_edge_triggered (RTEST (val) ? 1 : 0);
+	return val;
+}
+
+/********************
+t_get_event_batching
+********************/
+
+static VALUE t_get_event_batching (VALUE self UNUSED)
+{
+	return evma_get_event_batching() ? Qtrue : Qfalse;
+}
+
+/********************
+t_set_event_batching
+********************/
+
+static VALUE t_set_event_batching (VALUE self UNUSED, VALUE val)
+{
+	evma_set_event_batching (RTEST (val) ? 1 : 0);
+	return val;
+}
+
+/***********
+t_get_stats
+***********/
+
+static VALUE _stats_by_class (const uint64_t *counts)
+{
+	VALUE hash = rb_hash_new();
+	rb_hash_aset (hash, ID2SYM (rb_intern ("connection")), ULL2NUM (counts [ReactorStats_t::Connection]));
+	rb_hash_aset (hash, ID2SYM (rb_intern ("datagram")), ULL2NUM (counts [ReactorStats_t::Datagram]));
+	rb_hash_aset (hash, ID2SYM (rb_intern ("pipe")), ULL2NUM (counts [ReactorStats_t::Pipe]));
+	return hash;
+}
+
+static VALUE t_get_stats (VALUE self UNUSED)
+{
+	const ReactorStats_t *stats = evma_get_stats();
+	VALUE hash = rb_hash_new();
+
+	rb_hash_aset (hash, ID2SYM (rb_intern ("loop_iterations")), ULL2NUM (stats->LoopIterations));
+	rb_hash_aset (hash, ID2SYM (rb_intern ("poll_time")), rb_float_new (stats->PollTime / 1000000.0));
+	rb_hash_aset (hash, ID2SYM (rb_intern ("dispatch_time")), rb_float_new (stats->DispatchTime / 1000000.0));
+	rb_hash_aset (hash, ID2SYM (rb_intern ("wakeups")), ULL2NUM (stats->Wakeups));
+	rb_hash_aset (hash, ID2SYM (rb_intern ("events")), ULL2NUM (stats->Events));
+
+	// Keyed by the smallest event count each bucket holds.
+	VALUE per_wakeup = rb_hash_new();
+	for (int i = 0; i < ReactorStats_t::WakeupBuckets; i++) {
+		if (stats->EventsPerWakeup [i])
+			rb_hash_aset (per_wakeup, INT2FIX (1 << i), ULL2NUM (stats->EventsPerWakeup [i]));
+	}
+	rb_hash_aset (hash, ID2SYM (rb_intern ("events_per_wakeup")), per_wakeup);
+
+	rb_hash_aset (hash, ID2SYM (rb_intern ("timers_fired")), ULL2NUM (stats->TimersFired));
+	rb_hash_aset (hash, ID2SYM (rb_intern ("heartbeat_sweeps")), ULL2NUM (stats->HeartbeatSweeps));
+	rb_hash_aset (hash, ID2SYM (rb_intern ("heartbeat_time")), rb_float_new (stats->HeartbeatTime / 1000000.0));
+	rb_hash_aset (hash, ID2SYM (rb_intern ("loop_breaks")), ULL2NUM (stats->LoopBreaks));
+	rb_hash_aset (hash, ID2SYM (rb_intern ("completions")), ULL2NUM (stats->Completions));
+
+	rb_hash_aset (hash, ID2SYM (rb_intern ("bytes_read")), _stats_by_class (stats->BytesRead));
+	rb_hash_aset (hash, ID2SYM (rb_intern ("bytes_written")), _stats_by_class (stats->BytesWritten));
+	rb_hash_aset (hash, ID2SYM (rb_intern ("outbound_high_water")), _stats_by_class (stats->OutboundHighWater));
+
+	VALUE latency = rb_hash_new();
+	rb_hash_aset (latency, ID2SYM (rb_intern ("p50")), rb_float_new (stats->LatencyPercentile (50) / 1000000.0));
+	rb_hash_aset (latency, ID2SYM (rb_intern ("p90")), rb_float_new (stats->LatencyPercentile (90) / 1000000.0));
+	rb_hash_aset (latency, ID2SYM (rb_intern ("p99")), rb_float_new (stats->LatencyPercentile (99) / 1000000.0));
+	rb_hash_aset (latency, ID2SYM (rb_intern ("max")), rb_float_new (stats->LatencyPercentile (100) / 1000000.0));
+	rb_hash_aset (hash, ID2SYM (rb_intern ("callback_latency")), latency);
+
+	return hash;
+}
+
 /********************
 t_get/set_simultaneous_accept_count
 ********************/
@@ -1033,6 +1480,21 @@ static VALUE t_unwatch_filename (VALUE self UNUSED, VALUE sig)
 }
 
 
+/***********
+t_tail_file
+***********/
+
+static VALUE t_tail_file (VALUE self UNUSED, VALUE fname, VALUE flags, VALUE max_line_size)
+{
+	try {
+		return BSIG2NUM(evma_tail_file(StringValueCStr(fname), NUM2INT(flags), NUM2ULONG(max_line_size)));
+	} catch (std::runtime_error e) {
+		rb_raise (EM_eUnsupported, "%s", e.what());
+	}
+	return Qnil;
+}
+
+
 /***********
 t_watch_pid
 ***********/
@@ -1152,6 +1614,32 @@ static VALUE t__ssl_p (VALUE self UNUSED)
 	#endif
 }
 
+/**************
+t__reuseport_p
+**************/
+
+static VALUE t__reuseport_p (VALUE self UNUSED)
+{
+	#ifdef HAVE_CONST_SO_REUSEPORT
+	return Qtrue;
+	#else
+	return Qfalse;
+	#endif
+}
+
+/*************
+t__sendfile_p
+*************/
+
+static VALUE t__sendfile_p (VALUE self UNUSED)
+{
+	#ifdef HAVE_SENDFILE
+	return Qtrue;
+	#else
+	return Qfalse;
+	#endif
+}
+
 /********
 t_stopping
 ********/
@@ -1178,7 +1666,8 @@ static VALUE t_send_file_data (VALUE self UNUSED, VALUE signature, VALUE filenam
 {
 
 	/* The current implementation of evma_send_file_data_to_connection enforces a strict
-	 * upper limit on the file size it will transmit (currently 32K). The function returns
+	 * upper limit on the file size it will transmit (currently 32K), unless the connection
+	 * can send larger files with sendfile. The function returns
 	 * zero on success, -1 if the requested file exceeds its size limit, and a positive
 	 * number for other errors.
 	 * TODO: Positive return values are actually errno's, which is probably the wrong way to
@@ -1187,7 +1676,7 @@ static VALUE t_send_file_data (VALUE self UNUSED, VALUE signature, VALUE filenam
 
 	int b = evma_send_file_data_to_connection (NUM2BSIG (signature), StringValueCStr(filename));
 	if (b == -1)
-		rb_raise(rb_eRuntimeError, "%s", "File too large.  send_file_data() supports files under 32k.");
+		rb_raise(rb_eRuntimeError, "%s", "File too large.  send_file_data() supports files under 32k without sendfile.");
 	if (b > 0) {
 		char *err = strerror (b);
 		char buf[1024];
@@ -1201,6 +1690,31 @@ static VALUE t_send_file_data (VALUE self UNUSED, VALUE signature, VALUE filenam
 }
 
 
+/***************
+t_sendfile_data
+***************/
+
+static VALUE t_sendfile_data (VALUE self UNUSED, VALUE signature, VALUE filename)
+{
+	/* Returns false rather than raising when the connection can't use sendfile,
+	 * so that callers can fall back to sending the data themselves.
+	 */
+	int b = evma_sendfile_data_to_connection (NUM2BSIG (signature), StringValueCStr(filename));
+	if (b == -1)
+		return Qfalse;
+	if (b > 0) {
+		char *err = strerror (b);
+		char buf[1024];
+		memset (buf, 0, sizeof(buf));
+		snprintf (buf, sizeof(buf)-1, ": %s %s", StringValueCStr(filename),(err?err:"???"));
+
+		rb_raise (rb_eIOError, "%s", buf);
+	}
+
+	return Qtrue;
+}
+
+
 /*******************
 t_set_rlimit_nofile
 *******************/
@@ -1362,16 +1876,22 @@ extern "C" void Init_rubyeventmachine()
 
 	Intern_event_callback = rb_intern ("event_callback");
 	Intern_run_deferred_callbacks = rb_intern ("run_deferred_callbacks");
+	Intern_run_completions = rb_intern ("run_completions");
 	Intern_delete = rb_intern ("delete");
 	Intern_call = rb_intern ("call");
 	Intern_at = rb_intern("at");
 	Intern_receive_data = rb_intern ("receive_data");
+	Intern_receive_frames = rb_intern ("receive_frames");
+	Intern_receive_datagrams = rb_intern ("receive_datagrams");
+	Intern_run_event_batch = rb_intern ("run_event_batch");
 	Intern_ssl_handshake_completed = rb_intern ("ssl_handshake_completed");
 	Intern_ssl_verify_peer = rb_intern ("ssl_verify_peer");
 	Intern_notify_readable = rb_intern ("notify_readable");
 	Intern_notify_writable = rb_intern ("notify_writable");
 	Intern_proxy_target_unbound = rb_intern ("proxy_target_unbound");
 	Intern_proxy_completed = rb_intern ("proxy_completed");
+	Intern_file_rotated = rb_intern ("file_rotated");
+	Intern_file_truncated = rb_intern ("file_truncated");
 	Intern_connection_completed = rb_intern ("connection_completed");
 
 	// INCOMPLETE, we need to define class Connections inside module EventMachine
@@ -1380,6 +1900,15 @@ extern "C" void Init_rubyeventmachine()
 	EmModule = rb_define_module ("EventMachine");
 	EmConnection = rb_define_class_under (EmModule, "Connection", rb_cObject);
 
+	EventBatch = rb_ary_new();
+	rb_global_variable (&EventBatch);
+
+	#ifdef HAVE_SYNC_BUILTINS
+	// The GC only calls the mark function of objects with a data pointer.
+	CompletionMarker = TypedData_Wrap_Struct (0, &CompletionMarkerType, &CompletionMarker);
+	rb_global_variable (&CompletionMarker);
+	#endif
+
 	rb_define_class_under (EmModule, "NoHandlerForAcceptedConnection", rb_eRuntimeError);
 	EM_eConnectionError = rb_define_class_under (EmModule, "ConnectionError", rb_eRuntimeError);
 	EM_eConnectionNotBound = rb_define_class_under (EmModule, "ConnectionNotBound", rb_eRuntimeError);
@@ -1392,6 +1921,7 @@ extern "C" void Init_rubyeventmachine()
 	rb_define_module_function (EmModule, "run_machine_without_threads", (VALUE(*)(...))t_run_machine, 0);
 	rb_define_module_function (EmModule, "add_oneshot_timer", (VALUE(*)(...))t_add_oneshot_timer, 1);
 	rb_define_module_function (EmModule, "start_tcp_server", (VALUE(*)(...))t_start_server, 2);
+	rb_define_module_function (EmModule, "start_reuseport_tcp_server", (VALUE(*)(...))t_start_reuseport_server, 2);
 	rb_define_module_function (EmModule, "stop_tcp_server", (VALUE(*)(...))t_stop_server, 1);
 	rb_define_module_function (EmModule, "start_unix_server", (VALUE(*)(...))t_start_unix_server, 1);
 	rb_define_module_function (EmModule, "attach_sd", (VALUE(*)(...))t_attach_sd, 1);
@@ -1402,6 +1932,7 @@ extern "C" void Init_rubyeventmachine()
 	rb_define_module_function (EmModule, "get_cipher_name", (VALUE(*)(...))t_get_cipher_name, 1);
 	rb_define_module_function (EmModule, "get_cipher_protocol", (VALUE(*)(...))t_get_cipher_protocol, 1);
 	rb_define_module_function (EmModule, "get_sni_hostname", (VALUE(*)(...))t_get_sni_hostname, 1);
+	rb_define_module_function (EmModule, "ssl_session_reused?", (VALUE(*)(...))t_is_ssl_session_reused, 1);
 	rb_define_module_function (EmModule, "send_data", (VALUE(*)(...))t_send_data, 3);
 	rb_define_module_function (EmModule, "send_datagram", (VALUE(*)(...))t_send_datagram, 5);
 	rb_define_module_function (EmModule, "close_connection", (VALUE(*)(...))t_close_connection, 2);
@@ -1431,6 +1962,7 @@ extern "C" void Init_rubyeventmachine()
 
 	rb_define_module_function (EmModule, "watch_filename", (VALUE (*)(...))t_watch_filename, 1);
 	rb_define_module_function (EmModule, "unwatch_filename", (VALUE (*)(...))t_unwatch_filename, 1);
+	rb_define_module_function (EmModule, "tail_filename", (VALUE (*)(...))t_tail_file, 3);
 
 	rb_define_module_function (EmModule, "watch_pid", (VALUE (*)(...))t_watch_pid, 1);
 	rb_define_module_function (EmModule, "unwatch_pid", (VALUE (*)(...))t_unwatch_pid, 1);
@@ -1442,15 +1974,27 @@ extern "C" void Init_rubyeventmachine()
 	rb_define_module_function (EmModule, "release_machine", (VALUE(*)(...))t_release_machine, 0);
 	rb_define_module_function (EmModule, "stop", (VALUE(*)(...))t_stop, 0);
 	rb_define_module_function (EmModule, "signal_loopbreak", (VALUE(*)(...))t_signal_loopbreak, 0);
+	#ifdef HAVE_SYNC_BUILTINS
+	rb_define_module_function (EmModule, "queue_completion", (VALUE(*)(...))t_queue_completion, 1);
+	rb_define_module_function (EmModule, "completions_pending?", (VALUE(*)(...))t_completions_pending, 0);
+	#endif
 	rb_define_module_function (EmModule, "library_type", (VALUE(*)(...))t_library_type, 0);
 	rb_define_module_function (EmModule, "set_timer_quantum", (VALUE(*)(...))t_set_timer_quantum, 1);
 	rb_define_module_function (EmModule, "get_max_timer_count", (VALUE(*)(...))t_get_max_timer_count, 0);
 	rb_define_module_function (EmModule, "set_max_timer_count", (VALUE(*)(...))t_set_max_timer_count, 1);
+	rb_define_module_function (EmModule, "get_timer_wheel", (VALUE(*)(...))t_get_timer_wheel, 0);
+	rb_define_module_function (EmModule, "set_timer_wheel", (VALUE(*)(...))t_set_timer_wheel, 1);
+	rb_define_module_function (EmModule, "get_edge_triggered", (VALUE(*)(...))t_get_edge_triggered, 0);
+	rb_define_module_function (EmModule, "set_edge_triggered", (VALUE(*)(...))t_set_edge_triggered, 1);
+	rb_define_module_function (EmModule, "get_event_batching", (VALUE(*)(...))t_get_event_batching, 0);
+	rb_define_module_function (EmModule, "set_event_batching", (VALUE(*)(...))t_set_event_batching, 1);
+	rb_define_module_function (EmModule, "get_stats", (VALUE(*)(...))t_get_stats, 0);
 	rb_define_module_function (EmModule, "get_simultaneous_accept_count", (VALUE(*)(...))t_get_simultaneous_accept_count, 0);
 	rb_define_module_function (EmModule, "set_simultaneous_accept_count", (VALUE(*)(...))t_set_simultaneous_accept_count, 1);
 	rb_define_module_function (EmModule, "setuid_string", (VALUE(*)(...))t_setuid_string, 1);
 	rb_define_module_function (EmModule, "invoke_popen", (VALUE(*)(...))t_invoke_popen, 1);
 	rb_define_module_function (EmModule, "send_file_data", (VALUE(*)(...))t_send_file_data, 2);
+	rb_define_module_function (EmModule, "sendfile_data", (VALUE(*)(...))t_sendfile_data, 2);
 	rb_define_module_function (EmModule, "get_heartbeat_interval", (VALUE(*)(...))t_get_heartbeat_interval, 0);
 	rb_define_module_function (EmModule, "set_heartbeat_interval", (VALUE(*)(...))t_set_heartbeat_interval, 1);
 	rb_define_module_function (EmModule, "get_idle_time", (VALUE(*)(...))t_get_idle_time, 1);
@@ -1463,6 +2007,13 @@ extern "C" void Init_rubyeventmachine()
 	rb_define_module_function (EmModule, "set_comm_inactivity_timeout", (VALUE(*)(...))t_set_comm_inactivity_timeout, 2);
 	rb_define_module_function (EmModule, "get_pending_connect_timeout", (VALUE(*)(...))t_get_pending_connect_timeout, 1);
 	rb_define_module_function (EmModule, "set_pending_connect_timeout", (VALUE(*)(...))t_set_pending_connect_timeout, 2);
+	rb_define_module_function (EmModule, "get_read_batch_size", (VALUE(*)(...))t_get_read_batch_size, 1);
+	rb_define_module_function (EmModule, "set_read_batch_size", (VALUE(*)(...))t_set_read_batch_size, 2);
+	rb_define_module_function (EmModule, "set_inbound_framing", (VALUE(*)(...))t_set_inbound_framing, 5);
+	rb_define_module_function (EmModule, "get_datagram_batch_size", (VALUE(*)(...))t_get_datagram_batch_size, 1);
+	rb_define_module_function (EmModule, "set_datagram_batching", (VALUE(*)(...))t_set_datagram_batching, 3);
+	rb_define_module_function (EmModule, "get_read_iterations", (VALUE(*)(...))t_get_read_iterations, 1);
+	rb_define_module_function (EmModule, "set_read_iterations", (VALUE(*)(...))t_set_read_iterations, 2);
 	rb_define_module_function (EmModule, "set_rlimit_nofile", (VALUE(*)(...))t_set_rlimit_nofile, 1);
 	rb_define_module_function (EmModule, "get_connection_count", (VALUE(*)(...))t_get_connection_count, 0);
 
@@ -1475,6 +2026,8 @@ extern "C" void Init_rubyeventmachine()
 	rb_define_module_function (EmModule, "kqueue?", (VALUE(*)(...))t__kqueue_p, 0);
 
 	rb_define_module_function (EmModule, "ssl?", (VALUE(*)(...))t__ssl_p, 0);
+	rb_define_module_function (EmModule, "reuseport?", (VALUE(*)(...))t__reuseport_p, 0);
+	rb_define_module_function (EmModule, "sendfile?", (VALUE(*)(...))t__sendfile_p, 0);
 	rb_define_module_function(EmModule, "stopping?",(VALUE(*)(...))t_stopping, 0);
 
 	rb_define_method (EmConnection, "get_outbound_data_size", (VALUE(*)(...))conn_get_outbound_data_size, 0);
@@ -1493,6 +2046,19 @@ extern "C" void Init_rubyeventmachine()
 	// EM_SSL_VERIFY = 109,
 	// EM_PROXY_TARGET_UNBOUND = 110,
 	// EM_PROXY_COMPLETED = 111
+	rb_define_const (EmModule, "ConnectionFrames",         INT2NUM(EM_CONNECTION_FRAMES         ));
+	rb_define_const (EmModule, "ConnectionDatagrams",      INT2NUM(EM_CONNECTION_DATAGRAMS      ));
+
+	// Inbound framing
+	rb_define_const (EmModule, "FramingNone",         INT2NUM(EM_FRAMING_NONE         ));
+	rb_define_const (EmModule, "FramingLine",         INT2NUM(EM_FRAMING_LINE         ));
+	rb_define_const (EmModule, "FramingDelimiter",    INT2NUM(EM_FRAMING_DELIMITER    ));
+	rb_define_const (EmModule, "FramingLengthPrefix", INT2NUM(EM_FRAMING_LENGTH_PREFIX));
+
+	// Tailing files
+	rb_define_const (EmModule, "TailFromStart", INT2NUM(EM_TAIL_FROM_START));
+	rb_define_const (EmModule, "TailStrftime",  INT2NUM(EM_TAIL_STRFTIME  ));
+	rb_define_const (EmModule, "TailLines",     INT2NUM(EM_TAIL_LINES     ));
 
 	// SSL Protocols
 	rb_define_const (EmModule, "EM_PROTO_SSLv2",   INT2NUM(EM_PROTO_SSLv2  ));
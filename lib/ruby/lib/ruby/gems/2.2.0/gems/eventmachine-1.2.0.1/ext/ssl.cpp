@@ -24,6 +24,7 @@ See the file COPYING for complete licensing information.
 
 
 bool SslContext_t::bLibraryInitialized = false;
+map<string, SslContext_t*> SslContext_t::Contexts;
 
 
 
@@ -120,9 +121,11 @@ static void InitializeDefaultCredentials()
 SslContext_t::SslContext_t
 **************************/
 
-SslContext_t::SslContext_t (bool is_server, const string &privkeyfile, const string &certchainfile, const string &cipherlist, const string &ecdh_curve, const string &dhparam, int ssl_version) :
+SslContext_t::SslContext_t (bool is_server, const string &privkeyfile, const string &certchainfile, bool verify_peer, const string &cipherlist, const string &ecdh_curve, const string &dhparam, int ssl_version) :
 	bIsServer (is_server),
+	bCacheSessions (!verify_peer),
 	pCtx (NULL),
+	RefCount (0),
 	PrivateKey (NULL),
 	Certificate (NULL)
 {
@@ -263,11 +266,31 @@ SslContext_t::SslContext_t (bool is_server, const string &privkeyfile, const str
 	else
 		SSL_CTX_set_cipher_list (pCtx, "ALL:!ADH:!LOW:!EXP:!DES-CBC3-SHA:@STRENGTH");
 
+	/* A resumed session skips certificate verification, so it would never
+	 * reach the connection's ssl_verify_peer. Contexts that verify peers
+	 * always do full handshakes.
+	 */
 	if (bIsServer) {
-		SSL_CTX_sess_set_cache_size (pCtx, 128);
 		SSL_CTX_set_session_id_context (pCtx, (unsigned char*)"eventmachine", 12);
+		if (bCacheSessions) {
+			// Session tickets are on by default. Their keys belong to the
+			// SSL_CTX, so tickets are honored by every connection sharing it.
+			SSL_CTX_set_session_cache_mode (pCtx, SSL_SESS_CACHE_SERVER);
+			SSL_CTX_sess_set_cache_size (pCtx, ServerSessionCacheSize);
+		}
+		else {
+			SSL_CTX_set_session_cache_mode (pCtx, SSL_SESS_CACHE_OFF);
+			SSL_CTX_set_options (pCtx, SSL_OP_NO_TICKET);
+		}
 	}
 	else {
+		if (bCacheSessions) {
+			// Sessions are handed to us as they arrive, which with TLS 1.3
+			// is after the handshake, and kept per server in Sessions.
+			SSL_CTX_set_session_cache_mode (pCtx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+			SSL_CTX_sess_set_new_cb (pCtx, ssl_new_session_wrapper);
+		}
+
 		int e;
 		if (privkeyfile.length() > 0) {
 			e = SSL_CTX_use_PrivateKey_file (pCtx, privkeyfile.c_str(), SSL_FILETYPE_PEM);
@@ -290,6 +313,8 @@ SslContext_t::~SslContext_t
 
 SslContext_t::~SslContext_t()
 {
+	for (map<string, SSL_SESSION*>::iterator i = Sessions.begin(); i != Sessions.end(); i++)
+		SSL_SESSION_free (i->second);
 	if (pCtx)
 		SSL_CTX_free (pCtx);
 	if (PrivateKey)
@@ -300,26 +325,132 @@ SslContext_t::~SslContext_t()
 
 
 
+/*********************
+SslContext_t::Acquire
+*********************/
+
+SslContext_t *SslContext_t::Acquire (bool is_server, const string &privkeyfile, const string &certchainfile, bool verify_peer, const string &cipherlist, const string &ecdh_curve, const string &dhparam, int ssl_version)
+{
+	char flags [32];
+	snprintf (flags, sizeof(flags), "%c%c%d", is_server ? 'S' : 'C', verify_peer ? 'V' : '-', ssl_version);
+
+	string key (flags);
+	const string *parts[] = {&privkeyfile, &certchainfile, &cipherlist, &ecdh_curve, &dhparam};
+	for (size_t i = 0; i < sizeof(parts) / sizeof(parts[0]); i++) {
+		key.push_back ('\0');
+		key.append (*parts[i]);
+	}
+
+	string stamp = _FileStamp (privkeyfile) + _FileStamp (certchainfile) + _FileStamp (dhparam);
+
+	map<string, SslContext_t*>::iterator i = Contexts.find (key);
+	if (i != Contexts.end()) {
+		SslContext_t *ctx = i->second;
+		if (ctx->Stamp == stamp) {
+			ctx->RefCount++;
+			return ctx;
+		}
+		// One of the files was replaced, e.g. by a certificate renewal.
+		// Connections still using the old context keep it until they close.
+		Contexts.erase (i);
+		Release (ctx);
+	}
+
+	SslContext_t *ctx = new SslContext_t (is_server, privkeyfile, certchainfile, verify_peer, cipherlist, ecdh_curve, dhparam, ssl_version);
+	ctx->Key = key;
+	ctx->Stamp = stamp;
+	ctx->RefCount = 2; // the cache's and the caller's
+	Contexts [key] = ctx;
+	return ctx;
+}
+
+
+/*********************
+SslContext_t::Release
+*********************/
+
+void SslContext_t::Release (SslContext_t *ctx)
+{
+	assert (ctx && (ctx->RefCount > 0));
+	if (--ctx->RefCount == 0)
+		delete ctx;
+}
+
+
+/************************
+SslContext_t::_FileStamp
+************************/
+
+string SslContext_t::_FileStamp (const string &filename)
+{
+	if (filename.length() == 0)
+		return "";
+
+	struct stat st;
+	if (stat (filename.c_str(), &st) != 0)
+		return "?;";
+
+	char buf [64];
+	snprintf (buf, sizeof(buf), "%ld.%ld;", (long)st.st_mtime, (long)st.st_size);
+	return buf;
+}
+
+
+/************************
+SslContext_t::GetSession
+************************/
+
+SSL_SESSION *SslContext_t::GetSession (const string &key)
+{
+	map<string, SSL_SESSION*>::iterator i = Sessions.find (key);
+	return (i == Sessions.end()) ? NULL : i->second;
+}
+
+
+/************************
+SslContext_t::PutSession
+************************/
+
+void SslContext_t::PutSession (const string &key, SSL_SESSION *session)
+{
+	map<string, SSL_SESSION*>::iterator i = Sessions.find (key);
+	if (i != Sessions.end()) {
+		SSL_SESSION_free (i->second);
+		i->second = session;
+		return;
+	}
+
+	if (Sessions.size() >= MaxClientSessions) {
+		SSL_SESSION_free (Sessions.begin()->second);
+		Sessions.erase (Sessions.begin());
+	}
+	Sessions [key] = session;
+}
+
+
 /******************
 SslBox_t::SslBox_t
 ******************/
 
-SslBox_t::SslBox_t (bool is_server, const string &privkeyfile, const string &certchainfile, bool verify_peer, bool fail_if_no_peer_cert, const string &snihostname, const string &cipherlist, const string &ecdh_curve, const string &dhparam, int ssl_version, const uintptr_t binding):
+SslBox_t::SslBox_t (bool is_server, const string &privkeyfile, const string &certchainfile, bool verify_peer, bool fail_if_no_peer_cert, const string &snihostname, const string &cipherlist, const string &ecdh_curve, const string &dhparam, int ssl_version, const string &sessionkey, const uintptr_t binding):
 	bIsServer (is_server),
 	bHandshakeCompleted (false),
+	bFatalError (false),
 	bVerifyPeer (verify_peer),
 	bFailIfNoPeerCert (fail_if_no_peer_cert),
 	pSSL (NULL),
 	pbioRead (NULL),
-	pbioWrite (NULL)
+	pbioWrite (NULL),
+	Binding (binding)
 {
-	/* TODO someday: make it possible to re-use SSL contexts so we don't have to create
-	 * a new one every time we come here.
-	 */
-
-	Context = new SslContext_t (bIsServer, privkeyfile, certchainfile, cipherlist, ecdh_curve, dhparam, ssl_version);
+	Context = SslContext_t::Acquire (bIsServer, privkeyfile, certchainfile, verify_peer, cipherlist, ecdh_curve, dhparam, ssl_version);
 	assert (Context);
 
+	// A server may present different certificates per SNI name, so sessions
+	// are kept per name as well as per address.
+	if (!bIsServer && Context->bCacheSessions && (sessionkey.length() > 0))
+		SessionKey = sessionkey + "/" + snihostname;
+
 	pbioRead = BIO_new (BIO_s_mem());
 	assert (pbioRead);
 
@@ -335,8 +466,14 @@ SslBox_t::SslBox_t (bool is_server, const string &privkeyfile, const string &cer
 
 	SSL_set_bio (pSSL, pbioRead, pbioWrite);
 
-	// Store a pointer to the binding signature in the SSL object so we can retrieve it later
-	SSL_set_ex_data(pSSL, 0, (void*) binding);
+	// Store a pointer to ourselves in the SSL object so callbacks can find the binding
+	SSL_set_ex_data(pSSL, 0, (void*) this);
+
+	if (SessionKey.length() > 0) {
+		SSL_SESSION *session = Context->GetSession (SessionKey);
+		if (session)
+			SSL_set_session (pSSL, session);
+	}
 
 	if (bVerifyPeer) {
 		int mode = SSL_VERIFY_PEER | SSL_VERIFY_CLIENT_ONCE;
@@ -361,12 +498,43 @@ SslBox_t::~SslBox_t()
 	if (pSSL) {
 		if (SSL_get_shutdown (pSSL) & SSL_RECEIVED_SHUTDOWN)
 			SSL_shutdown (pSSL);
-		else
+		else {
+			// Without a close_notify SSL_clear takes the session for a failed one
+			// and makes it unresumable. Most peers just close the socket.
+			if (bHandshakeCompleted && !bFatalError)
+				SSL_set_shutdown (pSSL, SSL_get_shutdown (pSSL) | SSL_SENT_SHUTDOWN);
 			SSL_clear (pSSL);
+		}
 		SSL_free (pSSL);
 	}
 
-	delete Context;
+	SslContext_t::Release (Context);
+}
+
+
+
+/*************************
+SslBox_t::IsSessionReused
+*************************/
+
+bool SslBox_t::IsSessionReused()
+{
+	return (pSSL && SSL_session_reused (pSSL)) ? true : false;
+}
+
+
+
+/*********************
+SslBox_t::SaveSession
+*********************/
+
+bool SslBox_t::SaveSession (SSL_SESSION *session)
+{
+	if (SessionKey.length() == 0)
+		return false;
+
+	Context->PutSession (SessionKey, session);
+	return true;
 }
 
 
@@ -398,6 +566,7 @@ int SslBox_t::GetPlaintext (char *buf, int bufsize)
 			int er = SSL_get_error (pSSL, e);
 			if (er != SSL_ERROR_WANT_READ) {
 				// Return -1 for a nonfatal error, -2 for an error that should force the connection down.
+				bFatalError = true;
 				return (er == SSL_ERROR_SSL) ? (-2) : (-1);
 			}
 			else
@@ -425,6 +594,7 @@ int SslBox_t::GetPlaintext (char *buf, int bufsize)
 			return 0;
 		}
 		else {
+			bFatalError = true;
 			return -1;
 		}
 	}
@@ -507,7 +677,7 @@ int SslBox_t::PutPlaintext (const char *buf, int bufsize)
 		else {
 			int er = SSL_get_error (pSSL, n);
 			if ((er != SSL_ERROR_WANT_READ) && (er != SSL_ERROR_WANT_WRITE))
-				fatal = true;
+				fatal = bFatalError = true;
 			break;
 		}
 	}
@@ -597,7 +767,7 @@ extern "C" int ssl_verify_wrapper(int preverify_ok UNUSED, X509_STORE_CTX *ctx)
 
 	cert = X509_STORE_CTX_get_current_cert(ctx);
 	ssl = (SSL*) X509_STORE_CTX_get_ex_data(ctx, SSL_get_ex_data_X509_STORE_CTX_idx());
-	binding = (uintptr_t) SSL_get_ex_data(ssl, 0);
+	binding = ((SslBox_t*) SSL_get_ex_data(ssl, 0))->GetBinding();
 
 	out = BIO_new(BIO_s_mem());
 	PEM_write_bio_X509(out, cert);
@@ -611,5 +781,16 @@ extern "C" int ssl_verify_wrapper(int preverify_ok UNUSED, X509_STORE_CTX *ctx)
 	return result;
 }
 
+/***********************
+ssl_new_session_wrapper
+***********************/
+
+extern "C" int ssl_new_session_wrapper(SSL *ssl, SSL_SESSION *session)
+{
+	// Returning 1 tells OpenSSL we have kept the reference to the session.
+	SslBox_t *box = (SslBox_t*) SSL_get_ex_data(ssl, 0);
+	return (box && box->SaveSession(session)) ? 1 : 0;
+}
+
 #endif // WITH_SSL
 
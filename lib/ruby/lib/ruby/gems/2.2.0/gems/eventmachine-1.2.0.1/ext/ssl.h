@@ -30,19 +30,50 @@ See the file COPYING for complete licensing information.
 class SslContext_t
 ******************/
 
+/* Contexts are shared by every connection with the same TLS settings, so
+ * the key and certificate chain are read from disk once rather than on each
+ * handshake, and the server's session cache and ticket keys are common to
+ * all of its connections. The cache holds a reference of its own, and a
+ * context is only replaced once one of its files changes on disk.
+ * Client contexts also remember the last session negotiated with each
+ * server, so later connections to it can resume instead of doing a full
+ * handshake.
+ */
+
 class SslContext_t
 {
 	public:
-		SslContext_t (bool is_server, const string &privkeyfile, const string &certchainfile, const string &cipherlist, const string &ecdh_curve, const string &dhparam, int ssl_version);
+		static SslContext_t *Acquire (bool is_server, const string &privkeyfile, const string &certchainfile, bool verify_peer, const string &cipherlist, const string &ecdh_curve, const string &dhparam, int ssl_version);
+		static void Release (SslContext_t*);
+
+		SSL_SESSION *GetSession (const string&);
+		void PutSession (const string&, SSL_SESSION*);
+
+		enum {
+			ServerSessionCacheSize = 4096,
+			MaxClientSessions = 1024
+		};
+
+	private:
+		SslContext_t (bool is_server, const string &privkeyfile, const string &certchainfile, bool verify_peer, const string &cipherlist, const string &ecdh_curve, const string &dhparam, int ssl_version);
 		virtual ~SslContext_t();
 
+		static string _FileStamp (const string&);
+
 	private:
 		static bool bLibraryInitialized;
+		static map<string, SslContext_t*> Contexts;
 
 	private:
 		bool bIsServer;
+		bool bCacheSessions;
 		SSL_CTX *pCtx;
 
+		int RefCount;
+		string Key;
+		string Stamp;
+		map<string, SSL_SESSION*> Sessions;
+
 		EVP_PKEY *PrivateKey;
 		X509 *Certificate;
 
@@ -61,7 +92,7 @@ class SslBox_t
 class SslBox_t
 {
 	public:
-		SslBox_t (bool is_server, const string &privkeyfile, const string &certchainfile, bool verify_peer, bool fail_if_no_peer_cert, const string &snihostname, const string &cipherlist, const string &ecdh_curve, const string &dhparam, int ssl_version, const uintptr_t binding);
+		SslBox_t (bool is_server, const string &privkeyfile, const string &certchainfile, bool verify_peer, bool fail_if_no_peer_cert, const string &snihostname, const string &cipherlist, const string &ecdh_curve, const string &dhparam, int ssl_version, const string &sessionkey, const uintptr_t binding);
 		virtual ~SslBox_t();
 
 		int PutPlaintext (const char*, int);
@@ -71,6 +102,9 @@ class SslBox_t
 		bool CanGetCiphertext();
 		int GetCiphertext (char*, int);
 		bool IsHandshakeCompleted() {return bHandshakeCompleted;}
+		bool IsSessionReused();
+		uintptr_t GetBinding() {return Binding;}
+		bool SaveSession (SSL_SESSION*);
 
 		X509 *GetPeerCert();
 		int GetCipherBits();
@@ -85,16 +119,21 @@ class SslBox_t
 
 		bool bIsServer;
 		bool bHandshakeCompleted;
+		bool bFatalError;
 		bool bVerifyPeer;
 		bool bFailIfNoPeerCert;
 		SSL *pSSL;
 		BIO *pbioRead;
 		BIO *pbioWrite;
 
+		uintptr_t Binding;
+		string SessionKey;
+
 		PageList OutboundQ;
 };
 
 extern "C" int ssl_verify_wrapper(int, X509_STORE_CTX*);
+extern "C" int ssl_new_session_wrapper(SSL*, SSL_SESSION*);
 
 #endif // WITH_SSL
 
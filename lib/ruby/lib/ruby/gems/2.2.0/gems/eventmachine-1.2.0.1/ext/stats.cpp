@@ -0,0 +1,114 @@
+/*****************************************************************************
+
+$Id$
+
+File:     stats.cpp
+Date:     17Oct16
+
+Copyright (C) 2006-07 by Francis Cianfrocca. All Rights Reserved.
+Gmail: blackhedd
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of either: 1) the GNU General Public License
+as published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version; or 2) Ruby's License.
+
+See the file COPYING for complete licensing information.
+
+*****************************************************************************/
+
+
+#include "project.h"
+
+
+/******************************
+ReactorStats_t::ReactorStats_t
+******************************/
+
+ReactorStats_t::ReactorStats_t()
+{
+	Reset();
+}
+
+
+/*********************
+ReactorStats_t::Reset
+*********************/
+
+void ReactorStats_t::Reset()
+{
+	LoopIterations = 0;
+	PollTime = 0;
+	DispatchTime = 0;
+	Wakeups = 0;
+	Events = 0;
+	memset (EventsPerWakeup, 0, sizeof(EventsPerWakeup));
+	TimersFired = 0;
+	HeartbeatSweeps = 0;
+	HeartbeatTime = 0;
+	LoopBreaks = 0;
+	Completions = 0;
+	memset (BytesRead, 0, sizeof(BytesRead));
+	memset (BytesWritten, 0, sizeof(BytesWritten));
+	memset (OutboundHighWater, 0, sizeof(OutboundHighWater));
+	LatencyCount = 0;
+	memset (Latency, 0, sizeof(Latency));
+}
+
+
+/****************************
+ReactorStats_t::RecordWakeup
+****************************/
+
+void ReactorStats_t::RecordWakeup (int events)
+{
+	if (events <= 0)
+		return;
+
+	Wakeups++;
+	Events += events;
+
+	int bucket = 0;
+	while (bucket < WakeupBuckets - 1 && (events >> (bucket + 1)) != 0)
+		bucket++;
+	EventsPerWakeup [bucket]++;
+}
+
+
+/*****************************
+ReactorStats_t::RecordLatency
+*****************************/
+
+void ReactorStats_t::RecordLatency (uint64_t usec)
+{
+	// Anything past an hour is pinned there; it's an outlier either way.
+	if (usec > 3600000000ULL)
+		usec = 3600000000ULL;
+	Latency [LatencyCount % LatencySamples] = (uint32_t) usec;
+	LatencyCount++;
+}
+
+
+/*********************************
+ReactorStats_t::LatencyPercentile
+*********************************/
+
+uint64_t ReactorStats_t::LatencyPercentile (double pct) const
+{
+	/* Nearest-rank percentile over the samples currently in the ring.
+	 * Works on a copy, since this is the rare path and the ring has to
+	 * keep its order for the writer.
+	 */
+	size_t n = (LatencyCount < (uint64_t)LatencySamples) ? (size_t)LatencyCount : (size_t)LatencySamples;
+	if (n == 0)
+		return 0;
+
+	vector<uint32_t> samples (Latency, Latency + n);
+	size_t rank = (size_t) (pct / 100.0 * n + 0.5);
+	if (rank > 0)
+		rank--;
+	if (rank >= n)
+		rank = n - 1;
+	nth_element (samples.begin(), samples.begin() + rank, samples.end());
+	return samples [rank];
+}
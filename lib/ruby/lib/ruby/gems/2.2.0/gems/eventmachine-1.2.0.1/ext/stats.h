@@ -0,0 +1,95 @@
+/*****************************************************************************
+
+$Id$
+
+File:     stats.h
+Date:     17Oct16
+
+Copyright (C) 2006-07 by Francis Cianfrocca. All Rights Reserved.
+Gmail: blackhedd
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of either: 1) the GNU General Public License
+as published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version; or 2) Ruby's License.
+
+See the file COPYING for complete licensing information.
+
+*****************************************************************************/
+
+
+#ifndef __ReactorStats__H_
+#define __ReactorStats__H_
+
+
+/********************
+class ReactorStats_t
+********************/
+
+/* Counters describing where the reactor spends its time. They're plain
+ * integers bumped from the reactor thread only, so there's no locking and
+ * they can stay on all the time. Times are in microseconds, like
+ * everything else in the reactor.
+ *
+ * Dispatch latency (the time it takes to handle one event, including any
+ * Ruby callbacks it triggers) is kept in a ring of the most recent
+ * samples; percentiles are worked out from that ring when someone asks.
+ */
+
+class ReactorStats_t
+{
+	public:
+		enum DescriptorClass {
+			Connection = 0,
+			Datagram,
+			Pipe,
+			DescriptorClasses
+		};
+
+		enum {
+			WakeupBuckets = 14,
+			LatencySamples = 1024
+		};
+
+	public:
+		ReactorStats_t();
+
+		void Reset();
+
+		void RecordWakeup (int events);
+		void RecordLatency (uint64_t usec);
+		void RecordOutbound (DescriptorClass cls, int size) {
+			if ((uint64_t)size > OutboundHighWater[cls])
+				OutboundHighWater[cls] = size;
+		}
+
+		uint64_t LatencyPercentile (double) const;
+
+	public:
+		uint64_t LoopIterations;
+		uint64_t PollTime;
+		uint64_t DispatchTime;
+
+		uint64_t Wakeups;
+		uint64_t Events;
+		// Bucket n counts wakeups that returned [2^n, 2^(n+1)) events; the last is open-ended.
+		uint64_t EventsPerWakeup [WakeupBuckets];
+
+		uint64_t TimersFired;
+		uint64_t HeartbeatSweeps;
+		uint64_t HeartbeatTime;
+
+		// Loop breaker reads, and completions handed back from other threads.
+		uint64_t LoopBreaks;
+		uint64_t Completions;
+
+		uint64_t BytesRead [DescriptorClasses];
+		uint64_t BytesWritten [DescriptorClasses];
+		uint64_t OutboundHighWater [DescriptorClasses];
+
+		uint64_t LatencyCount;
+		uint32_t Latency [LatencySamples];
+};
+
+
+#endif // __ReactorStats__H_
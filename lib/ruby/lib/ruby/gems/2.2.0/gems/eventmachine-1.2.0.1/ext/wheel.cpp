@@ -0,0 +1,337 @@
+/*****************************************************************************
+
+$Id$
+
+File:     wheel.cpp
+Date:     17Oct16
+
+Copyright (C) 2006-07 by Francis Cianfrocca. All Rights Reserved.
+Gmail: blackhedd
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of either: 1) the GNU General Public License
+as published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version; or 2) Ruby's License.
+
+See the file COPYING for complete licensing information.
+
+*****************************************************************************/
+
+
+#include "project.h"
+
+
+/* Index of the lowest set bit of a non-zero word. */
+static inline int _LowestBit (uint64_t bits)
+{
+	#if defined(__GNUC__) && (__GNUC__ >= 4)
+	return __builtin_ctzll (bits);
+	#else
+	int n = 0;
+	while (!(bits & 1)) {
+		bits >>= 1;
+		n++;
+	}
+	return n;
+	#endif
+}
+
+
+/**************************
+TimerWheel_t::TimerWheel_t
+**************************/
+
+TimerWheel_t::TimerWheel_t():
+	CurrentTick (0),
+	Count (0)
+{
+	memset (Occupied, 0, sizeof(Occupied));
+}
+
+
+/***************************
+TimerWheel_t::~TimerWheel_t
+***************************/
+
+TimerWheel_t::~TimerWheel_t()
+{
+	// Entries are owned by the caller, there's nothing to free here.
+}
+
+
+/*******************
+TimerWheel_t::Reset
+*******************/
+
+void TimerWheel_t::Reset (uint64_t now)
+{
+	/* Only meaningful while the wheel is empty: sets the tick from which
+	 * the next call to Expire starts advancing.
+	 */
+	assert (Count == 0);
+	CurrentTick = now / Resolution;
+}
+
+
+/********************
+TimerWheel_t::Insert
+********************/
+
+void TimerWheel_t::Insert (Entry_t *e)
+{
+	if (IsQueued (e))
+		Remove (e);
+	_Place (e);
+	Count++;
+}
+
+
+/********************
+TimerWheel_t::Remove
+********************/
+
+void TimerWheel_t::Remove (Entry_t *e)
+{
+	/* Works on an entry wherever it currently sits, including the list of
+	 * expired entries the caller is still draining. A slot emptied here
+	 * keeps its occupancy bit until the next scan notices it.
+	 */
+	if (!IsQueued (e))
+		return;
+	e->Prev->Next = e->Next;
+	e->Next->Prev = e->Prev;
+	e->Prev = e->Next = NULL;
+	Count--;
+}
+
+
+/********************
+TimerWheel_t::Expire
+********************/
+
+void TimerWheel_t::Expire (uint64_t now)
+{
+	/* Advances the wheel up to the given time and moves every entry that
+	 * has come due onto the expired list, in deadline order (to tick
+	 * granularity). Spans in which the lower levels are known to be empty
+	 * are skipped over in one step.
+	 */
+	_Splice (&Pending);
+
+	uint64_t target = now / Resolution;
+	while (CurrentTick < target) {
+		int level = 0;
+		while (level < Levels && _NextSlot (level, 0) < 0)
+			level++;
+
+		if (level > 0) {
+			uint64_t edge;
+			if (level == Levels && Overflow.Empty())
+				edge = target;
+			else
+				edge = CurrentTick | ((((uint64_t)1) << (SlotBits * level)) - 1);
+			if (edge >= target) {
+				CurrentTick = target;
+				break;
+			}
+			CurrentTick = edge;
+		}
+
+		_Tick();
+	}
+}
+
+
+/***********************
+TimerWheel_t::ExpireAll
+***********************/
+
+void TimerWheel_t::ExpireAll()
+{
+	// Moves every queued entry onto the expired list, e.g. to free them at shutdown.
+	_Splice (&Pending);
+	for (int level = 0; level < Levels; level++) {
+		for (int slot = 0; slot < Slots; slot++)
+			_Splice (&Wheel[level][slot]);
+	}
+	_Splice (&Overflow);
+	memset (Occupied, 0, sizeof(Occupied));
+}
+
+
+/************************
+TimerWheel_t::PopExpired
+************************/
+
+TimerWheel_t::Entry_t *TimerWheel_t::PopExpired()
+{
+	if (Expired.Empty())
+		return NULL;
+	Entry_t *e = Expired.Next;
+	Remove (e);
+	return e;
+}
+
+
+/**************************
+TimerWheel_t::NextDeadline
+**************************/
+
+uint64_t TimerWheel_t::NextDeadline()
+{
+	/* Returns the time at which the next call to Expire can produce work,
+	 * or zero if the wheel is empty. Exact for the innermost level; for the
+	 * outer levels it's the start of the slot, which only means the reactor
+	 * wakes up early to cascade.
+	 */
+	if (!Pending.Empty() || !Expired.Empty())
+		return CurrentTick * Resolution;
+
+	for (int level = 0; level < Levels; level++) {
+		int shift = SlotBits * level;
+		int slot = _NextSlot (level, ((CurrentTick >> shift) & SlotMask) + 1);
+		if (slot >= 0) {
+			uint64_t base = (CurrentTick >> (shift + SlotBits)) << (shift + SlotBits);
+			return (base | ((uint64_t)slot << shift)) * Resolution;
+		}
+	}
+
+	if (!Overflow.Empty())
+		return (((CurrentTick >> (SlotBits * Levels)) + 1) << (SlotBits * Levels)) * Resolution;
+
+	return 0;
+}
+
+
+/*******************
+TimerWheel_t::_Link
+*******************/
+
+void TimerWheel_t::_Link (List_t *list, Entry_t *e)
+{
+	e->Prev = list->Prev;
+	e->Next = list;
+	list->Prev->Next = e;
+	list->Prev = e;
+}
+
+
+/********************
+TimerWheel_t::_Place
+********************/
+
+void TimerWheel_t::_Place (Entry_t *e)
+{
+	uint64_t tick = (e->When + Resolution - 1) / Resolution;
+	if (tick <= CurrentTick) {
+		_Link (&Pending, e);
+		return;
+	}
+
+	uint64_t diff = tick ^ CurrentTick;
+	for (int level = 0; level < Levels; level++) {
+		int shift = SlotBits * level;
+		if ((diff >> (shift + SlotBits)) == 0) {
+			int slot = (tick >> shift) & SlotMask;
+			_Link (&Wheel[level][slot], e);
+			Occupied[level][slot >> 6] |= ((uint64_t)1) << (slot & 63);
+			return;
+		}
+	}
+
+	_Link (&Overflow, e);
+}
+
+
+/**********************
+TimerWheel_t::_Cascade
+**********************/
+
+void TimerWheel_t::_Cascade (List_t *list)
+{
+	if (list->Empty())
+		return;
+
+	Entry_t *e = list->Next;
+	list->Prev->Next = NULL;
+	list->Prev = list->Next = list;
+
+	while (e) {
+		Entry_t *next = e->Next;
+		_Place (e);
+		e = next;
+	}
+}
+
+
+/*******************
+TimerWheel_t::_Tick
+*******************/
+
+void TimerWheel_t::_Tick()
+{
+	CurrentTick++;
+
+	// Outermost first, so entries can trickle all the way down in one tick.
+	if ((CurrentTick & ((((uint64_t)1) << (SlotBits * Levels)) - 1)) == 0)
+		_Cascade (&Overflow);
+
+	for (int level = Levels - 1; level > 0; level--) {
+		int shift = SlotBits * level;
+		if ((CurrentTick & ((((uint64_t)1) << shift) - 1)) != 0)
+			continue;
+		int slot = (CurrentTick >> shift) & SlotMask;
+		Occupied[level][slot >> 6] &= ~(((uint64_t)1) << (slot & 63));
+		_Cascade (&Wheel[level][slot]);
+	}
+
+	// Anything cascaded down onto exactly this tick landed on Pending.
+	_Splice (&Pending);
+
+	int slot = CurrentTick & SlotMask;
+	Occupied[0][slot >> 6] &= ~(((uint64_t)1) << (slot & 63));
+	_Splice (&Wheel[0][slot]);
+}
+
+
+/*********************
+TimerWheel_t::_Splice
+*********************/
+
+void TimerWheel_t::_Splice (List_t *list)
+{
+	// Moves a whole list onto the tail of the expired list.
+	if (list->Empty())
+		return;
+	list->Next->Prev = Expired.Prev;
+	Expired.Prev->Next = list->Next;
+	list->Prev->Next = &Expired;
+	Expired.Prev = list->Prev;
+	list->Prev = list->Next = list;
+}
+
+
+/***********************
+TimerWheel_t::_NextSlot
+***********************/
+
+int TimerWheel_t::_NextSlot (int level, int from)
+{
+	/* Finds the first non-empty slot at or after the given index, clearing
+	 * any stale occupancy bits left behind by Remove along the way.
+	 */
+	while (from < Slots) {
+		int word = from >> 6;
+		uint64_t bits = Occupied[level][word] & (~((uint64_t)0) << (from & 63));
+		if (!bits) {
+			from = (word + 1) << 6;
+			continue;
+		}
+		int slot = (word << 6) + _LowestBit (bits);
+		if (!Wheel[level][slot].Empty())
+			return slot;
+		Occupied[level][word] &= ~(((uint64_t)1) << (slot & 63));
+		from = slot + 1;
+	}
+	return -1;
+}
@@ -0,0 +1,101 @@
+/*****************************************************************************
+
+$Id$
+
+File:     wheel.h
+Date:     17Oct16
+
+Copyright (C) 2006-07 by Francis Cianfrocca. All Rights Reserved.
+Gmail: blackhedd
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of either: 1) the GNU General Public License
+as published by the Free Software Foundation; either version 2 of the
+License, or (at your option) any later version; or 2) Ruby's License.
+
+See the file COPYING for complete licensing information.
+
+*****************************************************************************/
+
+
+#ifndef __TimerWheel__H_
+#define __TimerWheel__H_
+
+
+/*******************
+class TimerWheel_t
+*******************/
+
+/* A hierarchical timing wheel. Entries are intrusive (the caller owns the
+ * storage and derives from Entry_t), so insertion and removal never allocate
+ * and are O(1). Deadlines are kept in microseconds like everything else in
+ * the reactor and are rounded up to the wheel's one-millisecond tick, so an
+ * entry never fires before its deadline.
+ *
+ * Four levels of 256 slots cover 2^32 ticks (about 49 days); anything
+ * further out waits on an overflow list. An entry lives on the level given
+ * by the highest byte in which its tick differs from the current tick, and
+ * is cascaded down one level each time the lower bytes of the current tick
+ * roll over.
+ */
+
+class TimerWheel_t
+{
+	public:
+		struct Entry_t {
+			Entry_t(): When(0), Prev(NULL), Next(NULL) {}
+			uint64_t When;
+			Entry_t *Prev;
+			Entry_t *Next;
+		};
+
+	public:
+		TimerWheel_t();
+		virtual ~TimerWheel_t();
+
+		void Reset (uint64_t);
+		void Insert (Entry_t*);
+		void Remove (Entry_t*);
+		bool IsQueued (const Entry_t *e) {return e->Next != NULL;}
+
+		void Expire (uint64_t);
+		void ExpireAll();
+		Entry_t *PopExpired();
+
+		uint64_t NextDeadline();
+		size_t Size() {return Count;}
+
+	private:
+		enum {
+			Resolution = 1000,
+			Levels = 4,
+			SlotBits = 8,
+			Slots = 1 << SlotBits,
+			SlotMask = Slots - 1,
+			MapWords = Slots / 64
+		};
+
+		struct List_t: public Entry_t {
+			List_t() {Prev = Next = this;}
+			bool Empty() {return Next == this;}
+		};
+
+		void _Link (List_t*, Entry_t*);
+		void _Place (Entry_t*);
+		void _Cascade (List_t*);
+		void _Splice (List_t*);
+		void _Tick();
+		int _NextSlot (int, int);
+
+		uint64_t CurrentTick;
+		size_t Count;
+
+		List_t Wheel [Levels][Slots];
+		uint64_t Occupied [Levels][MapWords];
+		List_t Overflow;
+		List_t Pending;
+		List_t Expired;
+};
+
+
+#endif // __TimerWheel__H_
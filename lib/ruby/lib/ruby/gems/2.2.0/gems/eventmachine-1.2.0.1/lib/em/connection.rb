@@ -117,6 +117,37 @@ module EventMachine
       puts "............>>>#{data.length}"
     end
 
+    # Called by EventMachine instead of {#receive_data} once {#set_inbound_framing}
+    # has been used, with every frame completed by one read. The frames don't
+    # include their delimiters or length prefixes.
+    #
+    # The base-class implementation passes each frame to {#receive_data}.
+    #
+    # @param [Array<String>] frames Complete frames, in the order they arrived.
+    #
+    # @see #set_inbound_framing
+    def receive_frames frames
+      frames.each { |frame| receive_data frame }
+    end
+
+    # Called by EventMachine instead of {#receive_data} on a datagram socket
+    # whose {#set_datagram_batching} asked for whole batches, with every
+    # datagram received in one pass through the reactor.
+    #
+    # The sender of each datagram is a packed sockaddr as returned by
+    # {#get_peername}, which Socket.unpack_sockaddr_in turns into a port and
+    # address to pass to {#send_datagram}. {#send_data} replies to the sender
+    # of the last datagram of the batch.
+    #
+    # The base-class implementation passes each datagram to {#receive_data}.
+    #
+    # @param [Array<Array(String, String)>] datagrams Payload and sender pairs, in the order they arrived.
+    #
+    # @see #set_datagram_batching
+    def receive_datagrams datagrams
+      datagrams.each { |data, sender| receive_data data }
+    end
+
     # Called by EventMachine when the SSL/TLS handshake has
     # been completed, as a result of calling #start_tls to initiate SSL/TLS on the connection.
     #
@@ -547,6 +578,17 @@ module EventMachine
       EventMachine::get_sni_hostname @signature
     end
 
+    # Tells whether the TLS handshake resumed an earlier session rather than
+    # doing a full key exchange. Client connections made with EventMachine.connect
+    # resume the last session they had with the same host, port and SNI name,
+    # unless they verify the peer, which always takes a full handshake.
+    #
+    # @return [Boolean]
+    # @see Connection#start_tls
+    def ssl_session_reused?
+      EventMachine::ssl_session_reused? @signature
+    end
+
     # Sends UDP messages.
     #
     # This method may be called from any Connection object that refers
@@ -678,6 +720,131 @@ module EventMachine
     end
     alias set_pending_connect_timeout pending_connect_timeout=
 
+    # The most bytes this connection reads before handing them to {#receive_data}.
+    # Zero (the default) means every read is dispatched as it happens, in chunks
+    # of up to 16KB.
+    #
+    # @return [Integer]
+    def read_batch_size
+      EventMachine::get_read_batch_size @signature
+    end
+
+    # Sets the read batch size. With a nonzero value, everything read from the socket
+    # in one pass through the reactor, up to that many bytes, is delivered to
+    # {#receive_data} as a single string. Bulk receivers make far fewer callbacks this way.
+    #
+    # @param [Integer] value Batch size in bytes, or zero to turn batching off
+    def read_batch_size= value
+      EventMachine::set_read_batch_size @signature, value.to_i
+    end
+
+    # The most read calls this connection makes per pass through the reactor before
+    # giving other connections a turn. Defaults to 10.
+    #
+    # @return [Integer]
+    def read_iterations
+      EventMachine::get_read_iterations @signature
+    end
+
+    # Sets the read iteration cap. Must be at least one.
+    #
+    # @param [Integer] value
+    def read_iterations= value
+      EventMachine::set_read_iterations @signature, value.to_i
+    end
+
+    # The most datagrams this socket receives or sends with one system call,
+    # or zero when batching is off. nil for connections that aren't datagram sockets.
+    #
+    # @return [Integer]
+    def datagram_batch_size
+      EventMachine::get_datagram_batch_size @signature
+    end
+
+    # Has a datagram socket receive and send up to batch_size datagrams with
+    # one system call (recvmmsg and sendmmsg where the platform has them)
+    # rather than one call per datagram. A batch size of zero turns this off.
+    #
+    # Datagrams received in a batch still go to {#receive_data} one by one,
+    # each with its sender as the address {#send_data} replies to. With
+    # :deliver_batches the whole batch goes to {#receive_datagrams} in one call.
+    #
+    # @example
+    #
+    #  module StatsdRelay
+    #    def post_init
+    #      set_datagram_batching 64, :deliver_batches => true
+    #    end
+    #
+    #    def receive_datagrams datagrams
+    #      datagrams.each { |data, sender| forward data }
+    #    end
+    #  end
+    #
+    # @param [Integer] batch_size From 0 to 256
+    # @option opts [Boolean] :deliver_batches (false) Call {#receive_datagrams} once per batch
+    #
+    # @return [Boolean] false if batching isn't available on this connection
+    def set_datagram_batching batch_size, opts = {}
+      EventMachine::set_datagram_batching @signature, Integer(batch_size), !!opts[:deliver_batches]
+    end
+
+    # Splits inbound data into frames in the reactor, and delivers them to
+    # {#receive_frames} in batches instead of handing raw chunks to {#receive_data}.
+    # This replaces a {EventMachine::BufferedTokenizer} for the common framings
+    # without the Ruby string splitting.
+    #
+    # * :line splits on "\n" and drops a "\r" before it
+    # * :delimiter splits on the given String
+    # * :length_prefix reads frames behind a big-endian length of the given
+    #   number of bytes, from 1 to 4 (default 4)
+    # * :none turns framing off again
+    #
+    # Framing can be changed from {#receive_frames}, and applies once the batch
+    # being delivered is done. Data read after its last frame goes through the
+    # new framing, or to {#receive_data} after :none. A frame longer than
+    # :max_frame_size closes the connection.
+    #
+    # @example
+    #
+    #  module LineServer
+    #    def post_init
+    #      set_inbound_framing :line, nil, :max_frame_size => 64 * 1024
+    #    end
+    #
+    #    def receive_frames lines
+    #      lines.each { |line| send_data "#{line.upcase}\n" }
+    #    end
+    #  end
+    #
+    # @param [Symbol] type :line, :delimiter, :length_prefix or :none
+    # @param [String, Integer] arg The delimiter or the prefix size
+    # @option opts [Integer] :max_frame_size (0) Longest frame allowed, zero for no limit
+    #
+    # @return [Boolean] false if framing isn't available on this connection
+    def set_inbound_framing type, arg = nil, opts = {}
+      max_frame_size = Integer(opts[:max_frame_size] || 0)
+      raise ArgumentError, "max_frame_size must not be negative" if max_frame_size < 0
+
+      case type
+      when :line
+        EventMachine::set_inbound_framing @signature, FramingLine, nil, 0, max_frame_size
+      when :delimiter
+        unless arg.is_a?(String) && !arg.empty?
+          raise ArgumentError, "delimiter must be a non-empty String"
+        end
+        EventMachine::set_inbound_framing @signature, FramingDelimiter, arg, 0, max_frame_size
+      when :length_prefix
+        prefix_size = Integer(arg || 4)
+        raise ArgumentError, "prefix size must be from 1 to 4 bytes" unless (1..4).include?(prefix_size)
+        EventMachine::set_inbound_framing @signature, FramingLengthPrefix, nil, prefix_size, max_frame_size
+      when :none
+        EventMachine::set_inbound_framing @signature, FramingNone, nil, 0, 0
+      else
+        raise ArgumentError, "unknown framing #{type.inspect}"
+      end
+    end
+
       # Reconnect to a given host/port with the current instance
       #
       # @param [String] server Hostname or IP address
@@ -692,6 +859,12 @@ module EventMachine
     # filename as an argument, though, and sends the contents of the file, in one
     # chunk.
     #
+    # Files up to 32K are read into memory. Larger ones are only supported where
+    # {EventMachine.sendfile?} is true, on connections without TLS: the file is
+    # then queued as it is and copied to the socket by the kernel with sendfile(2)
+    # as the outbound data drains, so it never goes through Ruby. Otherwise they
+    # raise a RuntimeError.
+    #
     # @param [String] filename Local path of the file to send
     #
     # @see #send_data
@@ -709,7 +882,8 @@ module EventMachine
     #
     # Warning: this feature has an implicit dependency on an outboard extension,
     # evma_fastfilereader. You must install this extension in order to use {#stream_file_data}
-    # with files larger than a certain size (currently 8192 bytes).
+    # with files larger than a certain size (currently 16384 bytes), except where the file
+    # can be sent with sendfile(2). See {#send_file_data}.
     #
     # @option args [Boolean] :http_chunks (false) If true, this method will stream the file data in a format
     #                                             compatible with the HTTP chunked-transfer encoding
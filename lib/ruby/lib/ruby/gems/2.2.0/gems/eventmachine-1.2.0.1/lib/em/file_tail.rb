@@ -0,0 +1,66 @@
+module EventMachine
+  # Follows a file as it's appended to, like `tail -F`. Only what was
+  # written since the last read is read, and by default it's delivered
+  # as complete lines, in batches.
+  #
+  # Rotation is followed: when another file takes over the name, or the
+  # next name of a strftime pattern (say an hourly log) turns up, the old
+  # file is read to its end before switching to the new one, which is
+  # read from its start. A file that shrinks, as with copytruncate, is
+  # read again from its start too.
+  #
+  # @note Tailing relies on inotify, so it's only available on Linux.
+  #
+  # @see EventMachine.tail_file
+  class FileTail < Connection
+    # @private
+    def receive_frames lines
+      receive_lines lines
+    end
+
+    # Returns the path or strftime pattern being followed.
+    #
+    # @return [String]
+    # @see EventMachine.tail_file
+    def path
+      @path
+    end
+
+    # Will be called with every line completed by one read, without their
+    # line endings. The base-class implementation passes each line to
+    # {#receive_line}.
+    #
+    # @param [Array<String>] lines
+    def receive_lines lines
+      lines.each { |line| receive_line line }
+    end
+
+    # Will be called for each line appended to the file. Supposed to be redefined by subclasses.
+    #
+    # @abstract
+    def receive_line line
+    end
+
+    # Will be called when a new file has taken over from the one being
+    # followed, after the last of the old one has been delivered. Supposed
+    # to be redefined by subclasses.
+    #
+    # @param [String] path Where the new file is.
+    # @abstract
+    def file_rotated path
+    end
+
+    # Will be called when the file turns out to have been truncated, after
+    # which it's read again from its start. Supposed to be redefined by
+    # subclasses.
+    #
+    # @abstract
+    def file_truncated
+    end
+
+    # Discontinue following the file. This in turn fires {EventMachine::Connection#unbind}.
+    def stop_watching
+      close_connection
+    end
+  end # FileTail
+end # EventMachine
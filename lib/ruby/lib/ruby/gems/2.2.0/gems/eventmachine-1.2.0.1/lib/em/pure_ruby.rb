@@ -169,6 +169,18 @@ module EventMachine
       false
     end
 
+    # This method is not implemented for pure-Ruby implementation
+    # @private
+    def reuseport?
+      false
+    end
+
+    # This method is not implemented for pure-Ruby implementation
+    # @private
+    def sendfile?
+      false
+    end
+
     # This method is a no-op in the pure-Ruby implementation. We simply return Ruby's built-in
     # per-process file-descriptor limit.
     # @private
@@ -182,6 +194,36 @@ module EventMachine
     def set_max_timer_count n
     end
 
+    # This method is a harmless no-op in pure Ruby, which keeps its own timer list.
+    # @private
+    def set_timer_wheel val
+    end
+
+    # @private
+    def get_timer_wheel
+      false
+    end
+
+    # This method is a harmless no-op in pure Ruby, which always uses select.
+    # @private
+    def set_edge_triggered val
+    end
+
+    # @private
+    def get_edge_triggered
+      false
+    end
+
+    # This method is a harmless no-op in pure Ruby, which delivers events one at a time.
+    # @private
+    def set_event_batching val
+    end
+
+    # @private
+    def get_event_batching
+      false
+    end
+
     # @private
     def get_sock_opt signature, level, optname
       selectable = Reactor.instance.get_selectable( signature ) or raise "unknown get_peername target"
@@ -207,6 +249,35 @@ module EventMachine
       send_data sig, data, data.length
     end
 
+    # Not implemented, the caller sends the file itself.
+    # @private
+    def sendfile_data sig, filename
+      false
+    end
+
+    # Not implemented, data is always delivered to receive_data.
+    # @private
+    def set_inbound_framing sig, mode, delimiter, prefix_size, max_frame_size
+      false
+    end
+
+    # Not implemented, datagrams are read and sent one at a time.
+    # @private
+    def get_datagram_batch_size sig
+      nil
+    end
+
+    # @private
+    def set_datagram_batching sig, batch_size, deliver_batches
+      false
+    end
+
+    # Not implemented, there's nothing to follow files with.
+    # @private
+    def tail_filename filename, flags, max_line_size
+      raise "no file tailing support in the pure ruby reactor"
+    end
+
     # @private
     def get_outbound_data_size sig
       r = Reactor.instance.get_selectable( sig ) or raise "unknown get_outbound_data_size target"
@@ -269,6 +340,22 @@ module EventMachine
   ConnectionCompleted = 104
   # @private
   LoopbreakSignalled = 105
+
+  # @private
+  FramingNone = 0
+  # @private
+  FramingLine = 1
+  # @private
+  FramingDelimiter = 2
+  # @private
+  FramingLengthPrefix = 3
+
+  # @private
+  TailFromStart = 1
+  # @private
+  TailStrftime = 2
+  # @private
+  TailLines = 4
 end
 
 module EventMachine
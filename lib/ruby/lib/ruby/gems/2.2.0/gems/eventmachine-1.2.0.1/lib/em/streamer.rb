@@ -3,7 +3,9 @@ module EventMachine
   # instantiated. Typically FileStreamer instances are not reused.
   #
   # Streaming uses buffering for files larger than 16K and uses so-called fast file reader (a C++ extension)
-  # if available (it is part of eventmachine gem itself).
+  # if available (it is part of eventmachine gem itself). Where the reactor supports sendfile(2), larger
+  # files that aren't sent in HTTP chunks are instead handed to the connection whole, and the kernel
+  # copies them to the socket as the outbound data drains.
   #
   # @example
   #
@@ -41,6 +43,8 @@ module EventMachine
         @size = File.size(filename)
         if @size <= MappingThreshold
           stream_without_mapping filename
+        elsif !@http_chunks && EventMachine::sendfile_data(@connection.signature, filename)
+          succeed
         else
           stream_with_mapping filename
         end
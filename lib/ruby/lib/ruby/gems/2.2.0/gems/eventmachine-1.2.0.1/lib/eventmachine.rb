@@ -28,6 +28,7 @@ require 'em/callback'
 require 'em/queue'
 require 'em/channel'
 require 'em/file_watch'
+require 'em/file_tail'
 require 'em/process_watch'
 require 'em/tick_loop'
 require 'em/resolver'
@@ -256,6 +257,17 @@ module EventMachine
     end
   end
 
+  # Forks +count+ worker processes, each running its own reactor with the given block,
+  # and returns their pids. Combined with {EventMachine.start_reuseport_server} this
+  # gives one sharded acceptor per worker, so accept throughput scales with cores.
+  #
+  # @param [Integer] count Number of reactors to fork
+  # @return [Array<Integer>] Process ids of the forked reactors
+  # @see EventMachine.start_reuseport_server
+  def self.fork_reactors count, &block
+    (1..Integer(count)).map { fork_reactor(&block) }
+  end
+
   # Clean up Ruby space following a release_machine
   def self.cleanup_machine
     if @threadpool && !@threadpool.empty?
@@ -535,6 +547,40 @@ module EventMachine
     s
   end
 
+  # Initiates a TCP server exactly like {EventMachine.start_server}, but opens the
+  # listening socket with SO_REUSEPORT. Any number of reactors may then bind a
+  # listener to the same address and port, and the kernel load-balances incoming
+  # connections across them.
+  #
+  # A single EventMachine reactor is bound to one Ruby thread and one core. To spread
+  # accepts over several cores, fork one reactor per core (see {EventMachine.fork_reactors})
+  # and call this method inside each of them. Every worker then owns its own
+  # epoll descriptor, connections and timers, and runs callbacks in its own interpreter.
+  #
+  # @example Four reactors sharing port 8080
+  #
+  #  EventMachine.fork_reactors(4) {
+  #    EventMachine.start_reuseport_server("0.0.0.0", 8080, EchoServer)
+  #  }
+  #  Process.waitall
+  #
+  # @param [String] server         Host to bind to.
+  # @param [Integer] port          Port to bind to.
+  # @param [Module, Class] handler A module or class that implements connection callbacks
+  #
+  # @note Requires a platform with SO_REUSEPORT (Linux 3.9+, *BSD, Mac OS X); check {EventMachine.reuseport?}.
+  # @see EventMachine.start_server
+  # @see EventMachine.fork_reactors
+  def self.start_reuseport_server server, port, handler=nil, *args, &block
+    raise Unsupported, "SO_REUSEPORT is not supported on this platform" unless reuseport?
+
+    klass = klass_from_handler(Connection, handler, *args)
+
+    s = start_reuseport_tcp_server server, Integer(port)
+    @acceptors[s] = [klass,args,block]
+    s
+  end
+
   # Attach to an existing socket's file descriptor. The socket may have been
   # started with {EventMachine.start_server}.
   def self.attach_server sock, handler=nil, *args, &block
@@ -924,6 +970,104 @@ module EventMachine
     get_max_timer_count
   end
 
+  # Selects the store used for timers and connection heartbeats (inactivity timeouts).
+  # By default they are kept in sorted maps, which cost an allocation and an O(log n)
+  # rebalance on every insert. With the timing wheel enabled, inserting and cancelling
+  # are O(1) and all timers that come due in a tick are expired as one batch, at the
+  # price of one millisecond granularity. Worth it with tens of thousands of timers or
+  # connections that have inactivity timeouts.
+  #
+  # @note This method has to be used *before* event loop is started.
+  #
+  # @param [Boolean] enable Use the hierarchical timing wheel
+  #
+  # @see EventMachine.set_max_timers
+  def self.timer_wheel= enable
+    set_timer_wheel enable
+  end
+
+  # @return [Boolean] true if reactors started from now on use the timing wheel
+  # @see EventMachine.timer_wheel=
+  def self.timer_wheel?
+    get_timer_wheel
+  end
+
+  # Registers TCP and Unix-domain connections with epoll as edge-triggered. Each
+  # connection is then added to the epoll set once, for both directions, instead of
+  # being rearmed with an epoll_ctl call every time its outbound queue fills or drains
+  # or it's paused and resumed. Reads and writes the reactor can't finish when the
+  # readiness edge arrives are carried over to the next pass. Connections made with
+  # {EventMachine.attach} or {EventMachine.watch} stay level-triggered.
+  #
+  # @note This method has to be used *before* event loop is started, and only has an
+  #   effect together with {EventMachine.epoll}.
+  #
+  # @param [Boolean] enable Use edge-triggered epoll registrations
+  def self.epoll_edge_triggered= enable
+    set_edge_triggered enable
+  end
+
+  # @return [Boolean] true if reactors started from now on register connections edge-triggered
+  # @see EventMachine.epoll_edge_triggered=
+  def self.epoll_edge_triggered?
+    get_edge_triggered
+  end
+
+  # Delivers the data, connection-completed, unbind and timer events of each pass
+  # through the reactor together, with one call into Ruby per pass instead of one per
+  # event. Servers handling many small messages spend noticeably less time on dispatch.
+  # Other events, such as {EventMachine.next_tick} callbacks, still run as they happen,
+  # after the events collected before them.
+  #
+  # Handlers run slightly later than they otherwise would. {Connection#unbind} runs
+  # after the connection is gone, so it can no longer ask the reactor about it (its
+  # peer, or {Connection#get_proxied_bytes}), and {Connection#pause} called from a
+  # handler only stops reads from the next pass on.
+  #
+  # @note This method has to be used *before* event loop is started.
+  #
+  # @param [Boolean] enable Batch event delivery
+  def self.event_batching= enable
+    set_event_batching enable
+  end
+
+  # @return [Boolean] true if reactors started from now on batch event delivery
+  # @see EventMachine.event_batching=
+  def self.event_batching?
+    get_event_batching
+  end
+
+  # Returns counters describing where the running reactor spends its time. They're
+  # kept by the reactor itself on every pass, cheaply enough to leave on in production;
+  # poll them periodically and compare against the previous sample to get rates.
+  #
+  # Times are in seconds. The hash contains:
+  #
+  # * :loop_iterations - passes through the reactor loop
+  # * :poll_time, :dispatch_time - time spent waiting for events vs. handling them
+  # * :wakeups, :events - polls that returned events, and how many in total
+  # * :events_per_wakeup - histogram of events per wakeup, keyed by power-of-two bucket
+  # * :timers_fired
+  # * :heartbeat_sweeps, :heartbeat_time - inactivity-timeout checks and their cost
+  # * :bytes_read, :bytes_written - per descriptor class (:connection, :datagram, :pipe)
+  # * :outbound_high_water - largest outbound queue seen, per descriptor class
+  # * :callback_latency - :p50, :p90, :p99 and :max time to handle one event,
+  #   over the most recent 1024 events
+  #
+  # A reactor whose :dispatch_time keeps up with wall clock time is saturated.
+  #
+  # @example
+  #
+  #  EventMachine.add_periodic_timer(10) {
+  #    stats = EventMachine.stats
+  #    puts "p99 callback latency: #{stats[:callback_latency][:p99]}"
+  #  }
+  #
+  # @return [Hash]
+  def self.stats
+    get_stats
+  end
+
   # Returns the total number of connections (file descriptors) currently held by the reactor.
   # Note that a tick must pass after the 'initiation' of a connection for this number to increment.
   # It's usually accurate, but don't rely on the exact precision of this number unless you really know EM internals.
@@ -973,19 +1117,44 @@ module EventMachine
     size = @next_tick_mutex.synchronize { @next_tick_queue.size }
     size.times do |i|
       callback = @next_tick_mutex.synchronize { @next_tick_queue.shift }
-      begin
-        callback.call
-      rescue
-        exception_raised = true
-        raise
-      ensure
-        # This is a little nasty. The problem is, if an exception occurs during
-        # the callback, then we need to send a signal to the reactor to actually
-        # do some work during the next_tick. The only mechanism we have from the
-        # ruby side is next_tick itself, although ideally, we'd just drop a byte
-        # on the loopback descriptor.
-        EM.next_tick {} if exception_raised
-      end
+      callback.call
+    end
+  ensure
+    # Only a tick that finds the queue empty breaks the loop, so whatever is
+    # left now (scheduled by these callbacks, or skipped by an exception)
+    # needs another pass.
+    if reactor_running? && !@next_tick_mutex.synchronize { @next_tick_queue.empty? }
+      signal_loopbreak
+    end
+  end
+
+  # Runs the callbacks of {EventMachine.defer} operations that finished on
+  # other threads since the last pass, oldest first. If one raises, the rest
+  # are queued again for the next pass.
+  #
+  # @private
+  def self.run_completions completions
+    until completions.empty?
+      result, cback = completions.shift
+      cback.call result if cback
+    end
+  ensure
+    completions.each { |completion| queue_completion completion }
+  end
+
+  unless respond_to?(:queue_completion)
+    # Without the extension's lock-free queue, completions go through
+    # @resultqueue, and every one of them breaks the loop.
+    #
+    # @private
+    def self.queue_completion completion
+      @resultqueue << completion
+      signal_loopbreak
+    end
+
+    # @private
+    def self.completions_pending?
+      !!(@resultqueue && !@resultqueue.empty?)
     end
   end
 
@@ -1073,13 +1242,12 @@ module EventMachine
             break # Ruby 2.0 may fail at Queue.pop
           end
           begin
-            result = op.call
-            @resultqueue << [result, cback]
+            completion = [op.call, cback]
           rescue Exception => error
             raise error unless eback
-            @resultqueue << [error, eback]
+            completion = [error, eback]
           end
-          EventMachine.signal_loopbreak
+          EventMachine.queue_completion completion
         end
       end
       @threadpool << thread
@@ -1094,7 +1262,7 @@ module EventMachine
   def self.defers_finished?
     return false if @threadpool and !@all_threads_spawned
     return false if @threadqueue and not @threadqueue.empty?
-    return false if @resultqueue and not @resultqueue.empty?
+    return false if completions_pending?
     return false if @threadpool and @threadqueue.num_waiting != @threadpool.size
     return true
   end
@@ -1127,10 +1295,12 @@ module EventMachine
     # extremely expensive even if they're just sleeping.
 
     raise ArgumentError, "no proc or block given" unless ((pr && pr.respond_to?(:call)) or block)
-    @next_tick_mutex.synchronize do
+    first = @next_tick_mutex.synchronize do
       @next_tick_queue << ( pr || block )
+      @next_tick_queue.size == 1
     end
-    signal_loopbreak if reactor_running?
+    # The reactor has already been woken for any ticks ahead of this one.
+    signal_loopbreak if first && reactor_running?
   end
 
   # A wrapper over the setuid system call. Particularly useful when opening a network
@@ -1317,6 +1487,59 @@ module EventMachine
     c
   end
 
+  # Follows a file as it's appended to, like `tail -F`, creating a new
+  # {EventMachine::FileTail} with your handler mixed in. What's appended is
+  # read from where the last read stopped, and delivered as lines to
+  # {FileTail#receive_lines} (or as it was read, to receive_data, with
+  # :lines => false). Rotation by renaming, recreating or truncating the
+  # file is followed, and reported to file_rotated and file_truncated.
+  #
+  # The file needn't exist yet, but its directory must. With :strftime,
+  # the filename is a pattern expanded in UTC, for logs that are written
+  # under a new name every hour or day.
+  #
+  # @example
+  #
+  #  module Follower
+  #    def receive_line line
+  #      puts line
+  #    end
+  #
+  #    def file_rotated path
+  #      puts "now following #{path}"
+  #    end
+  #  end
+  #
+  #  EventMachine.run {
+  #    EventMachine.tail_file("/var/log/app.log.%Y-%m-%d-%H", { :strftime => true }, Follower)
+  #  }
+  #
+  # @param [String]        filename Local path to the file, or a strftime pattern
+  # @param [Hash]          opts     (optional)
+  # @param [Class, Module] handler  A class or module that implements event handlers associated with the file.
+  #
+  # @option opts [Boolean] :from_start (false) Read what's in the file already, not just what's appended
+  # @option opts [Boolean] :strftime (false) The filename is a strftime pattern
+  # @option opts [Boolean] :lines (true) Deliver lines rather than blocks as read
+  # @option opts [Integer] :max_line_size (0) Longest line allowed, zero for no limit
+  def self.tail_file(filename, *args)
+    opts = args.first.is_a?(Hash) ? args.shift : {}
+    handler = args.shift
+    klass = klass_from_handler(FileTail, handler, *args)
+
+    flags = 0
+    flags |= TailFromStart if opts[:from_start]
+    flags |= TailStrftime if opts[:strftime]
+    flags |= TailLines unless opts[:lines] == false
+
+    s = EM::tail_filename(filename, flags, opts[:max_line_size] || 0)
+    c = klass.new s, *args
+    c.instance_variable_set("@path", filename)
+    @conns[s] = c
+    block_given? and yield c
+    c
+  end
+
   # EventMachine's process monitoring API. On Mac OS X and *BSD this method is implemented using kqueue.
   #
   # @example
@@ -1540,6 +1763,53 @@ module EventMachine
     end
   end
 
+  # Runs the events of one pass through the reactor, collected with
+  # {EventMachine.event_batching=} as opcode, target, data triples. The
+  # target is the connection, or its signature if it wasn't known yet.
+  #
+  # @private
+  def self.run_event_batch events
+    i = 0
+    while i < events.size
+      begin
+        while i < events.size
+          opcode, target, data = events[i], events[i + 1], events[i + 2]
+          i += 3
+
+          if opcode == ConnectionData
+            c = Integer === target ? @conns[target] : target
+            c or raise ConnectionNotBound, "received data #{data} for unknown signature: #{target}"
+            c.receive_data data
+          elsif opcode == ConnectionFrames
+            c = Integer === target ? @conns[target] : target
+            c or raise ConnectionNotBound, "received frames for unknown signature: #{target}"
+            c.receive_frames data
+          elsif opcode == ConnectionDatagrams
+            c = Integer === target ? @conns[target] : target
+            c or raise ConnectionNotBound, "received datagrams for unknown signature: #{target}"
+            c.receive_datagrams data
+          elsif opcode == TimerFired
+            t = @timers.delete(data)
+            next if t == false # timer cancelled
+            t or raise UnknownTimerFired, "timer data: #{data}"
+            t.call
+          elsif opcode == ConnectionCompleted
+            c = Integer === target ? @conns[target] : target
+            c or raise ConnectionNotBound, "received ConnectionCompleted for unknown signature: #{target}"
+            c.connection_completed
+          else
+            event_callback target, opcode, data
+          end
+        end
+      rescue => e
+        # Like the unbatched dispatch, an error handler gets every
+        # StandardError and the rest of the batch still runs.
+        raise unless instance_variable_defined? :@error_handler
+        @error_handler.call e
+      end
+    end
+  end
+
   #
   #
   # @private
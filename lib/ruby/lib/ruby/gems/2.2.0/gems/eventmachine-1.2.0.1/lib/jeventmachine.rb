@@ -78,6 +78,22 @@ module EventMachine
   # @private
   SslHandshakeCompleted = 108
 
+  # @private
+  FramingNone = 0
+  # @private
+  FramingLine = 1
+  # @private
+  FramingDelimiter = 2
+  # @private
+  FramingLengthPrefix = 3
+
+  # @private
+  TailFromStart = 1
+  # @private
+  TailStrftime = 2
+  # @private
+  TailLines = 4
+
   # Exceptions that are defined in rubymain.cpp
   class ConnectionError < RuntimeError; end
   class ConnectionNotBound < RuntimeError; end
@@ -151,6 +167,12 @@ module EventMachine
   def self.ssl?
     false
   end
+  def self.reuseport?
+    false
+  end
+  def self.sendfile?
+    false
+  end
   def self.signal_loopbreak
     @em.signalLoopbreak
   end
@@ -195,6 +217,24 @@ module EventMachine
     # harmless no-op in Java. There's no built-in timer limit.
     @max_timer_count || 100_000
   end
+  def self.set_timer_wheel val
+    # harmless no-op in Java. Timers are managed by the JVM reactor.
+  end
+  def self.get_timer_wheel
+    false
+  end
+  def self.set_edge_triggered val
+    # harmless no-op in Java. There's no epoll.
+  end
+  def self.get_edge_triggered
+    false
+  end
+  def self.set_event_batching val
+    # harmless no-op in Java. Events are always delivered one at a time.
+  end
+  def self.get_event_batching
+    false
+  end
   def self.library_type
     :java
   end
@@ -288,6 +328,21 @@ module EventMachine
   end
   def self.send_file_data(sig, filename)
   end
+  def self.sendfile_data(sig, filename)
+    false
+  end
+  def self.set_inbound_framing(sig, mode, delimiter, prefix_size, max_frame_size)
+    false
+  end
+  def self.get_datagram_batch_size(sig)
+    nil
+  end
+  def self.set_datagram_batching(sig, batch_size, deliver_batches)
+    false
+  end
+  def self.tail_filename(filename, flags, max_line_size)
+    raise Unsupported, "no file tailing support on this platform"
+  end
 
   class Connection
     def associate_callback_target sig
@@ -32,4 +32,42 @@ class TestConnectionWrite < Test::Unit::TestCase
       EM.stop
     end
   end
+
+  module Collector
+    def initialize(received)
+      @received = received
+    end
+
+    def receive_data(data)
+      @received << data
+    end
+
+    def unbind
+      EM.stop
+    end
+  end
+
+  # Mixes many small sends, which share outbound slabs, with sends large enough
+  # to get a slab of their own, and checks that the peer sees the exact stream.
+  def test_mixed_send_sizes_arrive_in_order
+    port = next_port
+    received = ''
+    expected = ''
+
+    EM.run do
+      setup_timeout
+      EM.start_server("127.0.0.1", port, Collector, received)
+      EM.connect("127.0.0.1", port) do |c|
+        2000.times do |i|
+          chunk = (i % 100 == 0) ? ("L#{i}" * 3000) : "s#{i};"
+          expected << chunk
+          c.send_data chunk
+        end
+        c.close_connection_after_writing
+      end
+    end
+
+    assert_equal expected.size, received.size
+    assert_equal expected, received
+  end
 end
@@ -0,0 +1,144 @@
+require 'em_test_helper'
+require 'socket'
+
+class TestDatagramBatching < Test::Unit::TestCase
+
+  class Server < EM::Connection
+    def initialize(result, opts)
+      @result, @opts = result, opts
+    end
+
+    def post_init
+      @result[:batching] = set_datagram_batching(16, @opts)
+      @result[:data] = []
+      @result[:batches] = []
+    end
+
+    def receive_data(data)
+      @result[:data] << data
+      send_data "re:#{data}"
+    end
+
+    def receive_datagrams(datagrams)
+      @result[:batches] << datagrams
+      datagrams.each do |data, sender|
+        port, host = Socket.unpack_sockaddr_in(sender)
+        @result[:data] << data
+        send_datagram "re:#{data}", host, port
+      end
+    end
+  end
+
+  class Client < EM::Connection
+    def initialize(result, port, messages)
+      @result, @port, @messages = result, port, messages
+      @result[:replies] = []
+    end
+
+    def post_init
+      @result[:client_port] = Socket.unpack_sockaddr_in(get_sockname).first
+      @result[:client_batching] = set_datagram_batching(8)
+      @messages.each { |m| send_datagram m, "127.0.0.1", @port }
+    end
+
+    def receive_data(data)
+      @result[:replies] << data
+      EM.stop if @result[:replies].size == @messages.size
+    end
+  end
+
+  def setup
+    @port = next_port
+  end
+
+  def run_batching(messages, opts = {})
+    result = {}
+    EM.run {
+      setup_timeout(5)
+      EM.open_datagram_socket "127.0.0.1", @port, Server, result, opts
+      EM.open_datagram_socket "127.0.0.1", 0, Client, result, @port, messages
+    }
+    omit("datagram batching not supported") unless result[:batching]
+    result
+  end
+
+  def test_datagrams_are_delivered_one_by_one
+    messages = (1..100).map { |i| "message #{i}" }
+    result = run_batching(messages)
+
+    assert result[:client_batching]
+    assert_equal messages, result[:data]
+    assert_equal messages.map { |m| "re:#{m}" }, result[:replies]
+    assert_equal [], result[:batches]
+  end
+
+  def test_whole_batches_with_senders
+    messages = (1..100).map { |i| "message #{i}" }
+    result = run_batching(messages, :deliver_batches => true)
+
+    assert_equal messages, result[:data]
+    assert_equal messages.map { |m| "re:#{m}" }, result[:replies]
+    assert result[:batches].size < messages.size
+    assert result[:batches].all? { |b| b.size <= 16 }
+
+    senders = result[:batches].flatten(1).map { |data, sender| Socket.unpack_sockaddr_in(sender) }
+    assert_equal [[result[:client_port], "127.0.0.1"]], senders.uniq
+  end
+
+  class ResizingServer < Server
+    def receive_data(data)
+      size = [1, 256, 0, 3][@result[:data].size % 4]
+      set_datagram_batching(size)
+      @result[:sizes] << datagram_batch_size
+      super
+    end
+
+    def post_init
+      super
+      @result[:sizes] = []
+    end
+  end
+
+  # The batch being dispatched must not be resized out from under itself.
+  def test_batch_size_changed_in_receive_data
+    messages = (1..200).map { |i| "message #{i}" * (i % 7) }
+    result = {}
+    EM.run {
+      setup_timeout(5)
+      EM.open_datagram_socket "127.0.0.1", @port, ResizingServer, result, {}
+      EM.open_datagram_socket "127.0.0.1", 0, Client, result, @port, messages
+    }
+    omit("datagram batching not supported") unless result[:batching]
+
+    assert_equal messages, result[:data]
+    assert_equal messages.map { |m| "re:#{m}" }, result[:replies]
+    assert_equal (0...messages.size).map { |i| [1, 256, 0, 3][i % 4] }, result[:sizes]
+  end
+
+  def test_empty_and_large_datagrams
+    messages = ["", "x" * 8000, "y"]
+    result = run_batching(messages)
+    assert_equal messages, result[:data]
+  end
+
+  def test_settings
+    EM.run {
+      s = EM.open_datagram_socket "127.0.0.1", @port
+      c = EM.connect "127.0.0.1", @port
+
+      assert_equal 0, s.datagram_batch_size
+      assert s.set_datagram_batching(32)
+      assert_equal 32, s.datagram_batch_size
+      assert !s.set_datagram_batching(-1)
+      assert !s.set_datagram_batching(257)
+      assert_equal 32, s.datagram_batch_size
+      assert s.set_datagram_batching(0)
+      assert_equal 0, s.datagram_batch_size
+
+      assert_nil c.datagram_batch_size
+      assert !c.set_datagram_batching(8)
+      EM.stop
+    }
+  end
+
+end
@@ -32,4 +32,51 @@ class TestDefer < Test::Unit::TestCase
     assert_equal(callback_parameters.select { |parameter| parameter == callback_parameter }.length, iterations * 0.5)
     assert_equal(errback_parameters.select{ |parameter| parameter == errback_parameter }.length, iterations * 0.5)
   end
+
+  def test_completions_share_wakeups
+    omit_unless(EM.respond_to?(:completions_pending?) && EM.respond_to?(:get_stats))
+    jobs = 2000
+    done = 0
+    stats = nil
+
+    EM.run {
+      setup_timeout(10)
+      jobs.times {
+        EM.defer(proc { :ok }, proc { |r|
+          done += 1 if r == :ok
+          if done == jobs
+            stats = EM.get_stats
+            EM.stop
+          end
+        })
+      }
+    }
+
+    assert_equal jobs, done
+    assert_equal jobs, stats[:completions]
+    assert stats[:loop_breaks] < jobs / 2, "#{stats[:loop_breaks]} wakeups for #{jobs} jobs"
+    assert !EM.completions_pending?
+  end
+
+  def test_failing_callback_leaves_the_rest_queued
+    results = []
+    errors = 0
+
+    EM.error_handler { errors += 1 }
+    EM.run {
+      setup_timeout(5)
+      10.times { |i|
+        EM.defer(proc { i }, proc { |r|
+          results << r
+          raise "boom" if r == 3
+          EM.stop if results.size == 10
+        })
+      }
+    }
+
+    assert_equal (0..9).to_a, results.sort
+    assert_equal 1, errors
+  ensure
+    EM.error_handler(nil)
+  end
 end
@@ -123,6 +123,74 @@ class TestEpoll < Test::Unit::TestCase
     File.unlink(fn) if File.exist?(fn)
   end
 
+  module EdgeEchoServer
+    def receive_data data
+      send_data data
+    end
+  end
+
+  module EdgeBulkClient
+    def initialize payload, received
+      @payload, @received = payload, received
+    end
+    def connection_completed
+      send_data @payload
+      pause
+      EM.add_timer(0.05) { resume }
+    end
+    def receive_data data
+      @received << data
+      close_connection if @received.bytesize >= @payload.bytesize
+    end
+    def unbind
+      EM.stop
+    end
+  end
+
+  def test_edge_triggered_setting
+    assert !EM.epoll_edge_triggered?
+    EM.epoll_edge_triggered = true
+    assert EM.epoll_edge_triggered?
+  ensure
+    EM.epoll_edge_triggered = false
+  end
+
+  def test_edge_triggered_echo
+    omit_if(!EM.epoll?)
+    EM.epoll
+    EM.epoll_edge_triggered = true
+    $n = 0
+    $max = 0
+    EM.run {
+      EM.start_server "127.0.0.1", @port, TestEchoServer
+      20.times {
+        EM.connect("127.0.0.1", @port, TestEchoClient) {$n += 1}
+      }
+      EM.add_timer(5) { EM.stop }
+    }
+    assert_equal(0, $n)
+    assert_equal(20, $max)
+  ensure
+    EM.epoll_edge_triggered = false
+  end
+
+  def test_edge_triggered_bulk_with_pause
+    omit_if(!EM.epoll?)
+    EM.epoll
+    EM.epoll_edge_triggered = true
+    payload = (0...4 * 1024 * 1024).map { |i| i % 251 }.pack('C*')
+    received = "".b
+    EM.run {
+      EM.start_server "127.0.0.1", @port, EdgeEchoServer
+      EM.connect "127.0.0.1", @port, EdgeBulkClient, payload, received
+      EM.add_timer(10) { EM.stop }
+    }
+    assert_equal(payload.bytesize, received.bytesize)
+    assert(payload == received)
+  ensure
+    EM.epoll_edge_triggered = false
+  end
+
   def test_attach_detach
     EM.epoll
     EM.run {
@@ -0,0 +1,125 @@
+require 'em_test_helper'
+
+class TestEventBatching < Test::Unit::TestCase
+
+  module Echo
+    def receive_data(data)
+      send_data data
+    end
+  end
+
+  module Client
+    def initialize(result, messages)
+      @result, @messages = result, messages
+    end
+
+    def connection_completed
+      @result[:completed] = true
+      @messages.each { |m| send_data m }
+    end
+
+    def receive_data(data)
+      (@result[:data] ||= '') << data
+      close_connection if @result[:data].bytesize >= @messages.join.bytesize
+    end
+
+    def unbind
+      @result[:unbound] = true
+      EM.stop
+    end
+  end
+
+  def setup
+    @port = next_port
+    EM.event_batching = true
+  end
+
+  def teardown
+    EM.event_batching = false
+  end
+
+  def test_setting
+    assert EM.event_batching?
+    EM.event_batching = false
+    assert !EM.event_batching?
+  end
+
+  def test_echo
+    result = {}
+    messages = (1..100).map { |i| "message #{i}\n" }
+
+    EM.run {
+      setup_timeout(5)
+      EM.start_server("127.0.0.1", @port, Echo)
+      EM.connect("127.0.0.1", @port, Client, result, messages)
+    }
+
+    assert result[:completed]
+    assert result[:unbound]
+    assert_equal messages.join, result[:data]
+  end
+
+  def test_timers_and_next_tick_keep_their_order
+    order = []
+
+    EM.run {
+      setup_timeout(5)
+      EM.add_timer(0.01) {
+        order << :timer
+        EM.next_tick { order << :tick }
+        EM.add_timer(0.01) { order << :second_timer; EM.stop }
+      }
+    }
+
+    assert_equal [:timer, :tick, :second_timer], order
+  end
+
+  def test_one_call_per_pass
+    batches = []
+    EM.singleton_class.send(:alias_method, :orig_run_event_batch, :run_event_batch)
+    EM.singleton_class.send(:define_method, :run_event_batch) do |events|
+      batches << events.size / 3
+      orig_run_event_batch events
+    end
+
+    EM.run {
+      setup_timeout(5)
+      3.times { EM.add_timer(0) { } }
+      EM.add_timer(0.05) { EM.stop }
+    }
+
+    # The block given to EM.run, then the three timers it added.
+    assert_equal [1, 3], batches.first(2)
+  ensure
+    EM.singleton_class.send(:alias_method, :run_event_batch, :orig_run_event_batch)
+  end
+
+  def test_error_handler_sees_every_error
+    errors = []
+    fired = []
+
+    EM.error_handler { |e| errors << e.message }
+    EM.run {
+      setup_timeout(5)
+      EM.add_timer(0) { fired << 1; raise "first" }
+      EM.add_timer(0) { fired << 2; raise "second" }
+      EM.add_timer(0) { fired << 3 }
+      EM.add_timer(0.05) { EM.stop }
+    }
+
+    assert_equal [1, 2, 3], fired
+    assert_equal ["first", "second"], errors
+  ensure
+    EM.error_handler(nil)
+  end
+
+  def test_errors_stop_the_reactor_without_a_handler
+    assert_raises(RuntimeError) {
+      EM.run {
+        setup_timeout(5)
+        EM.add_timer(0) { raise "boom" }
+      }
+    }
+  end
+
+end
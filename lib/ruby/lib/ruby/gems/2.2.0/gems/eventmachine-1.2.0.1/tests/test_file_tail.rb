@@ -0,0 +1,189 @@
+require 'em_test_helper'
+require 'tmpdir'
+require 'fileutils'
+
+class TestFileTail < Test::Unit::TestCase
+  if RUBY_PLATFORM =~ /linux/ && EM.respond_to?(:tail_filename)
+    class Follower < EM::FileTail
+      def initialize(result)
+        @result = result
+        @result[:lines] = []
+        @result[:events] = []
+      end
+
+      def receive_lines(lines)
+        @result[:batches] = (@result[:batches] || 0) + 1
+        @result[:lines].concat lines
+      end
+
+      def file_rotated(path)
+        @result[:events] << [:rotated, path, @result[:lines].size]
+      end
+
+      def file_truncated
+        @result[:events] << [:truncated, @result[:lines].size]
+      end
+
+      def unbind
+        @result[:unbound] = true
+      end
+    end
+
+    def setup
+      @dir = Dir.mktmpdir('em-tail')
+      @path = File.join(@dir, 'app.log')
+    end
+
+    def teardown
+      FileUtils.rm_rf @dir
+    end
+
+    def append(path, data)
+      File.open(path, 'a') { |f| f.write data }
+    end
+
+    def test_appended_lines
+      append @path, "old\n"
+      result = {}
+
+      EM.run {
+        setup_timeout(5)
+        EM.tail_file(@path, Follower, result)
+        append @path, "one\ntw"
+        EM.add_timer(0.1) { append @path, "o\r\nthree\n" }
+        EM.add_timer(0.2) { EM.stop }
+      }
+
+      assert_equal %w(one two three), result[:lines]
+      assert result[:unbound]
+    end
+
+    def test_from_start
+      append @path, "a\nb\n"
+      result = {}
+
+      EM.run {
+        setup_timeout(5)
+        EM.tail_file(@path, { :from_start => true }, Follower, result)
+        EM.add_timer(0.1) { EM.stop }
+      }
+
+      assert_equal %w(a b), result[:lines]
+    end
+
+    def test_blocks
+      data = []
+
+      EM.run {
+        setup_timeout(5)
+        EM.tail_file(@path, :lines => false) { |c|
+          c.singleton_class.send(:define_method, :receive_data) { |d| data << d }
+        }
+        EM.add_timer(0.05) { append @path, "no\nnewline" }
+        EM.add_timer(0.15) { EM.stop }
+      }
+
+      assert_equal "no\nnewline", data.join
+    end
+
+    def test_rotation_by_rename
+      append @path, ""
+      result = {}
+
+      EM.run {
+        setup_timeout(5)
+        EM.tail_file(@path, Follower, result)
+        EM.add_timer(0.05) {
+          append @path, "1\n2\npartial"
+          File.rename @path, "#{@path}.1"
+          append "#{@path}.1", " line\n"
+          append @path, "3\n"
+        }
+        EM.add_timer(0.15) { append @path, "4\n" }
+        EM.add_timer(0.25) { EM.stop }
+      }
+
+      assert_equal ["1", "2", "partial line", "3", "4"], result[:lines]
+      assert_equal [[:rotated, @path, 3]], result[:events]
+    end
+
+    def test_strftime_pattern
+      result = {}
+      pattern = File.join(@dir, 'app.log.%Y-%m-%d-%H')
+
+      EM.run {
+        setup_timeout(5)
+        tail = EM.tail_file(pattern, { :strftime => true }, Follower, result)
+        assert_equal pattern, tail.path
+        EM.add_timer(0.05) { append Time.now.utc.strftime(pattern), "first\n" }
+        EM.add_timer(0.15) { EM.stop }
+      }
+
+      assert_equal %w(first), result[:lines]
+    end
+
+    def test_truncation
+      append @path, "before\n"
+      result = {}
+
+      EM.run {
+        setup_timeout(5)
+        EM.tail_file(@path, Follower, result)
+        EM.add_timer(0.05) { append @path, "x\n" }
+        EM.add_timer(0.1) {
+          File.truncate @path, 0
+          append @path, "y\n"
+        }
+        EM.add_timer(0.2) { EM.stop }
+      }
+
+      assert_equal %w(x y), result[:lines]
+      assert_equal [[:truncated, 1]], result[:events]
+    end
+
+    def test_file_created_later
+      result = {}
+
+      EM.run {
+        setup_timeout(5)
+        EM.tail_file(@path, Follower, result)
+        EM.add_timer(0.05) { append @path, "new\n" }
+        EM.add_timer(0.15) { EM.stop }
+      }
+
+      assert_equal %w(new), result[:lines]
+      assert_equal [], result[:events]
+    end
+
+    def test_stop_watching
+      result = {}
+
+      EM.run {
+        setup_timeout(5)
+        tail = EM.tail_file(@path, Follower, result)
+        EM.add_timer(0.05) { tail.stop_watching }
+        EM.add_timer(0.1) { append @path, "late\n" }
+        EM.add_timer(0.2) { EM.stop }
+      }
+
+      assert result[:unbound]
+      assert_equal [], result[:lines]
+    end
+
+    def test_missing_directory
+      assert_raises(EM::Unsupported) {
+        EM.run {
+          setup_timeout(5)
+          EM.tail_file(File.join(@dir, 'nope', 'app.log'))
+        }
+      }
+    end
+  else
+    warn "EM.tail_file not implemented, skipping tests in #{__FILE__}"
+
+    # Because some rubies will complain if a TestCase class has no tests
+    def test_em_tail_file_unsupported
+      assert true
+    end
+  end
+end
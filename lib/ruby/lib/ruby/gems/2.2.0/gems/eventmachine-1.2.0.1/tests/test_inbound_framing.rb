@@ -0,0 +1,136 @@
+require 'em_test_helper'
+
+class TestInboundFraming < Test::Unit::TestCase
+
+  module Sender
+    def initialize(*chunks)
+      @chunks = chunks
+    end
+
+    def post_init
+      send_next
+    end
+
+    def send_next
+      if chunk = @chunks.shift
+        send_data chunk
+        EM.add_timer(0.05) { send_next }
+      else
+        close_connection_after_writing
+      end
+    end
+  end
+
+  module Receiver
+    def initialize(result, type, arg = nil, opts = {})
+      @result = result
+      @type, @arg, @opts = type, arg, opts
+    end
+
+    def post_init
+      @result[:framing] = set_inbound_framing(@type, @arg, @opts)
+      @result[:frames] = []
+      @result[:data] = ''
+    end
+
+    def receive_frames(frames)
+      @result[:batches] = (@result[:batches] || 0) + 1
+      @result[:frames].concat frames
+    end
+
+    def receive_data(data)
+      @result[:data] << data
+    end
+
+    def unbind(reason = nil)
+      @result[:reason] = reason
+      EM.stop
+    end
+  end
+
+  def setup
+    @port = next_port
+  end
+
+  def run_framing(chunks, *framing)
+    result = {}
+    EM.run {
+      setup_timeout(5)
+      EM.start_server("127.0.0.1", @port, Receiver, result, *framing)
+      EM.connect("127.0.0.1", @port, Sender, *chunks)
+    }
+    omit("inbound framing not supported") unless result[:framing]
+    result
+  end
+
+  def test_line_framing
+    result = run_framing(["one\r\ntwo\nthr", "ee\n\nfour"], :line)
+    assert_equal ["one", "two", "three", ""], result[:frames]
+    assert_equal "", result[:data]
+  end
+
+  def test_lines_of_one_read_come_in_one_batch
+    lines = (1..1000).map { |i| "line #{i}" }
+    result = run_framing([lines.map { |l| "#{l}\n" }.join], :line)
+    assert_equal lines, result[:frames]
+    assert result[:batches] < lines.size
+  end
+
+  def test_delimiter_split_across_reads
+    result = run_framing(["a<>b<", ">c", "<", ">d<>"], :delimiter, "<>")
+    assert_equal ["a", "b", "c", "d"], result[:frames]
+  end
+
+  def test_length_prefix_framing
+    frames = ["", "x", "y" * 300, "z" * 70000]
+    stream = frames.map { |f| [f.bytesize].pack("N") + f }.join
+    result = run_framing([stream[0, 3], stream[3, 10], stream[13..-1]], :length_prefix)
+    assert_equal frames, result[:frames]
+  end
+
+  def test_short_length_prefix
+    result = run_framing(["\x02hi\x00\x01!"], :length_prefix, 1)
+    assert_equal ["hi", "", "!"], result[:frames]
+  end
+
+  class Switcher < EM::Connection
+    include Receiver
+
+    def receive_frames(frames)
+      super
+      set_inbound_framing :none if frames.include? "BODY"
+    end
+  end
+
+  def test_switching_framing_hands_over_buffered_data
+    result = {}
+    EM.run {
+      setup_timeout(5)
+      EM.start_server("127.0.0.1", @port, Switcher, result, :line)
+      EM.connect("127.0.0.1", @port, Sender, "head\nBODY\nraw", "\nbytes and more")
+    }
+    omit("inbound framing not supported") unless result[:framing]
+
+    assert_equal ["head", "BODY"], result[:frames]
+    assert_equal "raw\nbytes and more", result[:data]
+  end
+
+  def test_max_frame_size_closes_connection
+    result = run_framing(["short\n", "x" * 100], :line, nil, :max_frame_size => 64)
+    assert_equal ["short"], result[:frames]
+    assert_equal Errno::EMSGSIZE, result[:reason]
+  end
+
+  def test_invalid_arguments
+    EM.run {
+      EM.start_server("127.0.0.1", @port)
+      c = EM.connect("127.0.0.1", @port)
+      assert_raises(ArgumentError) { c.set_inbound_framing :delimiter, "" }
+      assert_raises(ArgumentError) { c.set_inbound_framing :length_prefix, 5 }
+      assert_raises(ArgumentError) { c.set_inbound_framing :words }
+      assert_raises(ArgumentError) { c.set_inbound_framing :line, nil, :max_frame_size => -1 }
+      EM.stop
+    }
+  end
+
+end
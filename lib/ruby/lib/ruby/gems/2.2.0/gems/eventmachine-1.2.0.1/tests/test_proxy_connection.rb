@@ -89,6 +89,27 @@ class TestProxyConnection < Test::Unit::TestCase
       end
     end
 
+    module BulkClient
+      def connection_completed
+        send_data "EM rocks!"
+      end
+
+      def receive_data(data)
+        ($client_data ||= "".b) << data
+      end
+
+      def unbind
+        EM.stop
+      end
+    end
+
+    module BulkServer
+      def receive_data(data)
+        send_data $bulk_data if data == "EM rocks!"
+        close_connection_after_writing
+      end
+    end
+
     module ProxyServer
       def initialize port
         @port = port
@@ -146,6 +167,20 @@ class TestProxyConnection < Test::Unit::TestCase
       assert_equal("I know!".bytesize, $proxied_bytes)
     end
 
+    def test_proxied_bulk_data
+      $client_data = nil
+      $bulk_data = (0...(4 * 1024 * 1024)).map { |i| i % 253 }.pack('C*')
+      EM.run {
+        setup_timeout(5)
+        EM.start_server("127.0.0.1", @port, BulkServer)
+        EM.start_server("127.0.0.1", @proxy_port, ProxyServer, @port)
+        EM.connect("127.0.0.1", @proxy_port, BulkClient)
+      }
+
+      assert_equal($bulk_data.bytesize, $proxied_bytes)
+      assert($bulk_data == $client_data)
+    end
+
     def test_partial_proxy_connection
       EM.run {
         EM.start_server("127.0.0.1", @port, Server)
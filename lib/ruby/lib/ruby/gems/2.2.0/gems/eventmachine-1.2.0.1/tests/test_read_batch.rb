@@ -0,0 +1,78 @@
+require 'em_test_helper'
+
+class TestReadBatch < Test::Unit::TestCase
+
+  module Sender
+    def initialize(data)
+      @data = data
+    end
+
+    def post_init
+      send_data @data
+      close_connection_after_writing
+    end
+  end
+
+  module Receiver
+    def initialize(chunks, batch_size)
+      @chunks, @batch_size = chunks, batch_size
+    end
+
+    def post_init
+      self.read_batch_size = @batch_size
+    end
+
+    def receive_data(data)
+      @chunks << data
+    end
+
+    def unbind
+      EM.stop
+    end
+  end
+
+  def setup
+    @port = next_port
+  end
+
+  def test_defaults
+    EM.run {
+      EM.start_server("127.0.0.1", @port)
+      c = EM.connect("127.0.0.1", @port)
+      assert_equal 0, c.read_batch_size
+      assert_equal 10, c.read_iterations
+      EM.stop
+    }
+  end
+
+  def test_set_and_get
+    EM.run {
+      EM.start_server("127.0.0.1", @port)
+      c = EM.connect("127.0.0.1", @port)
+      c.read_batch_size = 256 * 1024
+      c.read_iterations = 4
+      assert_equal 256 * 1024, c.read_batch_size
+      assert_equal 4, c.read_iterations
+      c.read_batch_size = -1
+      c.read_iterations = 0
+      assert_equal 256 * 1024, c.read_batch_size
+      assert_equal 4, c.read_iterations
+      EM.stop
+    }
+  end
+
+  def test_batched_reads_deliver_whole_stream
+    data = (0...(2 * 1024 * 1024)).map { |i| (i % 251).chr }.join
+    chunks = []
+
+    EM.run {
+      setup_timeout(5)
+      EM.start_server("127.0.0.1", @port, Sender, data)
+      EM.connect("127.0.0.1", @port, Receiver, chunks, 64 * 1024)
+    }
+
+    assert_equal data, chunks.join
+    assert chunks.all? { |c| c.bytesize <= 64 * 1024 }
+  end
+
+end
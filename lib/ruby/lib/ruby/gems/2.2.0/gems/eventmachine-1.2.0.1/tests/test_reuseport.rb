@@ -0,0 +1,66 @@
+require 'em_test_helper'
+require 'socket'
+
+class TestReuseport < Test::Unit::TestCase
+
+  module Counter
+    def initialize(counts, index)
+      @counts, @index = counts, index
+    end
+
+    def post_init
+      @counts[@index] += 1
+    end
+  end
+
+  def setup
+    @port = next_port
+  end
+
+  def test_reuseport_listeners_share_port
+    omit_unless(EM.reuseport?)
+
+    counts = [0, 0]
+    EM.run {
+      EM.start_reuseport_server("127.0.0.1", @port, Counter, counts, 0)
+      EM.start_reuseport_server("127.0.0.1", @port, Counter, counts, 1)
+
+      clients = (1..20).map { TCPSocket.new("127.0.0.1", @port) }
+      EM.add_timer(0.2) {
+        clients.each { |c| c.close }
+        EM.stop
+      }
+    }
+
+    assert_equal 20, counts.inject(:+)
+  end
+
+  def test_plain_listener_refuses_reuseport_port
+    omit_unless(EM.reuseport?)
+
+    EM.run {
+      EM.start_reuseport_server("127.0.0.1", @port)
+      assert_raises(RuntimeError) { EM.start_server("127.0.0.1", @port) }
+      EM.stop
+    }
+  end
+
+  def test_fork_reactors
+    omit_unless(EM.reuseport?)
+    omit_if(windows? || jruby?)
+
+    rd, wr = IO.pipe
+    pids = EM.fork_reactors(2) {
+      rd.close
+      EM.start_reuseport_server("127.0.0.1", @port)
+      wr.write "."
+      wr.close
+      EM.add_timer(0.5) { EM.stop }
+    }
+    wr.close
+
+    assert_equal "..", rd.read
+    pids.each { |pid| Process.wait(pid) }
+  end
+
+end
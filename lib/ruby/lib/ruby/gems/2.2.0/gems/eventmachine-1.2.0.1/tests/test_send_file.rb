@@ -54,7 +54,8 @@ class TestSendFile < Test::Unit::TestCase
       assert_equal( "A" * 5000, data )
     end
 
-    # EM::Connection#send_file_data has a strict upper limit on the filesize it will work with.
+    # EM::Connection#send_file_data has a strict upper limit on the filesize it will work with,
+    # unless it can hand the file to sendfile.
     def test_send_large_file
       File.open( @filename, "w" ) {|f|
         f << ("A" * 1000000)
@@ -62,7 +63,7 @@ class TestSendFile < Test::Unit::TestCase
 
       data = ''
 
-      assert_raises(RuntimeError) {
+      if EM.sendfile?
         EM.run {
           EM.start_server "127.0.0.1", @port, TestModule, @filename
           setup_timeout
@@ -70,7 +71,59 @@ class TestSendFile < Test::Unit::TestCase
             c.data_to { |d| data << d }
           end
         }
+
+        assert_equal( 1000000, data.size )
+        assert_equal( "A" * 1000000, data )
+      else
+        assert_raises(RuntimeError) {
+          EM.run {
+            EM.start_server "127.0.0.1", @port, TestModule, @filename
+            setup_timeout
+            EM.connect "127.0.0.1", @port, TestClient do |c|
+              c.data_to { |d| data << d }
+            end
+          }
+        }
+      end
+    end
+
+    module SendfileTestModule
+      def initialize filename, outbound
+        @filename = filename
+        @outbound = outbound
+      end
+
+      def post_init
+        send_data "head"
+        send_file_data @filename
+        @outbound << get_outbound_data_size
+        send_data "tail"
+        close_connection_after_writing
+      end
+    end
+
+    def test_sendfile_interleaved_with_data
+      omit_unless(EM.sendfile?)
+
+      contents = (0...251).map { |i| i.chr }.join * 16_000
+      File.open( @filename, "wb" ) {|f| f << contents }
+
+      data = ''.force_encoding('BINARY')
+      outbound = []
+
+      EM.run {
+        EM.start_server "127.0.0.1", @port, SendfileTestModule, @filename, outbound
+        setup_timeout
+        EM.connect "127.0.0.1", @port, TestClient do |c|
+          # A slow reader, so the file has to wait for the socket to drain
+          c.pause
+          EM.add_timer(0.2) { c.resume }
+          c.data_to { |d| data << d }
+        end
       }
+
+      assert_equal( [4 + contents.size], outbound )
+      assert_equal( "head" + contents + "tail", data )
     end
 
     module StreamTestModule
@@ -167,6 +220,26 @@ class TestSendFile < Test::Unit::TestCase
     end
   end
 
+  if EM.respond_to?(:sendfile?) && EM.sendfile?
+    def test_stream_large_file_data_with_sendfile
+      File.open( @filename, "w" ) {|f|
+        f << ("A" * 1000000)
+      }
+
+      data = ''
+
+      EM.run {
+        EM.start_server "127.0.0.1", @port, StreamTestModule, @filename
+        setup_timeout
+        EM.connect "127.0.0.1", @port, TestClient do |c|
+          c.data_to { |d| data << d }
+        end
+      }
+
+      assert_equal( "A" * 1000000, data )
+    end
+  end
+
   begin
     require 'fastfilereaderext'
 
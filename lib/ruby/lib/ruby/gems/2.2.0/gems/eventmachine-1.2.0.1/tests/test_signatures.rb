@@ -0,0 +1,66 @@
+require 'em_test_helper'
+
+class TestSignatures < Test::Unit::TestCase
+
+  module Closer
+    def post_init
+      close_connection
+    end
+  end
+
+  module Reconnector
+    def initialize(port, signatures, count)
+      @port, @signatures, @count = port, signatures, count
+    end
+
+    def unbind
+      @signatures << signature
+      if @signatures.size < @count
+        EM.next_tick { EM.connect("127.0.0.1", @port, Reconnector, @port, @signatures, @count) }
+      else
+        EM.stop
+      end
+    end
+  end
+
+  def setup
+    @port = next_port
+  end
+
+  def test_signatures_of_closed_connections_are_not_reused
+    signatures = []
+
+    EM.run {
+      setup_timeout(5)
+      EM.start_server("127.0.0.1", @port, Closer)
+      EM.connect("127.0.0.1", @port, Reconnector, @port, signatures, 20)
+    }
+
+    assert_equal 20, signatures.size
+    assert_equal signatures, signatures.uniq
+    assert signatures.all? { |s| s.is_a?(Integer) && s > 0 }
+  end
+
+  def test_stale_signature_finds_nothing
+    stale = live = nil
+
+    EM.run {
+      setup_timeout(5)
+      EM.start_server("127.0.0.1", @port, Closer)
+      stale = EM.connect("127.0.0.1", @port).signature
+      EM.close_connection stale, false
+
+      EM.add_timer(0.1) {
+        # Likely to take over the closed connection's slot.
+        live = EM.connect("127.0.0.1", @port).signature
+        assert_equal(-1, EM.report_connection_error_status(stale))
+        assert_equal 0, EM.report_connection_error_status(live)
+        assert_equal(-1, EM.report_connection_error_status(0))
+        EM.stop
+      }
+    }
+
+    assert_not_equal stale, live
+  end
+
+end
@@ -0,0 +1,108 @@
+require 'em_test_helper'
+require 'openssl'
+require 'tempfile'
+
+class TestSslSessionReuse < Test::Unit::TestCase
+
+  module Server
+    def initialize(tls_args)
+      @tls_args = tls_args
+    end
+
+    def post_init
+      start_tls @tls_args
+    end
+
+    def ssl_handshake_completed
+      send_data "hello"
+    end
+  end
+
+  module Client
+    def initialize(state, tls_args)
+      @state, @tls_args = state, tls_args
+    end
+
+    def connection_completed
+      start_tls @tls_args
+    end
+
+    def ssl_verify_peer(cert)
+      true
+    end
+
+    # Wait for the server's data, which comes after any session tickets.
+    def receive_data(data)
+      @state[:reused] << ssl_session_reused?
+      close_connection
+    end
+
+    def unbind
+      @state[:connections] += 1
+      if @state[:connections] < @state[:count]
+        EM.connect("127.0.0.1", @state[:port], Client, @state, @tls_args)
+      else
+        EM.stop
+      end
+    end
+  end
+
+  def setup
+    @port = next_port
+
+    # The built-in certificate is too weak for current OpenSSL releases.
+    key = OpenSSL::PKey::RSA.new(2048)
+    cert = OpenSSL::X509::Certificate.new
+    cert.version = 2
+    cert.serial = 1
+    cert.subject = cert.issuer = OpenSSL::X509::Name.parse("/CN=localhost")
+    cert.public_key = key.public_key
+    cert.not_before = Time.now - 60
+    cert.not_after = Time.now + 3600
+    cert.sign(key, OpenSSL::Digest::SHA256.new)
+
+    @key_file = Tempfile.new('em_test')
+    @key_file.write(key.to_pem)
+    @key_file.close
+    @cert_file = Tempfile.new('em_test')
+    @cert_file.write(cert.to_pem)
+    @cert_file.close
+  end
+
+  def teardown
+    @key_file.unlink
+    @cert_file.unlink
+  end
+
+  def run_clients(count, tls_args = {})
+    state = { :port => @port, :count => count, :connections => 0, :reused => [] }
+    server_args = { :private_key_file => @key_file.path, :cert_chain_file => @cert_file.path }
+    EM.run {
+      setup_timeout(5)
+      EM.start_server("127.0.0.1", @port, Server, server_args)
+      EM.connect("127.0.0.1", @port, Client, state, tls_args)
+    }
+    state[:reused]
+  end
+
+  def test_later_connections_resume
+    omit_unless(EM.ssl?)
+    assert_equal [false, true, true], run_clients(3)
+  end
+
+  def test_tls_1_2_sessions_resume
+    omit_unless(EM.ssl?)
+    assert_equal [false, true, true], run_clients(3, :ssl_version => %w(tlsv1_2))
+  end
+
+  def test_sessions_are_kept_per_sni_name
+    omit_unless(EM.ssl?)
+    assert_equal [false, true], run_clients(2, :sni_hostname => "example.com")
+  end
+
+  def test_verified_connections_do_full_handshakes
+    omit_unless(EM.ssl?)
+    assert_equal [false, false], run_clients(2, :verify_peer => true)
+  end
+
+end
@@ -0,0 +1,68 @@
+require 'em_test_helper'
+
+class TestStats < Test::Unit::TestCase
+
+  module Echo
+    def receive_data(data)
+      send_data data
+    end
+  end
+
+  module Client
+    def initialize(payload)
+      @payload, @received = payload, ""
+    end
+
+    def connection_completed
+      send_data @payload
+    end
+
+    def receive_data(data)
+      @received << data
+      close_connection if @received.bytesize >= @payload.bytesize
+    end
+
+    def unbind
+      EM.add_timer(0.05) { $stats = EM.stats; EM.stop }
+    end
+  end
+
+  def setup
+    @port = next_port
+    $stats = nil
+  end
+
+  def test_stats_outside_reactor
+    assert_raises(RuntimeError) { EM.stats }
+  end
+
+  def test_counters
+    payload = "x" * 100_000
+
+    EM.run {
+      setup_timeout(2)
+      EM.add_timer(0.01) { }
+      EM.start_server("127.0.0.1", @port, Echo)
+      EM.connect("127.0.0.1", @port, Client, payload)
+    }
+
+    assert $stats[:loop_iterations] > 0
+    assert $stats[:wakeups] > 0
+    assert $stats[:events] >= $stats[:wakeups]
+    assert_equal $stats[:wakeups], $stats[:events_per_wakeup].values.inject(:+)
+    assert $stats[:timers_fired] >= 1
+    assert $stats[:heartbeat_sweeps] > 0
+
+    # Both ends of the echo count towards the totals.
+    assert_equal 2 * payload.bytesize, $stats[:bytes_read][:connection]
+    assert_equal 2 * payload.bytesize, $stats[:bytes_written][:connection]
+    assert $stats[:outbound_high_water][:connection] > 0
+
+    latency = $stats[:callback_latency]
+    assert latency[:p50] <= latency[:p99]
+    assert latency[:p99] <= latency[:max]
+    assert $stats[:poll_time] >= 0
+    assert $stats[:dispatch_time] > 0
+  end
+
+end
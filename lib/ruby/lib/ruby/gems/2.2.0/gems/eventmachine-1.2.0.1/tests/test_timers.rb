@@ -118,6 +118,68 @@ class TestTimers < Test::Unit::TestCase
     ensure
       EM.set_max_timers(defaults)
     end
+
+    def test_timer_wheel_fires_in_order
+      EM.timer_wheel = true
+      assert EM.timer_wheel?
+
+      fired = []
+      delays = [0.05, 0, 0.3, 0.01, 0.02, 0.3, 0.15]
+      EM.run {
+        delays.each_with_index { |d, i| EM.add_timer(d) { fired << i } }
+        EM.add_timer(0.4) { EM.stop }
+      }
+
+      assert_equal [1, 3, 4, 0, 6, 2, 5], fired
+    ensure
+      EM.timer_wheel = false
+    end
+
+    def test_timer_wheel_cancel_and_periodic
+      EM.timer_wheel = true
+
+      x = 0
+      EM.run {
+        t = EM::Timer.new(0.01) { flunk "Timer was not cancelled." }
+        t.cancel
+        EM::PeriodicTimer.new(0.01) { x += 1; EM.stop if x == 4 }
+      }
+
+      assert_equal 4, x
+    ensure
+      EM.timer_wheel = false
+    end
+
+    def test_timer_wheel_inactivity_timeout
+      EM.timer_wheel = true
+
+      start, finish = nil
+      timeout_handler = Module.new do
+        define_method(:unbind) { finish = Time.now; EM.stop }
+      end
+
+      EM.run {
+        setup_timeout
+        EM.heartbeat_interval = 0.01
+        EM.start_server("127.0.0.1", 12346)
+        EM.add_timer(0.01) {
+          start = Time.now
+          c = EM.connect("127.0.0.1", 12346, timeout_handler)
+          c.comm_inactivity_timeout = 0.02
+        }
+      }
+
+      assert_in_delta(0.02, (finish - start), 0.02)
+    ensure
+      EM.timer_wheel = false
+    end
+
+    def test_timer_wheel_cannot_change_while_running
+      EM.run {
+        assert_raises(RuntimeError) { EM.timer_wheel = true }
+        EM.stop
+      }
+    end
   end
 
 end
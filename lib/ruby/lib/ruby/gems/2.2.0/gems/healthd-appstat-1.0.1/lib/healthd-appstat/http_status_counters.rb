@@ -14,11 +14,16 @@ module Healthd
                 end
 
                 def <<(code)
+                    add code
+                end
+
+                def add(code, count = 1)
                     key = @key_cache[code]
-                    key = @key_cache[code] = "status_#{code}" unless key
+                    # three digits, as the status appears in the log
+                    key = @key_cache[code] = "status_%03d" % code unless key
 
-                    @data[key] += 1
-                    @data['request_count'.freeze] += 1
+                    @data[key] += count
+                    @data['request_count'.freeze] += count
                 end
 
                 def to_h
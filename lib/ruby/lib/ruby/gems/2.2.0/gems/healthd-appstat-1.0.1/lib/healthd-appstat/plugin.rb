@@ -41,7 +41,7 @@ module Healthd
                     @mode = mode
                     @pattern = pattern || @@pattern
                     @interval = interval || @queue.collection_interval
-                    @xdigest = XDigest.create :compression => 25
+                    @xdigest = XDigest.create :compression => 25, :engine => :merging
                     @status_counters = HTTPStatusCounters.new
 
                     unless @@units.include? @unit
@@ -69,9 +69,9 @@ module Healthd
                     #   }
                     #
                     #   access_log /var/log/nginx/healthd/application.log.$year-$month-$day-$hour healthd;
-                    @chainsaw = Chainsaw.create :separator  => @@pattern, 
-                                                :transforms => [:fixnum, nil, nil, :float], 
-                                                :ext        => ext
+                    #
+                    # only epoch, status and latency are used, the uri and the rest are never converted
+                    @ext = ext
                 end
 
                 def collect
@@ -86,49 +86,38 @@ module Healthd
                 end
 
                 def each_timeslot
-                    count = nil
-                    previous_timeslot = 0
+                    # lines are parsed and bucketed in C, only finished timeslots come back
+                    timeslots = Chainsaw.timeslots :separator => @@pattern, 
+                                                   :interval  => interval, 
+                                                   :usec      => @usec, 
+                                                   :arrival   => @arrival, 
+                                                   :ext       => @ext
+                    skipped = 0
 
                     LogFile.open(path, :mode => mode) do |io|
-                        @chainsaw.cut(io) do |epoch, request, status, latency, upstream_latency, x_forwarded_for|
-                            unless x_forwarded_for
-                                logger.warn %[partial line read from "#{io.path}". skipping]
-                                next
-                            end
-
-                            # normalize units to seconds with millisecond resolution
-                            if @usec
-                                latency = (latency / 1_000_000.0).round(3)
-                                # upstream_latency = (upstream_latency / 1_000_000).round(3)
-                            end
-
-                            # normalize timestamp to request completion time
-                            if @arrival
-                                epoch += latency
-                            end
-
-                            timeslot = epoch.div(interval) * interval + interval
-                            if timeslot > previous_timeslot   # e.g. nginx timestamps are not monotonic
-                                if count
-                                    stats = {
-                                        'duration'          => interval,
-                                        'latency_histogram' => xdigest.export(:round => 5), 
-                                        'http_counters'     => status_counters.to_h
-                                    }
-
-                                    yield previous_timeslot, stats
-                                end
-
-                                count = 0
-                                xdigest.clear
-                                status_counters.clear
-                                previous_timeslot = timeslot
-                            end
-
-                            count += 1
-                            xdigest.add latency
-                            status_counters << status
+                        # feed leaves a partial last line in the file for the next round
+                        lines_cut = timeslots.feed(io) do |timeslot, latencies, statuses|
+                            xdigest.clear
+                            xdigest.add_many latencies
+
+                            status_counters.clear
+                            statuses.each { |status, count| status_counters.add status, count }
+
+                            stats = {
+                                'duration'          => interval,
+                                'latency_histogram' => xdigest.export(:round => 5), 
+                                'http_counters'     => status_counters.to_h
+                            }
+
+                            yield timeslot, stats
                         end
+
+                        if timeslots.skipped > skipped
+                            logger.warn %[#{timeslots.skipped - skipped} malformed lines read from "#{io.path}". skipping]
+                            skipped = timeslots.skipped
+                        end
+
+                        lines_cut
                     end
                 end
             end
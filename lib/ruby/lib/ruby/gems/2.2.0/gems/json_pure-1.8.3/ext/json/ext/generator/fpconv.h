@@ -0,0 +1,353 @@
+#ifndef _FPCONV_H_
+#define _FPCONV_H_
+
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Formats doubles the same way Float#to_s does, without the method call and
+ * the String it allocates. The digits come from the Grisu3 algorithm in
+ * Florian Loitsch's "Printing Floating-Point Numbers Quickly and Accurately
+ * with Integers". Grisu3 gives up on the few doubles (about 0.5%) for which it
+ * can not be sure the digits are the shortest, and those are found with
+ * snprintf instead.
+ */
+
+#define FPCONV_BUFFER_LENGTH 32
+
+typedef struct {
+    unsigned long long f;
+    int e;
+} fpconv_fp;
+
+/* normalized powers of ten from 10^-348 to 10^340, every eighth one */
+static const struct {
+    unsigned long long f;
+    short e;
+    short k;
+} fpconv_powers[] = {
+    { 0xfa8fd5a0081c0288ULL, -1220, -348 },
+    { 0xbaaee17fa23ebf76ULL, -1193, -340 },
+    { 0x8b16fb203055ac76ULL, -1166, -332 },
+    { 0xcf42894a5dce35eaULL, -1140, -324 },
+    { 0x9a6bb0aa55653b2dULL, -1113, -316 },
+    { 0xe61acf033d1a45dfULL, -1087, -308 },
+    { 0xab70fe17c79ac6caULL, -1060, -300 },
+    { 0xff77b1fcbebcdc4fULL, -1034, -292 },
+    { 0xbe5691ef416bd60cULL, -1007, -284 },
+    { 0x8dd01fad907ffc3cULL,  -980, -276 },
+    { 0xd3515c2831559a83ULL,  -954, -268 },
+    { 0x9d71ac8fada6c9b5ULL,  -927, -260 },
+    { 0xea9c227723ee8bcbULL,  -901, -252 },
+    { 0xaecc49914078536dULL,  -874, -244 },
+    { 0x823c12795db6ce57ULL,  -847, -236 },
+    { 0xc21094364dfb5637ULL,  -821, -228 },
+    { 0x9096ea6f3848984fULL,  -794, -220 },
+    { 0xd77485cb25823ac7ULL,  -768, -212 },
+    { 0xa086cfcd97bf97f4ULL,  -741, -204 },
+    { 0xef340a98172aace5ULL,  -715, -196 },
+    { 0xb23867fb2a35b28eULL,  -688, -188 },
+    { 0x84c8d4dfd2c63f3bULL,  -661, -180 },
+    { 0xc5dd44271ad3cdbaULL,  -635, -172 },
+    { 0x936b9fcebb25c996ULL,  -608, -164 },
+    { 0xdbac6c247d62a584ULL,  -582, -156 },
+    { 0xa3ab66580d5fdaf6ULL,  -555, -148 },
+    { 0xf3e2f893dec3f126ULL,  -529, -140 },
+    { 0xb5b5ada8aaff80b8ULL,  -502, -132 },
+    { 0x87625f056c7c4a8bULL,  -475, -124 },
+    { 0xc9bcff6034c13053ULL,  -449, -116 },
+    { 0x964e858c91ba2655ULL,  -422, -108 },
+    { 0xdff9772470297ebdULL,  -396, -100 },
+    { 0xa6dfbd9fb8e5b88fULL,  -369,  -92 },
+    { 0xf8a95fcf88747d94ULL,  -343,  -84 },
+    { 0xb94470938fa89bcfULL,  -316,  -76 },
+    { 0x8a08f0f8bf0f156bULL,  -289,  -68 },
+    { 0xcdb02555653131b6ULL,  -263,  -60 },
+    { 0x993fe2c6d07b7facULL,  -236,  -52 },
+    { 0xe45c10c42a2b3b06ULL,  -210,  -44 },
+    { 0xaa242499697392d3ULL,  -183,  -36 },
+    { 0xfd87b5f28300ca0eULL,  -157,  -28 },
+    { 0xbce5086492111aebULL,  -130,  -20 },
+    { 0x8cbccc096f5088ccULL,  -103,  -12 },
+    { 0xd1b71758e219652cULL,   -77,   -4 },
+    { 0x9c40000000000000ULL,   -50,    4 },
+    { 0xe8d4a51000000000ULL,   -24,   12 },
+    { 0xad78ebc5ac620000ULL,     3,   20 },
+    { 0x813f3978f8940984ULL,    30,   28 },
+    { 0xc097ce7bc90715b3ULL,    56,   36 },
+    { 0x8f7e32ce7bea5c70ULL,    83,   44 },
+    { 0xd5d238a4abe98068ULL,   109,   52 },
+    { 0x9f4f2726179a2245ULL,   136,   60 },
+    { 0xed63a231d4c4fb27ULL,   162,   68 },
+    { 0xb0de65388cc8ada8ULL,   189,   76 },
+    { 0x83c7088e1aab65dbULL,   216,   84 },
+    { 0xc45d1df942711d9aULL,   242,   92 },
+    { 0x924d692ca61be758ULL,   269,  100 },
+    { 0xda01ee641a708deaULL,   295,  108 },
+    { 0xa26da3999aef774aULL,   322,  116 },
+    { 0xf209787bb47d6b85ULL,   348,  124 },
+    { 0xb454e4a179dd1877ULL,   375,  132 },
+    { 0x865b86925b9bc5c2ULL,   402,  140 },
+    { 0xc83553c5c8965d3dULL,   428,  148 },
+    { 0x952ab45cfa97a0b3ULL,   455,  156 },
+    { 0xde469fbd99a05fe3ULL,   481,  164 },
+    { 0xa59bc234db398c25ULL,   508,  172 },
+    { 0xf6c69a72a3989f5cULL,   534,  180 },
+    { 0xb7dcbf5354e9beceULL,   561,  188 },
+    { 0x88fcf317f22241e2ULL,   588,  196 },
+    { 0xcc20ce9bd35c78a5ULL,   614,  204 },
+    { 0x98165af37b2153dfULL,   641,  212 },
+    { 0xe2a0b5dc971f303aULL,   667,  220 },
+    { 0xa8d9d1535ce3b396ULL,   694,  228 },
+    { 0xfb9b7cd9a4a7443cULL,   720,  236 },
+    { 0xbb764c4ca7a44410ULL,   747,  244 },
+    { 0x8bab8eefb6409c1aULL,   774,  252 },
+    { 0xd01fef10a657842cULL,   800,  260 },
+    { 0x9b10a4e5e9913129ULL,   827,  268 },
+    { 0xe7109bfba19c0c9dULL,   853,  276 },
+    { 0xac2820d9623bf429ULL,   880,  284 },
+    { 0x80444b5e7aa7cf85ULL,   907,  292 },
+    { 0xbf21e44003acdd2dULL,   933,  300 },
+    { 0x8e679c2f5e44ff8fULL,   960,  308 },
+    { 0xd433179d9c8cb841ULL,   986,  316 },
+    { 0x9e19db92b4e31ba9ULL,  1013,  324 },
+    { 0xeb96bf6ebadf77d9ULL,  1039,  332 },
+    { 0xaf87023b9bf0ee6bULL,  1066,  340 },
+};
+
+static const unsigned int fpconv_small_powers[] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+static fpconv_fp fpconv_from_double(double d)
+{
+    unsigned long long bits;
+    int be;
+    fpconv_fp fp;
+
+    memcpy(&bits, &d, sizeof(bits));
+    be = (int)((bits >> 52) & 0x7FF);
+    fp.f = bits & 0x000FFFFFFFFFFFFFULL;
+    if (be) {
+        fp.f += 0x0010000000000000ULL;
+        fp.e = be - 1075;
+    } else {
+        fp.e = -1074;
+    }
+    return fp;
+}
+
+static fpconv_fp fpconv_normalize(fpconv_fp fp)
+{
+    while (!(fp.f & 0xFFC0000000000000ULL)) {
+        fp.f <<= 10;
+        fp.e -= 10;
+    }
+    while (!(fp.f & 0x8000000000000000ULL)) {
+        fp.f <<= 1;
+        fp.e--;
+    }
+    return fp;
+}
+
+/* upper 64 bits of the 128 bit product, rounded */
+static fpconv_fp fpconv_multiply(fpconv_fp x, fpconv_fp y)
+{
+    unsigned long long a = x.f >> 32, b = x.f & 0xFFFFFFFFULL;
+    unsigned long long c = y.f >> 32, d = y.f & 0xFFFFFFFFULL;
+    unsigned long long ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    unsigned long long tmp = (bd >> 32) + (ad & 0xFFFFFFFFULL) + (bc & 0xFFFFFFFFULL) + (1ULL << 31);
+    fpconv_fp r;
+
+    r.f = ac + (ad >> 32) + (bc >> 32) + (tmp >> 32);
+    r.e = x.e + y.e + 64;
+    return r;
+}
+
+/* half way to the neighbouring doubles, anything in between reads back as v */
+static void fpconv_boundaries(fpconv_fp v, fpconv_fp *minus, fpconv_fp *plus)
+{
+    plus->f = (v.f << 1) + 1;
+    plus->e = v.e - 1;
+    *plus = fpconv_normalize(*plus);
+    if (v.f == 0x0010000000000000ULL && v.e != -1074) {
+        /* the next lower double is closer than the next higher one */
+        minus->f = (v.f << 2) - 1;
+        minus->e = v.e - 2;
+    } else {
+        minus->f = (v.f << 1) - 1;
+        minus->e = v.e - 1;
+    }
+    minus->f <<= minus->e - plus->e;
+    minus->e = plus->e;
+}
+
+static int fpconv_round_weed(char *buf, int len, unsigned long long dist_high_w,
+        unsigned long long unsafe, unsigned long long rest,
+        unsigned long long ten_kappa, unsigned long long unit)
+{
+    unsigned long long small_dist = dist_high_w - unit;
+    unsigned long long big_dist = dist_high_w + unit;
+
+    while (rest < small_dist && unsafe - rest >= ten_kappa &&
+            (rest + ten_kappa < small_dist ||
+             small_dist - rest >= rest + ten_kappa - small_dist)) {
+        buf[len - 1]--;
+        rest += ten_kappa;
+    }
+    if (rest < big_dist && unsafe - rest >= ten_kappa &&
+            (rest + ten_kappa < big_dist ||
+             big_dist - rest > rest + ten_kappa - big_dist)) {
+        return 0;
+    }
+    return 2 * unit <= rest && rest <= unsafe - 4 * unit;
+}
+
+static int fpconv_digit_gen(fpconv_fp low, fpconv_fp w, fpconv_fp high, char *buf, int *len, int *kappa)
+{
+    unsigned long long unit = 1;
+    unsigned long long too_low = low.f - unit;
+    unsigned long long too_high = high.f + unit;
+    unsigned long long unsafe = too_high - too_low;
+    int shift = -w.e;
+    unsigned long long one = 1ULL << shift;
+    unsigned int integrals = (unsigned int)(too_high >> shift);
+    unsigned long long fractionals = too_high & (one - 1);
+    unsigned int divisor;
+    unsigned long long rest;
+
+    *len = 0;
+    *kappa = 9;
+    while (*kappa > 0 && integrals < fpconv_small_powers[*kappa]) (*kappa)--;
+    divisor = fpconv_small_powers[*kappa];
+    (*kappa)++;
+    while (*kappa > 0) {
+        buf[(*len)++] = '0' + integrals / divisor;
+        integrals %= divisor;
+        (*kappa)--;
+        rest = ((unsigned long long)integrals << shift) + fractionals;
+        if (rest < unsafe) {
+            return fpconv_round_weed(buf, *len, too_high - w.f, unsafe, rest,
+                    (unsigned long long)divisor << shift, unit);
+        }
+        divisor /= 10;
+    }
+    for (;;) {
+        fractionals *= 10;
+        unit *= 10;
+        unsafe *= 10;
+        buf[(*len)++] = '0' + (char)(fractionals >> shift);
+        fractionals &= one - 1;
+        (*kappa)--;
+        if (fractionals < unsafe) {
+            return fpconv_round_weed(buf, *len, (too_high - w.f) * unit, unsafe,
+                    fractionals, one, unit);
+        }
+    }
+}
+
+static int fpconv_grisu3(double d, char *buf, int *len, int *decpt)
+{
+    fpconv_fp v = fpconv_from_double(d);
+    fpconv_fp w = fpconv_normalize(v);
+    fpconv_fp minus, plus, ten_mk;
+    int k, i, kappa, ok;
+
+    fpconv_boundaries(v, &minus, &plus);
+    /* pick a power of ten that brings w.e into [-60, -32] */
+    k = (int)ceil((-60 - (w.e + 64) + 63) * 0.30102999566398114);
+    i = (348 + k - 1) / 8 + 1;
+    ten_mk.f = fpconv_powers[i].f;
+    ten_mk.e = fpconv_powers[i].e;
+    w = fpconv_multiply(w, ten_mk);
+    minus = fpconv_multiply(minus, ten_mk);
+    plus = fpconv_multiply(plus, ten_mk);
+    ok = fpconv_digit_gen(minus, w, plus, buf, len, &kappa);
+    *decpt = *len + kappa - fpconv_powers[i].k;
+    return ok;
+}
+
+/* more and more digits until the number reads back the same */
+static int fpconv_printf_digits(double d, char *buf, int *decpt)
+{
+    char str[32], *s;
+    int prec, len = 0;
+
+    for (prec = 1; prec < 17; prec++) {
+        snprintf(str, sizeof(str), "%.*e", prec - 1, d);
+        if (strtod(str, NULL) == d) break;
+    }
+    snprintf(str, sizeof(str), "%.*e", prec - 1, d);
+    for (s = str; *s != 'e'; s++) {
+        if (*s >= '0' && *s <= '9') buf[len++] = *s;
+    }
+    *decpt = atoi(s + 1) + 1;
+    return len;
+}
+
+/*
+ * Writes a finite, non-zero d to buf in the format of Float#to_s and returns
+ * the length. buf needs to hold FPCONV_BUFFER_LENGTH chars.
+ */
+static int fpconv_dtoa(double d, char *buf)
+{
+    char digits[18];
+    char *b = buf;
+    int len, decpt, exp;
+
+    if (d < 0.0) {
+        *b++ = '-';
+        d = -d;
+    }
+    if (!fpconv_grisu3(d, digits, &len, &decpt)) {
+        len = fpconv_printf_digits(d, digits, &decpt);
+    }
+    if (decpt > 0 && decpt <= DBL_DIG + 1 && decpt < len) {
+        /* a fraction stays in fixed notation one place longer */
+        memcpy(b, digits, decpt);
+        b += decpt;
+        *b++ = '.';
+        memcpy(b, digits + decpt, len - decpt);
+        b += len - decpt;
+    } else if (decpt > 0 && decpt <= DBL_DIG) {
+        memcpy(b, digits, len);
+        b += len;
+        for (; len < decpt; len++) *b++ = '0';
+        *b++ = '.';
+        *b++ = '0';
+    } else if (decpt <= 0 && decpt > -4) {
+        *b++ = '0';
+        *b++ = '.';
+        for (; decpt < 0; decpt++) *b++ = '0';
+        memcpy(b, digits, len);
+        b += len;
+    } else {
+        *b++ = digits[0];
+        *b++ = '.';
+        if (len > 1) {
+            memcpy(b, digits + 1, len - 1);
+            b += len - 1;
+        } else {
+            *b++ = '0';
+        }
+        exp = decpt - 1;
+        *b++ = 'e';
+        if (exp < 0) {
+            *b++ = '-';
+            exp = -exp;
+        } else {
+            *b++ = '+';
+        }
+        if (exp >= 100) {
+            *b++ = '0' + exp / 100;
+            exp %= 100;
+        }
+        *b++ = '0' + exp / 10;
+        *b++ = '0' + exp % 10;
+    }
+    return (int)(b - buf);
+}
+
+#endif
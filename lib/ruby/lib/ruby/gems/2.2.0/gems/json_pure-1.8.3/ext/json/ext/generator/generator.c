@@ -1,5 +1,6 @@
 #include "../fbuffer/fbuffer.h"
 #include "generator.h"
+#include "fpconv.h"
 
 #ifdef HAVE_RUBY_ENCODING_H
 static VALUE CEncoding_UTF_8;
@@ -829,17 +830,24 @@ static void generate_json_float(FBuffer *buffer, VALUE Vstate, JSON_Generator_St
 {
     double value = RFLOAT_VALUE(obj);
     char allow_nan = state->allow_nan;
-    VALUE tmp = rb_funcall(obj, i_to_s, 0);
-    if (!allow_nan) {
-        if (isinf(value)) {
-            fbuffer_free(buffer);
-            rb_raise(eGeneratorError, "%u: %"PRIsVALUE" not allowed in JSON", __LINE__, RB_OBJ_STRING(tmp));
-        } else if (isnan(value)) {
+    char buf[FPCONV_BUFFER_LENGTH];
+    VALUE tmp;
+    if (isinf(value) || isnan(value)) {
+        tmp = rb_funcall(obj, i_to_s, 0);
+        if (!allow_nan) {
             fbuffer_free(buffer);
             rb_raise(eGeneratorError, "%u: %"PRIsVALUE" not allowed in JSON", __LINE__, RB_OBJ_STRING(tmp));
         }
+        fbuffer_append_str(buffer, tmp);
+    } else if (value == 0.0) {
+        if (signbit(value)) {
+            fbuffer_append(buffer, "-0.0", 4);
+        } else {
+            fbuffer_append(buffer, "0.0", 3);
+        }
+    } else {
+        fbuffer_append(buffer, buf, fpconv_dtoa(value, buf));
     }
-    fbuffer_append_str(buffer, tmp);
 }
 
 static void generate_json(FBuffer *buffer, VALUE Vstate, JSON_Generator_State *state, VALUE obj)
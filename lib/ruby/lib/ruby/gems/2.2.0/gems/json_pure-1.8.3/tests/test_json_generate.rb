@@ -202,6 +202,29 @@ EOT
     assert_equal "[\n  -Infinity\n]", pretty_generate([JSON::MinusInfinity], :allow_nan => true)
   end
 
+  def test_generate_float
+    floats = [
+      0.0, -0.0, 0.1, 0.3, 1.5, 100.0, 1e15, 1e16, 1e22, 1e23, 0.0001, 0.00001,
+      123456789012345.6, 1234567890123456.7, 12345678901234567.0,
+      9007199254740993.0, 2.0 ** 63, 2.0 ** -1022, 5e-324, 2.2250738585072014e-308,
+      1.7976931348623157e308, 4.35, 5.0e-324 * 3, 1.0 / 3, 2.0 / 3,
+      # Grisu3 can't tell these are the shortest and falls back to snprintf
+      726009959711053.2, 447852216.7252343, 6.305972359549266e+16, 74998741883405.62,
+    ]
+    rand = Random.new(1467053563)
+    1000.times do
+      floats << [ rand.bytes(8) ].pack('a8').unpack('E').first
+      floats << rand.rand * 10 ** rand.rand(-20..20)
+      floats << rand.rand(100000) / 100.0
+    end
+    floats.each do |f|
+      next if f.nan? || f.infinite?
+      json = generate([ f ])
+      assert_equal "[#{f}]", json
+      assert_equal [ f ], parse(json)
+    end
+  end
+
   def test_depth
     ary = []; ary << ary
     assert_equal 0, JSON::SAFE_STATE_PROTOTYPE.depth
@@ -43,6 +43,7 @@
 #include "oj.h"
 #include "cache8.h"
 #include "odd.h"
+#include "grisu.h"
 
 #if !HAS_ENCODING_SUPPORT || defined(RUBINIUS_RUBY)
 #define rb_eEncodingError	rb_eException
@@ -445,6 +446,31 @@ static const char	inf_val[] = INF_VAL;
 static const char	ninf_val[] = NINF_VAL;
 static const char	nan_val[] = NAN_VAL;
 
+// Same as "%.1f" for a float with no fraction.
+static int
+dump_integral_float(long long int n, char *buf) {
+    char		tmp[24];
+    char		*t = tmp + sizeof(tmp);
+    char		*b = buf;
+    unsigned long long	u = (0 > n) ? -(unsigned long long)n : (unsigned long long)n;
+
+    do {
+	*--t = '0' + (u % 10);
+	u /= 10;
+    } while (0 < u);
+    if (0 > n) {
+	*b++ = '-';
+    }
+    for (; t < tmp + sizeof(tmp); t++) {
+	*b++ = *t;
+    }
+    *b++ = '.';
+    *b++ = '0';
+    *b = '\0';
+
+    return (int)(b - buf);
+}
+
 // Removed dependencies on math due to problems with CentOS 5.4.
 static void
 dump_float(VALUE obj, Out out) {
@@ -563,17 +589,12 @@ dump_float(VALUE obj, Out out) {
 	    }
 	}
     } else if (d == (double)(long long int)d) {
-	cnt = snprintf(buf, sizeof(buf), "%.1f", d);
+	cnt = dump_integral_float((long long int)d, buf);
     } else if (0 == out->opts->float_prec) {
-	volatile VALUE	rstr = rb_funcall(obj, oj_to_s_id, 0);
-
-	cnt = RSTRING_LEN(rstr);
-	if ((int)sizeof(buf) <= cnt) {
-	    cnt = sizeof(buf) - 1;
-	}
-	strncpy(buf, rb_string_value_ptr((VALUE*)&rstr), cnt);
-	buf[cnt] = '\0';
-    } else {
+	// same as Float#to_s without the method call or the String
+	cnt = oj_dtoa_ruby(d, buf);
+    } else if (15 < out->opts->float_prec ||
+	       0 == (cnt = oj_dtoa_g(d, out->opts->float_prec, buf))) {
 	cnt = snprintf(buf, sizeof(buf), out->opts->float_fmt, d);
     }
     if (out->end - out->cur <= (long)cnt) {
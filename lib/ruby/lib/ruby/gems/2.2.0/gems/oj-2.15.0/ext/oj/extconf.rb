@@ -11,6 +11,16 @@ type = 'ree' if 'ruby' == type && RUBY_DESCRIPTION.include?('Ruby Enterprise Edi
 is_windows = RbConfig::CONFIG['host_os'] =~ /(mingw|mswin)/
 platform = RUBY_PLATFORM
 version = RUBY_VERSION.split('.')
+
+# The parser uses AVX2 when the CPU has it, which requires a compiler that can
+# build individual functions for it.
+has_avx2 = try_compile(%{
+#include <immintrin.h>
+__attribute__((target("avx2"))) static int f(const char *s) { return _mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*)s)); }
+static char buf[32];
+int main() { __builtin_cpu_init(); return __builtin_cpu_supports("avx2") ? f(buf) : 0; }
+})
+
 puts ">>>>> Creating Makefile for #{type} version #{RUBY_VERSION} on #{platform} <<<<<"
 
 dflags = {
@@ -34,6 +44,7 @@ dflags = {
   'USE_RB_MUTEX' => (is_windows && !('1' == version[0] && '8' == version[1])) ? 1 : 0,
   'DATETIME_1_8' => ('ruby' == type && ('1' == version[0] && '8' == version[1])) ? 1 : 0,
   'NO_TIME_ROUND_PAD' => ('rubinius' == type) ? 1 : 0,
+  'HAS_AVX2' => has_avx2 ? 1 : 0,
   'HAS_DATA_OBJECT_WRAP' => ('ruby' == type && '2' == version[0] && '3' <= version[1]) ? 1 : 0,
 }
 # This is a monster hack to get around issues with 1.9.3-p0 on CentOS 5.4. SO
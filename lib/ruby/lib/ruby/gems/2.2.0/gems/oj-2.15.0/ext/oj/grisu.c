@@ -0,0 +1,490 @@
+/* grisu.c
+ * Copyright (c) 2016, Peter Ohler
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *  - Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ *  - Neither the name of Peter Ohler nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "grisu.h"
+
+// Shortest round trip digits for a double using the Grisu3 algorithm from
+// Florian Loitsch's "Printing Floating-Point Numbers Quickly and Accurately
+// with Integers". Grisu3 knows when it can not be sure the digits are the
+// shortest, about 0.5% of all doubles, and those are found with snprintf
+// instead.
+
+#define SIGNIFICAND_MASK	0x000FFFFFFFFFFFFFULL
+#define HIDDEN_BIT		0x0010000000000000ULL
+#define EXPONENT_MASK		0x7FF0000000000000ULL
+#define EXPONENT_BIAS		(0x3FF + 52)
+#define DENORMAL_EXP		(1 - EXPONENT_BIAS)
+#define MIN_TARGET_EXP		-60
+#define CACHED_POWERS_OFFSET	348
+#define CACHED_POWERS_STEP	8
+#define D_1_LOG2_10		0.30102999566398114
+
+typedef struct _DiyFp {
+    uint64_t	f;
+    int		e;
+} DiyFp;
+
+// Normalized powers of ten from 10^-348 to 10^340, every eighth one.
+static const struct {
+    uint64_t	f;
+    int16_t	e;
+    int16_t	k;
+} cached_powers[] = {
+    { 0xfa8fd5a0081c0288ULL, -1220, -348 },
+    { 0xbaaee17fa23ebf76ULL, -1193, -340 },
+    { 0x8b16fb203055ac76ULL, -1166, -332 },
+    { 0xcf42894a5dce35eaULL, -1140, -324 },
+    { 0x9a6bb0aa55653b2dULL, -1113, -316 },
+    { 0xe61acf033d1a45dfULL, -1087, -308 },
+    { 0xab70fe17c79ac6caULL, -1060, -300 },
+    { 0xff77b1fcbebcdc4fULL, -1034, -292 },
+    { 0xbe5691ef416bd60cULL, -1007, -284 },
+    { 0x8dd01fad907ffc3cULL,  -980, -276 },
+    { 0xd3515c2831559a83ULL,  -954, -268 },
+    { 0x9d71ac8fada6c9b5ULL,  -927, -260 },
+    { 0xea9c227723ee8bcbULL,  -901, -252 },
+    { 0xaecc49914078536dULL,  -874, -244 },
+    { 0x823c12795db6ce57ULL,  -847, -236 },
+    { 0xc21094364dfb5637ULL,  -821, -228 },
+    { 0x9096ea6f3848984fULL,  -794, -220 },
+    { 0xd77485cb25823ac7ULL,  -768, -212 },
+    { 0xa086cfcd97bf97f4ULL,  -741, -204 },
+    { 0xef340a98172aace5ULL,  -715, -196 },
+    { 0xb23867fb2a35b28eULL,  -688, -188 },
+    { 0x84c8d4dfd2c63f3bULL,  -661, -180 },
+    { 0xc5dd44271ad3cdbaULL,  -635, -172 },
+    { 0x936b9fcebb25c996ULL,  -608, -164 },
+    { 0xdbac6c247d62a584ULL,  -582, -156 },
+    { 0xa3ab66580d5fdaf6ULL,  -555, -148 },
+    { 0xf3e2f893dec3f126ULL,  -529, -140 },
+    { 0xb5b5ada8aaff80b8ULL,  -502, -132 },
+    { 0x87625f056c7c4a8bULL,  -475, -124 },
+    { 0xc9bcff6034c13053ULL,  -449, -116 },
+    { 0x964e858c91ba2655ULL,  -422, -108 },
+    { 0xdff9772470297ebdULL,  -396, -100 },
+    { 0xa6dfbd9fb8e5b88fULL,  -369,  -92 },
+    { 0xf8a95fcf88747d94ULL,  -343,  -84 },
+    { 0xb94470938fa89bcfULL,  -316,  -76 },
+    { 0x8a08f0f8bf0f156bULL,  -289,  -68 },
+    { 0xcdb02555653131b6ULL,  -263,  -60 },
+    { 0x993fe2c6d07b7facULL,  -236,  -52 },
+    { 0xe45c10c42a2b3b06ULL,  -210,  -44 },
+    { 0xaa242499697392d3ULL,  -183,  -36 },
+    { 0xfd87b5f28300ca0eULL,  -157,  -28 },
+    { 0xbce5086492111aebULL,  -130,  -20 },
+    { 0x8cbccc096f5088ccULL,  -103,  -12 },
+    { 0xd1b71758e219652cULL,   -77,   -4 },
+    { 0x9c40000000000000ULL,   -50,    4 },
+    { 0xe8d4a51000000000ULL,   -24,   12 },
+    { 0xad78ebc5ac620000ULL,     3,   20 },
+    { 0x813f3978f8940984ULL,    30,   28 },
+    { 0xc097ce7bc90715b3ULL,    56,   36 },
+    { 0x8f7e32ce7bea5c70ULL,    83,   44 },
+    { 0xd5d238a4abe98068ULL,   109,   52 },
+    { 0x9f4f2726179a2245ULL,   136,   60 },
+    { 0xed63a231d4c4fb27ULL,   162,   68 },
+    { 0xb0de65388cc8ada8ULL,   189,   76 },
+    { 0x83c7088e1aab65dbULL,   216,   84 },
+    { 0xc45d1df942711d9aULL,   242,   92 },
+    { 0x924d692ca61be758ULL,   269,  100 },
+    { 0xda01ee641a708deaULL,   295,  108 },
+    { 0xa26da3999aef774aULL,   322,  116 },
+    { 0xf209787bb47d6b85ULL,   348,  124 },
+    { 0xb454e4a179dd1877ULL,   375,  132 },
+    { 0x865b86925b9bc5c2ULL,   402,  140 },
+    { 0xc83553c5c8965d3dULL,   428,  148 },
+    { 0x952ab45cfa97a0b3ULL,   455,  156 },
+    { 0xde469fbd99a05fe3ULL,   481,  164 },
+    { 0xa59bc234db398c25ULL,   508,  172 },
+    { 0xf6c69a72a3989f5cULL,   534,  180 },
+    { 0xb7dcbf5354e9beceULL,   561,  188 },
+    { 0x88fcf317f22241e2ULL,   588,  196 },
+    { 0xcc20ce9bd35c78a5ULL,   614,  204 },
+    { 0x98165af37b2153dfULL,   641,  212 },
+    { 0xe2a0b5dc971f303aULL,   667,  220 },
+    { 0xa8d9d1535ce3b396ULL,   694,  228 },
+    { 0xfb9b7cd9a4a7443cULL,   720,  236 },
+    { 0xbb764c4ca7a44410ULL,   747,  244 },
+    { 0x8bab8eefb6409c1aULL,   774,  252 },
+    { 0xd01fef10a657842cULL,   800,  260 },
+    { 0x9b10a4e5e9913129ULL,   827,  268 },
+    { 0xe7109bfba19c0c9dULL,   853,  276 },
+    { 0xac2820d9623bf429ULL,   880,  284 },
+    { 0x80444b5e7aa7cf85ULL,   907,  292 },
+    { 0xbf21e44003acdd2dULL,   933,  300 },
+    { 0x8e679c2f5e44ff8fULL,   960,  308 },
+    { 0xd433179d9c8cb841ULL,   986,  316 },
+    { 0x9e19db92b4e31ba9ULL,  1013,  324 },
+    { 0xeb96bf6ebadf77d9ULL,  1039,  332 },
+    { 0xaf87023b9bf0ee6bULL,  1066,  340 },
+};
+
+static const uint32_t	small_powers[] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+static DiyFp
+diy_fp(double d) {
+    uint64_t	bits;
+    int		be;
+    DiyFp	fp;
+
+    memcpy(&bits, &d, sizeof(bits));
+    be = (int)((bits & EXPONENT_MASK) >> 52);
+    if (0 == be) {
+	fp.f = bits & SIGNIFICAND_MASK;
+	fp.e = DENORMAL_EXP;
+    } else {
+	fp.f = (bits & SIGNIFICAND_MASK) + HIDDEN_BIT;
+	fp.e = be - EXPONENT_BIAS;
+    }
+    return fp;
+}
+
+static DiyFp
+normalize(DiyFp fp) {
+    while (0 == (fp.f & 0xFFC0000000000000ULL)) {
+	fp.f <<= 10;
+	fp.e -= 10;
+    }
+    while (0 == (fp.f & 0x8000000000000000ULL)) {
+	fp.f <<= 1;
+	fp.e--;
+    }
+    return fp;
+}
+
+// The upper 64 bits of the 128 bit product, rounded.
+static DiyFp
+multiply(DiyFp x, DiyFp y) {
+    uint64_t	a = x.f >> 32;
+    uint64_t	b = x.f & 0xFFFFFFFFULL;
+    uint64_t	c = y.f >> 32;
+    uint64_t	d = y.f & 0xFFFFFFFFULL;
+    uint64_t	ac = a * c;
+    uint64_t	bc = b * c;
+    uint64_t	ad = a * d;
+    uint64_t	bd = b * d;
+    uint64_t	tmp = (bd >> 32) + (ad & 0xFFFFFFFFULL) + (bc & 0xFFFFFFFFULL) + (1ULL << 31);
+    DiyFp	r;
+
+    r.f = ac + (ad >> 32) + (bc >> 32) + (tmp >> 32);
+    r.e = x.e + y.e + 64;
+
+    return r;
+}
+
+// The points half way to the neighboring doubles. Any number between them
+// reads back as v.
+static void
+boundaries(DiyFp v, DiyFp *minus, DiyFp *plus) {
+    plus->f = (v.f << 1) + 1;
+    plus->e = v.e - 1;
+    *plus = normalize(*plus);
+    if (HIDDEN_BIT == v.f && DENORMAL_EXP != v.e) {
+	// the next lower double is closer than the next higher one
+	minus->f = (v.f << 2) - 1;
+	minus->e = v.e - 2;
+    } else {
+	minus->f = (v.f << 1) - 1;
+	minus->e = v.e - 1;
+    }
+    minus->f <<= minus->e - plus->e;
+    minus->e = plus->e;
+}
+
+static DiyFp
+cached_power(int min_exp, int *kp) {
+    int		k = (int)ceil((min_exp + 64 - 1) * D_1_LOG2_10);
+    int		i = (CACHED_POWERS_OFFSET + k - 1) / CACHED_POWERS_STEP + 1;
+    DiyFp	p;
+
+    p.f = cached_powers[i].f;
+    p.e = cached_powers[i].e;
+    *kp = cached_powers[i].k;
+
+    return p;
+}
+
+// Moves the last digit closer to w if that can be done while staying in the
+// safe interval. Returns 0 if the result may not be the closest shortest one.
+static int
+round_weed(char *buf, int len, uint64_t dist_high_w, uint64_t unsafe, uint64_t rest, uint64_t ten_kappa, uint64_t unit) {
+    uint64_t	small_dist = dist_high_w - unit;
+    uint64_t	big_dist = dist_high_w + unit;
+
+    while (rest < small_dist &&
+	   unsafe - rest >= ten_kappa &&
+	   (rest + ten_kappa < small_dist || small_dist - rest >= rest + ten_kappa - small_dist)) {
+	buf[len - 1]--;
+	rest += ten_kappa;
+    }
+    if (rest < big_dist &&
+	unsafe - rest >= ten_kappa &&
+	(rest + ten_kappa < big_dist || big_dist - rest > rest + ten_kappa - big_dist)) {
+	return 0;
+    }
+    return 2 * unit <= rest && rest <= unsafe - 4 * unit;
+}
+
+static int
+digit_gen(DiyFp low, DiyFp w, DiyFp high, char *buf, int *lenp, int *kappap) {
+    uint64_t	unit = 1;
+    uint64_t	too_low = low.f - unit;
+    uint64_t	too_high = high.f + unit;
+    uint64_t	unsafe = too_high - too_low;
+    int		shift = -w.e;
+    uint64_t	one = 1ULL << shift;
+    uint32_t	integrals = (uint32_t)(too_high >> shift);
+    uint64_t	fractionals = too_high & (one - 1);
+    int		kappa = 9;
+    uint32_t	divisor;
+    uint64_t	rest;
+    int		len = 0;
+
+    while (0 < kappa && integrals < small_powers[kappa]) {
+	kappa--;
+    }
+    divisor = small_powers[kappa];
+    kappa++;
+    while (0 < kappa) {
+	buf[len++] = '0' + integrals / divisor;
+	integrals %= divisor;
+	kappa--;
+	rest = ((uint64_t)integrals << shift) + fractionals;
+	if (rest < unsafe) {
+	    *lenp = len;
+	    *kappap = kappa;
+	    return round_weed(buf, len, too_high - w.f, unsafe, rest, (uint64_t)divisor << shift, unit);
+	}
+	divisor /= 10;
+    }
+    while (1) {
+	fractionals *= 10;
+	unit *= 10;
+	unsafe *= 10;
+	buf[len++] = '0' + (char)(fractionals >> shift);
+	fractionals &= one - 1;
+	kappa--;
+	if (fractionals < unsafe) {
+	    *lenp = len;
+	    *kappap = kappa;
+	    return round_weed(buf, len, (too_high - w.f) * unit, unsafe, fractionals, one, unit);
+	}
+    }
+}
+
+static int
+grisu3(double d, char *buf, int *lenp, int *decpt) {
+    DiyFp	v = diy_fp(d);
+    DiyFp	w = normalize(v);
+    DiyFp	minus;
+    DiyFp	plus;
+    DiyFp	ten_mk;
+    int		mk;
+    int		kappa;
+    int		ok;
+
+    boundaries(v, &minus, &plus);
+    ten_mk = cached_power(MIN_TARGET_EXP - (w.e + 64), &mk);
+    w = multiply(w, ten_mk);
+    minus = multiply(minus, ten_mk);
+    plus = multiply(plus, ten_mk);
+    ok = digit_gen(minus, w, plus, buf, lenp, &kappa);
+    *decpt = *lenp + kappa - mk;
+
+    return ok;
+}
+
+// Tries more and more digits until the number reads back the same.
+static int
+printf_digits(double d, char *buf, int *decpt) {
+    char	str[32];
+    char	*s;
+    int		len = 0;
+    int		prec;
+
+    for (prec = 1; prec < 17; prec++) {
+	snprintf(str, sizeof(str), "%.*e", prec - 1, d);
+	if (strtod(str, 0) == d) {
+	    break;
+	}
+    }
+    snprintf(str, sizeof(str), "%.*e", prec - 1, d);
+    for (s = str; 'e' != *s; s++) {
+	if ('0' <= *s && *s <= '9') {
+	    buf[len++] = *s;
+	}
+    }
+    *decpt = atoi(s + 1) + 1;
+
+    return len;
+}
+
+int
+oj_dtoa_digits(double d, char *buf, int *decpt) {
+    int	len;
+
+    if (!grisu3(d, buf, &len, decpt)) {
+	len = printf_digits(d, buf, decpt);
+    }
+    return len;
+}
+
+static char*
+append_exp(char *b, int exp) {
+    *b++ = 'e';
+    if (0 > exp) {
+	*b++ = '-';
+	exp = -exp;
+    } else {
+	*b++ = '+';
+    }
+    if (100 <= exp) {
+	*b++ = '0' + exp / 100;
+	exp %= 100;
+    }
+    *b++ = '0' + exp / 10;
+    *b++ = '0' + exp % 10;
+
+    return b;
+}
+
+int
+oj_dtoa_ruby(double d, char *buf) {
+    char	digits[OJ_DTOA_DIGITS_MAX];
+    char	*b = buf;
+    int		decpt;
+    int		len;
+
+    if (0.0 > d) {
+	*b++ = '-';
+	d = -d;
+    }
+    len = oj_dtoa_digits(d, digits, &decpt);
+    // Ruby keeps a fraction in fixed notation one place longer than a
+    // whole number.
+    if (0 < decpt && decpt <= DBL_DIG + 1 && decpt < len) {
+	memcpy(b, digits, decpt);
+	b += decpt;
+	*b++ = '.';
+	memcpy(b, digits + decpt, len - decpt);
+	b += len - decpt;
+    } else if (0 < decpt && decpt <= DBL_DIG) {
+	memcpy(b, digits, len);
+	b += len;
+	for (; len < decpt; len++) {
+	    *b++ = '0';
+	}
+	*b++ = '.';
+	*b++ = '0';
+    } else if (0 >= decpt && -4 < decpt) {
+	*b++ = '0';
+	*b++ = '.';
+	for (; 0 > decpt; decpt++) {
+	    *b++ = '0';
+	}
+	memcpy(b, digits, len);
+	b += len;
+    } else {
+	*b++ = *digits;
+	*b++ = '.';
+	if (1 < len) {
+	    memcpy(b, digits + 1, len - 1);
+	    b += len - 1;
+	} else {
+	    *b++ = '0';
+	}
+	b = append_exp(b, decpt - 1);
+    }
+    *b = '\0';
+
+    return (int)(b - buf);
+}
+
+int
+oj_dtoa_g(double d, int prec, char *buf) {
+    char	digits[OJ_DTOA_DIGITS_MAX];
+    char	*b = buf;
+    int		decpt;
+    int		len;
+
+    if (0.0 > d) {
+	*b++ = '-';
+	d = -d;
+    }
+    if (DBL_MIN > d) {
+	// subnormals have fewer than DBL_DIG digits of precision
+	return 0;
+    }
+    len = oj_dtoa_digits(d, digits, &decpt);
+    if (prec < len) {
+	return 0;
+    }
+    if (decpt - 1 < -4 || prec <= decpt - 1) {
+	*b++ = *digits;
+	if (1 < len) {
+	    *b++ = '.';
+	    memcpy(b, digits + 1, len - 1);
+	    b += len - 1;
+	}
+	b = append_exp(b, decpt - 1);
+    } else if (0 >= decpt) {
+	*b++ = '0';
+	*b++ = '.';
+	for (; 0 > decpt; decpt++) {
+	    *b++ = '0';
+	}
+	memcpy(b, digits, len);
+	b += len;
+    } else if (decpt < len) {
+	memcpy(b, digits, decpt);
+	b += decpt;
+	*b++ = '.';
+	memcpy(b, digits + decpt, len - decpt);
+	b += len - decpt;
+    } else {
+	memcpy(b, digits, len);
+	b += len;
+	for (; len < decpt; len++) {
+	    *b++ = '0';
+	}
+    }
+    *b = '\0';
+
+    return (int)(b - buf);
+}
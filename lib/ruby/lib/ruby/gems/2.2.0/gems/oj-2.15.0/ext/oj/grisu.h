@@ -0,0 +1,53 @@
+/* grisu.h
+ * Copyright (c) 2016, Peter Ohler
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *  - Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ *  - Neither the name of Peter Ohler nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __OJ_GRISU_H__
+#define __OJ_GRISU_H__
+
+// enough for any double plus a terminator
+#define OJ_DTOA_DIGITS_MAX	18
+// longest output from oj_dtoa_ruby() or oj_dtoa_g(), sign, '.', exponent, and terminator included
+#define OJ_DTOA_BUF_MAX		32
+
+// Places the shortest digits that read back as d, which must be positive and
+// finite, in buf and returns how many there are. The value is
+// 0.<digits> * 10^decpt.
+extern int	oj_dtoa_digits(double d, char *buf, int *decpt);
+
+// Formats a non-zero finite d the same way Float#to_s does and returns the
+// length.
+extern int	oj_dtoa_ruby(double d, char *buf);
+
+// Formats a non-zero finite d the same way snprintf() does with "%0.<prec>g"
+// and returns the length, or returns 0 if d needs more than prec digits to
+// read back the same. Only correct for prec of DBL_DIG (15) or less.
+extern int	oj_dtoa_g(double d, int prec, char *buf);
+
+#endif /* __OJ_GRISU_H__ */
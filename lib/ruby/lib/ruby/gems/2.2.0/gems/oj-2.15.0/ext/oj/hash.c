@@ -28,7 +28,9 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include "oj.h"
 #include "hash.h"
+#include "encode.h"
 #include <stdint.h>
 
 #define HASH_MASK	0x000003FF
@@ -48,6 +50,19 @@ struct _Hash {
 struct _Hash	class_hash;
 struct _Hash	intern_hash;
 
+// Hash keys seen while parsing. Each slot holds one key so the cache never
+// grows, a new key just replaces whatever was in its slot.
+typedef struct _KeyStr {
+    VALUE	str;
+    size_t	len;
+    char	key[OJ_KEY_CACHE_MAX];
+} *KeyStr;
+
+static struct _KeyStr	key_cache[HASH_SLOT_CNT];
+static VALUE		key_cache_wrap = Qnil; // marks the cached Strings
+
+struct _KeyCacheStats	oj_key_cache_stats = { HASH_SLOT_CNT, 0, 0, 0, 0, 0 };
+
 // almost the Murmur hash algorithm
 #define M 0x5bd1e995
 #define C1 0xCC9E2D51
@@ -89,10 +104,25 @@ hash_calc(const uint8_t *key, size_t len) {
     return h;
 }
 
+static void
+key_cache_mark(void *ptr) {
+    KeyStr	ks = (KeyStr)ptr;
+    KeyStr	end = ks + HASH_SLOT_CNT;
+
+    for (; ks < end; ks++) {
+	if (0 != ks->str) {
+	    rb_gc_mark(ks->str);
+	}
+    }
+}
+
 void
 oj_hash_init() {
     memset(class_hash.slots, 0, sizeof(class_hash.slots));
     memset(intern_hash.slots, 0, sizeof(intern_hash.slots));
+    memset(key_cache, 0, sizeof(key_cache));
+    key_cache_wrap = Data_Wrap_Struct(rb_cObject, key_cache_mark, 0, key_cache);
+    rb_gc_register_address(&key_cache_wrap);
 }
 
 // if slotp is 0 then just lookup
@@ -152,6 +182,40 @@ oj_attr_hash_get(const char *key, size_t len, ID **slotp) {
     return (ID)hash_get(&intern_hash, key, len, (VALUE**)slotp, 0);
 }
 
+// Returns a frozen String for a key no longer than OJ_KEY_CACHE_MAX, the same
+// one each time the key is seen unless it has been pushed out of the cache.
+VALUE
+oj_key_cache_get(const char *key, size_t len, int *hitp) {
+    uint32_t		h = hash_calc((const uint8_t*)key, len) & HASH_MASK;
+    KeyStr		ks = key_cache + h;
+    volatile VALUE	rstr;
+
+    if (len == ks->len && 0 != ks->str && 0 == memcmp(ks->key, key, len)) {
+	*hitp = 1;
+	return ks->str;
+    }
+    *hitp = 0;
+    rstr = rb_str_new(key, len);
+    rstr = oj_encode(rstr);
+    rb_obj_freeze(rstr);
+    if (0 == ks->str) {
+	oj_key_cache_stats.entries++;
+    }
+    ks->str = rstr;
+    ks->len = len;
+    memcpy(ks->key, key, len);
+
+    return rstr;
+}
+
+void
+oj_key_cache_record(size_t hits, size_t misses) {
+    oj_key_cache_stats.hits += hits;
+    oj_key_cache_stats.misses += misses;
+    oj_key_cache_stats.last_hits = hits;
+    oj_key_cache_stats.last_misses = misses;
+}
+
 char*
 oj_strndup(const char *s, size_t len) {
     char	*d = ALLOC_N(char, len + 1);
@@ -33,12 +33,28 @@
 
 #include "ruby.h"
 
+// longest key kept in the parse key cache
+#define OJ_KEY_CACHE_MAX	32
+
 typedef struct _Hash	*Hash;
 
+typedef struct _KeyCacheStats {
+    size_t	slots;
+    size_t	entries;
+    size_t	hits;
+    size_t	misses;
+    size_t	last_hits;	// for the most recent parse
+    size_t	last_misses;
+} *KeyCacheStats;
+
+extern struct _KeyCacheStats	oj_key_cache_stats;
+
 extern void	oj_hash_init();
 
 extern VALUE	oj_class_hash_get(const char *key, size_t len, VALUE **slotp);
 extern ID	oj_attr_hash_get(const char *key, size_t len, ID **slotp);
+extern VALUE	oj_key_cache_get(const char *key, size_t len, int *hitp);
+extern void	oj_key_cache_record(size_t hits, size_t misses);
 
 extern void	oj_hash_print();
 extern char*	oj_strndup(const char *s, size_t len);
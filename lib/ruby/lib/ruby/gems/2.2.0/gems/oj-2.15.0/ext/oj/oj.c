@@ -41,6 +41,7 @@
 #include "parse.h"
 #include "hash.h"
 #include "odd.h"
+#include "scan.h"
 #include "encode.h"
 
 typedef struct _YesNoOpt {
@@ -97,6 +98,7 @@ VALUE	oj_bigdecimal_class;
 VALUE	oj_cstack_class;
 VALUE	oj_date_class;
 VALUE	oj_datetime_class;
+VALUE	oj_encoder_class;
 VALUE	oj_parse_error_class;
 VALUE	oj_stream_writer_class;
 VALUE	oj_string_writer_class;
@@ -113,6 +115,7 @@ static VALUE	auto_sym;
 static VALUE	bigdecimal_as_decimal_sym;
 static VALUE	bigdecimal_load_sym;
 static VALUE	bigdecimal_sym;
+static VALUE	cache_keys_sym;
 static VALUE	circular_sym;
 static VALUE	class_cache_sym;
 static VALUE	compat_sym;
@@ -134,6 +137,7 @@ static VALUE	quirks_mode_sym;
 static VALUE	raise_sym;
 static VALUE	ruby_sym;
 static VALUE	sec_prec_sym;
+static VALUE	simd_sym;
 static VALUE	strict_sym;
 static VALUE	symbol_keys_sym;
 static VALUE	time_format_sym;
@@ -181,6 +185,8 @@ struct _Options	oj_default_options = {
     No,		// nilnil
     Yes,	// allow_gc
     Yes,	// quirks_mode
+    Yes,	// simd
+    Yes,	// cache_keys
     json_class,	// create_id
     10,		// create_id_len
     9,		// sec_prec
@@ -224,6 +230,8 @@ static VALUE	define_mimic_json(int argc, VALUE *argv, VALUE self);
  * - nilnil: [true|false|nil] if true a nil input to load will return nil and not raise an Exception
  * - allow_gc: [true|false|nil] allow or prohibit GC during parsing, default is true (allow)
  * - quirks_mode: [true,|false|nil] Allow single JSON values instead of documents, default is true (allow)
+ * - simd: [true|false|nil] use vector instructions, when the CPU has them, to scan strings and white space while parsing, default is true
+ * - cache_keys: [true|false|nil] reuse frozen Strings for short hash keys in strict and compat mode parsing, default is true
  * - indent_str: [String|nil] String to use for indentation, overriding the indent option is not nil
  * - space: [String|nil] String to use for the space after the colon in JSON object fields
  * - space_before: [String|nil] String to use before the colon separator in JSON object fields
@@ -251,6 +259,8 @@ get_def_opts(VALUE self) {
     rb_hash_aset(opts, nilnil_sym, (Yes == oj_default_options.nilnil) ? Qtrue : ((No == oj_default_options.nilnil) ? Qfalse : Qnil));
     rb_hash_aset(opts, allow_gc_sym, (Yes == oj_default_options.allow_gc) ? Qtrue : ((No == oj_default_options.allow_gc) ? Qfalse : Qnil));
     rb_hash_aset(opts, quirks_mode_sym, (Yes == oj_default_options.quirks_mode) ? Qtrue : ((No == oj_default_options.quirks_mode) ? Qfalse : Qnil));
+    rb_hash_aset(opts, simd_sym, (Yes == oj_default_options.simd) ? Qtrue : ((No == oj_default_options.simd) ? Qfalse : Qnil));
+    rb_hash_aset(opts, cache_keys_sym, (Yes == oj_default_options.cache_keys) ? Qtrue : ((No == oj_default_options.cache_keys) ? Qfalse : Qnil));
     rb_hash_aset(opts, float_prec_sym, INT2FIX(oj_default_options.float_prec));
     switch (oj_default_options.mode) {
     case StrictMode:	rb_hash_aset(opts, mode_sym, strict_sym);	break;
@@ -331,6 +341,8 @@ get_def_opts(VALUE self) {
  * @param [true|false|nil] :nilnil if true a nil input to load will return nil and not raise an Exception
  * @param [true|false|nil] :allow_gc allow or prohibit GC during parsing, default is true (allow)
  * @param [true|false|nil] :quirks_mode allow single JSON values instead of documents, default is true (allow)
+ * @param [true|false|nil] :simd use vector instructions, when the CPU has them, to scan strings and white space while parsing, default is true
+ * @param [true|false|nil] :cache_keys reuse frozen Strings for short hash keys in strict and compat mode parsing, default is true
  * @param [String|nil] :space String to use for the space after the colon in JSON object fields
  * @param [String|nil] :space_before String to use before the colon separator in JSON object fields
  * @param [String|nil] :object_nl String to use after a JSON object field value
@@ -346,6 +358,28 @@ set_def_opts(VALUE self, VALUE opts) {
     return Qnil;
 }
 
+/* call-seq: key_cache_stats() => Hash
+ *
+ * Returns statistics for the hash key cache used when the :cache_keys option
+ * is true. The cache holds at most :slots keys. The :hits and :misses are
+ * totals for all parses while :last_hits and :last_misses are for the most
+ * recent parse that used the cache.
+ * @return [Hash] key cache statistics
+ */
+static VALUE
+key_cache_stats(VALUE self) {
+    VALUE	stats = rb_hash_new();
+
+    rb_hash_aset(stats, ID2SYM(rb_intern("slots")), ULONG2NUM(oj_key_cache_stats.slots));
+    rb_hash_aset(stats, ID2SYM(rb_intern("entries")), ULONG2NUM(oj_key_cache_stats.entries));
+    rb_hash_aset(stats, ID2SYM(rb_intern("hits")), ULONG2NUM(oj_key_cache_stats.hits));
+    rb_hash_aset(stats, ID2SYM(rb_intern("misses")), ULONG2NUM(oj_key_cache_stats.misses));
+    rb_hash_aset(stats, ID2SYM(rb_intern("last_hits")), ULONG2NUM(oj_key_cache_stats.last_hits));
+    rb_hash_aset(stats, ID2SYM(rb_intern("last_misses")), ULONG2NUM(oj_key_cache_stats.last_misses));
+
+    return stats;
+}
+
 void
 oj_parse_options(VALUE ropts, Options copts) {
     struct _YesNoOpt	ynos[] = {
@@ -358,6 +392,8 @@ oj_parse_options(VALUE ropts, Options copts) {
 	{ nilnil_sym, &copts->nilnil },
 	{ allow_gc_sym, &copts->allow_gc },
 	{ quirks_mode_sym, &copts->quirks_mode },
+	{ simd_sym, &copts->simd },
+	{ cache_keys_sym, &copts->cache_keys },
 	{ Qnil, 0 }
     };
     YesNoOpt		o;
@@ -1549,6 +1585,268 @@ stream_writer_pop_all(VALUE self) {
     return Qnil;
 }
 
+/* Document-class: Oj::Encoder
+ * 
+ * Dumps objects to JSON using the same output buffer each time instead of
+ * starting with a new one for every document. The buffer grows to fit the
+ * documents being dumped and shrinks again if they get much smaller, so a
+ * stream of similar documents is dumped without allocating anything more than
+ * the returned String. The to_stream() method writes the document straight to
+ * a file descriptor, or an IO that has one, without creating a String at all.
+ *
+ * An Encoder can be shared but a dump that starts while another is in
+ * progress, from a to_json() or another thread, uses a buffer of its own.
+ */
+
+#define ENCODER_MIN_SIZE	4096
+// dumps between checks for a buffer that is much larger than needed
+#define ENCODER_WINDOW		64
+
+typedef struct _EncoderCall {
+    Encoder	e;
+    VALUE	obj;
+    Options	copts;
+    VALUE	stream;
+    size_t	size;
+} *EncoderCall;
+
+static void
+encoder_free(void *ptr) {
+    Encoder	e;
+
+    if (0 == ptr) {
+	return;
+    }
+    e = (Encoder)ptr;
+    xfree(e->out.buf);
+    xfree(ptr);
+}
+
+// Gives back most of the buffer if every document in the last window would
+// have fit in a quarter of it.
+static void
+encoder_fit(Encoder e) {
+    size_t	size = e->out.end - e->out.buf;
+    size_t	want = e->window_max * 2;
+
+    if (ENCODER_WINDOW > e->window_cnt) {
+	return;
+    }
+    if (want < ENCODER_MIN_SIZE) {
+	want = ENCODER_MIN_SIZE;
+    }
+    if (want * 2 < size) {
+	REALLOC_N(e->out.buf, char, want + 10);
+	e->out.end = e->out.buf + want;
+	e->shrinks++;
+    }
+    e->window_cnt = 0;
+    e->window_max = 0;
+}
+
+// The stream can be an IO or, other than on Windows, a file descriptor.
+static void
+encoder_write(const char *s, ssize_t size, VALUE stream) {
+    VALUE	clas = rb_obj_class(stream);
+#if !IS_WINDOWS
+    ssize_t	cnt;
+    int		fd = 0;
+    VALUE	v;
+#endif
+
+    if (oj_stringio_class == clas) {
+	rb_funcall(stream, oj_write_id, 1, rb_str_new(s, size));
+#if !IS_WINDOWS
+    } else if ((FIXNUM_P(stream) && 0 <= (fd = FIX2INT(stream))) ||
+	       (rb_respond_to(stream, oj_fileno_id) &&
+		Qnil != (v = rb_funcall(stream, oj_fileno_id, 0)) &&
+		0 != (fd = FIX2INT(v)))) {
+	while (0 < size) {
+	    if (0 > (cnt = write(fd, s, size))) {
+		if (EINTR == errno) {
+		    continue;
+		}
+		rb_raise(rb_eIOError, "Write failed. [%d:%s]\n", errno, strerror(errno));
+	    }
+	    s += cnt;
+	    size -= cnt;
+	}
+#endif
+    } else if (rb_respond_to(stream, oj_write_id)) {
+	rb_funcall(stream, oj_write_id, 1, rb_str_new(s, size));
+    } else {
+	rb_raise(rb_eArgError, "to_stream() expected an IO Object or a file descriptor.");
+    }
+}
+
+// The write happens here too, while the encoder is still busy, since
+// fileno() or write() could otherwise start a dump that moves the buffer.
+static VALUE
+encoder_call(VALUE x) {
+    EncoderCall	call = (EncoderCall)x;
+    Encoder	e = call->e;
+
+    oj_dump_obj_to_json(call->obj, call->copts, &e->out);
+    e->last_size = e->out.cur - e->out.buf;
+    if (e->window_max < e->last_size) {
+	e->window_max = e->last_size;
+    }
+    e->window_cnt++;
+    e->dumps++;
+    if (call->size == (size_t)(e->out.end - e->out.buf)) {
+	e->reuses++;
+    } else {
+	e->grows++;
+    }
+    if (Qnil != call->stream) {
+	encoder_write(e->out.buf, e->out.cur - e->out.buf, call->stream);
+    }
+    return Qnil;
+}
+
+static VALUE
+encoder_done(VALUE x) {
+    ((Encoder)x)->busy = 0;
+
+    return Qnil;
+}
+
+// Dumps into the encoder buffer, from out.buf to out.cur, and then writes it
+// to stream unless stream is Qnil.
+static void
+encoder_encode(Encoder e, VALUE obj, Options copts, VALUE stream) {
+    struct _EncoderCall	call;
+
+    encoder_fit(e);
+    call.e = e;
+    call.obj = obj;
+    call.copts = copts;
+    call.stream = stream;
+    call.size = e->out.end - e->out.buf;
+    e->busy = 1;
+    rb_ensure(encoder_call, (VALUE)&call, encoder_done, (VALUE)e);
+}
+
+/* call-seq: new(options)
+ *
+ * Creates a new Encoder.
+ * @param [Hash] options same as default_options
+ */
+static VALUE
+encoder_new(int argc, VALUE *argv, VALUE self) {
+    Encoder	e = ALLOC(struct _Encoder);
+
+    memset(e, 0, sizeof(struct _Encoder));
+    e->opts = oj_default_options;
+    if (1 == argc) {
+	oj_parse_options(argv[0], &e->opts);
+    }
+    e->out.buf = ALLOC_N(char, ENCODER_MIN_SIZE + 10);
+    e->out.end = e->out.buf + ENCODER_MIN_SIZE;
+    e->out.allocated = 1;
+    e->out.cur = e->out.buf;
+    *e->out.cur = '\0';
+
+    return Data_Wrap_Struct(oj_encoder_class, 0, encoder_free, e);
+}
+
+/* call-seq: dump(obj, options) => json-string
+ *
+ * Dumps an Object (obj) to a string.
+ * @param [Object] obj Object to serialize as an JSON document String
+ * @param [Hash] options changes to the options the Encoder was created with
+ */
+static VALUE
+encoder_dump(int argc, VALUE *argv, VALUE self) {
+    Encoder		e = (Encoder)DATA_PTR(self);
+    struct _Options	copts = e->opts;
+    VALUE		rstr;
+
+    if (1 > argc) {
+	rb_raise(rb_eArgError, "wrong number of arguments (0 for 1).");
+    }
+    if (2 == argc) {
+	oj_parse_options(argv[1], &copts);
+    }
+    if (e->busy) {
+	char		buf[4096];
+	struct _Out	out;
+
+	out.buf = buf;
+	out.end = buf + sizeof(buf) - 10;
+	out.allocated = 0;
+	oj_dump_obj_to_json(*argv, &copts, &out);
+	rstr = rb_str_new(out.buf, out.cur - out.buf);
+	if (out.allocated) {
+	    xfree(out.buf);
+	}
+    } else {
+	encoder_encode(e, *argv, &copts, Qnil);
+	rstr = rb_str_new(e->out.buf, e->out.cur - e->out.buf);
+    }
+    return oj_encode(rstr);
+}
+
+/* call-seq: to_stream(io, obj, options)
+ *
+ * Dumps an Object to the specified IO stream or file descriptor. If the IO has
+ * a file descriptor the JSON is written to it directly, as with Oj.to_stream().
+ * @param [IO|Fixnum] io IO stream or file descriptor to write the JSON document to
+ * @param [Object] obj Object to serialize as an JSON document String
+ * @param [Hash] options changes to the options the Encoder was created with
+ */
+static VALUE
+encoder_to_stream(int argc, VALUE *argv, VALUE self) {
+    Encoder		e = (Encoder)DATA_PTR(self);
+    struct _Options	copts = e->opts;
+
+    if (2 > argc) {
+	rb_raise(rb_eArgError, "wrong number of arguments (%d for 2).", argc);
+    }
+    if (3 == argc) {
+	oj_parse_options(argv[2], &copts);
+    }
+    if (e->busy) {
+	char		buf[4096];
+	struct _Out	out;
+
+	out.buf = buf;
+	out.end = buf + sizeof(buf) - 10;
+	out.allocated = 0;
+	oj_dump_obj_to_json(argv[1], &copts, &out);
+	encoder_write(out.buf, out.cur - out.buf, *argv);
+	if (out.allocated) {
+	    xfree(out.buf);
+	}
+    } else {
+	encoder_encode(e, argv[1], &copts, *argv);
+    }
+    return Qnil;
+}
+
+/* call-seq: stats() => Hash
+ *
+ * Returns statistics for the buffer. Of the :dumps so far, :reused is how many
+ * fit in the buffer as it was and :grown is how many had to make it larger.
+ * The buffer has been made smaller :shrunk times. It is currently :capacity bytes and the last document
+ * was :last_size bytes.
+ * @return [Hash] buffer statistics
+ */
+static VALUE
+encoder_stats(VALUE self) {
+    Encoder	e = (Encoder)DATA_PTR(self);
+    VALUE	stats = rb_hash_new();
+
+    rb_hash_aset(stats, ID2SYM(rb_intern("dumps")), ULONG2NUM(e->dumps));
+    rb_hash_aset(stats, ID2SYM(rb_intern("reused")), ULONG2NUM(e->reuses));
+    rb_hash_aset(stats, ID2SYM(rb_intern("grown")), ULONG2NUM(e->grows));
+    rb_hash_aset(stats, ID2SYM(rb_intern("shrunk")), ULONG2NUM(e->shrinks));
+    rb_hash_aset(stats, ID2SYM(rb_intern("capacity")), ULONG2NUM(e->out.end - e->out.buf));
+    rb_hash_aset(stats, ID2SYM(rb_intern("last_size")), ULONG2NUM(e->last_size));
+
+    return stats;
+}
+
 // Mimic JSON section
 
 static VALUE
@@ -1845,6 +2143,8 @@ static struct _Options	mimic_object_to_json_options = {
     Yes,	// nilnil
     Yes,	// allow_gc
     Yes,	// quirks_mode
+    Yes,	// simd
+    Yes,	// cache_keys
     json_class,	// create_id
     10,		// create_id_len
     9,		// sec_prec
@@ -2058,6 +2358,12 @@ void Init_oj() {
     rb_define_method(oj_stream_writer_class, "pop", stream_writer_pop, 0);
     rb_define_method(oj_stream_writer_class, "pop_all", stream_writer_pop_all, 0);
 
+    oj_encoder_class = rb_define_class_under(Oj, "Encoder", rb_cObject);
+    rb_define_module_function(oj_encoder_class, "new", encoder_new, -1);
+    rb_define_method(oj_encoder_class, "dump", encoder_dump, -1);
+    rb_define_method(oj_encoder_class, "to_stream", encoder_to_stream, -1);
+    rb_define_method(oj_encoder_class, "stats", encoder_stats, 0);
+
     rb_require("time");
     rb_require("date");
     // On Rubinius the require fails but can be done from a ruby file.
@@ -2078,6 +2384,7 @@ void Init_oj() {
 
     rb_define_module_function(Oj, "default_options", get_def_opts, 0);
     rb_define_module_function(Oj, "default_options=", set_def_opts, 1);
+    rb_define_module_function(Oj, "key_cache_stats", key_cache_stats, 0);
 
     rb_define_module_function(Oj, "mimic_JSON", define_mimic_json, -1);
     rb_define_module_function(Oj, "load", load, -1);
@@ -2158,6 +2465,7 @@ void Init_oj() {
     auto_sym = ID2SYM(rb_intern("auto"));		rb_gc_register_address(&auto_sym);
     bigdecimal_as_decimal_sym = ID2SYM(rb_intern("bigdecimal_as_decimal"));rb_gc_register_address(&bigdecimal_as_decimal_sym);
     bigdecimal_load_sym = ID2SYM(rb_intern("bigdecimal_load"));rb_gc_register_address(&bigdecimal_load_sym);
+    cache_keys_sym = ID2SYM(rb_intern("cache_keys"));	rb_gc_register_address(&cache_keys_sym);
     bigdecimal_sym = ID2SYM(rb_intern("bigdecimal"));	rb_gc_register_address(&bigdecimal_sym);
     circular_sym = ID2SYM(rb_intern("circular"));	rb_gc_register_address(&circular_sym);
     class_cache_sym = ID2SYM(rb_intern("class_cache"));	rb_gc_register_address(&class_cache_sym);
@@ -2180,6 +2488,7 @@ void Init_oj() {
     raise_sym = ID2SYM(rb_intern("raise"));		rb_gc_register_address(&raise_sym);
     ruby_sym = ID2SYM(rb_intern("ruby"));		rb_gc_register_address(&ruby_sym);
     sec_prec_sym = ID2SYM(rb_intern("second_precision"));rb_gc_register_address(&sec_prec_sym);
+    simd_sym = ID2SYM(rb_intern("simd"));		rb_gc_register_address(&simd_sym);
     space_before_sym = ID2SYM(rb_intern("space_before"));rb_gc_register_address(&space_before_sym);
     space_sym = ID2SYM(rb_intern("space"));		rb_gc_register_address(&space_sym);
     strict_sym = ID2SYM(rb_intern("strict"));		rb_gc_register_address(&strict_sym);
@@ -2198,6 +2507,7 @@ void Init_oj() {
 
     oj_hash_init();
     oj_odd_init();
+    oj_scan_init();
 
 #if USE_PTHREAD_MUTEX
     pthread_mutex_init(&oj_cache_mutex, 0);
@@ -156,6 +156,8 @@ typedef struct _Options {
     char		nilnil;		// YesNo
     char		allow_gc;	// allow GC during parse
     char		quirks_mode;	// allow single JSON values instead of documents
+    char		simd;		// YesNo, use the vectorized scanner when parsing
+    char		cache_keys;	// YesNo, reuse frozen Strings for hash keys when parsing
     const char		*create_id;	// 0 or string
     size_t		create_id_len;	// length of create_id
     int			sec_prec;	// second precision when dumping time
@@ -193,6 +195,19 @@ typedef struct _StreamWriter {
     int			fd;
 } *StreamWriter;
 
+typedef struct _Encoder {
+    struct _Out		out;
+    struct _Options	opts;
+    int			busy;		// dumping into out now
+    int			window_cnt;	// dumps since the buffer size was last checked
+    size_t		window_max;	// largest document in the window
+    size_t		last_size;
+    unsigned long	dumps;
+    unsigned long	reuses;		// dumps that fit without growing the buffer
+    unsigned long	grows;
+    unsigned long	shrinks;
+} *Encoder;
+
 enum {
     NO_VAL   = 0x00,
     STR_VAL  = 0x01,
@@ -260,6 +275,7 @@ extern VALUE	oj_bigdecimal_class;
 extern VALUE	oj_cstack_class;
 extern VALUE	oj_date_class;
 extern VALUE	oj_datetime_class;
+extern VALUE	oj_encoder_class;
 extern VALUE	oj_doc_class;
 extern VALUE	oj_stream_writer_class;
 extern VALUE	oj_string_writer_class;
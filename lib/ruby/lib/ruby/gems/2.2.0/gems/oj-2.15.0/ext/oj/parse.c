@@ -38,6 +38,9 @@
 #include "parse.h"
 #include "buf.h"
 #include "val_stack.h"
+#include "scan.h"
+#include "hash.h"
+#include "encode.h"
 
 // Workaround in case INFINITY is not defined in math.h or if the OS is CentOS
 #define OJ_INFINITY	(1.0/0.0)
@@ -51,19 +54,31 @@
 #define EXP_MAX		100000
 #define DEC_MAX		15
 
+inline static const char*
+scan_str(ParseInfo pi, const char *s) {
+    if (Yes == pi->options.simd) {
+	return oj_scan_str(s, pi->end);
+    }
+    return oj_scan_str_scalar(s, pi->end);
+}
+
 static void
 next_non_white(ParseInfo pi) {
-    for (; 1; pi->cur++) {
-	switch(*pi->cur) {
-	case ' ':
-	case '\t':
-	case '\f':
-	case '\n':
-	case '\r':
-	    break;
-	default:
-	    return;
-	}
+    switch(*pi->cur) {
+    case ' ':
+    case '\t':
+    case '\f':
+    case '\n':
+    case '\r':
+	break;
+    default:
+	// Compact JSON rarely has any white space so don't bother scanning.
+	return;
+    }
+    if (Yes == pi->options.simd) {
+	pi->cur = oj_scan_white(pi->cur + 1, pi->end);
+    } else {
+	pi->cur = oj_scan_white_scalar(pi->cur + 1, pi->end);
     }
 }
 
@@ -282,7 +297,11 @@ read_escaped_str(ParseInfo pi, const char *start) {
 		return;
 	    }
 	} else {
-	    buf_append(&buf, *s);
+	    // Copy everything up to the next quote or escape at once.
+	    const char	*e = scan_str(pi, s + 1);
+
+	    buf_append_string(&buf, s, e - s);
+	    s = e - 1;
 	}
     }
     if (0 == parent) {
@@ -332,17 +351,16 @@ read_str(ParseInfo pi) {
     const char	*str = pi->cur;
     Val		parent = stack_peek(&pi->stack);
 
-    for (; '"' != *pi->cur; pi->cur++) {
-	if (pi->end <= pi->cur) {
-	    oj_set_error_at(pi, oj_parse_error_class, __FILE__, __LINE__, "quoted string not terminated");
-	    return;
-	} else if ('\0' == *pi->cur) {
-	    oj_set_error_at(pi, oj_parse_error_class, __FILE__, __LINE__, "NULL byte in string");
-	    return;
-	} else if ('\\' == *pi->cur) {
-	    read_escaped_str(pi, str);
-	    return;
-	}
+    pi->cur = scan_str(pi, pi->cur);
+    if (pi->end <= pi->cur) {
+	oj_set_error_at(pi, oj_parse_error_class, __FILE__, __LINE__, "quoted string not terminated");
+	return;
+    } else if ('\0' == *pi->cur) {
+	oj_set_error_at(pi, oj_parse_error_class, __FILE__, __LINE__, "NULL byte in string");
+	return;
+    } else if ('\\' == *pi->cur) {
+	read_escaped_str(pi, str);
+	return;
     }
     if (0 == parent) { // simple add
 	pi->add_cstr(pi, str, pi->cur - str, str);
@@ -762,6 +780,26 @@ oj_num_as_value(NumInfo ni) {
     return rnum;
 }
 
+VALUE
+oj_key_str(ParseInfo pi, const char *key, size_t klen) {
+    volatile VALUE	rkey;
+
+    if (Yes == pi->options.cache_keys && OJ_KEY_CACHE_MAX >= klen) {
+	int	hit;
+
+	rkey = oj_key_cache_get(key, klen, &hit);
+	if (hit) {
+	    pi->key_hits++;
+	} else {
+	    pi->key_misses++;
+	}
+	return rkey;
+    }
+    rkey = rb_str_new(key, klen);
+
+    return oj_encode(rkey);
+}
+
 void
 oj_set_error_at(ParseInfo pi, VALUE err_clas, const char* file, int line, const char *format, ...) {
     va_list	ap;
@@ -816,6 +854,8 @@ oj_pi_parse(int argc, VALUE *argv, ParseInfo pi, char *json, size_t len, int yie
     if (2 == argc) {
 	oj_parse_options(argv[1], &pi->options);
     }
+    pi->key_hits = 0;
+    pi->key_misses = 0;
     if (yieldOk && rb_block_given_p()) {
 	pi->proc = Qnil;
     } else {
@@ -917,6 +957,10 @@ oj_pi_parse(int argc, VALUE *argv, ParseInfo pi, char *json, size_t len, int yie
 	xfree(json);
     }
     stack_cleanup(&pi->stack);
+    // only strict and compat mode keys go through the cache
+    if (0 < pi->key_hits + pi->key_misses) {
+	oj_key_cache_record(pi->key_hits, pi->key_misses);
+    }
     if (0 != line) {
 	rb_jump_tag(line);
     }
@@ -89,12 +89,15 @@ typedef struct _ParseInfo {
     void		(*add_num)(struct _ParseInfo *pi, NumInfo ni);
     void		(*add_value)(struct _ParseInfo *pi, VALUE val);
     VALUE		err_class;
+    size_t		key_hits;	// key cache use for this parse
+    size_t		key_misses;
 } *ParseInfo;
 
 extern void	oj_parse2(ParseInfo pi);
 extern void	oj_set_error_at(ParseInfo pi, VALUE err_clas, const char* file, int line, const char *format, ...);
 extern VALUE	oj_pi_parse(int argc, VALUE *argv, ParseInfo pi, char *json, size_t len, int yieldOk);
 extern VALUE	oj_num_as_value(NumInfo ni);
+extern VALUE	oj_key_str(ParseInfo pi, const char *key, size_t klen);
 
 extern void	oj_set_strict_callbacks(ParseInfo pi);
 extern void	oj_set_object_callbacks(ParseInfo pi);
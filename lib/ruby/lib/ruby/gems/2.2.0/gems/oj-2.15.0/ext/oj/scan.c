@@ -0,0 +1,171 @@
+/* scan.c
+ * Copyright (c) 2016, Peter Ohler
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *  - Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ *  - Neither the name of Peter Ohler nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+
+#include "scan.h"
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#define USE_SSE2	1
+#include <emmintrin.h>
+#else
+#define USE_SSE2	0
+#endif
+
+#if USE_SSE2 && HAS_AVX2
+#include <immintrin.h>
+#endif
+
+static const char*
+scan_str(const char *s, const char *end) {
+    return oj_scan_str_scalar(s, end);
+}
+
+static const char*
+scan_white(const char *s, const char *end) {
+    return oj_scan_white_scalar(s, end);
+}
+
+ScanFunc	oj_scan_str = scan_str;
+ScanFunc	oj_scan_white = scan_white;
+
+#if USE_SSE2
+// Each block of 16 bytes is compared against every character of interest and
+// the results collapsed into a bit mask, one bit per byte. The lowest set bit
+// is the first match.
+static const char*
+scan_str_sse2(const char *s, const char *end) {
+    const __m128i	quote = _mm_set1_epi8('"');
+    const __m128i	escape = _mm_set1_epi8('\\');
+    const __m128i	zero = _mm_setzero_si128();
+    __m128i		v;
+    int			mask;
+
+    for (; s + 16 <= end; s += 16) {
+	v = _mm_loadu_si128((const __m128i*)s);
+	mask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote),
+							   _mm_cmpeq_epi8(v, escape)),
+					      _mm_cmpeq_epi8(v, zero)));
+	if (0 != mask) {
+	    return s + __builtin_ctz(mask);
+	}
+    }
+    return oj_scan_str_scalar(s, end);
+}
+
+static const char*
+scan_white_sse2(const char *s, const char *end) {
+    const __m128i	space = _mm_set1_epi8(' ');
+    const __m128i	tab = _mm_set1_epi8('\t');
+    const __m128i	ff = _mm_set1_epi8('\f');
+    const __m128i	nl = _mm_set1_epi8('\n');
+    const __m128i	cr = _mm_set1_epi8('\r');
+    __m128i		v;
+    int			mask;
+
+    for (; s + 16 <= end; s += 16) {
+	v = _mm_loadu_si128((const __m128i*)s);
+	mask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, space),
+									 _mm_cmpeq_epi8(v, tab)),
+							   _mm_or_si128(_mm_cmpeq_epi8(v, nl),
+									_mm_cmpeq_epi8(v, cr))),
+					      _mm_cmpeq_epi8(v, ff)));
+	if (0xFFFF != mask) {
+	    return s + __builtin_ctz(~mask);
+	}
+    }
+    return oj_scan_white_scalar(s, end);
+}
+#endif
+
+#if USE_SSE2 && HAS_AVX2
+// Same as the SSE2 versions but 32 bytes at a time. Only used if the CPU
+// reports AVX2 support at run time.
+__attribute__((target("avx2")))
+static const char*
+scan_str_avx2(const char *s, const char *end) {
+    const __m256i	quote = _mm256_set1_epi8('"');
+    const __m256i	escape = _mm256_set1_epi8('\\');
+    const __m256i	zero = _mm256_setzero_si256();
+    __m256i		v;
+    uint32_t		mask;
+
+    for (; s + 32 <= end; s += 32) {
+	v = _mm256_loadu_si256((const __m256i*)s);
+	mask = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote),
+									      _mm256_cmpeq_epi8(v, escape)),
+							      _mm256_cmpeq_epi8(v, zero)));
+	if (0 != mask) {
+	    return s + __builtin_ctz(mask);
+	}
+    }
+    return scan_str_sse2(s, end);
+}
+
+__attribute__((target("avx2")))
+static const char*
+scan_white_avx2(const char *s, const char *end) {
+    const __m256i	space = _mm256_set1_epi8(' ');
+    const __m256i	tab = _mm256_set1_epi8('\t');
+    const __m256i	ff = _mm256_set1_epi8('\f');
+    const __m256i	nl = _mm256_set1_epi8('\n');
+    const __m256i	cr = _mm256_set1_epi8('\r');
+    __m256i		v;
+    uint32_t		mask;
+
+    for (; s + 32 <= end; s += 32) {
+	v = _mm256_loadu_si256((const __m256i*)s);
+	mask = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, space),
+											       _mm256_cmpeq_epi8(v, tab)),
+									      _mm256_or_si256(_mm256_cmpeq_epi8(v, nl),
+											      _mm256_cmpeq_epi8(v, cr))),
+							      _mm256_cmpeq_epi8(v, ff)));
+	if (0xFFFFFFFF != mask) {
+	    return s + __builtin_ctz(~mask);
+	}
+    }
+    return scan_white_sse2(s, end);
+}
+#endif
+
+void
+oj_scan_init() {
+#if USE_SSE2
+    oj_scan_str = scan_str_sse2;
+    oj_scan_white = scan_white_sse2;
+#if HAS_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+	oj_scan_str = scan_str_avx2;
+	oj_scan_white = scan_white_avx2;
+    }
+#endif
+#endif
+}
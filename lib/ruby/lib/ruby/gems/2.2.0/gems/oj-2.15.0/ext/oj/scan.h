@@ -0,0 +1,79 @@
+/* scan.h
+ * Copyright (c) 2016, Peter Ohler
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *  - Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ *  - Neither the name of Peter Ohler nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __OJ_SCAN_H__
+#define __OJ_SCAN_H__
+
+// The scanners skip over the parts of a JSON document that need no more than
+// a look at each byte. oj_scan_str stops on a '"', '\\', or '\0' and
+// oj_scan_white stops on anything other than JSON white space. Both stop at
+// end if nothing is found. The vectorized versions are picked in
+// oj_scan_init() based on what the CPU supports.
+
+typedef const char*	(*ScanFunc)(const char *s, const char *end);
+
+extern ScanFunc	oj_scan_str;
+extern ScanFunc	oj_scan_white;
+
+extern void	oj_scan_init(void);
+
+inline static const char*
+oj_scan_str_scalar(const char *s, const char *end) {
+    for (; s < end; s++) {
+	switch (*s) {
+	case '"':
+	case '\\':
+	case '\0':
+	    return s;
+	default:
+	    break;
+	}
+    }
+    return end;
+}
+
+inline static const char*
+oj_scan_white_scalar(const char *s, const char *end) {
+    for (; s < end; s++) {
+	switch (*s) {
+	case ' ':
+	case '\t':
+	case '\f':
+	case '\n':
+	case '\r':
+	    break;
+	default:
+	    return s;
+	}
+    }
+    return end;
+}
+
+#endif /* __OJ_SCAN_H__ */
@@ -755,6 +755,8 @@ oj_pi_sparse(int argc, VALUE *argv, ParseInfo pi, int fd) {
     if (2 == argc) {
 	oj_parse_options(argv[1], &pi->options);
     }
+    pi->key_hits = 0;
+    pi->key_misses = 0;
     if (Qnil == input && Yes == pi->options.nilnil) {
 	return Qnil;
     }
@@ -816,6 +818,10 @@ oj_pi_sparse(int argc, VALUE *argv, ParseInfo pi, int fd) {
     if (0 != fd) {
 	close(fd);
     }
+    // only strict and compat mode keys go through the cache
+    if (0 < pi->key_hits + pi->key_misses) {
+	oj_key_cache_record(pi->key_hits, pi->key_misses);
+    }
     if (0 != line) {
 	rb_jump_tag(line);
     }
@@ -78,9 +78,10 @@ calc_hash_key(ParseInfo pi, Val parent) {
     volatile VALUE	rkey = parent->key_val;
 
     if (Qundef == rkey) {
-	rkey = rb_str_new(parent->key, parent->klen);
+	rkey = oj_key_str(pi, parent->key, parent->klen);
+    } else {
+	rkey = oj_encode(rkey);
     }
-    rkey = oj_encode(rkey);
     if (Yes == pi->options.sym_key) {
 	rkey = rb_str_intern(rkey);
     }
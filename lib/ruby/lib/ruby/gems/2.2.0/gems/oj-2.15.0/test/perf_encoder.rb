@@ -0,0 +1,58 @@
+#!/usr/bin/env ruby -wW1
+# encoding: UTF-8
+
+$: << '.'
+$: << File.join(File.dirname(__FILE__), "../lib")
+$: << File.join(File.dirname(__FILE__), "../ext")
+
+require 'optparse'
+require 'perf'
+require 'oj'
+
+$iter = 5000
+$size = 200
+
+opts = OptionParser.new
+opts.on("-c", "--count [Int]", Integer, "iterations")          { |i| $iter = i }
+opts.on("-s", "--size [Int]", Integer, "requests per batch")    { |i| $size = i }
+opts.on("-h", "--help", "Show this display")                   { puts opts; Process.exit!(0) }
+files = opts.parse(ARGV)
+
+# A batch of request statistics, dumped over and over with small changes like
+# a metrics reporter would.
+$obj = {
+  'hostname' => 'app-01',
+  'timestamp' => 1467053563,
+  'requests' => (0...$size).map { |i|
+    { 'path' => "/api/v1/items/#{i}", 'status' => 200, 'duration' => 0.0125 * i, 'bytes' => 1024 + i }
+  },
+}
+
+Oj.default_options = { :mode => :strict }
+$encoder = Oj::Encoder.new(:mode => :strict)
+raise "Encoder did not dump the same as Oj.dump" unless Oj.dump($obj) == $encoder.dump($obj)
+
+def allocated
+  GC.start
+  before = GC.stat[:total_allocated_objects]
+  100.times { yield }
+  (GC.stat[:total_allocated_objects] - before) / 100.0
+end
+
+$null = File.open(File::NULL, 'w')
+
+puts '-' * 80
+puts "Encoder Performance on #{$size} requests, #{Oj.dump($obj).size} bytes"
+puts "Objects allocated per dump with Oj.dump: #{allocated { Oj.dump($obj) }}, Encoder#dump: #{allocated { $encoder.dump($obj) }}"
+puts "Objects allocated per write with Oj.to_stream: #{allocated { Oj.to_stream($null, $obj) }}, Encoder#to_stream: #{allocated { $encoder.to_stream($null, $obj) }}"
+perf = Perf.new()
+perf.add('Oj', 'dump') { Oj.dump($obj) }
+perf.add('Oj::Encoder', 'dump') { $encoder.dump($obj) }
+perf.add('Oj', 'to_stream') { Oj.to_stream($null, $obj) }
+perf.add('Oj::Encoder', 'to_stream') { $encoder.to_stream($null, $obj) }
+perf.run($iter)
+puts "Encoder: #{$encoder.stats}"
+
+puts
+puts '-' * 80
+puts
@@ -0,0 +1,57 @@
+#!/usr/bin/env ruby -wW1
+# encoding: UTF-8
+
+$: << '.'
+$: << File.join(File.dirname(__FILE__), "../lib")
+$: << File.join(File.dirname(__FILE__), "../ext")
+
+require 'optparse'
+require 'perf'
+require 'oj'
+require 'json'
+
+$iter = 10000
+$size = 100
+
+opts = OptionParser.new
+opts.on("-c", "--count [Int]", Integer, "iterations")          { |i| $iter = i }
+opts.on("-s", "--size [Int]", Integer, "centroids per histogram") { |i| $size = i }
+opts.on("-h", "--help", "Show this display")                   { puts opts; Process.exit!(0) }
+files = opts.parse(ARGV)
+
+# A host stats report, mostly computed floats such as load averages, CPU
+# usage deltas, and the centroids of a latency histogram.
+rand = Random.new(1467053563)
+$obj = {
+  'hostname' => 'app-01',
+  'timestamp' => 1467053563.121,
+  'loadavg' => [0.52, 0.58, 0.59],
+  'cpu' => {
+    'user' => rand.rand * 100,
+    'system' => rand.rand * 10,
+    'idle' => rand.rand * 100,
+    'iowait' => rand.rand,
+  },
+  'latency_histogram' => (0...$size).map { |i|
+    { 'mean' => (i + rand.rand) * 1.7, 'count' => 1 + rand.rand(50) }
+  },
+  'requests_per_second' => rand.rand(100000) / 100.0,
+  'memory_used' => 0.7 * 17179869184,
+}
+
+[0, 15].each do |prec|
+  json = Oj.dump($obj, :mode => :compat, :float_precision => prec)
+  raise "float_precision #{prec} did not dump the same as JSON" unless 0 != prec || JSON.generate($obj) == json
+end
+
+puts '-' * 80
+puts "Float Dump Performance, #{$size} centroids"
+perf = Perf.new()
+perf.add('Oj:prec 0', 'dump') { Oj.dump($obj, :mode => :compat, :float_precision => 0) }
+perf.add('Oj:prec 15', 'dump') { Oj.dump($obj, :mode => :compat, :float_precision => 15) }
+perf.add('JSON::Ext', 'generate') { JSON.generate($obj) }
+perf.run($iter)
+
+puts
+puts '-' * 80
+puts
@@ -0,0 +1,58 @@
+#!/usr/bin/env ruby -wW1
+# encoding: UTF-8
+
+$: << '.'
+$: << File.join(File.dirname(__FILE__), "../lib")
+$: << File.join(File.dirname(__FILE__), "../ext")
+
+require 'optparse'
+require 'perf'
+require 'oj'
+
+$iter = 1000
+$size = 100
+
+opts = OptionParser.new
+opts.on("-c", "--count [Int]", Integer, "iterations")       { |i| $iter = i }
+opts.on("-s", "--size [Int]", Integer, "objects per array") { |i| $size = i }
+opts.on("-h", "--help", "Show this display")                { puts opts; Process.exit!(0) }
+files = opts.parse(ARGV)
+
+# An array of objects that all have the same keys, like a batch of queue
+# messages.
+$obj = (0...$size).map { |i|
+  {
+    'MessageId' => "5fea7756-0ea4-451a-a703-a558b933e2#{'%02d' % (i % 100)}",
+    'ReceiptHandle' => 'MbZj6wDWli+JvwwJaBV+3dcjk2YW2vA3+STFFljTM8tJJg6HRG6PYSasuWXPJB+CwLj1FjgXUv1uSj1gUPAWV66FU',
+    'MD5OfBody' => 'fafb00f5732ab283681e124bf8747ed1',
+    'Body' => "message #{i}",
+    'Attributes' => {
+      'SenderId' => 'AIDAIENQZJOLO23YVJ4VO',
+      'ApproximateReceiveCount' => i % 3 + 1,
+      'SentTimestamp' => 1467053563121 + i,
+    },
+  }
+}
+$json = Oj.dump($obj, :mode => :strict)
+
+Oj.default_options = { :mode => :strict }
+
+def allocated(cache_keys)
+  GC.start
+  before = GC.stat[:total_allocated_objects]
+  Oj.strict_load($json, :cache_keys => cache_keys)
+  GC.stat[:total_allocated_objects] - before
+end
+
+puts '-' * 80
+puts "Key Cache Performance on #{$size} objects, #{$json.size} bytes"
+puts "Objects allocated per load with the key cache: #{allocated(true)}, without: #{allocated(false)}"
+perf = Perf.new()
+perf.add('Oj:cache_keys', 'strict_load') { Oj.strict_load($json, :cache_keys => true) }
+perf.add('Oj:no_cache', 'strict_load') { Oj.strict_load($json, :cache_keys => false) }
+perf.run($iter)
+puts "Key cache: #{Oj.key_cache_stats}"
+
+puts
+puts '-' * 80
+puts
@@ -0,0 +1,96 @@
+#!/usr/bin/env ruby -wW1
+# encoding: UTF-8
+
+$: << '.'
+$: << File.join(File.dirname(__FILE__), "../lib")
+$: << File.join(File.dirname(__FILE__), "../ext")
+
+require 'optparse'
+require 'perf'
+require 'oj'
+
+$iter = 20000
+$indent = 0
+$size = 10
+
+opts = OptionParser.new
+opts.on("-c", "--count [Int]", Integer, "iterations")       { |i| $iter = i }
+opts.on("-i", "--indent [Int]", Integer, "indentation")     { |i| $indent = i }
+opts.on("-s", "--size [Int]", Integer, "messages per batch") { |i| $size = i }
+opts.on("-h", "--help", "Show this display")                { puts opts; Process.exit!(0) }
+files = opts.parse(ARGV)
+
+# A queue receive response carrying notifications. The body of each message is
+# itself JSON encoded as a string, as is the notification message inside it,
+# so most of the document is long strings with escapes in them.
+def message(i)
+  event = {
+    'eventVersion' => '2.0',
+    'eventSource' => 'aws:s3',
+    'eventTime' => '2016-06-27T18:52:43.121Z',
+    'eventName' => 'ObjectCreated:Put',
+    'requestParameters' => { 'sourceIPAddress' => '10.12.113.87' },
+    'responseElements' => {
+      'x-amz-request-id' => 'C3D13FE58DE4C810',
+      'x-amz-id-2' => 'FMyUVURIY8/IgAtTv8xRjskZQpcIZ9KG4V5Wp6S7S/JRWeUWerMUE5JgHvANOjpD',
+    },
+    's3' => {
+      's3SchemaVersion' => '1.0',
+      'configurationId' => 'uploads',
+      'bucket' => { 'name' => 'media-uploads', 'arn' => 'arn:aws:s3:::media-uploads' },
+      'object' => {
+        'key' => "incoming/2016/06/27/#{i}/photo %28copy%29.jpg",
+        'size' => 1048576 + i,
+        'eTag' => 'd41d8cd98f00b204e9800998ecf8427e',
+        'sequencer' => '0055AED6DCD90281E5',
+      },
+    },
+  }
+  notification = {
+    'Type' => 'Notification',
+    'MessageId' => "22b80b92-fdea-4c2c-8f9d-bdfb0c7bf3#{'%02d' % (i % 100)}",
+    'TopicArn' => 'arn:aws:sns:us-east-1:123456789012:uploads',
+    'Subject' => 'Amazon S3 Notification',
+    'Message' => Oj.dump({ 'Records' => [event] }, :mode => :strict),
+    'Timestamp' => '2016-06-27T18:52:43.198Z',
+    'SignatureVersion' => '1',
+    'Signature' => 'EXAMPLElDMXvB8r9R83tGoNn0ecwd5UjllzsvSvbItzfaMpN2nk5HVSw7XnOn/49IkxDKz8YrlH2qJXj2iZB0Zo2O71c4qQk1fMUDi3LGpij7RCW7AW9vYYsSqIKRnFS94ilu7NFhUzLiieYr4BKHpdTmdD6c0esg=',
+    'SigningCertURL' => 'https://sns.us-east-1.amazonaws.com/SimpleNotificationService-f3ecfb7224c7233fe7bb5f59f96de52f.pem',
+    'UnsubscribeURL' => 'https://sns.us-east-1.amazonaws.com/?Action=Unsubscribe&SubscriptionArn=arn:aws:sns:us-east-1:123456789012:uploads:2bcfbf39-05c3-41de-beaa-fcfcc21c8f55',
+  }
+  body = Oj.dump(notification, :mode => :strict)
+  {
+    'MessageId' => "5fea7756-0ea4-451a-a703-a558b933e2#{'%02d' % (i % 100)}",
+    'ReceiptHandle' => 'MbZj6wDWli+JvwwJaBV+3dcjk2YW2vA3+STFFljTM8tJJg6HRG6PYSasuWXPJB+CwLj1FjgXUv1uSj1gUPAWV66FU/WeR4mq2OKpEGYWbnLmpRCJVAyeMjeU5ZBdtcQ+QEauMZc8ZRv37sIW2iJKq3M9MFx1YvV11A2x/KSbkJ0=' * 2,
+    'MD5OfBody' => 'fafb00f5732ab283681e124bf8747ed1',
+    'Body' => body,
+    'Attributes' => {
+      'SenderId' => 'AIDAIENQZJOLO23YVJ4VO',
+      'ApproximateFirstReceiveTimestamp' => '1467053563198',
+      'ApproximateReceiveCount' => '1',
+      'SentTimestamp' => '1467053563121',
+    },
+  }
+end
+
+$obj = { 'Messages' => (0...$size).map { |i| message(i) } }
+$json = Oj.dump($obj, :mode => :strict, :indent => $indent)
+
+Oj.default_options = { :mode => :strict }
+
+[true, false].each do |simd|
+  raise "simd #{simd} did not load the same object" unless $obj == Oj.strict_load($json, :simd => simd)
+end
+
+puts '-' * 80
+puts "Scan Performance on #{$size} messages, #{$json.size} bytes"
+perf = Perf.new()
+perf.add('Oj:simd', 'strict_load') { Oj.strict_load($json, :simd => true) }
+perf.add('Oj:scalar', 'strict_load') { Oj.strict_load($json, :simd => false) }
+perf.add('Oj:compat simd', 'compat_load') { Oj.compat_load($json, :simd => true) }
+perf.add('Oj:compat scalar', 'compat_load') { Oj.compat_load($json, :simd => false) }
+perf.run($iter)
+
+puts
+puts '-' * 80
+puts
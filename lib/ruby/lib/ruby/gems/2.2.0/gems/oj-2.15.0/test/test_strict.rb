@@ -46,6 +46,34 @@ class StrictJuice < Minitest::Test
     dump_and_load(-2.48e100 * 1.0e10, false)
   end
 
+  # Floats that don't fit in a long long dump the same as to_s with a
+  # :float_precision of 0, which always reads back as the same Float, and the
+  # same as "%0.15g" by default.
+  def test_float_round_trip
+    floats = [
+      0.1, 0.3, 1.5, 1.0e22, 1.0e23, 0.0001, 0.00001, 123456789012345.6, 1234567890123456.7,
+      2.0 ** -1022, 5e-324, 2.2250738585072014e-308, 1.7976931348623157e308, 4.35,
+      5.0e-324 * 3, 1.0 / 3, 2.0 / 3, 1.0e-5 / 3, 1.0e23 / 7,
+      # Grisu3 can't tell these are the shortest and falls back to snprintf
+      726009959711053.2, 447852216.7252343, 74998741883405.62,
+    ]
+    rand = Random.new(1467053563)
+    1000.times do
+      floats << [rand.bytes(8)].pack('a8').unpack('E')[0]
+      floats << rand.rand * 10 ** rand.rand(-20..20)
+      floats << rand.rand(100000) / 100.0
+    end
+    floats.each do |f|
+      next if f.nan? || f.infinite? || (f == f.to_i && f.abs < 2 ** 63)
+      json = Oj.dump(f, :mode => :strict, :float_precision => 0)
+      assert_equal(f.to_s, json)
+      assert_equal(f, Float(json))
+      assert_equal((-f).to_s, Oj.dump(-f, :mode => :strict, :float_precision => 0))
+      assert_equal('%0.15g' % [f], Oj.dump(f, :mode => :strict))
+      assert_equal('%0.10g' % [f], Oj.dump(f, :mode => :strict, :float_precision => 10))
+    end
+  end
+
   def test_string
     dump_and_load('', false)
     dump_and_load('abc', false)
@@ -243,6 +271,51 @@ class StrictJuice < Minitest::Test
     assert_equal([{ 'x' => 1 }, { 'y' => 2 }], results)
   end
 
+  # The vectorized scanner works on 16 or 32 bytes at a time so put the
+  # interesting characters at every offset around those boundaries.
+  def test_scan_strings
+    [true, false].each do |simd|
+      (0..70).each do |i|
+        plain = 'x' * i
+        assert_equal(plain, Oj.strict_load(%{"#{plain}"}, :simd => simd))
+        escaped = "#{plain}\"#{plain}\n#{plain}"
+        assert_equal({ escaped => [escaped] }, Oj.strict_load(Oj.dump({ escaped => [escaped] }, :mode => :strict), :simd => simd))
+        assert_raises(Oj::ParseError) { Oj.strict_load(%{["#{plain}\0"]}, :simd => simd) }
+        assert_raises(Oj::ParseError) { Oj.strict_load(%{["#{plain}}, :simd => simd) }
+      end
+    end
+  end
+
+  def test_cache_keys
+    json = %{[{"MessageId":"a","Body":"b"},{"MessageId":"c","Body":"d"}]}
+    a = Oj.strict_load(json, :cache_keys => true)
+    stats = Oj.key_cache_stats
+    assert_equal(4, stats[:last_hits] + stats[:last_misses])
+    assert(2 <= stats[:last_hits])
+    assert(a[0].keys[0].equal?(a[1].keys[0]))
+    assert(a[0].keys[0].frozen?)
+    # object mode doesn't use the cache and leaves the last stats alone
+    Oj.load(json, :mode => :object)
+    assert_equal(stats, Oj.key_cache_stats)
+    assert_equal([{ 'MessageId' => 'a', 'Body' => 'b' }, { 'MessageId' => 'c', 'Body' => 'd' }], a)
+
+    long = 'k' * 100
+    assert_equal({ long => 1 }, Oj.strict_load(%{{"#{long}":1}}, :cache_keys => true))
+    assert_equal([{ 'MessageId' => 'a', 'Body' => 'b' }, { 'MessageId' => 'c', 'Body' => 'd' }],
+                 Oj.strict_load(json, :cache_keys => false))
+    assert_equal([{ :MessageId => 'a', :Body => 'b' }, { :MessageId => 'c', :Body => 'd' }],
+                 Oj.strict_load(json, :cache_keys => true, :symbol_keys => true))
+  end
+
+  def test_scan_white
+    [true, false].each do |simd|
+      (0..70).each do |i|
+        white = " \t\r\n\f" * i
+        assert_equal({ 'a' => [1, 'b'] }, Oj.strict_load(%{#{white}{#{white}"a"#{white}:#{white}[1,#{white}"b"#{white}]#{white}}#{white}}, :simd => simd))
+      end
+    end
+  end
+
   def dump_and_load(obj, trace=false)
     json = Oj.dump(obj, :indent => 2)
     puts json if trace
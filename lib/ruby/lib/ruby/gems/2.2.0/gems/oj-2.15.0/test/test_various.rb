@@ -128,6 +128,8 @@ class Juice < Minitest::Test
       :nilnil=>true,
       :allow_gc=>false,
       :quirks_mode=>false,
+      :simd=>false,
+      :cache_keys=>false,
       :float_precision=>13,
       :mode=>:strict,
       :escape_mode=>:ascii,
@@ -289,4 +289,81 @@ class OjWriter < Minitest::Test
     assert_equal(%|{"a1":{},"a2":{"b":{}},"a3":{"a4":37}}\n|, output.string())
   end
 
+  def test_encoder_dump
+    e = Oj::Encoder.new(:mode => :strict)
+    assert_equal(%|{"a":[1,2.5,"x"]}|, e.dump({ 'a' => [1, 2.5, 'x'] }))
+    assert_equal(%|[true,null]|, e.dump([true, nil]))
+    assert_equal(%|{\n  "a":1\n}\n|, e.dump({ 'a' => 1 }, :indent => 2))
+    assert_equal(%|{"a":1}|, e.dump({ 'a' => 1 }))
+    assert_raises(TypeError) { e.dump(Object.new) }
+    assert_equal(%|[1]|, e.dump([1]))
+  end
+
+  def test_encoder_buffer_reuse
+    e = Oj::Encoder.new(:mode => :compat)
+    big = { 'a' => 'x' * 100000 }
+    assert_equal(Oj.dump(big, :mode => :compat), e.dump(big))
+    100.times { |i| assert_equal(%|{"i":#{i}}|, e.dump({ 'i' => i })) }
+    stats = e.stats
+    assert_equal(101, stats[:dumps])
+    assert_equal(1, stats[:grown])
+    assert_equal(100, stats[:reused])
+    assert_equal(1, stats[:shrunk])
+    assert(stats[:capacity] < 100000 * 4)
+    assert_equal(8, stats[:last_size])
+  end
+
+  def test_encoder_nested_dump
+    e = Oj::Encoder.new(:mode => :compat, :use_to_json => true)
+    inner = Object.new
+    inner.define_singleton_method(:to_json) { |*a| e.dump({ 'b' => 2 }) }
+    assert_equal(%|{"a":{"b":2}}|, e.dump({ 'a' => inner }))
+  end
+
+  def test_encoder_to_stream_stringio
+    e = Oj::Encoder.new(:mode => :strict)
+    output = StringIO.open("", "w+")
+    e.to_stream(output, { 'a' => 1 })
+    e.to_stream(output, [2, 3])
+    assert_equal(%|{"a":1}[2,3]|, output.string())
+  end
+
+  def test_encoder_to_stream_file
+    filename = File.join(File.dirname(__FILE__), 'open_file_test.json')
+    e = Oj::Encoder.new(:mode => :strict)
+    File.open(filename, "w") do |f|
+      e.to_stream(f, { 'a' => [1, 'x' * 10000] })
+      e.to_stream(f, [true])
+    end
+    content = File.read(filename)
+    assert_equal(%|{"a":[1,"#{'x' * 10000}"]}[true]|, content)
+  end
+
+  def test_encoder_to_stream_fd
+    filename = File.join(File.dirname(__FILE__), 'open_file_test.json')
+    e = Oj::Encoder.new(:mode => :strict)
+    File.open(filename, "w") do |f|
+      e.to_stream(f.fileno, { 'a' => [1, 'x' * 10000] })
+      e.to_stream(f.fileno, [true])
+    end
+    content = File.read(filename)
+    assert_equal(%|{"a":[1,"#{'x' * 10000}"]}[true]|, content)
+    assert_raises(ArgumentError) { e.to_stream(-1, [true]) }
+  end
+
+  # A dump from inside fileno() must not move the buffer being written.
+  def test_encoder_to_stream_dump_in_fileno
+    filename = File.join(File.dirname(__FILE__), 'open_file_test.json')
+    e = Oj::Encoder.new(:mode => :strict)
+    big = { 'b' => 'y' * 200000 }
+    nested = nil
+    File.open(filename, "w") do |f|
+      f.define_singleton_method(:fileno) { nested = e.dump(big); super() }
+      e.to_stream(f, { 'a' => 'x' * 5000 })
+    end
+    content = File.read(filename)
+    assert_equal(%|{"a":"#{'x' * 5000}"}|, content)
+    assert_equal(Oj.dump(big, :mode => :strict), nested)
+  end
+
 end # OjWriter
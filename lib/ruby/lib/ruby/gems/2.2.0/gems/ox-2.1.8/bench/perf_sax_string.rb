@@ -0,0 +1,57 @@
+#!/usr/bin/env ruby
+# Compares Ox.sax_parse on a String, a StringIO and a plain IO for large
+# SQS ReceiveMessage style responses.
+#
+#   ruby -Ilib bench/perf_sax_string.rb [size_in_kb] [iterations]
+
+$: << File.join(File.dirname(__FILE__), '../lib')
+$: << File.join(File.dirname(__FILE__), '../ext')
+
+require 'benchmark'
+require 'stringio'
+require 'ox'
+
+size = (ARGV[0] || 1024).to_i * 1024
+iter = (ARGV[1] || 50).to_i
+
+class Counter < ::Ox::Sax
+  attr_reader :count
+
+  def initialize
+    @count = 0
+  end
+
+  def start_element(name); @count += 1; end
+  def attr(name, value); end
+  def text(value); end
+end
+
+messages = []
+i = 0
+while messages.join.size < size
+  i += 1
+  messages << %{<Message><MessageId>#{'%08d' % i}-a1b2-c3d4-e5f6-0123456789ab</MessageId><ReceiptHandle>#{'AQEB' + ('x' * 300)}</ReceiptHandle><MD5OfBody>fafb00f5732ab283681e124bf8747ed1</MD5OfBody><Body>{&quot;id&quot;:#{i},&quot;event&quot;:&quot;created&quot;}</Body><Attribute><Name>SenderId</Name><Value>195004372649</Value></Attribute></Message>}
+end
+xml = %{<?xml version="1.0"?>
+<ReceiveMessageResponse xmlns="http://queue.amazonaws.com/doc/2012-11-05/"><ReceiveMessageResult>#{messages.join}</ReceiveMessageResult><ResponseMetadata><RequestId>b6633655-283d-45b4-aee4-4e84e0ae6afa</RequestId></ResponseMetadata></ReceiveMessageResponse>
+}
+
+class ReadOnly
+  def initialize(str)
+    @io = StringIO.new(str)
+  end
+
+  def read(n)
+    @io.read(n)
+  end
+end
+
+puts "#{xml.size / 1024} KB document, #{iter} iterations"
+
+opts = { :convert_special => true }
+Benchmark.bmbm(24) do |x|
+  x.report('String') { iter.times { Ox.sax_parse(Counter.new, xml, opts) } }
+  x.report('StringIO') { iter.times { Ox.sax_parse(Counter.new, StringIO.new(xml), opts) } }
+  x.report('IO#read') { iter.times { Ox.sax_parse(Counter.new, ReadOnly.new(xml), opts) } }
+  x.report('IO#read :buf_size => 64K') { iter.times { Ox.sax_parse(Counter.new, ReadOnly.new(xml), opts.merge(:buf_size => 0x10000)) } }
+end
@@ -99,6 +99,7 @@ Cache	ox_attr_cache = 0;
 
 static VALUE	auto_define_sym;
 static VALUE	auto_sym;
+static VALUE	buf_size_sym;
 static VALUE	circular_sym;
 static VALUE	convert_special_sym;
 static VALUE	effort_sym;
@@ -681,15 +682,18 @@ load_file(int argc, VALUE *argv, VALUE self) {
 
 /* call-seq: sax_parse(handler, io, options)
  *
- * Parses an IO stream or file containing an XML document. Raises an exception
- * if the XML is malformed or the classes specified are not valid.
+ * Parses an IO stream, file, or String containing an XML document. Raises an
+ * exception if the XML is malformed or the classes specified are not valid. A
+ * String (or a StringIO that has not been read from) is parsed from memory
+ * without any further reads.
  * @param [Ox::Sax] handler SAX (responds to OX::Sax methods) like handler
- * @param [IO|String] io IO Object to read from
+ * @param [IO|String] io IO Object or String to read from
  * @param [Hash] options parse options
  * @param [true|false] :convert_special flag indicating special characters like &lt; are converted
  * @param [true|false] :symbolize flag indicating the parser symbolize element and attribute names
  * @param [true|false] :smart flag indicating the parser uses hints if available (use with html)
  * @param [:skip_return|:skip_white] :skip flag indicating the parser skips \r or collpase white space into a single space. Default (skip nothing)
+ * @param [Fixnum] :buf_size initial size of the buffer IO is read into, larger values mean fewer reads. The buffer grows as needed. Default 4096, at most 16M
  */
 static VALUE
 sax_parse(int argc, VALUE *argv, VALUE self) {
@@ -699,6 +703,7 @@ sax_parse(int argc, VALUE *argv, VALUE self) {
     options.convert_special = 0;
     options.smart = 0;
     options.skip = NoSkip;
+    options.buf_size = 0;
 
     if (argc < 2) {
 	rb_raise(ox_parse_error_class, "Wrong number of arguments to sax_parse.\n");
@@ -723,6 +728,14 @@ sax_parse(int argc, VALUE *argv, VALUE self) {
 		options.skip = SpcSkip;
 	    }
 	}
+	if (Qnil != (v = rb_hash_lookup(h, buf_size_sym))) {
+	    long	size = NUM2LONG(v);
+
+	    if (0 > size) {
+		rb_raise(rb_eArgError, ":buf_size can not be negative.\n");
+	    }
+	    options.buf_size = (MAX_SAX_BUF_SIZE < size) ? MAX_SAX_BUF_SIZE : (size_t)size;
+	}
     }
     ox_sax_parse(argv[0], argv[1], &options);
 
@@ -968,6 +981,7 @@ void Init_ox() {
 
     auto_define_sym = ID2SYM(rb_intern("auto_define"));		rb_gc_register_address(&auto_define_sym);
     auto_sym = ID2SYM(rb_intern("auto"));			rb_gc_register_address(&auto_sym);
+    buf_size_sym = ID2SYM(rb_intern("buf_size"));		rb_gc_register_address(&buf_size_sym);
     circular_sym = ID2SYM(rb_intern("circular"));		rb_gc_register_address(&circular_sym);
     convert_special_sym = ID2SYM(rb_intern("convert_special")); rb_gc_register_address(&convert_special_sym);
     effort_sym = ID2SYM(rb_intern("effort"));			rb_gc_register_address(&effort_sym);
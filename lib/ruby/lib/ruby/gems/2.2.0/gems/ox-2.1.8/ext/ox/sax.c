@@ -168,7 +168,7 @@ ox_sax_parse(VALUE handler, VALUE io, SaxOptions options) {
 
 static void
 sax_drive_init(SaxDrive dr, VALUE handler, VALUE io, SaxOptions options) {
-    ox_sax_buf_init(&dr->buf, io);
+    ox_sax_buf_init(&dr->buf, io, options->buf_size);
     dr->buf.dr = dr;
     stack_init(&dr->stack);
     dr->handler = handler;
@@ -183,7 +183,9 @@ sax_drive_init(SaxDrive dr, VALUE handler, VALUE io, SaxOptions options) {
 	VALUE	encoding;
 
 	dr->encoding = 0;
-	if (rb_respond_to(io, ox_external_encoding_id) && Qnil != (encoding = rb_funcall(io, ox_external_encoding_id, 0))) {
+	if (T_STRING == rb_type(io)) {
+	    dr->encoding = rb_enc_get(io);
+	} else if (rb_respond_to(io, ox_external_encoding_id) && Qnil != (encoding = rb_funcall(io, ox_external_encoding_id, 0))) {
 	    int	e = rb_enc_get_index(encoding);
 	    if (0 <= e) {
 		dr->encoding = rb_enc_from_index(e);
@@ -196,6 +198,7 @@ sax_drive_init(SaxDrive dr, VALUE handler, VALUE io, SaxOptions options) {
     if ('\0' == *ox_default_options.encoding) {
 	VALUE	encoding;
 
+	// a String has no encoding to ask for here, it gets the default like IO
 	if (rb_respond_to(io, ox_external_encoding_id) && Qnil != (encoding = rb_funcall(io, ox_external_encoding_id, 0))) {
 	    dr->encoding = encoding;
 	} else {
@@ -12,11 +12,15 @@
 #include "sax_hint.h"
 #include "ox.h"
 
+/* larger :buf_size values are cut down to this, the buffer still grows past it */
+#define MAX_SAX_BUF_SIZE	0x1000000
+
 typedef struct _SaxOptions {
     int			symbolize;
     int			convert_special;
     int			smart;
     SkipMode		skip;
+    size_t		buf_size;	/* initial read buffer size for IO input */
 } *SaxOptions;
 
 typedef struct _SaxDrive {
@@ -26,18 +26,18 @@ static VALUE		partial_io_cb(VALUE rdr);
 static int		read_from_io(Buf buf);
 static int		read_from_fd(Buf buf);
 static int		read_from_io_partial(Buf buf);
-static int		read_from_str(Buf buf);
 
 void
-ox_sax_buf_init(Buf buf, VALUE io) {
+ox_sax_buf_init(Buf buf, VALUE io, size_t size) {
     VALUE	io_class = rb_obj_class(io);
     VALUE	rfd;
+    VALUE	s = Qnil;
 
-    if (ox_stringio_class == io_class && 0 == FIX2INT(rb_funcall2(io, ox_pos_id, 0, 0))) {
-	VALUE	s = rb_funcall2(io, ox_string_id, 0, 0);
-
-	buf->read_func = read_from_str;
-	buf->in_str = StringValuePtr(s);
+    buf->read_func = 0;
+    if (T_STRING == rb_type(io)) {
+	s = io;
+    } else if (ox_stringio_class == io_class && 0 == FIX2INT(rb_funcall2(io, ox_pos_id, 0, 0))) {
+	s = rb_funcall2(io, ox_string_id, 0, 0);
     } else if (rb_cFile == io_class && Qnil != (rfd = rb_funcall(io, ox_fileno_id, 0))) {
 	buf->read_func = read_from_fd;
 	buf->fd = FIX2INT(rfd);
@@ -50,11 +50,27 @@ ox_sax_buf_init(Buf buf, VALUE io) {
     } else {
         rb_raise(ox_arg_error_class, "sax_parser io argument must respond to readpartial() or read().\n");
     }
-    buf->head = buf->base;
-    *buf->head = '\0';
-    buf->end = buf->head + sizeof(buf->base) - BUF_PAD;
+    if (Qnil != s) {
+	/* The whole document goes into the buffer at once so it is never
+	 * refilled or slid. The parser writes terminators into the buffer
+	 * so the string itself can not be used.
+	 */
+	size = RSTRING_LEN(s) + BUF_PAD;
+	buf->head = ALLOC_N(char, size);
+	memcpy(buf->head, StringValuePtr(s), size - BUF_PAD);
+	buf->read_end = buf->head + size - BUF_PAD;
+    } else {
+	if (size <= sizeof(buf->base)) {
+	    buf->head = buf->base;
+	    size = sizeof(buf->base);
+	} else {
+	    buf->head = ALLOC_N(char, size);
+	}
+	buf->read_end = buf->head;
+    }
+    *buf->read_end = '\0';
+    buf->end = buf->head + size - BUF_PAD;
     buf->tail = buf->head;
-    buf->read_end = buf->head;
     buf->pro = 0;
     buf->str = 0;
     buf->line = 1;
@@ -68,7 +84,11 @@ int
 ox_sax_buf_read(Buf buf) {
     int         err;
     size_t      shift = 0;
-    
+
+    if (0 == buf->read_func) {
+	/* everything was read when the buffer was set up */
+	return -1;
+    }
     // if there is not much room to read into, shift or realloc a larger buffer.
     if (buf->head < buf->tail && 4096 > buf->end - buf->tail) {
         if (0 == buf->pro) {
@@ -137,9 +157,12 @@ partial_io_cb(VALUE rbuf) {
     args[0] = ULONG2NUM(buf->end - buf->tail);
     rstr = rb_funcall2(buf->io, ox_readpartial_id, 1, args);
     str = StringValuePtr(rstr);
-    cnt = strlen(str);
+    cnt = RSTRING_LEN(rstr);
+    if (cnt > (size_t)(buf->end - buf->tail)) {
+	cnt = buf->end - buf->tail;
+    }
     //printf("*** read partial %lu bytes, str: '%s'\n", cnt, str);
-    strcpy(buf->tail, str);
+    memcpy(buf->tail, str, cnt);
     buf->read_end = buf->tail + cnt;
 
     return Qtrue;
@@ -156,9 +179,12 @@ io_cb(VALUE rbuf) {
     args[0] = ULONG2NUM(buf->end - buf->tail);
     rstr = rb_funcall2(buf->io, ox_read_id, 1, args);
     str = StringValuePtr(rstr);
-    cnt = strlen(str);
+    cnt = RSTRING_LEN(rstr);
+    if (cnt > (size_t)(buf->end - buf->tail)) {
+	cnt = buf->end - buf->tail;
+    }
     //printf("*** read %lu bytes, str: '%s'\n", cnt, str);
-    strcpy(buf->tail, str);
+    memcpy(buf->tail, str, cnt);
     buf->read_end = buf->tail + cnt;
 
     return Qtrue;
@@ -188,36 +214,3 @@ read_from_fd(Buf buf) {
     }
     return 0;
 }
-
-static char*
-ox_stpncpy(char *dest, const char *src, size_t n) {
-    size_t	cnt = strlen(src) + 1;
-
-    if (n < cnt) {
-	cnt = n;
-    }
-    strncpy(dest, src, cnt);
-
-    return dest + cnt - 1;
-}
-
-
-static int
-read_from_str(Buf buf) {
-    size_t      max = buf->end - buf->tail - 1;
-    char	*s;
-    long	cnt;
-
-    if ('\0' == *buf->in_str) {
-	/* done */
-	return -1;
-    }
-    s = ox_stpncpy(buf->tail, buf->in_str, max);
-    *s = '\0';
-    cnt = s - buf->tail;
-    buf->in_str += cnt;
-    buf->read_end = buf->tail + cnt;
-
-    return 0;
-}
-
@@ -22,7 +22,6 @@ typedef struct _Buf {
     union {
         int     	fd;
         VALUE   	io;
-	const char	*in_str;
     };
     struct _SaxDrive	*dr;
 } *Buf;
@@ -36,7 +35,7 @@ typedef struct _CheckPt {
 
 #define CHECK_PT_INIT { -1, 0, 0, '\0' }
 
-extern void	ox_sax_buf_init(Buf buf, VALUE io);
+extern void	ox_sax_buf_init(Buf buf, VALUE io, size_t size);
 extern int	ox_sax_buf_read(Buf buf);
 
 static inline char
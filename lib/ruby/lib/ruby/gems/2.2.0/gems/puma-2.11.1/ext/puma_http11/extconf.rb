@@ -2,6 +2,10 @@ require 'mkmf'
 
 dir_config("puma_http11")
 
+have_func("rb_hash_bulk_insert", "ruby.h")
+have_header("sys/epoll.h")
+have_func("rb_io_descriptor", "ruby/io.h")
+
 if %w'crypto libeay32'.find {|crypto| have_library(crypto, 'BIO_read')} and
     %w'ssl ssleay32'.find {|ssl| have_library(ssl, 'SSL_CTX_new')}
   
@@ -0,0 +1,63 @@
+/*
+ * Generated by tools/gen_http_fields.rb, do not edit.
+ *
+ * A list of common HTTP headers we expect to receive.
+ * This allows us to avoid repeatedly creating identical string
+ * objects to be used as keys in the request hash.
+ */
+
+#define COMMON_FIELD_SLOTS 64
+
+static struct common_field common_http_fields[] = {
+# define f(N, F) { (sizeof(N) - 1), N, F, Qnil }
+	f("ACCEPT", FIELD_CACHE),
+	f("ACCEPT_CHARSET", FIELD_CACHE),
+	f("ACCEPT_ENCODING", FIELD_CACHE),
+	f("ACCEPT_LANGUAGE", FIELD_CACHE),
+	f("ALLOW", 0),
+	f("AUTHORIZATION", 0),
+	f("CACHE_CONTROL", FIELD_CACHE),
+	f("CONNECTION", FIELD_CACHE),
+	f("CONTENT_ENCODING", FIELD_CACHE),
+	f("CONTENT_LENGTH", FIELD_RAW),
+	f("CONTENT_TYPE", FIELD_RAW | FIELD_CACHE),
+	f("COOKIE", 0),
+	f("DATE", 0),
+	f("EXPECT", FIELD_CACHE),
+	f("FROM", 0),
+	f("HOST", FIELD_CACHE),
+	f("IF_MATCH", 0),
+	f("IF_MODIFIED_SINCE", 0),
+	f("IF_NONE_MATCH", 0),
+	f("IF_RANGE", 0),
+	f("IF_UNMODIFIED_SINCE", 0),
+	f("KEEP_ALIVE", FIELD_CACHE),
+	f("MAX_FORWARDS", 0),
+	f("PRAGMA", FIELD_CACHE),
+	f("PROXY_AUTHORIZATION", 0),
+	f("RANGE", 0),
+	f("REFERER", 0),
+	f("TE", FIELD_CACHE),
+	f("TRAILER", 0),
+	f("TRANSFER_ENCODING", FIELD_CACHE),
+	f("UPGRADE", FIELD_CACHE),
+	f("USER_AGENT", FIELD_CACHE),
+	f("VIA", 0),
+	f("X_FORWARDED_FOR", 0),
+	f("X_REAL_IP", 0),
+	f("WARNING", 0),
+# undef f
+};
+
+/* index into common_http_fields for each hash slot, -1 if empty */
+static const signed char common_field_slots[COMMON_FIELD_SLOTS] = {
+	16, 29, -1, 28, 19, 22, 25, 20, -1, 14, 2, -1, 12, -1, 5, -1,
+	0, 4, -1, -1, -1, -1, 1, -1, -1, 35, 18, 34, 13, -1, 8, -1,
+	-1, -1, -1, -1, -1, 27, 21, -1, 11, 26, 17, 23, 7, -1, 6, 15,
+	31, -1, -1, -1, -1, 3, -1, -1, 9, 10, 24, -1, 33, 32, -1, 30,
+};
+
+static inline unsigned common_field_hash(const unsigned char *f, size_t len)
+{
+  return (len * 14 + f[0] * 3 + f[len - 1] * 20 + f[len / 2] * 21) & (COMMON_FIELD_SLOTS - 1);
+}
@@ -15,7 +15,8 @@
 #include <stddef.h>
 #endif
 
-#define BUFFER_LEN 1024
+/* field/value pairs collected before being added to the request hash */
+#define MAX_PENDING_FIELDS 32
 
 struct puma_parser;
 
@@ -38,6 +39,7 @@ typedef struct puma_parser {
 
   VALUE request;
   VALUE body;
+  VALUE data;
 
   field_cb http_field;
   element_cb request_method;
@@ -48,8 +50,9 @@ typedef struct puma_parser {
   element_cb http_version;
   element_cb header_done;
 
-  char buf[BUFFER_LEN];
-  
+  int nfields;
+  VALUE fields[MAX_PENDING_FIELDS * 2];
+
 } puma_parser;
 
 int puma_parser_init(puma_parser *parser);
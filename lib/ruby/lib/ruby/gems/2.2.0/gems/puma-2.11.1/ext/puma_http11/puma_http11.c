@@ -44,7 +44,7 @@ static VALUE global_request_path;
 #define VALIDATE_MAX_LENGTH(len, N) if(len > MAX_##N##_LENGTH) { rb_raise(eHttpParserError, MAX_##N##_LENGTH_ERR, len); }
 
 /** Defines global strings in the init method. */
-#define DEF_GLOBAL(N, val)   global_##N = rb_str_new2(val); rb_global_variable(&global_##N)
+#define DEF_GLOBAL(N, val)   global_##N = rb_obj_freeze(rb_str_new2(val)); rb_global_variable(&global_##N)
 
 
 /* Defines the maximum allowed lengths for various input elements.*/
@@ -56,160 +56,207 @@ DEF_MAX_LENGTH(REQUEST_PATH, 2048);
 DEF_MAX_LENGTH(QUERY_STRING, (1024 * 10));
 DEF_MAX_LENGTH(HEADER, (1024 * (80 + 32)));
 
+#define FIELD_RAW 1
+#define FIELD_CACHE 2
+
+/* how many distinct values are interned for each cached field */
+#define FIELD_VALUE_WAYS 4
+#define MAX_CACHED_VALUE_LENGTH 256
+
 struct common_field {
 	const size_t len;
 	const char *name;
-  int raw;
+  int flags;
 	VALUE value;
+  VALUE values[FIELD_VALUE_WAYS];
+  unsigned next;
 };
 
-/*
- * A list of common HTTP headers we expect to receive.
- * This allows us to avoid repeatedly creating identical string
- * objects to be used with rb_hash_aset().
- */
-static struct common_field common_http_fields[] = {
-# define f(N) { (sizeof(N) - 1), N, 0, Qnil }
-# define fr(N) { (sizeof(N) - 1), N, 1, Qnil }
-	f("ACCEPT"),
-	f("ACCEPT_CHARSET"),
-	f("ACCEPT_ENCODING"),
-	f("ACCEPT_LANGUAGE"),
-	f("ALLOW"),
-	f("AUTHORIZATION"),
-	f("CACHE_CONTROL"),
-	f("CONNECTION"),
-	f("CONTENT_ENCODING"),
-	fr("CONTENT_LENGTH"),
-	fr("CONTENT_TYPE"),
-	f("COOKIE"),
-	f("DATE"),
-	f("EXPECT"),
-	f("FROM"),
-	f("HOST"),
-	f("IF_MATCH"),
-	f("IF_MODIFIED_SINCE"),
-	f("IF_NONE_MATCH"),
-	f("IF_RANGE"),
-	f("IF_UNMODIFIED_SINCE"),
-	f("KEEP_ALIVE"), /* Firefox sends this */
-	f("MAX_FORWARDS"),
-	f("PRAGMA"),
-	f("PROXY_AUTHORIZATION"),
-	f("RANGE"),
-	f("REFERER"),
-	f("TE"),
-	f("TRAILER"),
-	f("TRANSFER_ENCODING"),
-	f("UPGRADE"),
-	f("USER_AGENT"),
-	f("VIA"),
-	f("X_FORWARDED_FOR"), /* common for proxies */
-	f("X_REAL_IP"), /* common for proxies */
-	f("WARNING")
-# undef f
-};
+#include "http11_fields.h"
 
 /*
- * qsort(3) and bsearch(3) improve average performance slightly, but may
- * not be worth it for lack of portability to certain platforms...
+ * Header names we don't know about are kept here by hash, so a client
+ * that sends the same X-Whatever on every request doesn't get a new key
+ * string built each time.
  */
-#if defined(HAVE_QSORT_BSEARCH)
-/* sort by length, then by name if there's a tie */
-static int common_field_cmp(const void *a, const void *b)
-{
-  struct common_field *cfa = (struct common_field *)a;
-  struct common_field *cfb = (struct common_field *)b;
-  signed long diff = cfa->len - cfb->len;
-  return diff ? diff : memcmp(cfa->name, cfb->name, cfa->len);
-}
-#endif /* HAVE_QSORT_BSEARCH */
+#define UNKNOWN_FIELD_SLOTS 64
+static VALUE unknown_fields[UNKNOWN_FIELD_SLOTS];
 
 static void init_common_fields(void)
 {
-  unsigned i;
+  unsigned i, j;
   struct common_field *cf = common_http_fields;
   char tmp[256]; /* MAX_FIELD_NAME_LENGTH */
   memcpy(tmp, HTTP_PREFIX, HTTP_PREFIX_LEN);
 
   for(i = 0; i < ARRAY_SIZE(common_http_fields); cf++, i++) {
-    if(cf->raw) {
+    if(cf->flags & FIELD_RAW) {
       cf->value = rb_str_new(cf->name, cf->len);
     } else {
       memcpy(tmp + HTTP_PREFIX_LEN, cf->name, cf->len + 1);
       cf->value = rb_str_new(tmp, HTTP_PREFIX_LEN + cf->len);
     }
+    /* frozen keys are stored in the hash as is rather than dup'd */
+    rb_obj_freeze(cf->value);
     rb_global_variable(&cf->value);
+
+    for(j = 0; j < FIELD_VALUE_WAYS; j++) {
+      cf->values[j] = Qnil;
+      if(cf->flags & FIELD_CACHE) rb_global_variable(&cf->values[j]);
+    }
+  }
+
+  for(i = 0; i < UNKNOWN_FIELD_SLOTS; i++) {
+    unknown_fields[i] = Qnil;
+    rb_global_variable(&unknown_fields[i]);
+  }
+}
+
+static struct common_field *find_common_field(const char *field, size_t flen)
+{
+  struct common_field *cf;
+  int i = common_field_slots[common_field_hash((const unsigned char *)field, flen)];
+
+  if(i < 0) return NULL;
+
+  cf = &common_http_fields[i];
+  if(cf->len == flen && !memcmp(cf->name, field, flen))
+    return cf;
+
+  return NULL;
+}
+
+static VALUE find_unknown_field_value(const char *field, size_t flen)
+{
+  VALUE f;
+  size_t i;
+  unsigned h = 2166136261U; /* FNV-1a */
+
+  for(i = 0; i < flen; i++) {
+    h = (h ^ (unsigned char)field[i]) * 16777619U;
   }
 
-#if defined(HAVE_QSORT_BSEARCH)
-  qsort(common_http_fields,
-        ARRAY_SIZE(common_http_fields),
-        sizeof(struct common_field),
-        common_field_cmp);
-#endif /* HAVE_QSORT_BSEARCH */
+  f = unknown_fields[h & (UNKNOWN_FIELD_SLOTS - 1)];
+
+  if(f == Qnil || (size_t)RSTRING_LEN(f) != HTTP_PREFIX_LEN + flen ||
+     memcmp(RSTRING_PTR(f) + HTTP_PREFIX_LEN, field, flen)) {
+    f = rb_str_new(NULL, HTTP_PREFIX_LEN + flen);
+    memcpy(RSTRING_PTR(f), HTTP_PREFIX, HTTP_PREFIX_LEN);
+    memcpy(RSTRING_PTR(f) + HTTP_PREFIX_LEN, field, flen);
+    rb_obj_freeze(f);
+
+    unknown_fields[h & (UNKNOWN_FIELD_SLOTS - 1)] = f;
+  }
+
+  return f;
 }
 
-static VALUE find_common_field_value(const char *field, size_t flen)
+/*
+ * Returns one of the interned values for this field, adding it to the
+ * cache (evicting round robin) if it isn't there yet.
+ */
+static VALUE find_cached_value(struct common_field *cf, const char *value, size_t vlen)
 {
-#if defined(HAVE_QSORT_BSEARCH)
-  struct common_field key;
-  struct common_field *found;
-  key.name = field;
-  key.len = (signed long)flen;
-  found = (struct common_field *)bsearch(&key, common_http_fields,
-                                         ARRAY_SIZE(common_http_fields),
-                                         sizeof(struct common_field),
-                                         common_field_cmp);
-  return found ? found->value : Qnil;
-#else /* !HAVE_QSORT_BSEARCH */
+  VALUE v;
   unsigned i;
-  struct common_field *cf = common_http_fields;
-  for(i = 0; i < ARRAY_SIZE(common_http_fields); i++, cf++) {
-    if (cf->len == flen && !memcmp(cf->name, field, flen))
-      return cf->value;
+
+  for(i = 0; i < FIELD_VALUE_WAYS; i++) {
+    v = cf->values[i];
+    if(v != Qnil && (size_t)RSTRING_LEN(v) == vlen &&
+       !memcmp(RSTRING_PTR(v), value, vlen))
+      return v;
   }
-  return Qnil;
-#endif /* !HAVE_QSORT_BSEARCH */
+
+  v = rb_obj_freeze(rb_str_new(value, vlen));
+  cf->values[cf->next] = v;
+  cf->next = (cf->next + 1) % FIELD_VALUE_WAYS;
+
+  return v;
+}
+
+/*
+ * Values are substrings of the data being parsed, so they share its
+ * buffer rather than being copied out of it. With managed strings the
+ * parser works on a copy of the data, so they have to be copied.
+ */
+static VALUE parser_str(puma_parser* hp, const char *at, size_t length)
+{
+#ifdef MANAGED_STRINGS
+  return rb_str_new(at, length);
+#else
+  return rb_str_subseq(hp->data, at - RSTRING_PTR(hp->data), length);
+#endif
+}
+
+/*
+ * Pairs are collected as they are parsed and added to the request hash
+ * all at once, rather than growing it a field at a time.
+ */
+static void flush_fields(puma_parser* hp)
+{
+  if(hp->nfields == 0) return;
+
+#ifdef HAVE_RB_HASH_BULK_INSERT
+  rb_hash_bulk_insert(hp->nfields * 2, hp->fields, hp->request);
+#else
+  {
+    int i;
+    for(i = 0; i < hp->nfields * 2; i += 2) {
+      rb_hash_aset(hp->request, hp->fields[i], hp->fields[i + 1]);
+    }
+  }
+#endif
+
+  hp->nfields = 0;
+}
+
+static void push_field(puma_parser* hp, VALUE f, VALUE v)
+{
+  if(hp->nfields == MAX_PENDING_FIELDS) flush_fields(hp);
+
+  hp->fields[hp->nfields * 2] = f;
+  hp->fields[hp->nfields * 2 + 1] = v;
+  hp->nfields++;
 }
 
 void http_field(puma_parser* hp, const char *field, size_t flen,
                                  const char *value, size_t vlen)
 {
+  struct common_field *cf;
   VALUE v = Qnil;
   VALUE f = Qnil;
 
   VALIDATE_MAX_LENGTH(flen, FIELD_NAME);
   VALIDATE_MAX_LENGTH(vlen, FIELD_VALUE);
 
-  v = rb_str_new(value, vlen);
+  cf = find_common_field(field, flen);
 
-  f = find_common_field_value(field, flen);
+  if(cf) {
+    f = cf->value;
 
-  if (f == Qnil) {
+    if((cf->flags & FIELD_CACHE) && vlen <= MAX_CACHED_VALUE_LENGTH) {
+      v = find_cached_value(cf, value, vlen);
+    } else {
+      v = parser_str(hp, value, vlen);
+    }
+  } else {
     /*
      * We got a strange header that we don't have a memoized value for.
      * Fallback to creating a new string to use as a hash key.
      */
-
-    size_t new_size = HTTP_PREFIX_LEN + flen;
-    assert(new_size < BUFFER_LEN);
-
-    memcpy(hp->buf, HTTP_PREFIX, HTTP_PREFIX_LEN);
-    memcpy(hp->buf + HTTP_PREFIX_LEN, field, flen);
-
-    f = rb_str_new(hp->buf, new_size);
+    f = find_unknown_field_value(field, flen);
+    v = parser_str(hp, value, vlen);
   }
 
-  rb_hash_aset(hp->request, f, v);
+  push_field(hp, f, v);
 }
 
 void request_method(puma_parser* hp, const char *at, size_t length)
 {
   VALUE val = Qnil;
 
-  val = rb_str_new(at, length);
-  rb_hash_aset(hp->request, global_request_method, val);
+  val = parser_str(hp, at, length);
+  push_field(hp, global_request_method, val);
 }
 
 void request_uri(puma_parser* hp, const char *at, size_t length)
@@ -218,8 +265,8 @@ void request_uri(puma_parser* hp, const char *at, size_t length)
 
   VALIDATE_MAX_LENGTH(length, REQUEST_URI);
 
-  val = rb_str_new(at, length);
-  rb_hash_aset(hp->request, global_request_uri, val);
+  val = parser_str(hp, at, length);
+  push_field(hp, global_request_uri, val);
 }
 
 void fragment(puma_parser* hp, const char *at, size_t length)
@@ -228,8 +275,8 @@ void fragment(puma_parser* hp, const char *at, size_t length)
 
   VALIDATE_MAX_LENGTH(length, FRAGMENT);
 
-  val = rb_str_new(at, length);
-  rb_hash_aset(hp->request, global_fragment, val);
+  val = parser_str(hp, at, length);
+  push_field(hp, global_fragment, val);
 }
 
 void request_path(puma_parser* hp, const char *at, size_t length)
@@ -238,8 +285,8 @@ void request_path(puma_parser* hp, const char *at, size_t length)
 
   VALIDATE_MAX_LENGTH(length, REQUEST_PATH);
 
-  val = rb_str_new(at, length);
-  rb_hash_aset(hp->request, global_request_path, val);
+  val = parser_str(hp, at, length);
+  push_field(hp, global_request_path, val);
 }
 
 void query_string(puma_parser* hp, const char *at, size_t length)
@@ -248,14 +295,14 @@ void query_string(puma_parser* hp, const char *at, size_t length)
 
   VALIDATE_MAX_LENGTH(length, QUERY_STRING);
 
-  val = rb_str_new(at, length);
-  rb_hash_aset(hp->request, global_query_string, val);
+  val = parser_str(hp, at, length);
+  push_field(hp, global_query_string, val);
 }
 
 void http_version(puma_parser* hp, const char *at, size_t length)
 {
-  VALUE val = rb_str_new(at, length);
-  rb_hash_aset(hp->request, global_http_version, val);
+  VALUE val = parser_str(hp, at, length);
+  push_field(hp, global_http_version, val);
 }
 
 /** Finalizes the request header to have a bunch of stuff that's
@@ -263,6 +310,7 @@ void http_version(puma_parser* hp, const char *at, size_t length)
 
 void header_done(puma_parser* hp, const char *at, size_t length)
 {
+  flush_fields(hp);
   hp->body = rb_str_new(at, length);
 }
 
@@ -278,6 +326,8 @@ void HttpParser_free(void *data) {
 void HttpParser_mark(puma_parser* hp) {
   if(hp->request) rb_gc_mark(hp->request);
   if(hp->body) rb_gc_mark(hp->body);
+  if(hp->data) rb_gc_mark(hp->data);
+  rb_gc_mark_locations(hp->fields, hp->fields + hp->nfields * 2);
 }
 
 VALUE HttpParser_alloc(VALUE klass)
@@ -293,6 +343,8 @@ VALUE HttpParser_alloc(VALUE klass)
   hp->http_version = http_version;
   hp->header_done = header_done;
   hp->request = Qnil;
+  hp->data = Qnil;
+  hp->nfields = 0;
 
   puma_parser_init(hp);
 
@@ -374,6 +426,7 @@ VALUE HttpParser_execute(VALUE self, VALUE req_hash, VALUE data, VALUE start)
   long dlen = 0;
 
   DATA_GET(self, puma_parser, http);
+  REQUIRE_TYPE(req_hash, T_HASH);
 
   from = FIX2INT(start);
   dptr = rb_extract_chars(data, &dlen);
@@ -383,7 +436,11 @@ VALUE HttpParser_execute(VALUE self, VALUE req_hash, VALUE data, VALUE start)
     rb_raise(eHttpParserError, "%s", "Requested start is after data buffer end.");
   } else {
     http->request = req_hash;
+    http->data = data;
+    http->nfields = 0;
     puma_parser_execute(http, dptr, dlen, from);
+    flush_fields(http);
+    http->data = Qnil;
 
     rb_free_chars(dptr);
     VALIDATE_MAX_LENGTH(puma_parser_nread(http), HEADER);
@@ -457,6 +514,7 @@ VALUE HttpParser_body(VALUE self) {
 }
 
 void Init_io_buffer(VALUE puma);
+void Init_selector(VALUE puma);
 void Init_mini_ssl(VALUE mod);
 
 void Init_puma_http11()
@@ -487,5 +545,6 @@ void Init_puma_http11()
   init_common_fields();
 
   Init_io_buffer(mPuma);
+  Init_selector(mPuma);
   Init_mini_ssl(mPuma);
 }
@@ -0,0 +1,411 @@
+#include "ruby.h"
+
+#ifdef HAVE_SYS_EPOLL_H
+
+#include "ruby/io.h"
+#include "ruby/thread.h"
+
+#include <sys/types.h>
+#include <sys/epoll.h>
+#include <sys/time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/*
+ * Watches IOs for readability with epoll. IOs stay registered until they
+ * are deregistered or time out, so an idle keep-alive connection costs
+ * nothing on each pass of the reactor, and timeouts are kept in a heap
+ * so finding the next one doesn't mean looking at every client.
+ *
+ * A selector is only meant to be used from one thread at a time.
+ */
+
+#define SELECTOR_MAX_EVENTS 256
+
+struct sel_entry {
+  VALUE io;          /* Qnil if the fd isn't registered */
+  double timeout_at;
+  int heap_index;    /* -1 if the entry has no timeout */
+};
+
+struct selector {
+  int epfd;
+
+  /* indexed by fd */
+  struct sel_entry* entries;
+  int capa;
+
+  /* fds with a timeout, soonest first */
+  int* heap;
+  int nheap;
+
+  VALUE ios; /* io => fd */
+
+  struct epoll_event events[SELECTOR_MAX_EVENTS];
+};
+
+static double sel_now(void) {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static int sel_fd(VALUE io) {
+  VALUE f = rb_convert_type(io, T_FILE, "IO", "to_io");
+#ifdef HAVE_RB_IO_DESCRIPTOR
+  return rb_io_descriptor(f);
+#else
+  rb_io_t* fptr;
+
+  GetOpenFile(f, fptr);
+  return fptr->fd;
+#endif
+}
+
+static void sel_grow(struct selector* sel, int fd) {
+  int capa = sel->capa ? sel->capa : 64;
+  int i;
+
+  if(fd < sel->capa) return;
+
+  while(capa <= fd) capa *= 2;
+
+  REALLOC_N(sel->entries, struct sel_entry, capa);
+  REALLOC_N(sel->heap, int, capa);
+
+  for(i = sel->capa; i < capa; i++) {
+    sel->entries[i].io = Qnil;
+    sel->entries[i].heap_index = -1;
+  }
+
+  sel->capa = capa;
+}
+
+/* Timeout heap */
+
+static int sel_heap_less(struct selector* sel, int a, int b) {
+  return sel->entries[sel->heap[a]].timeout_at < sel->entries[sel->heap[b]].timeout_at;
+}
+
+static void sel_heap_swap(struct selector* sel, int a, int b) {
+  int fd = sel->heap[a];
+
+  sel->heap[a] = sel->heap[b];
+  sel->heap[b] = fd;
+
+  sel->entries[sel->heap[a]].heap_index = a;
+  sel->entries[sel->heap[b]].heap_index = b;
+}
+
+static void sel_heap_up(struct selector* sel, int i) {
+  while(i > 0 && sel_heap_less(sel, i, (i - 1) / 2)) {
+    sel_heap_swap(sel, i, (i - 1) / 2);
+    i = (i - 1) / 2;
+  }
+}
+
+static void sel_heap_down(struct selector* sel, int i) {
+  while(1) {
+    int l = i * 2 + 1;
+    int r = l + 1;
+    int min = i;
+
+    if(l < sel->nheap && sel_heap_less(sel, l, min)) min = l;
+    if(r < sel->nheap && sel_heap_less(sel, r, min)) min = r;
+
+    if(min == i) return;
+
+    sel_heap_swap(sel, i, min);
+    i = min;
+  }
+}
+
+static void sel_heap_remove(struct selector* sel, int fd) {
+  int i = sel->entries[fd].heap_index;
+
+  if(i < 0) return;
+
+  sel->entries[fd].heap_index = -1;
+  sel->nheap--;
+
+  if(i == sel->nheap) return;
+
+  sel->heap[i] = sel->heap[sel->nheap];
+  sel->entries[sel->heap[i]].heap_index = i;
+
+  sel_heap_up(sel, i);
+  sel_heap_down(sel, sel->entries[sel->heap[i]].heap_index);
+}
+
+static void sel_heap_insert(struct selector* sel, int fd, double timeout_at) {
+  sel->entries[fd].timeout_at = timeout_at;
+  sel->entries[fd].heap_index = sel->nheap;
+  sel->heap[sel->nheap++] = fd;
+
+  sel_heap_up(sel, sel->nheap - 1);
+}
+
+static void sel_drop(struct selector* sel, int fd) {
+  sel_heap_remove(sel, fd);
+  rb_hash_delete(sel->ios, sel->entries[fd].io);
+  sel->entries[fd].io = Qnil;
+
+  /* the fd may already have been closed, which removes it for us */
+  epoll_ctl(sel->epfd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+static void sel_mark(struct selector* sel) {
+  rb_gc_mark(sel->ios);
+}
+
+static void sel_free(struct selector* sel) {
+  if(sel->epfd >= 0) close(sel->epfd);
+  xfree(sel->entries);
+  xfree(sel->heap);
+  xfree(sel);
+}
+
+static VALUE sel_alloc(VALUE klass) {
+  VALUE obj;
+  struct selector* sel;
+
+  obj = Data_Make_Struct(klass, struct selector, sel_mark, sel_free, sel);
+
+  sel->epfd = -1;
+  sel->ios = rb_hash_new();
+
+  return obj;
+}
+
+static struct selector* sel_get(VALUE self) {
+  struct selector* sel;
+
+  Data_Get_Struct(self, struct selector, sel);
+
+  if(sel->epfd < 0) rb_raise(rb_eIOError, "closed selector");
+
+  return sel;
+}
+
+/*
+ * call-seq:
+ *    Selector.new -> selector
+ */
+static VALUE sel_init(VALUE self) {
+  struct selector* sel;
+
+  Data_Get_Struct(self, struct selector, sel);
+
+#ifdef EPOLL_CLOEXEC
+  sel->epfd = epoll_create1(EPOLL_CLOEXEC);
+#else
+  sel->epfd = epoll_create(SELECTOR_MAX_EVENTS);
+  if(sel->epfd >= 0) fcntl(sel->epfd, F_SETFD, FD_CLOEXEC);
+#endif
+
+  if(sel->epfd < 0) rb_sys_fail("epoll_create");
+
+  return self;
+}
+
+/*
+ * call-seq:
+ *    selector.register(io, timeout_at = nil) -> io
+ *
+ * Watches +io+ (anything with a to_io) for readability. If +timeout_at+
+ * is given, it's returned by #select as timed out once that Time has
+ * passed without it becoming readable. Registering an IO again just
+ * updates its timeout.
+ */
+static VALUE sel_register(int argc, VALUE* argv, VALUE self) {
+  struct selector* sel = sel_get(self);
+  VALUE io, timeout_at;
+  int fd;
+
+  rb_scan_args(argc, argv, "11", &io, &timeout_at);
+
+  fd = sel_fd(io);
+  sel_grow(sel, fd);
+
+  /* the fd was closed and reused without being deregistered */
+  if(sel->entries[fd].io != Qnil && sel->entries[fd].io != io) {
+    sel_drop(sel, fd);
+  }
+
+  if(sel->entries[fd].io == Qnil) {
+    struct epoll_event ev;
+
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+
+    if(epoll_ctl(sel->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+      if(errno != EEXIST || epoll_ctl(sel->epfd, EPOLL_CTL_MOD, fd, &ev) < 0)
+        rb_sys_fail("epoll_ctl");
+    }
+
+    sel->entries[fd].io = io;
+    rb_hash_aset(sel->ios, io, INT2FIX(fd));
+  }
+
+  sel_heap_remove(sel, fd);
+
+  if(!NIL_P(timeout_at)) {
+    struct timespec ts = rb_time_timespec(timeout_at);
+    sel_heap_insert(sel, fd, ts.tv_sec + ts.tv_nsec / 1e9);
+  }
+
+  return io;
+}
+
+/*
+ * call-seq:
+ *    selector.deregister(io) -> true/false
+ *
+ * Stops watching +io+. It doesn't need to still be open.
+ */
+static VALUE sel_deregister(VALUE self, VALUE io) {
+  struct selector* sel = sel_get(self);
+  VALUE fd = rb_hash_lookup(sel->ios, io);
+
+  if(NIL_P(fd)) return Qfalse;
+
+  sel_drop(sel, FIX2INT(fd));
+
+  return Qtrue;
+}
+
+struct sel_wait_args {
+  int epfd;
+  struct epoll_event* events;
+  int timeout;
+  int result;
+  int error;
+};
+
+static void* sel_wait(void* ptr) {
+  struct sel_wait_args* args = (struct sel_wait_args*)ptr;
+
+  args->result = epoll_wait(args->epfd, args->events, SELECTOR_MAX_EVENTS, args->timeout);
+  args->error = errno;
+
+  return NULL;
+}
+
+/*
+ * call-seq:
+ *    selector.select(timeout) -> [readable, timed_out]
+ *
+ * Waits up to +timeout+ seconds, or until the soonest registered timeout,
+ * for registered IOs to become readable. Readable IOs stay registered but
+ * lose their timeout. IOs which timed out are deregistered.
+ */
+static VALUE sel_select(VALUE self, VALUE timeout) {
+  struct selector* sel = sel_get(self);
+  struct sel_wait_args args;
+  VALUE readable = rb_ary_new();
+  VALUE timed_out = rb_ary_new();
+  double wait = NUM2DBL(timeout);
+  double now;
+  int i;
+
+  if(sel->nheap > 0) {
+    double diff = sel->entries[sel->heap[0]].timeout_at - sel_now();
+
+    if(diff < wait) wait = diff < 0.0 ? 0.0 : diff;
+  }
+
+  args.epfd = sel->epfd;
+  args.events = sel->events;
+  args.timeout = (int)(wait * 1000 + 0.999);
+
+  rb_thread_call_without_gvl(sel_wait, &args, RUBY_UBF_IO, 0);
+
+  if(args.result < 0) {
+    if(args.error != EINTR) {
+      errno = args.error;
+      rb_sys_fail("epoll_wait");
+    }
+
+    args.result = 0;
+  }
+
+  for(i = 0; i < args.result; i++) {
+    int fd = sel->events[i].data.fd;
+
+    if(fd < sel->capa && sel->entries[fd].io != Qnil) {
+      sel_heap_remove(sel, fd);
+      rb_ary_push(readable, sel->entries[fd].io);
+    }
+  }
+
+  now = sel_now();
+
+  while(sel->nheap > 0 && sel->entries[sel->heap[0]].timeout_at <= now) {
+    int fd = sel->heap[0];
+
+    rb_ary_push(timed_out, sel->entries[fd].io);
+    sel_drop(sel, fd);
+  }
+
+  return rb_assoc_new(readable, timed_out);
+}
+
+/*
+ * call-seq:
+ *    selector.ios -> Array
+ *
+ * Returns everything currently registered.
+ */
+static VALUE sel_ios(VALUE self) {
+  struct selector* sel;
+
+  Data_Get_Struct(self, struct selector, sel);
+
+  return rb_funcall(sel->ios, rb_intern("keys"), 0);
+}
+
+static VALUE sel_size(VALUE self) {
+  struct selector* sel;
+
+  Data_Get_Struct(self, struct selector, sel);
+
+  return rb_hash_size(sel->ios);
+}
+
+static VALUE sel_close(VALUE self) {
+  struct selector* sel;
+
+  Data_Get_Struct(self, struct selector, sel);
+
+  if(sel->epfd >= 0) {
+    close(sel->epfd);
+    sel->epfd = -1;
+  }
+
+  rb_hash_clear(sel->ios);
+  sel->nheap = 0;
+
+  return Qnil;
+}
+
+void Init_selector(VALUE puma) {
+  VALUE cSelector = rb_define_class_under(puma, "Selector", rb_cObject);
+
+  rb_define_alloc_func(cSelector, sel_alloc);
+  rb_define_method(cSelector, "initialize", sel_init, 0);
+  rb_define_method(cSelector, "register", sel_register, -1);
+  rb_define_method(cSelector, "deregister", sel_deregister, 1);
+  rb_define_method(cSelector, "select", sel_select, 1);
+  rb_define_method(cSelector, "ios", sel_ios, 0);
+  rb_define_method(cSelector, "size", sel_size, 0);
+  rb_define_method(cSelector, "close", sel_close, 0);
+}
+
+#else
+
+void Init_selector(VALUE puma) {
+  /* lib/puma/selector.rb provides one using IO.select */
+}
+
+#endif
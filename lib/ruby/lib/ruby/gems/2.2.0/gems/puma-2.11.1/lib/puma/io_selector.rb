@@ -0,0 +1,75 @@
+module Puma
+  # IO.select based version of the epoll selector in the C extension,
+  # used where that isn't available. Each call to #select looks at
+  # every registered IO.
+  class IOSelector
+    def initialize
+      @ios = {}
+    end
+
+    def register(io, timeout_at=nil)
+      @ios[io] = timeout_at
+      io
+    end
+
+    def deregister(io)
+      return false unless @ios.key?(io)
+      @ios.delete io
+      true
+    end
+
+    def select(timeout)
+      timeouts = @ios.values.compact
+
+      unless timeouts.empty?
+        diff = timeouts.min.to_f - Time.now.to_f
+
+        if diff < 0.0
+          timeout = 0
+        elsif diff < timeout
+          timeout = diff
+        end
+      end
+
+      begin
+        ready = IO.select @ios.keys, nil, nil, timeout
+      rescue IOError => e
+        closed = @ios.keys.select { |io| io.to_io.closed? }
+
+        raise if closed.empty?
+
+        STDERR.puts "Error in select: #{e.message} (#{e.class})"
+        STDERR.puts e.backtrace
+        closed.each { |io| @ios.delete io }
+        retry
+      end
+
+      readable = ready ? ready[0] : []
+      readable.each { |io| @ios[io] = nil }
+
+      now = Time.now
+      timed_out = []
+
+      @ios.each do |io, timeout_at|
+        timed_out << io if timeout_at and timeout_at <= now
+      end
+
+      timed_out.each { |io| @ios.delete io }
+
+      [readable, timed_out]
+    end
+
+    def ios
+      @ios.keys
+    end
+
+    def size
+      @ios.size
+    end
+
+    def close
+      @ios.clear
+      nil
+    end
+  end
+end
@@ -1,4 +1,5 @@
 require 'puma/util'
+require 'puma/selector'
 
 module Puma
   class Reactor
@@ -12,101 +13,68 @@ module Puma
       @mutex = Mutex.new
       @ready, @trigger = Puma::Util.pipe
       @input = []
-      @sleep_for = DefaultSleepFor
-      @timeouts = []
 
-      @sockets = [@ready]
+      @selector = Selector.new
+      @selector.register @ready
     end
 
     private
 
     def run_internal
-      sockets = @sockets
+      selector = @selector
 
       while true
-        begin
-          ready = IO.select sockets, nil, nil, @sleep_for
-        rescue IOError => e
-          if sockets.any? { |socket| socket.closed? }
-            STDERR.puts "Error in select: #{e.message} (#{e.class})"
-            STDERR.puts e.backtrace
-            sockets = sockets.reject { |socket| socket.closed? }
-            retry
-          else
-            raise
-          end
-        end
-
-        if ready and reads = ready[0]
-          reads.each do |c|
-            if c == @ready
-              @mutex.synchronize do
-                case @ready.read(1)
-                when "*"
-                  sockets += @input
-                  @input.clear
-                when "c"
-                  sockets.delete_if do |s|
-                    if s == @ready
-                      false
-                    else
-                      s.close
-                      true
-                    end
-                  end
-                when "!"
-                  return
+        reads, timed_out = selector.select DefaultSleepFor
+
+        reads.each do |c|
+          if c == @ready
+            @mutex.synchronize do
+              case @ready.read(1)
+              when "*"
+                # Clients are only registered here, on the reactor
+                # thread, so the selector is never used concurrently.
+                @input.each { |i| selector.register i, i.timeout_at }
+                @input.clear
+              when "c"
+                selector.ios.each do |s|
+                  next if s == @ready
+                  selector.deregister s
+                  s.close
                 end
+              when "!"
+                return
               end
-            else
-              # We have to be sure to remove it from the timeout
-              # list or we'll accidentally close the socket when
-              # it's in use!
-              if c.timeout_at
-                @mutex.synchronize do
-                  @timeouts.delete c
-                end
+            end
+          else
+            begin
+              if c.try_to_finish
+                selector.deregister c
+                @app_pool << c
+              elsif c.timeout_at
+                # Still waiting on the rest of the request, so it
+                # keeps the deadline it was added with.
+                selector.register c, c.timeout_at
               end
 
-              begin
-                if c.try_to_finish
-                  @app_pool << c
-                  sockets.delete c
-                end
-
-              # The client doesn't know HTTP well
-              rescue HttpParserError => e
-                c.write_400
-                c.close
-
-                sockets.delete c
-
-                @events.parse_error @server, c.env, e
-              rescue StandardError => e
-                c.write_500
-                c.close
+            # The client doesn't know HTTP well
+            rescue HttpParserError => e
+              selector.deregister c
+              c.write_400
+              c.close
 
-                sockets.delete c
-              end
+              @events.parse_error @server, c.env, e
+            rescue StandardError => e
+              selector.deregister c
+              c.write_500
+              c.close
             end
           end
         end
 
-        unless @timeouts.empty?
-          @mutex.synchronize do
-            now = Time.now
-
-            while @timeouts.first.timeout_at < now
-              c = @timeouts.shift
-              c.write_408 if c.in_data_phase
-              c.close
-              sockets.delete c
-
-              break if @timeouts.empty?
-            end
-
-            calculate_sleep
-          end
+        # The selector has already stopped watching these
+        timed_out.each do |c|
+          c.write_408 if c.in_data_phase
+          c.close
         end
       end
     end
@@ -118,6 +86,7 @@ module Puma
     ensure
       @trigger.close
       @ready.close
+      @selector.close
     end
 
     def run_in_thread
@@ -131,20 +100,7 @@ module Puma
         ensure
           @trigger.close
           @ready.close
-        end
-      end
-    end
-
-    def calculate_sleep
-      if @timeouts.empty?
-        @sleep_for = DefaultSleepFor
-      else
-        diff = @timeouts.first.timeout_at.to_f - Time.now.to_f
-
-        if diff < 0.0
-          @sleep_for = 0
-        else
-          @sleep_for = diff
+          @selector.close
         end
       end
     end
@@ -153,13 +109,6 @@ module Puma
       @mutex.synchronize do
         @input << c
         @trigger << "*"
-
-        if c.timeout_at
-          @timeouts << c
-          @timeouts.sort! { |a,b| a.timeout_at <=> b.timeout_at }
-
-          calculate_sleep
-        end
       end
     end
 
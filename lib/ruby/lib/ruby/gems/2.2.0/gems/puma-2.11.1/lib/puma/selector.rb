@@ -0,0 +1,7 @@
+require 'puma/puma_http11'
+require 'puma/io_selector'
+
+module Puma
+  # Use the epoll based selector from the C extension when there is one
+  Selector = IOSelector unless const_defined? "Selector"
+end
@@ -68,6 +68,56 @@ class Http11ParserTest < Test::Unit::TestCase
     assert_equal 'posts-17408', req['FRAGMENT']
   end
 
+  def test_parse_headers
+    parser = HttpParser.new
+    req = {}
+    http = "GET / HTTP/1.1\r\nHost: example.com\r\nContent-Type: text/plain\r\nX-Request-Id: abc123\r\nX-Request-Id2: def\r\n\r\n"
+    parser.execute(req, http, 0)
+
+    assert parser.finished?
+    assert_equal 'example.com', req['HTTP_HOST']
+    assert_equal 'text/plain', req['CONTENT_TYPE']
+    assert_equal 'abc123', req['HTTP_X_REQUEST_ID']
+    assert_equal 'def', req['HTTP_X_REQUEST_ID2']
+    assert req.keys.all? { |k| k.frozen? }
+  end
+
+  def test_common_values_are_shared
+    http = "GET / HTTP/1.1\r\nConnection: keep-alive\r\nAccept: */*\r\nCookie: a=b\r\n\r\n"
+
+    reqs = 2.times.map do
+      req = {}
+      HttpParser.new.execute(req, http.dup, 0)
+      req
+    end
+
+    assert_equal 'keep-alive', reqs[0]['HTTP_CONNECTION']
+    assert reqs[0]['HTTP_CONNECTION'].frozen?
+    assert_same reqs[0]['HTTP_CONNECTION'], reqs[1]['HTTP_CONNECTION']
+    assert_same reqs[0]['HTTP_ACCEPT'], reqs[1]['HTTP_ACCEPT']
+    assert_equal 'a=b', reqs[1]['HTTP_COOKIE']
+    assert !reqs[1]['HTTP_COOKIE'].frozen?
+  end
+
+  def test_parse_in_pieces
+    parser = HttpParser.new
+    req = {}
+    http = "GET /a?b=c HTTP/1.1\r\n" + (1..40).map { |i| "X-Field-#{i}: #{i}\r\n" }.join
+    nread = parser.execute(req, http.dup, 0)
+    assert !parser.finished?
+
+    http << "Host: example.com\r\n\r\nbody"
+    parser.execute(req, http, nread)
+
+    assert parser.finished?
+    assert_equal '/a', req['REQUEST_PATH']
+    assert_equal 'b=c', req['QUERY_STRING']
+    assert_equal '1', req['HTTP_X_FIELD_1']
+    assert_equal '40', req['HTTP_X_FIELD_40']
+    assert_equal 'example.com', req['HTTP_HOST']
+    assert_equal 'body', parser.body
+  end
+
   # lame random garbage maker
   def rand_data(min, max, readable=true)
     count = min + ((rand(max)+1) *10).to_i
@@ -0,0 +1,96 @@
+require 'puma/selector'
+require 'test/unit'
+
+module SelectorTests
+  def setup
+    @selector = selector_class.new
+    @r, @w = IO.pipe
+  end
+
+  def teardown
+    @selector.close
+    @r.close
+    @w.close
+  end
+
+  def test_readable
+    @selector.register @r
+    assert_equal [[], []], @selector.select(0)
+
+    @w << "x"
+    assert_equal [[@r], []], @selector.select(1)
+
+    # still registered until told otherwise
+    assert_equal [[@r], []], @selector.select(1)
+    assert_equal 1, @selector.size
+  end
+
+  def test_deregister
+    @selector.register @r
+    assert @selector.deregister(@r)
+    assert !@selector.deregister(@r)
+
+    @w << "x"
+    assert_equal [[], []], @selector.select(0)
+    assert_equal [], @selector.ios
+  end
+
+  def test_timeout
+    @selector.register @r, Time.now + 0.1
+
+    start = Time.now
+    assert_equal [[], [@r]], @selector.select(5)
+    assert Time.now - start < 1, "select didn't wake up for the timeout"
+
+    assert_equal 0, @selector.size
+  end
+
+  def test_readable_clears_timeout
+    @selector.register @r, Time.now + 0.1
+    @w << "x"
+    assert_equal [[@r], []], @selector.select(1)
+
+    sleep 0.15
+    assert_equal [[@r], []], @selector.select(0)
+  end
+
+  def test_timeouts_expire_in_order
+    ios = 3.times.map { IO.pipe }
+    now = Time.now
+
+    ios.each_with_index do |(r, w), i|
+      @selector.register r, now + (3 - i) * 0.05
+    end
+
+    expired = []
+    expired.concat @selector.select(1)[1] until expired.size == 3
+
+    assert_equal ios.map(&:first).reverse, expired
+  ensure
+    ios.flatten.each(&:close)
+  end
+
+  def test_register_to_io
+    client = Struct.new(:to_io).new(@r)
+
+    @selector.register client
+    @w << "x"
+    assert_equal [[client], []], @selector.select(1)
+  end
+end
+
+class TestIOSelector < Test::Unit::TestCase
+  include SelectorTests
+
+  def selector_class
+    Puma::IOSelector
+  end
+end
+
+class TestSelector < Test::Unit::TestCase
+  include SelectorTests
+
+  def selector_class
+    Puma::Selector
+  end
+end
@@ -0,0 +1,116 @@
+# Generates ext/puma_http11/http11_fields.h, the table of common HTTP
+# header names the C parser knows about, along with a perfect hash
+# function over them.
+#
+#   ruby tools/gen_http_fields.rb > ext/puma_http11/http11_fields.h
+#
+# Names are given the way the parser hands them to http_field, that is
+# upcased and with dashes turned into underscores. Raw fields are stored
+# in the env without the HTTP_ prefix, and cached fields have their
+# values interned since the same few values are sent over and over.
+
+FIELDS = [
+  ["ACCEPT", :cache],
+  ["ACCEPT_CHARSET", :cache],
+  ["ACCEPT_ENCODING", :cache],
+  ["ACCEPT_LANGUAGE", :cache],
+  ["ALLOW"],
+  ["AUTHORIZATION"],
+  ["CACHE_CONTROL", :cache],
+  ["CONNECTION", :cache],
+  ["CONTENT_ENCODING", :cache],
+  ["CONTENT_LENGTH", :raw],
+  ["CONTENT_TYPE", :raw, :cache],
+  ["COOKIE"],
+  ["DATE"],
+  ["EXPECT", :cache],
+  ["FROM"],
+  ["HOST", :cache],
+  ["IF_MATCH"],
+  ["IF_MODIFIED_SINCE"],
+  ["IF_NONE_MATCH"],
+  ["IF_RANGE"],
+  ["IF_UNMODIFIED_SINCE"],
+  ["KEEP_ALIVE", :cache], # Firefox sends this
+  ["MAX_FORWARDS"],
+  ["PRAGMA", :cache],
+  ["PROXY_AUTHORIZATION"],
+  ["RANGE"],
+  ["REFERER"],
+  ["TE", :cache],
+  ["TRAILER"],
+  ["TRANSFER_ENCODING", :cache],
+  ["UPGRADE", :cache],
+  ["USER_AGENT", :cache],
+  ["VIA"],
+  ["X_FORWARDED_FOR"], # common for proxies
+  ["X_REAL_IP"], # common for proxies
+  ["WARNING"]
+]
+
+SLOTS = 64
+
+def field_hash(name, m)
+  len = name.bytesize
+  (len * m[0] + name.getbyte(0) * m[1] + name.getbyte(len - 1) * m[2] +
+    name.getbyte(len / 2) * m[3]) & (SLOTS - 1)
+end
+
+def search
+  (1..31).each do |a|
+    (1..31).each do |b|
+      (1..31).each do |c|
+        (0..31).each do |d|
+          m = [a, b, c, d]
+          slots = FIELDS.map { |name, *| field_hash(name, m) }
+          return m if slots.uniq.size == slots.size
+        end
+      end
+    end
+  end
+
+  abort "no perfect hash found for #{FIELDS.size} fields in #{SLOTS} slots"
+end
+
+m = search
+slots = Array.new(SLOTS, -1)
+FIELDS.each_with_index { |(name, *), i| slots[field_hash(name, m)] = i }
+
+puts <<-EOS
+/*
+ * Generated by tools/gen_http_fields.rb, do not edit.
+ *
+ * A list of common HTTP headers we expect to receive.
+ * This allows us to avoid repeatedly creating identical string
+ * objects to be used as keys in the request hash.
+ */
+
+#define COMMON_FIELD_SLOTS #{SLOTS}
+
+static struct common_field common_http_fields[] = {
+# define f(N, F) { (sizeof(N) - 1), N, F, Qnil }
+EOS
+
+FIELDS.each do |name, *flags|
+  f = flags.map { |x| "FIELD_#{x.to_s.upcase}" }
+  puts "\tf(#{name.inspect}, #{f.empty? ? 0 : f.join(' | ')}),"
+end
+
+puts <<-EOS
+# undef f
+};
+
+/* index into common_http_fields for each hash slot, -1 if empty */
+static const signed char common_field_slots[COMMON_FIELD_SLOTS] = {
+EOS
+
+slots.each_slice(16) { |s| puts "\t#{s.join(', ')}," }
+
+puts <<-EOS
+};
+
+static inline unsigned common_field_hash(const unsigned char *f, size_t len)
+{
+  return (len * #{m[0]} + f[0] * #{m[1]} + f[len - 1] * #{m[2]} + f[len / 2] * #{m[3]}) & (COMMON_FIELD_SLOTS - 1);
+}
+EOS
@@ -0,0 +1,46 @@
+# Compares the digest engines on a stream of latency-like samples.
+#
+#   ruby -Ilib benchmarks/engines.rb [samples] [engines...]
+#
+# Samples default to 10M; engines to array, optimized and merging. The pure
+# Ruby ArrayDigest needs a lot of patience at 10M.
+require 'benchmark'
+require 'x-digest'
+
+samples = (ARGV.shift || 10_000_000).to_i
+engines = ARGV.empty? ? %w[array optimized merging] : ARGV
+compression = 25
+
+# log-normal around 50 ms with a long tail, rounded to ms like nginx logs
+srand 1234
+values = Array.new(samples) do
+    u1 = 1.0 - rand
+    u2 = rand
+    z = Math.sqrt(-2 * Math.log(u1)) * Math.cos(2 * Math::PI * u2)
+    (Math.exp(Math.log(0.05) + 0.8 * z)).round(3)
+end
+sorted = values.sort
+
+digests = {
+    'array'     => -> { XDigest::ArrayDigest.new :compression => compression },
+    'optimized' => -> { XDigest::ArrayDigestOptimized.new :compression => compression },
+    'merging'   => -> { XDigest::MergingDigest.new :compression => compression },
+}
+
+puts %[#{samples} samples, compression #{compression}]
+results = {}
+Benchmark.bm(10) do |b|
+    engines.each do |name|
+        digest = digests.fetch(name).call
+        b.report(name) { values.each { |v| digest.add v } }
+        results[name] = digest
+    end
+end
+
+puts
+puts %[#{'quantile'.ljust(10)} #{'exact'.rjust(9)} #{engines.collect { |i| i.rjust(9) }.join ' '}]
+[0.5, 0.9, 0.99, 0.999].each do |q|
+    exact = sorted[(q * (samples - 1)).round]
+    estimates = engines.collect { |i| ('%.4f' % results[i].quantile(q)).rjust(9) }
+    puts %[#{q.to_s.ljust(10)} #{('%.4f' % exact).rjust(9)} #{estimates.join ' '}]
+end
@@ -0,0 +1,523 @@
+#include "xdigest.h"
+#include "merging.h"
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#define DEFAULT_COMPRESSION 100
+#define BUFFER_FACTOR 5
+
+extern VALUE rb_mXDigest;
+VALUE rb_cMergingDigest;
+
+static int
+centroid_compare(const void *a, const void *b)
+{
+    double x = ((const Centroid*)a)->mean;
+    double y = ((const Centroid*)b)->mean;
+
+    return (x > y) - (x < y);
+}
+
+/*
+ * Same size bound as the array digests, 4 * n * q * (1 - q) / compression
+ * with q taken at the middle of the centroid, so the tails stay as sharp.
+ */
+static bool
+merging_fits(MergingDigest *digest, double so_far, double count, double total)
+{
+    double q = (so_far + count / 2) / total;
+    return count <= 4 * total * q * (1 - q) / digest->compression;
+}
+
+static void
+merging_grow(MergingDigest *digest)
+{
+    long capacity = digest->capacity * 2;
+
+    Centroid *centroids = (Centroid*)realloc(digest->centroids, sizeof(Centroid)*capacity);
+    if (centroids == NULL) {
+        rb_raise(rb_eNoMemError, "allocation of centroids failed");
+    }
+    digest->centroids = centroids;
+
+    Centroid *buffer = (Centroid*)realloc(digest->buffer, sizeof(Centroid)*(digest->buffer_size + capacity));
+    if (buffer == NULL) {
+        rb_raise(rb_eNoMemError, "allocation of buffer failed");
+    }
+    digest->buffer = buffer;
+    digest->capacity = capacity;
+}
+
+int
+merging_digest_init(MergingDigest *digest, double compression)
+{
+    // the size bound allows about compression / 2 * ln(n) centroids, which
+    // this covers up to a few million samples before having to grow
+    long capacity = (long)ceil(10 * compression) + 10;
+    long buffer_size = BUFFER_FACTOR * capacity;
+
+    Centroid *centroids = (Centroid*)malloc(sizeof(Centroid)*capacity);
+    if (centroids == NULL) {
+        return -1;
+    }
+
+    // sized so the centroids can be copied in behind a full buffer for sorting
+    Centroid *buffer = (Centroid*)malloc(sizeof(Centroid)*(buffer_size + capacity));
+    if (buffer == NULL) {
+        free(centroids);
+        return -1;
+    }
+
+    digest->compression = compression;
+    digest->capacity = capacity;
+    digest->centroids = centroids;
+    digest->buffer_size = buffer_size;
+    digest->buffer = buffer;
+    merging_digest_clear(digest);
+
+    return 0;
+}
+
+void
+merging_digest_release(MergingDigest *digest)
+{
+    free(digest->centroids);
+    free(digest->buffer);
+    digest->centroids = NULL;
+    digest->buffer = NULL;
+}
+
+void
+merging_digest_clear(MergingDigest *digest)
+{
+    digest->active = 0;
+    digest->buffered = 0;
+    digest->total_weight = 0;
+    digest->unmerged_weight = 0;
+    digest->min = INFINITY;
+    digest->max = -INFINITY;
+}
+
+void
+merging_digest_add(MergingDigest *digest, double value, long weight)
+{
+    if (digest->buffered == digest->buffer_size) {
+        merging_digest_compress(digest);
+    }
+
+    digest->buffer[digest->buffered].mean = value;
+    digest->buffer[digest->buffered].count = weight;
+    digest->buffered++;
+    digest->unmerged_weight += weight;
+
+    if (value < digest->min)
+        digest->min = value;
+    if (value > digest->max)
+        digest->max = value;
+}
+
+void
+merging_digest_compress(MergingDigest *digest)
+{
+    if (digest->buffered == 0) {
+        return;
+    }
+
+    memcpy(digest->buffer + digest->buffered, digest->centroids, sizeof(Centroid)*digest->active);
+
+    long n = digest->buffered + digest->active;
+    qsort(digest->buffer, n, sizeof(Centroid), centroid_compare);
+
+    double total = digest->total_weight + digest->unmerged_weight;
+    double so_far = 0;
+    long out = 0;
+    Centroid current = digest->buffer[0];
+
+    for (long i = 1; i < n; i++) {
+        Centroid next = digest->buffer[i];
+
+        if (merging_fits(digest, so_far, current.count + next.count, total)) {
+            current.count += next.count;
+            current.mean += (next.mean - current.mean) * next.count / current.count;
+        }
+        else {
+            // may move the buffer, so it's indexed afresh every time
+            if (out == digest->capacity)
+                merging_grow(digest);
+
+            so_far += current.count;
+            digest->centroids[out++] = current;
+            current = next;
+        }
+    }
+    if (out == digest->capacity)
+        merging_grow(digest);
+    digest->centroids[out++] = current;
+
+    digest->active = out;
+    digest->buffered = 0;
+    digest->total_weight += digest->unmerged_weight;
+    digest->unmerged_weight = 0;
+}
+
+static void
+merging_add_centroids(MergingDigest *digest, const Centroid *centroids, long n)
+{
+    for (long i = 0; i < n; i++) {
+        merging_digest_add(digest, centroids[i].mean, centroids[i].count);
+    }
+}
+
+void
+merging_digest_merge(MergingDigest *digest, MergingDigest *other)
+{
+    if (digest == other) {
+        // adding compresses into the very arrays being read, so read a copy
+        long n = other->active + other->buffered;
+        Centroid *centroids = (Centroid*)malloc(sizeof(Centroid)*(n ? n : 1));
+        if (centroids == NULL) {
+            rb_raise(rb_eNoMemError, "allocation of centroids failed");
+        }
+        memcpy(centroids, other->centroids, sizeof(Centroid)*other->active);
+        memcpy(centroids + other->active, other->buffer, sizeof(Centroid)*other->buffered);
+
+        merging_add_centroids(digest, centroids, n);
+        free(centroids);
+        return;
+    }
+
+    merging_add_centroids(digest, other->centroids, other->active);
+    merging_add_centroids(digest, other->buffer, other->buffered);
+
+    // the extremes may have been merged away into other's centroids
+    if (other->min < digest->min)
+        digest->min = other->min;
+    if (other->max > digest->max)
+        digest->max = other->max;
+}
+
+/*
+ * Each centroid's mean is taken to sit at the middle of its weight, and
+ * values in between are interpolated linearly. Below the first and above
+ * the last centroid, the observed minimum and maximum close the range.
+ */
+double
+merging_digest_quantile(MergingDigest *digest, double q)
+{
+    merging_digest_compress(digest);
+
+    long n = digest->active;
+    Centroid *c = digest->centroids;
+
+    if (n == 0) {
+        return NAN;
+    }
+    if (n == 1) {
+        return c[0].mean;
+    }
+
+    double total = digest->total_weight;
+    double index = q * total;
+
+    if (index < c[0].count / 2.0) {
+        return digest->min + (c[0].mean - digest->min) * index / (c[0].count / 2.0);
+    }
+
+    double so_far = c[0].count / 2.0;
+    for (long i = 0; i < n - 1; i++) {
+        double delta = (c[i].count + c[i + 1].count) / 2.0;
+
+        if (so_far + delta > index) {
+            double z = (index - so_far) / delta;
+            return c[i].mean + (c[i + 1].mean - c[i].mean) * z;
+        }
+        so_far += delta;
+    }
+
+    double half = c[n - 1].count / 2.0;
+    double z = (index - so_far) / half;
+    if (z > 1)
+        z = 1;
+    return c[n - 1].mean + (digest->max - c[n - 1].mean) * z;
+}
+
+double
+merging_digest_cdf(MergingDigest *digest, double x)
+{
+    merging_digest_compress(digest);
+
+    long n = digest->active;
+    Centroid *c = digest->centroids;
+
+    if (n == 0) {
+        return NAN;
+    }
+    if (x < digest->min) {
+        return 0;
+    }
+    if (x >= digest->max) {
+        return 1;
+    }
+    if (n == 1) {
+        return (x - digest->min) / (digest->max - digest->min);
+    }
+
+    double total = digest->total_weight;
+
+    if (x < c[0].mean) {
+        if (c[0].mean == digest->min)
+            return 0;
+        return c[0].count / 2.0 * (x - digest->min) / (c[0].mean - digest->min) / total;
+    }
+
+    double so_far = c[0].count / 2.0;
+    for (long i = 0; i < n - 1; i++) {
+        double delta = (c[i].count + c[i + 1].count) / 2.0;
+
+        if (x < c[i + 1].mean) {
+            return (so_far + delta * (x - c[i].mean) / (c[i + 1].mean - c[i].mean)) / total;
+        }
+        so_far += delta;
+    }
+
+    double half = c[n - 1].count / 2.0;
+    return (so_far + half * (x - c[n - 1].mean) / (digest->max - c[n - 1].mean)) / total;
+}
+
+static double
+merging_round(double value, long digits)
+{
+    double scale = pow(10, digits);
+    return round(value * scale) / scale;
+}
+
+// NUM2DBL raises TypeError for anything that isn't a number
+static double
+merging_value(VALUE rb_value)
+{
+    return NUM2DBL(rb_value);
+}
+
+static long
+merging_weight(VALUE rb_weight)
+{
+    if (NIL_P(rb_weight))
+        return 1;
+
+    long weight = NUM2LONG(rb_weight);
+    if (weight <= 0) {
+        rb_raise(rb_eArgError, "weight has to be positive");
+    }
+    return weight;
+}
+
+static VALUE
+merging_initialize(int argc, VALUE* argv, VALUE self)
+{
+    MergingDigest *digest;
+    Data_Get_Struct(self, MergingDigest, digest);
+
+    VALUE rb_compression;
+    rb_scan_args(argc, argv, "01", &rb_compression);
+
+    if (NIL_P(rb_compression))
+        rb_compression = rb_int2inum(DEFAULT_COMPRESSION);
+    double compression = NUM2DBL(rb_compression);
+
+    if (compression < 1) {
+        rb_raise(rb_eArgError, "compression has to be 1 or higher");
+    }
+
+    merging_digest_release(digest);
+    if (merging_digest_init(digest, compression) != 0) {
+        rb_raise(rb_eNoMemError, "allocation of centroids failed");
+    }
+
+    return self;
+}
+
+static void
+merging_free(void *ptr) {
+    if (0 == ptr) {
+        return;
+    }
+    merging_digest_release((MergingDigest*)ptr);
+    xfree(ptr);
+}
+
+static VALUE
+merging_allocate(VALUE klass)
+{
+    MergingDigest *digest;
+    VALUE res = Data_Make_Struct(klass, MergingDigest, 0, merging_free, digest);
+    return res;
+}
+
+static MergingDigest *
+merging_get_digest(VALUE self)
+{
+    MergingDigest *digest;
+    Data_Get_Struct(self, MergingDigest, digest);
+
+    if (digest->centroids == NULL) {
+        rb_raise(rb_eRuntimeError, "digest is not initialized");
+    }
+    return digest;
+}
+
+VALUE
+merging_add(int argc, VALUE *argv, VALUE self)
+{
+    VALUE rb_value, rb_weight;
+    rb_scan_args(argc, argv, "11", &rb_value, &rb_weight);
+
+    double value = merging_value(rb_value);
+    long weight = merging_weight(rb_weight);
+
+    merging_digest_add(merging_get_digest(self), value, weight);
+    return Qnil;
+}
+
+/*
+ * add for every value of an Array, each with a weight of 1, without
+ * going through method dispatch per sample.
+ */
+VALUE
+merging_add_many(VALUE self, VALUE rb_values)
+{
+    MergingDigest *digest = merging_get_digest(self);
+    Check_Type(rb_values, T_ARRAY);
+
+    for (long i = 0; i < RARRAY_LEN(rb_values); i++) {
+        merging_digest_add(digest, merging_value(rb_ary_entry(rb_values, i)), 1);
+    }
+    return Qnil;
+}
+
+VALUE
+merging_compress(VALUE self)
+{
+    merging_digest_compress(merging_get_digest(self));
+    return Qnil;
+}
+
+VALUE
+merging_merge_bang(VALUE self, VALUE rb_other)
+{
+    if (!rb_obj_is_kind_of(rb_other, rb_cMergingDigest)) {
+        rb_raise(rb_eTypeError, "other is not a merging digest");
+    }
+
+    merging_digest_merge(merging_get_digest(self), merging_get_digest(rb_other));
+    return self;
+}
+
+VALUE
+merging_quantile(VALUE self, VALUE rb_q)
+{
+    double q = NUM2DBL(rb_q);
+
+    if (q < 0 || q > 1) {
+        rb_raise(rb_eArgError, "q should be in [0,1], got %f", q);
+    }
+    return rb_float_new(merging_digest_quantile(merging_get_digest(self), q));
+}
+
+VALUE
+merging_cdf(VALUE self, VALUE rb_x)
+{
+    return rb_float_new(merging_digest_cdf(merging_get_digest(self), NUM2DBL(rb_x)));
+}
+
+VALUE
+merging_export(int argc, VALUE *argv, VALUE self)
+{
+    VALUE rb_round;
+    rb_scan_args(argc, argv, "01", &rb_round);
+
+    MergingDigest *digest = merging_get_digest(self);
+    merging_digest_compress(digest);
+
+    bool round = RTEST(rb_round);
+    long digits = round ? NUM2LONG(rb_round) : 0;
+
+    VALUE rb_centroids = rb_ary_new2(digest->active);
+    for (long i = 0; i < digest->active; i++) {
+        double mean = digest->centroids[i].mean;
+        if (round)
+            mean = merging_round(mean, digits);
+
+        rb_ary_push(rb_centroids, rb_assoc_new(rb_float_new(mean), rb_int2inum(digest->centroids[i].count)));
+    }
+    return rb_centroids;
+}
+
+VALUE
+merging_import(VALUE self, VALUE rb_centroids)
+{
+    Check_Type(rb_centroids, T_ARRAY);
+    MergingDigest *digest = merging_get_digest(self);
+
+    for (long i = 0; i < RARRAY_LEN(rb_centroids); i++) {
+        VALUE rb_centroid = rb_ary_entry(rb_centroids, i);
+        Check_Type(rb_centroid, T_ARRAY);
+
+        double mean = merging_value(rb_ary_entry(rb_centroid, 0));
+        long count = merging_weight(rb_ary_entry(rb_centroid, 1));
+        merging_digest_add(digest, mean, count);
+    }
+    return self;
+}
+
+VALUE
+merging_clear(VALUE self)
+{
+    merging_digest_clear(merging_get_digest(self));
+    return self;
+}
+
+VALUE
+merging_get_total_weight(VALUE self)
+{
+    MergingDigest *digest = merging_get_digest(self);
+    return rb_int2inum(digest->total_weight + digest->unmerged_weight);
+}
+
+VALUE
+merging_get_centroid_count(VALUE self)
+{
+    MergingDigest *digest = merging_get_digest(self);
+    merging_digest_compress(digest);
+
+    return rb_int2inum(digest->active);
+}
+
+VALUE
+merging_get_compression(VALUE self)
+{
+    return rb_float_new(merging_get_digest(self)->compression);
+}
+
+void
+Init_merging(void)
+{
+    rb_mXDigest = rb_define_module("XDigest");
+
+    // MergingDigestExtended
+    rb_cMergingDigest = rb_define_class_under(rb_mXDigest, "MergingDigestExtended", rb_cObject);
+    rb_define_alloc_func(rb_cMergingDigest, merging_allocate);
+    rb_define_method(rb_cMergingDigest, "initialize", merging_initialize, -1);
+    rb_define_method(rb_cMergingDigest, "add", merging_add, -1);
+    rb_define_method(rb_cMergingDigest, "add_many", merging_add_many, 1);
+    rb_define_method(rb_cMergingDigest, "compress", merging_compress, 0);
+    rb_define_method(rb_cMergingDigest, "merge!", merging_merge_bang, 1);
+    rb_define_method(rb_cMergingDigest, "quantile", merging_quantile, 1);
+    rb_define_method(rb_cMergingDigest, "cdf", merging_cdf, 1);
+    rb_define_method(rb_cMergingDigest, "export", merging_export, -1);
+    rb_define_method(rb_cMergingDigest, "import", merging_import, 1);
+    rb_define_method(rb_cMergingDigest, "clear", merging_clear, 0);
+    rb_define_method(rb_cMergingDigest, "total_weight", merging_get_total_weight, 0);
+    rb_define_method(rb_cMergingDigest, "centroid_count", merging_get_centroid_count, 0);
+    rb_define_method(rb_cMergingDigest, "compression", merging_get_compression, 0);
+}
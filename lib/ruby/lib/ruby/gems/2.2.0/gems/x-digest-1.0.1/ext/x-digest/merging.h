@@ -0,0 +1,45 @@
+#ifndef MERGING_H
+#define MERGING_H 1
+
+#include "ruby.h"
+
+typedef struct centroid {
+    double mean;
+    long count;
+} Centroid;
+
+/*
+ * Merging t-digest. Samples are appended to an unsorted buffer; when it
+ * fills, buffer and centroids are sorted together and swept once, merging
+ * neighbours for as long as the size bound allows. Nothing on the add path
+ * calls back into Ruby, and it only allocates when the centroids outgrow
+ * their array.
+ */
+typedef struct merging_digest {
+    double compression;
+    long capacity;
+    long active;
+    Centroid *centroids;
+    long buffer_size;
+    long buffered;
+    Centroid *buffer;
+    long total_weight;
+    long unmerged_weight;
+    double min;
+    double max;
+} MergingDigest;
+
+extern VALUE rb_cMergingDigest;
+
+int merging_digest_init(MergingDigest *digest, double compression);
+void merging_digest_release(MergingDigest *digest);
+void merging_digest_clear(MergingDigest *digest);
+void merging_digest_add(MergingDigest *digest, double value, long weight);
+void merging_digest_compress(MergingDigest *digest);
+void merging_digest_merge(MergingDigest *digest, MergingDigest *other);
+double merging_digest_quantile(MergingDigest *digest, double q);
+double merging_digest_cdf(MergingDigest *digest, double x);
+
+void Init_merging();
+
+#endif /* MERGING */
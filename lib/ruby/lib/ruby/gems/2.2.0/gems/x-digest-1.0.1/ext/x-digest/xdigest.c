@@ -2,6 +2,7 @@
 #include "page.h"
 #include "centroids.h"
 #include "counts.h"
+#include "merging.h"
 #include <stdbool.h>
 #include <time.h>
 #include <float.h>
@@ -540,4 +541,5 @@ Init_xdigest(void)
     Init_centroids();
     Init_counts();
     Init_page();
+    Init_merging();
 }
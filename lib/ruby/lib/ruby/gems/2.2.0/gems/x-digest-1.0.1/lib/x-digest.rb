@@ -1,9 +1,17 @@
 require 'x-digest/version'
 require 'x-digest/array_digest_optimized'
 require 'x-digest/array_digest'
+require 'x-digest/merging_digest'
 
 module XDigest
-    def self.create(ext: nil, **options)
+    # engine: :merging picks the all-native MergingDigest, which ignores ext
+    # and page_size. The array digests stay the default.
+    def self.create(ext: nil, engine: :array, **options)
+        if engine == :merging
+            options.delete :page_size
+            return MergingDigest.new **options
+        end
+
         if ext.nil?
             ext = case ENV['EXT']
             when '0'
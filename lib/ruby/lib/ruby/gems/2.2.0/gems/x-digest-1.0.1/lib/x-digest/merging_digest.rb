@@ -0,0 +1,39 @@
+require 'x-digest/centroid'
+require 'x-digest/xdigest'
+
+module XDigest
+    class ArgumentError < ::ArgumentError; end
+
+    # t-digest kept entirely in C. Samples are buffered and merged into the
+    # centroids in sorted batches, so add never calls back into Ruby.
+    class MergingDigest < MergingDigestExtended
+        @@compression = 100
+
+        def initialize(compression: @@compression)
+            super compression
+        end
+
+        def size
+            total_weight
+        end
+
+        def centroids
+            export.collect { |mean, count| Centroid.new mean, count }
+        end
+
+        def merge(other)
+            x = create_merging_digest
+            x.merge! self
+            x.merge! other
+            x
+        end
+
+        def export(round: false)
+            super round
+        end
+
+        def create_merging_digest
+            MergingDigest.new :compression => compression
+        end
+    end
+end
@@ -17,6 +17,11 @@ module XDigest
             tmp.shuffle.each { |i| add i.mean, i.count }
         end
 
+        def add_many(values)
+            values.each { |value| add value }
+            nil
+        end
+
         def size
             total_weight
         end
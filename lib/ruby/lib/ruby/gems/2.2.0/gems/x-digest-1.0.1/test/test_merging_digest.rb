@@ -0,0 +1,32 @@
+$LOAD_PATH.unshift File.expand_path('../../lib', __FILE__)
+
+require 'minitest/autorun'
+require 'x-digest'
+
+class TestMergingDigest < Minitest::Test
+    def test_self_merge
+        digest = XDigest::MergingDigest.new
+        200_000.times { |i| digest.add i / 200_000.0 }
+        median = digest.quantile 0.5
+
+        digest.merge! digest
+        assert_equal 400_000, digest.size
+        assert_in_delta median, digest.quantile(0.5), 0.01
+        assert_equal 400_000, digest.export.inject(0) { |sum, (_, count)| sum + count }
+    end
+
+    def test_weights
+        digest = XDigest::MergingDigest.new
+        digest.add 1.0
+        digest.add 2.0, 3
+        assert_equal 4, digest.size
+
+        assert_raises(ArgumentError) { digest.add 1.0, 0 }
+        assert_raises(ArgumentError) { digest.add 1.0, -1 }
+        assert_raises(ArgumentError) { digest.import [[1.0, 0]] }
+        assert_raises(TypeError) { digest.add 1.0, 'x' }
+        assert_raises(TypeError) { digest.add 'x' }
+        assert_raises(TypeError) { digest.add nil }
+        assert_equal 4, digest.size
+    end
+end